@@ -0,0 +1,219 @@
+#version 460 core
+
+// Tiled deferred lighting. Each work group lights one tile of the G-buffer: it first culls the point
+// and spot lights against the tile's frustum, then each invocation shades its own pixel using only
+// the lights that reach the tile.
+
+#include "include/lighting.glsl"
+
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+// Lights are culled once their attenuated colour falls below this level.
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+layout (std140) uniform Matrices
+{
+    mat4 view;
+    mat4 projection;
+};
+
+layout (binding = 0) uniform sampler2D gAlbedoSpecular;
+layout (binding = 1) uniform sampler2D gNormal;
+layout (binding = 2) uniform sampler2D gDepth;
+layout (binding = 0, rgba8) uniform writeonly image2D outputImage;
+
+uniform vec3 backgroundColour;
+
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+shared uint tilePointLightCount;
+shared uint tileSpotLightCount;
+shared uint tilePointLights[MAX_LIGHTS_PER_TILE];
+shared uint tileSpotLights[MAX_LIGHTS_PER_TILE];
+shared vec4 tilePlanes[4];
+shared float tileNear;
+shared float tileFar;
+shared mat4 inverseProjection;
+shared mat4 inverseView;
+
+// Gets the distance beyond which a light contributes less than LIGHT_CUTOFF, or a negative value if
+// it never does.
+float CalculateLightRadius(float constant, float linear, float quadratic, vec4 ambient, vec4 diffuse, vec4 specular)
+{
+    float brightness = max(max(ambient.r, ambient.g), ambient.b) +
+                       max(max(diffuse.r, diffuse.g), diffuse.b) +
+                       max(max(specular.r, specular.g), specular.b);
+
+    // Solve brightness / (constant + linear * d + quadratic * d^2) = LIGHT_CUTOFF for d.
+    float c = constant - brightness / LIGHT_CUTOFF;
+    if (c >= 0.0f) return -1.0f;
+
+    if (quadratic <= 0.0f)
+    {
+        return linear > 0.0f ? -c / linear : 3.4e38f;
+    }
+
+    return (-linear + sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+}
+
+// Determines whether a sphere in view space overlaps the tile's frustum.
+bool IsSphereInTile(vec3 centre, float radius)
+{
+    if (radius < 0.0f) return false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (dot(tilePlanes[i].xyz, centre) < -radius) return false;
+    }
+
+    return -centre.z + radius >= tileNear && -centre.z - radius <= tileFar;
+}
+
+// Unprojects a point from normalised device coordinates into view space.
+vec3 Unproject(vec3 ndc)
+{
+    vec4 position = inverseProjection * vec4(ndc, 1.0f);
+    return position.xyz / position.w;
+}
+
+void main()
+{
+    ivec2 size = textureSize(gDepth, 0);
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = pixel.x < size.x && pixel.y < size.y;
+    uint localIndex = gl_LocalInvocationIndex;
+
+    if (localIndex == 0)
+    {
+        tileMinDepth = 0xFFFFFFFFu;
+        tileMaxDepth = 0u;
+        tilePointLightCount = 0u;
+        tileSpotLightCount = 0u;
+        inverseProjection = inverse(projection);
+        inverseView = inverse(view);
+    }
+
+    barrier();
+
+    // Depths are positive, so their bit patterns sort in the same order as their values.
+    float depth = inside ? texelFetch(gDepth, pixel, 0).r : 1.0f;
+    if (depth < 1.0f)
+    {
+        atomicMin(tileMinDepth, floatBitsToUint(depth));
+        atomicMax(tileMaxDepth, floatBitsToUint(depth));
+    }
+
+    barrier();
+
+    // A tile with no geometry has nothing to light.
+    bool empty = tileMinDepth > tileMaxDepth;
+
+    if (localIndex == 0 && !empty)
+    {
+        vec2 tileMin = vec2(gl_WorkGroupID.xy * TILE_SIZE) / vec2(size) * 2.0f - 1.0f;
+        vec2 tileMax = vec2((gl_WorkGroupID.xy + 1) * TILE_SIZE) / vec2(size) * 2.0f - 1.0f;
+
+        vec3 corners[4] = vec3[4](
+            Unproject(vec3(tileMin.x, tileMin.y, 1.0f)),
+            Unproject(vec3(tileMax.x, tileMin.y, 1.0f)),
+            Unproject(vec3(tileMax.x, tileMax.y, 1.0f)),
+            Unproject(vec3(tileMin.x, tileMax.y, 1.0f)));
+        vec3 centre = Unproject(vec3((tileMin + tileMax) * 0.5f, 1.0f));
+
+        // The side planes pass through the camera, and are flipped to face into the tile.
+        for (int i = 0; i < 4; i++)
+        {
+            vec3 normal = normalize(cross(corners[i], corners[(i + 1) % 4]));
+            tilePlanes[i] = vec4(dot(normal, centre) < 0.0f ? -normal : normal, 0.0f);
+        }
+
+        tileNear = -Unproject(vec3(0.0f, 0.0f, uintBitsToFloat(tileMinDepth) * 2.0f - 1.0f)).z;
+        tileFar = -Unproject(vec3(0.0f, 0.0f, uintBitsToFloat(tileMaxDepth) * 2.0f - 1.0f)).z;
+    }
+
+    barrier();
+
+    if (!empty)
+    {
+        // The invocations of the tile share the lights between them.
+#ifndef NO_POINT_LIGHTS
+        for (uint i = localIndex; i < uint(pointLightsSize); i += TILE_SIZE * TILE_SIZE)
+        {
+            PointLight light = pointLights[i];
+            float radius = CalculateLightRadius(light.constant, light.linear, light.quadratic, light.ambient, light.diffuse, light.specular);
+
+            if (IsSphereInTile(vec3(view * vec4(light.position.xyz, 1.0f)), radius))
+            {
+                uint index = atomicAdd(tilePointLightCount, 1u);
+                if (index < MAX_LIGHTS_PER_TILE)
+                {
+                    tilePointLights[index] = i;
+                }
+            }
+        }
+#endif
+
+#ifndef NO_SPOT_LIGHTS
+        for (uint i = localIndex; i < uint(spotLightsSize); i += TILE_SIZE * TILE_SIZE)
+        {
+            SpotLight light = spotLights[i];
+            float radius = CalculateLightRadius(light.constant, light.linear, light.quadratic, light.ambient, light.diffuse, light.specular);
+
+            if (IsSphereInTile(vec3(view * vec4(light.position.xyz, 1.0f)), radius))
+            {
+                uint index = atomicAdd(tileSpotLightCount, 1u);
+                if (index < MAX_LIGHTS_PER_TILE)
+                {
+                    tileSpotLights[index] = i;
+                }
+            }
+        }
+#endif
+    }
+
+    barrier();
+
+    if (!inside) return;
+
+    if (depth >= 1.0f)
+    {
+        imageStore(outputImage, pixel, vec4(backgroundColour, 1.0f));
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5f) / vec2(size);
+    vec3 fragPos = vec3(inverseView * vec4(Unproject(vec3(uv, depth) * 2.0f - 1.0f), 1.0f));
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 diffuseColour = albedoSpecular.rgb;
+    vec3 specularColour = vec3(albedoSpecular.a);
+    vec3 norm = normalize(texelFetch(gNormal, pixel, 0).xyz);
+    vec3 viewDir = normalize(vec3(viewPos) - fragPos);
+
+    vec3 result = vec3(0.0f);
+
+#ifndef NO_DIRECTIONAL_LIGHT
+    result += CalculateDirectionalLight(directionalLight, norm, viewDir, diffuseColour, specularColour);
+#endif
+
+#ifndef NO_POINT_LIGHTS
+    uint pointLightCount = min(tilePointLightCount, uint(MAX_LIGHTS_PER_TILE));
+    for (uint i = 0; i < pointLightCount; i++)
+    {
+        result += CalculatePointLight(pointLights[tilePointLights[i]], norm, fragPos, viewDir, diffuseColour, specularColour);
+    }
+#endif
+
+#ifndef NO_SPOT_LIGHTS
+    uint spotLightCount = min(tileSpotLightCount, uint(MAX_LIGHTS_PER_TILE));
+    for (uint i = 0; i < spotLightCount; i++)
+    {
+        result += CalculateSpotLight(spotLights[tileSpotLights[i]], norm, fragPos, viewDir, diffuseColour, specularColour);
+    }
+#endif
+
+    imageStore(outputImage, pixel, vec4(result, 1.0f));
+}
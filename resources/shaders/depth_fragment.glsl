@@ -0,0 +1,6 @@
+#version 460 core
+
+// Only depth is written during the depth pre-pass.
+void main()
+{
+}
@@ -0,0 +1,17 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices
+{
+    mat4 view;
+    mat4 projection;
+};
+uniform mat4 model;
+
+// Must match model_vertex.glsl exactly, so the depth written here passes the depth test in the main pass.
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,26 @@
+#version 460 core
+
+// Writes the surface attributes that deferred_lighting.glsl lights later. Defining NO_SPECULAR_MAP
+// reuses the diffuse texture for specular colour, as in model_fragment.glsl.
+#include "include/material.glsl"
+
+in vec3 normal;
+in vec2 texCoords;
+in vec3 fragPos;
+
+layout (location = 0) out vec4 AlbedoSpecular;
+layout (location = 1) out vec4 Normal;
+
+void main()
+{
+    vec3 diffuseColour = vec3(SampleDiffuse(texCoords));
+#ifdef NO_SPECULAR_MAP
+    vec3 specularColour = diffuseColour * vec3(material.specularColour);
+#else
+    vec3 specularColour = vec3(SampleSpecular(texCoords));
+#endif
+
+    // Only the intensity of the specular colour is kept, in the alpha channel of the albedo.
+    AlbedoSpecular = vec4(diffuseColour, dot(specularColour, vec3(1.0f / 3.0f)));
+    Normal = vec4(normalize(normal), 0.0f);
+}
@@ -0,0 +1,142 @@
+// Light sources and the Lighting uniform block shared by lit shaders.
+//
+// Features can be compiled out by defining:
+//   NO_DIRECTIONAL_LIGHT - the scene has no directional light.
+//   NO_POINT_LIGHTS      - the scene has no point lights.
+//   NO_SPOT_LIGHTS       - the scene has no spot lights.
+//   POINT_LIGHT_COUNT    - a fixed number of point lights, so the loop can be unrolled.
+//   SPOT_LIGHT_COUNT     - a fixed number of spot lights, so the loop can be unrolled.
+
+struct DirectionalLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+struct PointLight
+{
+    vec4 position;
+    float constant;
+    float linear;
+    float quadratic;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+#define MAX_NO_POINT_LIGHTS 128
+
+struct SpotLight
+{
+    vec4 position;
+    vec4 direction;
+    float constant;
+    float linear;
+    float quadratic;
+    float innerCutOff;
+    float outerCutOff;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+#define MAX_NO_SPOT_LIGHTS 128
+
+layout (std140) uniform Lighting
+{
+    vec4 viewPos;
+    int pointLightsSize;
+    PointLight pointLights[MAX_NO_POINT_LIGHTS];
+    int spotLightsSize;
+    SpotLight spotLights[MAX_NO_SPOT_LIGHTS];
+    DirectionalLight directionalLight;
+};
+
+#ifndef POINT_LIGHT_COUNT
+#define POINT_LIGHT_COUNT pointLightsSize
+#endif
+
+#ifndef SPOT_LIGHT_COUNT
+#define SPOT_LIGHT_COUNT spotLightsSize
+#endif
+
+vec3 CalculateDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 diffuseColour, vec3 specularColour)
+{
+    vec3 lightDir = normalize(vec3(light.direction));
+
+    // Diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0f);
+
+    // Specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(reflectDir, viewDir), 0.0f), 32);
+
+    // Combine results
+    vec3 ambient = vec3(light.ambient) * diffuseColour;
+    vec3 diffuse = vec3(light.diffuse) * diff * diffuseColour;
+    vec3 specular = vec3(light.specular) * spec * specularColour;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColour, vec3 specularColour)
+{
+    vec3 lightDir = normalize(vec3(light.position) - fragPos);
+
+    // Diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0f);
+
+    // Specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+
+    // Attentuation
+    float distance = length(vec3(light.position) - fragPos);
+    float attentuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // Combine results
+    vec3 ambient = vec3(light.ambient) * diffuseColour;
+    vec3 diffuse = vec3(light.diffuse) * diff * diffuseColour;
+    vec3 specular = vec3(light.specular) * spec * specularColour;
+
+    ambient *= attentuation;
+    diffuse *= attentuation;
+    specular *= attentuation;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColour, vec3 specularColour)
+{
+    vec3 lightDir = normalize(vec3(light.position) - fragPos);
+
+    float theta = dot(lightDir, normalize(vec3(light.direction)));
+    float intensity = smoothstep(light.outerCutOff, light.innerCutOff, theta);
+
+    vec3 ambient = vec3(light.ambient) * diffuseColour;
+    vec3 diffuse, specular;
+
+    if (theta > light.outerCutOff)
+    {
+        // Do lighting calculation.
+
+        // Diffuse
+        float diff = max(dot(normal, lightDir), 0.0f);
+        diffuse = vec3(light.diffuse) * diff * diffuseColour;
+
+        // Specular
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+        specular = vec3(light.specular) * spec * specularColour;
+    }
+
+    // Attentuation
+    float distance = length(vec3(light.position) - fragPos);
+    float attentuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    ambient *= attentuation;
+    diffuse *= attentuation * intensity;
+    specular *= attentuation * intensity;
+
+    return (ambient + diffuse + specular);
+}
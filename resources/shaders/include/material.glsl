@@ -0,0 +1,59 @@
+// The material a draw is made with: its textures, selected from the material table through materialIndex
+// instead of being bound per draw, and its parameters. Must be included before any declarations, as it
+// enables an extension.
+//
+// With ARB_bindless_texture each table entry holds texture handles. Otherwise it holds the index of a texture
+// array pool and the layer within it, and the pools are bound to the first texture units. The bindings must
+// match src/rendering/material.h and src/rendering/material_texture_table.h.
+
+#extension GL_ARB_bindless_texture : enable
+
+#define MATERIAL_INDEX_LOCATION 0
+#define MATERIAL_PARAMETERS_BINDING 8
+#define MATERIAL_TABLE_BINDING 0
+#define MAX_TEXTURE_POOLS 16
+
+struct MaterialTextures
+{
+    uvec2 diffuse;
+    uvec2 specular;
+};
+
+layout (std430, binding = MATERIAL_TABLE_BINDING) readonly buffer MaterialTable
+{
+    MaterialTextures materials[];
+};
+
+layout (location = MATERIAL_INDEX_LOCATION) uniform uint materialIndex;
+
+// Colours that multiply the textures, which are white for empty slots.
+layout (std140, binding = MATERIAL_PARAMETERS_BINDING) uniform MaterialParameters
+{
+    vec4 diffuseColour;
+    vec4 specularColour;
+} material;
+
+#ifdef GL_ARB_bindless_texture
+vec4 SampleMaterialTexture(uvec2 entry, vec2 coordinates)
+{
+    return texture(sampler2D(entry), coordinates);
+}
+#else
+layout (binding = 0) uniform sampler2DArray texturePools[MAX_TEXTURE_POOLS];
+
+vec4 SampleMaterialTexture(uvec2 entry, vec2 coordinates)
+{
+    // The pool index comes from a uniform, so it is dynamically uniform as sampler array indexing requires.
+    return texture(texturePools[entry.x], vec3(coordinates, float(entry.y)));
+}
+#endif
+
+vec4 SampleDiffuse(vec2 coordinates)
+{
+    return SampleMaterialTexture(materials[materialIndex].diffuse, coordinates) * material.diffuseColour;
+}
+
+vec4 SampleSpecular(vec2 coordinates)
+{
+    return SampleMaterialTexture(materials[materialIndex].specular, coordinates) * material.specularColour;
+}
@@ -14,6 +14,9 @@ out vec3 normal;
 out vec2 texCoords;
 out vec3 fragPos;
 
+// Must match depth_vertex.glsl exactly, so the depth pre-pass and this pass produce the same depth.
+invariant gl_Position;
+
 void main()
 {
     normal = mat3(transpose(inverse(model))) * aNormal;
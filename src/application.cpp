@@ -11,17 +11,57 @@
 #include "rendering/camera_manager.h"
 #include "rendering/model.h"
 #include "rendering/lighting.h"
+#include "rendering/loader_thread.h"
+#include "rendering/material.h"
+#include "rendering/material_texture_table.h"
+#include "rendering/render_thread.h"
 #include "rendering/shader.h"
+#include "rendering/shader_cache.h"
+#include "rendering/texture_cache.h"
+#include "rendering/texture_streamer.h"
+#include "rendering/texture_uploader.h"
 
 #include "ecs/entity.h"
 
+#include "io/async_file_reader.h"
+#include "io/virtual_file_system.h"
+
+#include "utils/frame_clock.h"
+#include "utils/gl_extensions.h"
+#include "utils/gl_state.h"
+#include "utils/job_system.h"
 #include "utils/logging.h"
 #include "utils/profiling.h"
 
+#include <cmath>
 #include <stdexcept>
 
-#include "ecs/systems/lighting_system.h"
-#include "glm/gtc/type_ptr.hpp"
+constexpr const char* RESOURCE_ARCHIVE_PATH = "resources.pak";
+
+constexpr double STATISTICS_LOG_INTERVAL = 5.0;
+
+/**
+ * \brief Determines if frames are drawn on a dedicated render thread, overlapping the simulation of the
+ * next frame, rather than on the main thread after each simulation step.
+ */
+constexpr bool RENDER_ON_SEPARATE_THREAD = true;
+
+/**
+ * \brief Presents frames on every vertical blank, so the frame rate is capped at the display's refresh rate.
+ */
+constexpr int SWAP_INTERVAL = 1;
+
+/**
+ * \brief Lets the GPU queue up to one frame behind the one being drawn, which keeps it busy while adding
+ * at most a frame of latency.
+ */
+constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+
+/**
+ * \brief Determines if each frame is finished before input for the next is sampled, trading throughput
+ * for the lowest input latency.
+ */
+constexpr bool LOW_LATENCY_MODE = false;
 
 Application::Application()
 {
@@ -42,9 +82,24 @@ void Application::Initialise()
 {
     DFM_PROFILE_FUNCTION();
 
+    m_start_time = std::chrono::steady_clock::now();
+
     // Initialise logging
     Logging::Initialise();
 
+    // Start the worker threads of the job system, which background asset work also runs on.
+    Instrumentor::SetThreadName("Main");
+    JobSystem::Initialise();
+
+    // Read assets from the packed archive when one has been built, falling back to loose files.
+    if (VirtualFileSystem::Exists(RESOURCE_ARCHIVE_PATH))
+    {
+        VirtualFileSystem::Mount(RESOURCE_ARCHIVE_PATH);
+    }
+
+    // Start the IO thread that batches reads of loose asset files.
+    AsyncFileReader::Initialise();
+
     // Initialise GLFW.
     if (!glfwInit())
     {
@@ -64,11 +119,27 @@ void Application::Initialise()
         throw std::runtime_error{ "Failed to initialise GLAD." };
     }
 
+    GlExtensions::Initialise(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+    ShaderCache::Initialise();
+
+    // Queue shaders first, so the driver compiles them while the rest of the renderer starts up.
+    ResourceManager::QueueShader("model_shader", "resources/shaders/model_vertex.glsl", "resources/shaders/model_fragment.glsl");
+    ResourceManager::QueueShader("depth_shader", "resources/shaders/depth_vertex.glsl", "resources/shaders/depth_fragment.glsl");
+    ResourceManager::QueueShader("gbuffer_shader", "resources/shaders/model_vertex.glsl", "resources/shaders/gbuffer_fragment.glsl");
+    ResourceManager::PollShaders();
+
+    TextureUploader::Initialise();
+    TextureStreamer::Initialise();
+
+    // Start the loader thread, whose shared context uploads mesh buffers and textures while frames are drawn.
+    // Textures queued before it starts, such as the streamer's placeholder, are uploaded on it as well.
+    LoaderThread::Initialise(*m_window);
+
     const auto [width, height] = m_window->GetDimensions();
     glViewport(0, 0, width, height);
 
-    // Load shaders
-    const Shader shader = ResourceManager::LoadShader("model_shader", "resources/shaders/model_vertex.glsl", "resources/shaders/model_fragment.glsl");
+    // Wait for the shaders needed to configure the UBOs.
+    const Shader shader = ResourceManager::GetShader("model_shader");
 
     // Create UBOs
     Ubo matrices_ubo;
@@ -83,6 +154,10 @@ void Application::Initialise()
     lighting_ubo.Create();
     UboManager::Register("lighting", lighting_ubo);
 
+    UboManager::BindShaderBlocks(ResourceManager::GetShader("depth_shader"));
+    UboManager::BindShaderBlocks(ResourceManager::GetShader("gbuffer_shader"));
+    UboManager::BindShaderBlocks(ResourceManager::LoadComputeShader("deferred_lighting_shader", "resources/shaders/deferred_lighting.glsl"));
+
     // Initialise Cameras
     CameraManager::Initialise();
 
@@ -99,29 +174,30 @@ void Application::Run() const
     const Shader shader = ResourceManager::GetShader("model_shader");
     shader.Use();
 
-    Model cube_model{};
-    cube_model.Load("resources/models/cube/cube.fbx");
+    const auto cube_model = std::make_shared<Model>();
+    cube_model->Load("resources/models/cube/cube.fbx");
 
-    Model ball_model{};
-    ball_model.Load("resources/models/ball/ball.fbx");
+    const auto ball_model = std::make_shared<Model>();
+    ball_model->Load("resources/models/ball/ball.fbx");
 
     Scene scene;
+    scene.SetDepthPrePassEnabled(true);
 
     Entity cube_object = scene.CreateEntity("Cube 1");
     cube_object.AddComponent<MeshComponent>(cube_model);
-    cube_object.AddComponent<ShaderComponent>(shader);
+    cube_object.AddComponent<ShaderComponent>(shader, "model_shader");
     auto& cube_object_transform = cube_object.GetComponent<TransformComponent>();
     cube_object_transform.position = { -1.5f, 0.0f, 0.0f };
 
     Entity cube_object2 = scene.CreateEntity("Cube 2");
     cube_object2.AddComponent<MeshComponent>(cube_model);
-    cube_object2.AddComponent<ShaderComponent>(shader);
+    cube_object2.AddComponent<ShaderComponent>(shader, "model_shader");
     auto& cube_object2_transform = cube_object2.GetComponent<TransformComponent>();
     cube_object2_transform.position = { 0.0f, 0.0f, 5.0f };
 
     Entity ball_object = scene.CreateEntity("Ball 1");
     ball_object.AddComponent<MeshComponent>(ball_model);
-    ball_object.AddComponent<ShaderComponent>(shader);
+    ball_object.AddComponent<ShaderComponent>(shader, "model_shader");
     auto& ball_object_transform = ball_object.GetComponent<TransformComponent>();
     ball_object_transform.position = { 1.5f, 0.0f, 0.0f };
 
@@ -132,7 +208,7 @@ void Application::Run() const
 #if POINT_LIGHT
     Entity point_light_object = scene.CreateEntity("Point Light");
     point_light_object.AddComponent<MeshComponent>(cube_model);
-    point_light_object.AddComponent<ShaderComponent>(shader);
+    point_light_object.AddComponent<ShaderComponent>(shader, "model_shader");
     auto& point_light_component = point_light_object.AddComponent<LightComponent>();
     point_light_component.type = LightComponent::Type::Point;
     point_light_component.constant = 1.0f;
@@ -160,7 +236,7 @@ void Application::Run() const
 #if SPOT_LIGHT
     Entity spot_light_object = scene.CreateEntity("Spot Light");
     spot_light_object.AddComponent<MeshComponent>(cube_model);
-    spot_light_object.AddComponent<ShaderComponent>(shader);
+    spot_light_object.AddComponent<ShaderComponent>(shader, "model_shader");
     auto& spot_light_component = spot_light_object.AddComponent<LightComponent>();
     spot_light_component.type = LightComponent::Type::Spot;
     spot_light_component.constant = 1.0f;
@@ -179,22 +255,117 @@ void Application::Run() const
 
     glEnable(GL_DEPTH_TEST);
 
-    while (!m_window->ShouldClose())
-    {
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Everything that needs the GL context on this thread has been created, so it can be handed over.
+    RenderThread::Initialise(m_window, RENDER_ON_SEPARATE_THREAD, FramePacing{ SWAP_INTERVAL, FRAMES_IN_FLIGHT, LOW_LATENCY_MODE });
 
-        // TODO: Calculate the actual delta time and pass this as a parameter.
-        scene.Update(0.1);
+    FrameClock frame_clock;
 
-        // Update entities
-        cube_object_transform.rotation = { 0.0f, static_cast<float>(glfwGetTime()) * 10.0f, 0.0f };
-        point_light_object_transform.position = { sin(static_cast<float>(glfwGetTime())) * 5.0f, 0.0f, cos(static_cast<float>(glfwGetTime())) * 5.0f };
-        scene.UpdateLightSources(LightUpdateType::All);
+    bool first_frame = true;
+    bool render_path_key_down = false;
+    double last_statistics_time = glfwGetTime();
 
+    while (!m_window->ShouldClose())
+    {
+        // Input is sampled here, which frame latency is measured from.
+        RenderThread::PrepareInput();
         glfwPollEvents();
-        m_window->SwapBuffers();
+
+        // F2 switches between the forward and deferred render paths.
+        if (const bool key_down = m_window->IsKeyPressed(GLFW_KEY_F2); key_down != render_path_key_down)
+        {
+            render_path_key_down = key_down;
+
+            if (key_down)
+            {
+                scene.SetRenderPath(scene.GetRenderPath() == RenderPath::Forward ? RenderPath::Deferred : RenderPath::Forward);
+                DFM_CORE_INFO("Switched to the {0} render path.", scene.GetRenderPath() == RenderPath::Forward ? "forward" : "deferred");
+            }
+        }
+
+        // The scene writes the frame into a snapshot, which is drawn while the next frame is simulated.
+        RenderSnapshot& snapshot = RenderThread::BeginFrame();
+
+        // Simulate in fixed steps for the real time that has passed, so entities move at the same speed at
+        // any frame rate.
+        frame_clock.Tick();
+
+        while (frame_clock.Step())
+        {
+            scene.FixedUpdate(frame_clock.GetFixedStep());
+
+            // Update entities
+            const auto time = static_cast<float>(frame_clock.GetSimulationTime());
+            cube_object_transform.rotation = { 0.0f, time * 10.0f, 0.0f };
+            point_light_object_transform.position = { std::sin(time) * 5.0f, 0.0f, std::cos(time) * 5.0f };
+        }
+
+        scene.Extract(frame_clock.GetDeltaTime(), frame_clock.GetInterpolation(), snapshot);
+        RenderThread::Submit();
+
+        // Frames are counted once presented, so the time to the first frame includes drawing it on either thread.
+        if (first_frame && RenderThread::GetStatistics().frames > 0)
+        {
+            first_frame = false;
+
+            const auto time_to_first_frame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start_time);
+            const ShaderCacheStatistics shader_statistics = ShaderCache::GetStatistics();
+            DFM_CORE_INFO("Time to first frame: {0:.2f} ms ({1} shader programs loaded from cache, {2} compiled).",
+                time_to_first_frame.count(), shader_statistics.hits, shader_statistics.misses);
+        }
+
+        if (glfwGetTime() - last_statistics_time >= STATISTICS_LOG_INTERVAL)
+        {
+            last_statistics_time = glfwGetTime();
+
+            const FrameStatistics frame_statistics = RenderThread::GetStatistics();
+            DFM_CORE_INFO("Frames ({0}): {1:.1f} per second, {2:.2f} ms latency; simulation {3:.2f} ms, "
+                "waiting for the renderer {4:.2f} ms, rendering {5:.2f} ms.",
+                RenderThread::IsThreaded() ? "render thread" : "main thread", frame_statistics.frames_per_second,
+                frame_statistics.latency_milliseconds, frame_statistics.simulation_milliseconds,
+                frame_statistics.wait_milliseconds, frame_statistics.render_milliseconds);
+
+            const FrameTimeHistogram& cpu_histogram = frame_statistics.cpu_histogram;
+            const FrameTimeHistogram& gpu_histogram = frame_statistics.gpu_histogram;
+            DFM_CORE_INFO("Frame times: CPU {0:.2f} ms (p50 {1} ms, p95 {2} ms, p99 {3} ms); GPU {4:.2f} ms "
+                "(p50 {5} ms, p95 {6} ms, p99 {7} ms).",
+                frame_statistics.cpu_milliseconds, cpu_histogram.GetPercentile(0.5), cpu_histogram.GetPercentile(0.95),
+                cpu_histogram.GetPercentile(0.99), frame_statistics.gpu_milliseconds, gpu_histogram.GetPercentile(0.5),
+                gpu_histogram.GetPercentile(0.95), gpu_histogram.GetPercentile(0.99));
+
+            const FrameTimeHistogram& latency_histogram = frame_statistics.present_latency_histogram;
+            DFM_CORE_INFO("Input to present latency: {0:.2f} ms (p50 {1} ms, p99 {2} ms) with {3} frames in flight{4}.",
+                frame_statistics.present_latency_milliseconds, latency_histogram.GetPercentile(0.5),
+                latency_histogram.GetPercentile(0.99), FRAMES_IN_FLIGHT, LOW_LATENCY_MODE ? " in low-latency mode" : "");
+
+            const FrameClockStatistics clock_statistics = frame_clock.GetStatistics();
+            DFM_CORE_INFO("Simulation: {0} fixed steps of {1:.2f} ms in {2} frames, {3} steps dropped to catch up.",
+                clock_statistics.fixed_steps, frame_clock.GetFixedStep() * 1000.0, clock_statistics.frames,
+                clock_statistics.dropped_steps);
+
+            const DepthPrePassStatistics& depth_statistics = frame_statistics.depth_pre_pass;
+            DFM_CORE_INFO("Depth pre-pass {0}: {1} fragments shaded, {2} saved ({3}).",
+                scene.IsDepthPrePassEnabled() ? "on" : "off", depth_statistics.fragments_shaded, depth_statistics.fragments_saved,
+                depth_statistics.counting_invocations ? "fragment shader invocations" : "samples passed");
+
+            const GlStateStatistics& state_statistics = frame_statistics.gl_state;
+            DFM_CORE_INFO("GL binds skipped last frame: {0}/{1} programs, {2}/{3} vertex arrays, {4}/{5} buffers, "
+                "{6}/{7} textures, {8}/{9} samplers.",
+                state_statistics.programs.skipped, state_statistics.programs.issued + state_statistics.programs.skipped,
+                state_statistics.vertex_arrays.skipped, state_statistics.vertex_arrays.issued + state_statistics.vertex_arrays.skipped,
+                state_statistics.buffers.skipped, state_statistics.buffers.issued + state_statistics.buffers.skipped,
+                state_statistics.textures.skipped, state_statistics.textures.issued + state_statistics.textures.skipped,
+                state_statistics.samplers.skipped, state_statistics.samplers.issued + state_statistics.samplers.skipped);
+
+            for (const SystemTiming& timing : scene.GetSystemTimings())
+            {
+                DFM_CORE_INFO("System {0}: {1:.3f} ms last frame, {2:.3f} ms on average ({3}).", timing.name,
+                    timing.milliseconds, timing.average_milliseconds, timing.main_thread ? "main thread" : "worker");
+            }
+        }
     }
+
+    // Take the GL context back before the scene and its models are released.
+    RenderThread::Shutdown();
 }
 
 /**
@@ -203,5 +374,14 @@ void Application::Run() const
 void Application::Dispose()
 {
     DFM_PROFILE_FUNCTION();
+    LoaderThread::Shutdown();
+    MaterialManager::Shutdown();
+    MaterialTextureTable::Shutdown();
+    TextureStreamer::Shutdown();
+    TextureCache::Clear();
+    TextureUploader::Shutdown();
+    AsyncFileReader::Shutdown();
+    JobSystem::Shutdown();
+    VirtualFileSystem::UnmountAll();
     glfwTerminate();
 }
\ No newline at end of file
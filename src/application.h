@@ -8,6 +8,7 @@
 #include "glad/glad.h"
 #include "glfw_window.h"
 
+#include <chrono>
 #include <memory>
 
 /**
@@ -42,6 +43,11 @@ public:
 
 private:
     std::shared_ptr<GlfwWindow> m_window;
+
+    /**
+     * \brief The time at which initialisation started, used to report the time to the first frame.
+     */
+    std::chrono::steady_clock::time_point m_start_time;
 };
 
 #endif // APPLICATION_H
\ No newline at end of file
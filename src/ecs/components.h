@@ -7,11 +7,15 @@
 
 #include "ecs/uuid.h"
 
+#include "glm/common.hpp"
 #include "glm/vec3.hpp"
 
 #include "rendering/model.h"
 #include "rendering/shader.h"
 
+#include <memory>
+#include <string>
+
 /**
  * \brief Represents a universally-unique-identifier (UUID) used to identify an entity.
  */
@@ -39,11 +43,42 @@ struct TransformComponent
 };
 
 /**
- * \brief Represents the 3D mesh used to draw an entity.
+ * \brief Represents the world-space transformation of the entity at the end of the previous fixed
+ * simulation step. Entities are drawn between it and their current transform, so their motion is smooth
+ * at frame rates that are not a multiple of the simulation rate.
+ */
+struct PreviousTransformComponent
+{
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+};
+
+/**
+ * \brief Blends an entity's previous and current transforms. Rotations are blended per Euler angle, so an
+ * angle that wraps around between two steps turns the long way.
+ * \param previous The transform at the end of the previous step.
+ * \param current The transform at the end of the current step.
+ * \param interpolation How far to blend towards the current transform, from 0 to 1.
+ * \return The blended transform.
+ */
+inline TransformComponent InterpolateTransform(const PreviousTransformComponent& previous, const TransformComponent& current,
+                                               const float interpolation)
+{
+    return TransformComponent{
+        glm::mix(previous.position, current.position, interpolation),
+        glm::mix(previous.rotation, current.rotation, interpolation),
+        glm::mix(previous.scale, current.scale, interpolation)
+    };
+}
+
+/**
+ * \brief Represents the 3D mesh used to draw an entity. Models are shared between the entities that
+ * draw them and the render snapshots they are drawn from.
  */
 struct MeshComponent
 {
-    Model model;
+    std::shared_ptr<const Model> model;
 };
 
 /**
@@ -52,6 +87,12 @@ struct MeshComponent
 struct ShaderComponent
 {
     Shader shader;
+
+    /**
+     * \brief The name of the shader in the resource manager. When set, the cheapest variant of the shader
+     * that suits the scene's lights and the entity's textures is used in its place.
+     */
+    std::string name;
 };
 
 /**
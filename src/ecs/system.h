@@ -5,6 +5,101 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * \brief The phases of a frame that systems run in. Every system of a phase finishes before any system
+ * of a later phase starts.
+ */
+enum class SystemPhase
+{
+    /**
+     * \brief Simulation phases, run for every fixed step with the step's length as the delta time.
+     */
+    PreUpdate,
+    Update,
+
+    /**
+     * \brief Render phases, run once per frame with the real delta time to write the render snapshot.
+     */
+    PreRender,
+    Render
+};
+
+/**
+ * \brief Describes when a system runs and which components it touches, which the \code SystemManager
+ * uses to run systems that do not conflict at the same time.
+ */
+struct SystemDescriptor
+{
+    /**
+     * \brief The name the system is reported and profiled under. The system's type name is used when empty.
+     */
+    std::string name;
+
+    SystemPhase phase{ SystemPhase::Update };
+
+    /**
+     * \brief The type hashes of the components the system reads. A system that declares no components is
+     * assumed to conflict with every other system of its phase.
+     */
+    std::vector<size_t> reads;
+
+    /**
+     * \brief The type hashes of the components the system writes.
+     */
+    std::vector<size_t> writes;
+
+    /**
+     * \brief The type hashes of the systems of the same phase that must finish before the system starts.
+     */
+    std::vector<size_t> run_after;
+
+    /**
+     * \brief Determines if the system must run on the main thread, such as when it polls the window. Systems
+     * must not make GL calls, as the GL context may be current on the render thread.
+     */
+    bool main_thread{ true };
+
+    /**
+     * \brief Adds components that the system reads.
+     * \tparam T The types of the components.
+     * \return The descriptor.
+     */
+    template <typename... T>
+    SystemDescriptor& Reads()
+    {
+        (reads.push_back(typeid(T).hash_code()), ...);
+        return *this;
+    }
+
+    /**
+     * \brief Adds components that the system writes.
+     * \tparam T The types of the components.
+     * \return The descriptor.
+     */
+    template <typename... T>
+    SystemDescriptor& Writes()
+    {
+        (writes.push_back(typeid(T).hash_code()), ...);
+        return *this;
+    }
+
+    /**
+     * \brief Adds systems of the same phase that must finish before the system starts.
+     * \tparam T The types of the systems.
+     * \return The descriptor.
+     */
+    template <typename... T>
+    SystemDescriptor& RunsAfter()
+    {
+        (run_after.push_back(typeid(T).hash_code()), ...);
+        return *this;
+    }
+};
+
 class ISystem
 {
 public:
@@ -18,6 +113,16 @@ public:
 
     virtual ~ISystem() = default;
     virtual void Update(const double dt) = 0;
+
+    /**
+     * \brief Describes when the system runs and which components it touches. Systems that do not override
+     * this run on the main thread in the update phase, one at a time.
+     * \return The system's descriptor.
+     */
+    [[nodiscard]] virtual SystemDescriptor Describe() const
+    {
+        return {};
+    }
 };
 
-#endif // SYSTEM_H
\ No newline at end of file
+#endif // SYSTEM_H
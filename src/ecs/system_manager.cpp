@@ -3,15 +3,324 @@
  */
 
 #include "ecs/system_manager.h"
+#include "utils/job_system.h"
+#include "utils/profiling.h"
 
- /**
-  * \brief Updates each of the registered systems using the given delta time.
-  * \param dt The delta time.
-  */
-void SystemManager::Update(const double dt)
+#include <chrono>
+#include <thread>
+
+/**
+ * \brief How much the most recent frame contributes to a system's average time.
+ */
+constexpr double TIMING_AVERAGE_WEIGHT = 0.05;
+
+/**
+ * \brief Updates the registered systems of a range of phases using the given delta time, and waits for
+ * them all. Systems of other phases are not run, and are not waited for.
+ * \param dt The delta time.
+ * \param first_phase The first phase to run.
+ * \param last_phase The last phase to run.
+ */
+void SystemManager::Update(const double dt, const SystemPhase first_phase, const SystemPhase last_phase)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (m_systems.empty()) return;
+
+    if (m_schedule_dirty)
+    {
+        BuildSchedule();
+    }
+
+    // Systems are ordered by phase, so the phases run are a contiguous part of the schedule.
+    size_t begin = 0;
+    while (begin < m_systems.size() && m_systems[begin].descriptor.phase < first_phase)
+    {
+        begin++;
+    }
+
+    size_t end = begin;
+    while (end < m_systems.size() && m_systems[end].descriptor.phase <= last_phase)
+    {
+        end++;
+    }
+
+    if (begin == end) return;
+
+    FrameState& frame = *m_frame;
+    frame.finished.store(0, std::memory_order_relaxed);
+    frame.end = end;
+
+    // Only the dependencies between the systems being run are waited for.
+    for (size_t i = begin; i < end; i++)
+    {
+        frame.remaining[i].store(0, std::memory_order_relaxed);
+    }
+
+    for (size_t i = begin; i < end; i++)
+    {
+        for (const size_t successor : m_systems[i].successors)
+        {
+            if (successor < end)
+            {
+                frame.remaining[successor].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (size_t i = begin; i < end; i++)
+    {
+        if (frame.remaining[i].load(std::memory_order_relaxed) == 0)
+        {
+            Dispatch(i, dt);
+        }
+    }
+
+    // The main thread runs its own systems as they become ready, and helps the workers in between.
+    while (frame.finished.load(std::memory_order_acquire) < end - begin)
+    {
+        size_t index = m_systems.size();
+
+        {
+            std::lock_guard lock{ frame.mutex };
+
+            // The earliest ready system runs first, so the order only depends on the schedule.
+            if (const auto first = std::min_element(frame.main_thread_ready.begin(), frame.main_thread_ready.end());
+                first != frame.main_thread_ready.end())
+            {
+                index = *first;
+                frame.main_thread_ready.erase(first);
+            }
+        }
+
+        if (index < m_systems.size())
+        {
+            RunSystem(index, dt);
+        }
+        else if (!JobSystem::TryRunJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * \brief Gets how long each system took to update, in the order the systems are scheduled.
+ * \return The timings of the systems.
+ */
+std::vector<SystemTiming> SystemManager::GetTimings() const
+{
+    std::vector<SystemTiming> timings;
+    timings.reserve(m_systems.size());
+
+    for (const auto& registered : m_systems)
+    {
+        timings.push_back(SystemTiming{
+            registered.descriptor.name,
+            registered.descriptor.phase,
+            registered.descriptor.main_thread,
+            registered.milliseconds,
+            registered.average_milliseconds
+        });
+    }
+
+    return timings;
+}
+
+/**
+ * \brief Orders the systems and works out which systems each one waits for.
+ */
+void SystemManager::BuildSchedule()
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (auto& registered : m_systems)
+    {
+        registered.descriptor = registered.system->Describe();
+
+        if (registered.descriptor.name.empty())
+        {
+            registered.descriptor.name = registered.type_name;
+        }
+
+        registered.successors.clear();
+        registered.dependency_count = 0;
+    }
+
+    // Phases come first, and the registration order breaks ties within a phase.
+    std::stable_sort(m_systems.begin(), m_systems.end(), [](const RegisteredSystem& a, const RegisteredSystem& b)
+    {
+        return a.descriptor.phase < b.descriptor.phase;
+    });
+
+    // Within each phase, move systems after the systems they are declared to run after, keeping the
+    // registration order wherever the constraints allow.
+    std::vector<RegisteredSystem> ordered;
+    ordered.reserve(m_systems.size());
+
+    for (size_t phase_begin = 0; phase_begin < m_systems.size();)
+    {
+        size_t phase_end = phase_begin;
+        while (phase_end < m_systems.size() && m_systems[phase_end].descriptor.phase == m_systems[phase_begin].descriptor.phase)
+        {
+            phase_end++;
+        }
+
+        std::vector<bool> placed(phase_end - phase_begin, false);
+
+        const auto is_waiting = [&](const RegisteredSystem& registered)
+        {
+            for (const size_t type : registered.descriptor.run_after)
+            {
+                for (size_t i = phase_begin; i < phase_end; i++)
+                {
+                    if (m_systems[i].type == type && !placed[i - phase_begin])
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        };
+
+        for (size_t remaining = phase_end - phase_begin; remaining > 0; remaining--)
+        {
+            size_t next = phase_end;
+
+            for (size_t i = phase_begin; i < phase_end; i++)
+            {
+                if (!placed[i - phase_begin] && !is_waiting(m_systems[i]))
+                {
+                    next = i;
+                    break;
+                }
+            }
+
+            // The constraints form a cycle, which is broken at the earliest registered system.
+            if (next == phase_end)
+            {
+                next = phase_begin + static_cast<size_t>(std::find(placed.begin(), placed.end(), false) - placed.begin());
+                DFM_CORE_ERROR("System {0} is part of a cycle of ordering constraints.", m_systems[next].descriptor.name);
+            }
+
+            placed[next - phase_begin] = true;
+            ordered.push_back(std::move(m_systems[next]));
+        }
+
+        phase_begin = phase_end;
+    }
+
+    m_systems = std::move(ordered);
+
+    // Every earlier system that a system must not overlap with becomes one of its dependencies. Systems of
+    // earlier phases always are, and so are earlier systems it conflicts with or is declared to run after.
+    for (size_t j = 0; j < m_systems.size(); j++)
+    {
+        const SystemDescriptor& later = m_systems[j].descriptor;
+
+        for (size_t i = 0; i < j; i++)
+        {
+            const SystemDescriptor& earlier = m_systems[i].descriptor;
+            const bool declared = std::find(later.run_after.begin(), later.run_after.end(), m_systems[i].type) != later.run_after.end();
+
+            if (earlier.phase != later.phase || declared || Conflicts(earlier, later))
+            {
+                m_systems[i].successors.push_back(j);
+                m_systems[j].dependency_count++;
+            }
+        }
+    }
+
+    m_frame = std::make_unique<FrameState>();
+    m_frame->remaining = std::make_unique<std::atomic<uint32_t>[]>(m_systems.size());
+    m_schedule_dirty = false;
+
+    for (const auto& registered : m_systems)
+    {
+        DFM_CORE_INFO("System {0} waits for {1} other systems and runs on {2}.", registered.descriptor.name,
+            registered.dependency_count, registered.descriptor.main_thread ? "the main thread" : "any thread");
+    }
+}
+
+/**
+ * \brief Hands a system whose dependencies have finished to the thread it runs on.
+ * \param index The index of the system.
+ * \param dt The delta time.
+ */
+void SystemManager::Dispatch(const size_t index, const double dt)
+{
+    if (m_systems[index].descriptor.main_thread || JobSystem::GetWorkerCount() == 0)
+    {
+        std::lock_guard lock{ m_frame->mutex };
+        m_frame->main_thread_ready.push_back(index);
+        return;
+    }
+
+    JobSystem::Run([this, index, dt] { RunSystem(index, dt); });
+}
+
+/**
+ * \brief Updates a system, then dispatches the systems that were only waiting for it.
+ * \param index The index of the system.
+ * \param dt The delta time.
+ */
+void SystemManager::RunSystem(const size_t index, const double dt)
 {
-    for (const auto& [_, value] : m_registry)
+    RegisteredSystem& registered = m_systems[index];
+
+    {
+        DFM_PROFILE_SCOPE(registered.descriptor.name);
+
+        const auto start_timepoint = std::chrono::steady_clock::now();
+        registered.system->Update(dt);
+
+        registered.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_timepoint).count();
+        registered.average_milliseconds += (registered.milliseconds - registered.average_milliseconds) * TIMING_AVERAGE_WEIGHT;
+    }
+
+    for (const size_t successor : registered.successors)
     {
-        value.get()->Update(dt);
+        // Successors are in schedule order, so the rest belong to phases that are not being run.
+        if (successor >= m_frame->end) break;
+
+        if (m_frame->remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Dispatch(successor, dt);
+        }
     }
-}
\ No newline at end of file
+
+    m_frame->finished.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * \brief Determines whether two systems touch the same components, with at least one of them writing.
+ * \param a The descriptor of the first system.
+ * \param b The descriptor of the second system.
+ * \return A boolean value indicating if the systems must not run at the same time.
+ */
+bool SystemManager::Conflicts(const SystemDescriptor& a, const SystemDescriptor& b)
+{
+    // Systems that declare nothing may touch anything.
+    if ((a.reads.empty() && a.writes.empty()) || (b.reads.empty() && b.writes.empty()))
+    {
+        return true;
+    }
+
+    const auto contains = [](const std::vector<size_t>& types, const size_t type)
+    {
+        return std::find(types.begin(), types.end(), type) != types.end();
+    };
+
+    for (const size_t type : a.writes)
+    {
+        if (contains(b.reads, type) || contains(b.writes, type)) return true;
+    }
+
+    for (const size_t type : b.writes)
+    {
+        if (contains(a.reads, type)) return true;
+    }
+
+    return false;
+}
@@ -9,22 +9,54 @@
 
 #include "utils/logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <unordered_map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
 
 class Scene;
 
 /**
- * \brief Manages systems used to act upon components.
+ * \brief How long a system took to update.
+ */
+struct SystemTiming
+{
+    std::string name;
+    SystemPhase phase;
+    bool main_thread;
+
+    /**
+     * \brief The time the system took in the most recent frame, in milliseconds.
+     */
+    double milliseconds;
+
+    /**
+     * \brief The time the system took averaged over recent frames, in milliseconds.
+     */
+    double average_milliseconds;
+};
+
+/**
+ * \brief Manages systems used to act upon components. Systems are ordered by phase, then by their explicit
+ * ordering constraints and the order they were registered in. Systems whose components do not conflict
+ * run at the same time on the job system's workers, while conflicting systems run in that order.
  */
 class SystemManager
 {
 public:
     /**
-     * \brief Updates each of the registered systems using the given delta time.
+     * \brief Updates the registered systems of a range of phases using the given delta time, and waits for
+     * them all. Systems of other phases are not run, and are not waited for.
      * \param dt The delta time.
+     * \param first_phase The first phase to run.
+     * \param last_phase The last phase to run.
      */
-    void Update(double dt);
+    void Update(double dt, SystemPhase first_phase = SystemPhase::PreUpdate, SystemPhase last_phase = SystemPhase::Render);
 
     /**
      * \brief Registers a system to the system registry.
@@ -34,8 +66,9 @@ public:
     template <typename T>
     void RegisterSystem(Scene* scene)
     {
-        const std::shared_ptr<ISystem> type_ptr = std::make_shared<T>(scene);
-        m_registry[typeid(T).hash_code()] = type_ptr;
+        RemoveSystem<T>();
+        m_systems.push_back(RegisteredSystem{ typeid(T).hash_code(), typeid(T).name(), std::make_shared<T>(scene), {}, {}, 0, 0.0, 0.0 });
+        m_schedule_dirty = true;
     }
 
     /**
@@ -45,22 +78,125 @@ public:
     template <typename T>
     void RemoveSystem()
     {
-        m_registry.erase(typeid(T).hash_code());
+        const size_t type = typeid(T).hash_code();
+        const auto search = std::find_if(m_systems.begin(), m_systems.end(), [type](const RegisteredSystem& registered)
+        {
+            return registered.type == type;
+        });
+
+        if (search != m_systems.end())
+        {
+            m_systems.erase(search);
+            m_schedule_dirty = true;
+        }
     }
 
     /**
      * \brief Gets a reference to the given system in the registry.
      * \tparam T The type of system to retrieve.
      * \return The retrieved system.
+     * \throws std::out_of_range If the system is not registered.
      */
     template <typename T>
     T& GetSystem()
     {
-        return *(static_cast<T*>(m_registry.at(typeid(T).hash_code()).get()));
+        const size_t type = typeid(T).hash_code();
+
+        for (const auto& registered : m_systems)
+        {
+            if (registered.type == type)
+            {
+                return *(static_cast<T*>(registered.system.get()));
+            }
+        }
+
+        throw std::out_of_range{ std::string{ "System is not registered: " } + typeid(T).name() };
     }
 
+    /**
+     * \brief Gets how long each system took to update, in the order the systems are scheduled.
+     * \return The timings of the systems.
+     */
+    [[nodiscard]] std::vector<SystemTiming> GetTimings() const;
+
 private:
-    std::unordered_map<size_t, std::shared_ptr<ISystem>> m_registry;
+    /**
+     * \brief A registered system and its place in the schedule.
+     */
+    struct RegisteredSystem
+    {
+        size_t type;
+        std::string type_name;
+        std::shared_ptr<ISystem> system;
+        SystemDescriptor descriptor;
+
+        /**
+         * \brief The indices of the systems that wait for this one.
+         */
+        std::vector<size_t> successors;
+
+        /**
+         * \brief The number of systems this one waits for.
+         */
+        uint32_t dependency_count;
+
+        double milliseconds;
+        double average_milliseconds;
+    };
+
+    /**
+     * \brief The progress of the systems through the current frame.
+     */
+    struct FrameState
+    {
+        /**
+         * \brief The number of unfinished systems that each system still waits for.
+         */
+        std::unique_ptr<std::atomic<uint32_t>[]> remaining;
+
+        /**
+         * \brief The indices of main thread systems that are ready to run.
+         */
+        std::vector<size_t> main_thread_ready;
+        std::mutex mutex;
+        std::atomic<size_t> finished;
+
+        /**
+         * \brief One past the index of the last system run this frame.
+         */
+        size_t end;
+    };
+
+    std::vector<RegisteredSystem> m_systems;
+    std::unique_ptr<FrameState> m_frame;
+    bool m_schedule_dirty{ true };
+
+    /**
+     * \brief Orders the systems and works out which systems each one waits for.
+     */
+    void BuildSchedule();
+
+    /**
+     * \brief Hands a system whose dependencies have finished to the thread it runs on.
+     * \param index The index of the system.
+     * \param dt The delta time.
+     */
+    void Dispatch(size_t index, double dt);
+
+    /**
+     * \brief Updates a system, then dispatches the systems that were only waiting for it.
+     * \param index The index of the system.
+     * \param dt The delta time.
+     */
+    void RunSystem(size_t index, double dt);
+
+    /**
+     * \brief Determines whether two systems touch the same components, with at least one of them writing.
+     * \param a The descriptor of the first system.
+     * \param b The descriptor of the second system.
+     * \return A boolean value indicating if the systems must not run at the same time.
+     */
+    [[nodiscard]] static bool Conflicts(const SystemDescriptor& a, const SystemDescriptor& b);
 };
 
-#endif // SYSTEM_MANAGER_H
\ No newline at end of file
+#endif // SYSTEM_MANAGER_H
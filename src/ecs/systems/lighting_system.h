@@ -9,17 +9,11 @@
 #include "ecs/system.h"
 
 #include "rendering/lighting.h"
-
-enum class LightUpdateType
-{
-    Point,
-    Spot,
-    Directional,
-    All
-};
+#include "rendering/render_snapshot.h"
 
 /**
- * \brief A system used to handle updating lighting components.
+ * \brief A system used to copy the scene's lights into the render snapshot, in the layout the renderer
+ * uploads to the lighting UBO.
  */
 class LightingSystem final : public ISystem
 {
@@ -30,123 +24,67 @@ public:
     }
 
     /**
-     * \brief Updates lighting-related components using the given delta time
+     * \brief Copies the lights into the render snapshot being written, at their interpolated transforms.
      * \param dt The delta time.
      */
     void Update(const double dt) override
     {
-        const auto& lights = m_scene->m_registry.view<LightComponent>();
+        LightSnapshot& lights = m_scene->m_render_snapshot->lights;
+        const float interpolation = m_scene->m_interpolation;
 
-        for (const auto& entity : lights)
+        m_scene->GetLights().each([&lights, interpolation](const LightComponent& light_component, const TransformComponent& current,
+                                                           const PreviousTransformComponent& previous, const IdComponent&)
         {
-            auto& [id] = m_scene->m_registry.get<IdComponent>(entity);
-            auto& transform_component = m_scene->m_registry.get<TransformComponent>(entity);
+            // Lights move between simulation steps along with the entities they are attached to.
+            const TransformComponent transform_component = InterpolateTransform(previous, current, interpolation);
 
-            switch (auto& light_component = m_scene->m_registry.get<LightComponent>(entity); light_component.type)
+            // Lights beyond the capacity of the lighting UBO are not drawn.
+            switch (light_component.type)
             {
             case LightComponent::Type::Point:
-                if (auto search = m_point_lights.find(id); search != m_point_lights.end()) continue;
-
+                if (lights.point_lights.size() < static_cast<size_t>(MAX_NO_POINT_LIGHTS))
                 {
-                    auto point_light_data = ComponentToPointLightData(transform_component, light_component);
-                    PointLight point_light{ point_light_data };
-
-                    // Register this entity with this spot light.
-                    m_point_lights[id] = point_light.GetIndex();
+                    lights.point_lights.push_back(ComponentToPointLightData(transform_component, light_component));
                 }
 
                 break;
 
             case LightComponent::Type::Directional:
-                {
-                    auto directional_light_data = ComponentToDirectionalLightData(transform_component, light_component);
-                    [[maybe_unused]] DirectionalLight directional_light{ directional_light_data };
-                }
+                lights.directional_light = ComponentToDirectionalLightData(transform_component, light_component);
+                lights.has_directional_light = true;
 
                 break;
 
             case LightComponent::Type::Spot:
-                if (auto search = m_spot_lights.find(id); search != m_spot_lights.end()) continue;
-
+                if (lights.spot_lights.size() < static_cast<size_t>(MAX_NO_SPOT_LIGHTS))
                 {
-                    auto spot_light_data = ComponentToSpotLightData(transform_component, light_component);
-                    SpotLight spot_light{ spot_light_data };
-
-                    // Register this entity with this spot light.
-                    m_spot_lights[id] = spot_light.GetIndex();
+                    lights.spot_lights.push_back(ComponentToSpotLightData(transform_component, light_component));
                 }
 
                 break;
             }
-        }
+        });
     }
 
     /**
-     * \brief Updates the given type of light sources within the scene.
-     * \param update_type The type of light source to update.
+     * \brief Describes the lighting system, which copies the lights before the draws are recorded.
+     * \return The system's descriptor.
      */
-    void UpdateLightSources(const LightUpdateType update_type)
+    [[nodiscard]] SystemDescriptor Describe() const override
     {
-        const auto view = m_scene->m_registry.view<LightComponent>();
+        SystemDescriptor descriptor;
+        descriptor.name = "LightingSystem";
+        descriptor.phase = SystemPhase::PreRender;
+        descriptor.Reads<IdComponent, TransformComponent, PreviousTransformComponent, LightComponent>();
 
-        for (auto& entity : view)
-        {
-            auto& [uuid] = m_scene->m_registry.get<IdComponent>(entity);
-            auto& transform_component = m_scene->m_registry.get<TransformComponent>(entity);
-            auto& light_component = m_scene->m_registry.get<LightComponent>(entity);
-            auto& light_type = light_component.type;
+        // Lights are uploaded by the renderer, so the system makes no GL calls.
+        descriptor.main_thread = false;
 
-            if (update_type == LightUpdateType::All)
-            {
-                // Update all the lights.
-
-                if (light_type == LightComponent::Type::Point)
-                {
-                    const unsigned int index = m_point_lights[uuid];
-                    auto data = ComponentToPointLightData(transform_component, light_component);
-                    UpdatePointLight(index, data);
-                }
-
-                if (light_type == LightComponent::Type::Directional)
-                {
-                    auto data = ComponentToDirectionalLightData(transform_component, light_component);
-                    UpdateDirectionalLight(data);
-                }
-
-                if (light_type == LightComponent::Type::Spot)
-                {
-                    const unsigned int index = m_spot_lights[uuid];
-                    auto data = ComponentToSpotLightData(transform_component, light_component);
-                    UpdateSpotLight(index, data);
-                }
-            }
-            else if (light_type == LightComponent::Type::Point && update_type == LightUpdateType::Point)
-            {
-                // Update point lights.
-                const unsigned int index = m_point_lights[uuid];
-                auto data = ComponentToPointLightData(transform_component, light_component);
-                UpdatePointLight(index, data);
-            }
-            else if (light_type == LightComponent::Type::Directional && update_type == LightUpdateType::Directional)
-            {
-                // Update directional light.
-                auto data = ComponentToDirectionalLightData(transform_component, light_component);
-                UpdateDirectionalLight(data);
-            }
-            else if (light_type == LightComponent::Type::Spot && update_type == LightUpdateType::Spot)
-            {
-                // Update spot lights.
-                const unsigned int index = m_spot_lights[uuid];
-                auto data = ComponentToSpotLightData(transform_component, light_component);
-                UpdateSpotLight(index, data);
-            }
-        }
+        return descriptor;
     }
 
 private:
     Scene* m_scene;
-    std::unordered_map<UUID, unsigned int> m_spot_lights;
-    std::unordered_map<UUID, unsigned int> m_point_lights;
 };
 
 #endif // LIGHTING_SYSTEM_H
\ No newline at end of file
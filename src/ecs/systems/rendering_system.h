@@ -8,12 +8,25 @@
 #include "ecs/components.h"
 #include "ecs/system.h"
 
-#include "utils/logging.h"
+#include "rendering/camera_manager.h"
+#include "rendering/render_command_list.h"
+#include "rendering/render_snapshot.h"
+#include "rendering/shader_preprocessor.h"
+
+#include "utils/hash.h"
+#include "utils/job_system.h"
+#include "utils/thread_scratch.h"
 
 #include "glm/ext/matrix_transform.hpp"
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
 
  /**
-  * \brief A system used to handle updating renderable components.
+  * \brief A system used to record the draws of the renderable components into the render snapshot's
+  * command lists, and to copy the camera, which the renderer then uses without touching the scene.
   */
 class RenderingSystem final : public ISystem
 {
@@ -24,34 +37,274 @@ public:
     }
 
     /**
-     * \brief Updates rendering-related components using the given delta time
+     * \brief Records the draws of the renderable entities into the render snapshot being written, at their
+     * interpolated transforms. Entities are split into chunks recorded on the job system's workers, each
+     * into its own command list.
      * \param dt The delta time.
      */
     void Update(const double dt) override
     {
-        const auto renderable_view = m_scene->m_registry.view<MeshComponent, ShaderComponent>();
-        for (const auto entity : renderable_view)
+        RenderSnapshot& snapshot = *m_scene->m_render_snapshot;
+        const Camera& camera = CameraManager::GetMainCamera();
+
+        snapshot.camera = { camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.GetPosition() };
+        snapshot.render_path = m_scene->m_render_path;
+        snapshot.depth_pre_pass = m_scene->m_depth_pre_pass && m_scene->m_render_path == RenderPath::Forward;
+        snapshot.command_lists.resize(JobSystem::GetWorkerCount() + 1);
+
+        const FrameRecording recording = PrepareRecording(snapshot);
+
+        const float interpolation = m_scene->m_interpolation;
+        m_texture_requests.Prepare();
+
+        Scene::ParallelEachIn<TransformComponent, PreviousTransformComponent, MeshComponent, ShaderComponent>(m_scene->GetRenderables(),
+            [this, &snapshot, &camera, &recording, interpolation](const entt::entity, const TransformComponent& current,
+                                                                  const PreviousTransformComponent& previous, const MeshComponent& mesh,
+                                                                  const ShaderComponent& shader_component)
         {
-            auto [position, rotation, scale] = m_scene->m_registry.get<TransformComponent>(entity);
-            auto [model] = m_scene->m_registry.get<MeshComponent>(entity);
-            auto [shader] = m_scene->m_registry.get<ShaderComponent>(entity);
+            // Models whose meshes are still being uploaded on the loader thread are left out until they are ready.
+            if (!mesh.model->IsReady()) return;
 
-            glm::mat4 model_mat{ 1.0f };
-            model_mat = glm::translate(model_mat, position);
-            model_mat = glm::rotate(model_mat, glm::radians(rotation.x), glm::vec3{ 1.0f, 0.0f, 0.0f });
-            model_mat = glm::rotate(model_mat, glm::radians(rotation.y), glm::vec3{ 0.0f, 1.0f, 0.0f });
-            model_mat = glm::rotate(model_mat, glm::radians(rotation.z), glm::vec3{ 0.0f, 0.0f, 1.0f });
-            model_mat = glm::scale(model_mat, scale);
+            RenderCommandList& commands = snapshot.command_lists[JobSystem::GetWorkerIndex() + 1];
+            const TransformComponent transform = InterpolateTransform(previous, current, interpolation);
+            const glm::mat4 model_mat = CalculateModelMatrix(transform);
 
-            shader.Use();
-            shader.SetMat4("model", model_mat);
+            Record(commands, recording, *mesh.model, shader_component, model_mat);
 
-            model.Draw(shader);
-        }
+            m_texture_requests.Local().push_back({ mesh.model, CalculateScreenSize(camera, *mesh.model, transform, model_mat) });
+        });
+
+        // Each list is sorted on a worker, leaving only a merge of the sorted lists to the render thread.
+        JobSystem::ParallelFor(snapshot.command_lists.size(), 1, [&snapshot](const size_t i)
+        {
+            snapshot.command_lists[i].Sort();
+        });
+
+        m_texture_requests.MergeInto(snapshot.texture_requests);
+    }
+
+    /**
+     * \brief Describes the rendering system, which records the draws once everything else has been updated.
+     * \return The system's descriptor.
+     */
+    [[nodiscard]] SystemDescriptor Describe() const override
+    {
+        SystemDescriptor descriptor;
+        descriptor.name = "RenderingSystem";
+        descriptor.phase = SystemPhase::Render;
+        descriptor.Reads<TransformComponent, PreviousTransformComponent, MeshComponent, ShaderComponent>();
+
+        // Draws are submitted by the renderer, so the system makes no GL calls.
+        descriptor.main_thread = false;
+
+        return descriptor;
     }
 
 private:
+    /**
+     * \brief The largest number of lights of one type that is compiled into a shader variant, so that
+     * the light loop can be unrolled. Scenes with more lights loop over the count in the lighting UBO.
+     */
+    static constexpr int MAX_UNROLLED_LIGHTS = 8;
+
+    /**
+     * \brief The programs a frame's draws are recorded with, worked out once before recording starts.
+     */
+    struct FrameRecording
+    {
+        bool depth_pre_pass;
+        ProgramRequest depth_program;
+
+        /**
+         * \brief The shader used in place of each entity's own, if any.
+         */
+        std::string shading_shader;
+
+        /**
+         * \brief The permutations for models with and without a specular map, and the hashes of their keys.
+         */
+        ShaderPermutation permutations[2];
+        uint64_t permutation_hashes[2];
+    };
+
     Scene* m_scene;
+    ThreadScratch<TextureRequest> m_texture_requests;
+
+    /**
+     * \brief Works out the programs a snapshot's draws are recorded with.
+     * \param snapshot The render snapshot, whose lights have been written.
+     * \return The programs of the frame.
+     */
+    [[nodiscard]] static FrameRecording PrepareRecording(const RenderSnapshot& snapshot)
+    {
+        FrameRecording recording;
+        recording.depth_pre_pass = snapshot.depth_pre_pass;
+        recording.depth_program = { HashString("depth_shader"), Shader{}, "depth_shader", ShaderPermutation{} };
+
+        // Deferred shading applies the lights later, so only the model's textures select the G-buffer variant.
+        if (snapshot.render_path == RenderPath::Deferred)
+        {
+            recording.shading_shader = "gbuffer_shader";
+        }
+        else
+        {
+            recording.permutations[0] = SelectScenePermutation(snapshot.lights);
+        }
+
+        recording.permutations[1] = recording.permutations[0];
+        recording.permutations[1].Define("NO_SPECULAR_MAP");
+
+        for (int i = 0; i < 2; i++)
+        {
+            recording.permutation_hashes[i] = HashString(recording.permutations[i].GetKey());
+        }
+
+        return recording;
+    }
+
+    /**
+     * \brief Records the draws of one entity, with one item per mesh and pass.
+     * \param commands The command list of the calling thread.
+     * \param recording The programs of the frame.
+     * \param model The entity's model.
+     * \param shader_component The entity's shader.
+     * \param model_mat The entity's model matrix.
+     */
+    static void Record(RenderCommandList& commands, const FrameRecording& recording, const Model& model,
+                       const ShaderComponent& shader_component, const glm::mat4& model_mat)
+    {
+        const uint32_t constants = commands.AddConstants(model_mat);
+
+        if (recording.depth_pre_pass)
+        {
+            const ProgramRequest& depth_program = recording.depth_program;
+            const uint32_t program = FindOrAddProgram(commands, depth_program);
+
+            for (const Mesh& mesh : model.GetMeshes())
+            {
+                commands.BeginItem(RenderCommandList::MakeSortKey(RenderPass::Depth, depth_program.key, 0, mesh.GetDepthVertexArray()));
+                commands.BindProgram(program);
+                commands.SetConstants(constants);
+                commands.BindVertexArray(mesh.GetDepthVertexArray());
+                commands.DrawIndexed(mesh.GetIndexCount());
+                commands.EndItem();
+            }
+        }
+
+        // Use the cheapest variant of the shader that still covers the scene's lights and the model's textures.
+        const int variant = model.HasTexture(TextureSlot::Specular) ? 0 : 1;
+        const std::string& name = recording.shading_shader.empty() ? shader_component.name : recording.shading_shader;
+        const GLint shader_id = shader_component.shader.GetId();
+
+        ProgramRequest shading_program;
+        shading_program.key = name.empty() ? HashBytes(&shader_id, sizeof(shader_id)) : HashString(name, recording.permutation_hashes[variant]);
+
+        uint32_t program = commands.FindProgram(shading_program.key);
+        if (program == RenderCommandList::NO_PROGRAM)
+        {
+            shading_program.shader = shader_component.shader;
+            shading_program.name = name;
+            shading_program.permutation = recording.permutations[variant];
+            program = commands.AddProgram(std::move(shading_program));
+        }
+
+        const uint64_t program_key = commands.GetPrograms()[program].key;
+
+        for (const Mesh& mesh : model.GetMeshes())
+        {
+            commands.BeginItem(RenderCommandList::MakeSortKey(RenderPass::Shading, program_key, mesh.GetMaterialId(), mesh.GetVertexArray()));
+            commands.BindProgram(program);
+            commands.SetConstants(constants);
+            commands.BindMaterial(mesh.GetMaterialId());
+            commands.BindVertexArray(mesh.GetVertexArray());
+            commands.DrawIndexed(mesh.GetIndexCount());
+            commands.EndItem();
+        }
+    }
+
+    /**
+     * \brief Gets the index of a command list's request for a program, adding the request if needed.
+     * \param commands The command list.
+     * \param request The request.
+     * \return The index of the request.
+     */
+    static uint32_t FindOrAddProgram(RenderCommandList& commands, const ProgramRequest& request)
+    {
+        const uint32_t program = commands.FindProgram(request.key);
+        return program != RenderCommandList::NO_PROGRAM ? program : commands.AddProgram(request);
+    }
+
+    /**
+     * \brief Estimates how large a model is on screen, which decides the resolution its textures are
+     * streamed in at.
+     * \param camera The camera the model is drawn from.
+     * \param model The model.
+     * \param transform The transform of the model's entity.
+     * \param model_mat The model matrix of the model's entity.
+     * \return The height of the model on screen in pixels.
+     */
+    static float CalculateScreenSize(const Camera& camera, const Model& model, const TransformComponent& transform,
+                                     const glm::mat4& model_mat)
+    {
+        const glm::vec3 centre{ model_mat * glm::vec4{ model.GetBoundingCentre(), 1.0f } };
+        const float radius = model.GetBoundingRadius() * std::max({ transform.scale.x, transform.scale.y, transform.scale.z });
+        return camera.GetProjectedSize(2.0f * radius, glm::length(centre - camera.GetPosition()));
+    }
+
+    /**
+     * \brief Calculates the model matrix of an entity, identically for every pass that draws it.
+     * \param transform The entity's transform.
+     * \return The model matrix.
+     */
+    static glm::mat4 CalculateModelMatrix(const TransformComponent& transform)
+    {
+        glm::mat4 model_mat{ 1.0f };
+        model_mat = glm::translate(model_mat, transform.position);
+        model_mat = glm::rotate(model_mat, glm::radians(transform.rotation.x), glm::vec3{ 1.0f, 0.0f, 0.0f });
+        model_mat = glm::rotate(model_mat, glm::radians(transform.rotation.y), glm::vec3{ 0.0f, 1.0f, 0.0f });
+        model_mat = glm::rotate(model_mat, glm::radians(transform.rotation.z), glm::vec3{ 0.0f, 0.0f, 1.0f });
+        model_mat = glm::scale(model_mat, transform.scale);
+
+        return model_mat;
+    }
+
+    /**
+     * \brief Selects the shader features needed by the lights of a snapshot.
+     * \param lights The lights of the snapshot.
+     * \return The preprocessor definitions that compile out unused lighting.
+     */
+    [[nodiscard]] static ShaderPermutation SelectScenePermutation(const LightSnapshot& lights)
+    {
+        const int point_lights = static_cast<int>(lights.point_lights.size());
+        const int spot_lights = static_cast<int>(lights.spot_lights.size());
+
+        ShaderPermutation permutation;
+
+        if (!lights.has_directional_light)
+        {
+            permutation.Define("NO_DIRECTIONAL_LIGHT");
+        }
+
+        if (point_lights == 0)
+        {
+            permutation.Define("NO_POINT_LIGHTS");
+        }
+        else if (point_lights <= MAX_UNROLLED_LIGHTS)
+        {
+            permutation.Define("POINT_LIGHT_COUNT", point_lights);
+        }
+
+        if (spot_lights == 0)
+        {
+            permutation.Define("NO_SPOT_LIGHTS");
+        }
+        else if (spot_lights <= MAX_UNROLLED_LIGHTS)
+        {
+            permutation.Define("SPOT_LIGHT_COUNT", spot_lights);
+        }
+
+        return permutation;
+    }
 };
 
 #endif // RENDERING_SYSTEM_H
\ No newline at end of file
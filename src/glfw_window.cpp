@@ -25,6 +25,27 @@ GlfwWindow::GlfwWindow(const std::string& title, const WindowDimensions& dimensi
     }
 }
 
+/**
+ * \brief Creates a hidden window whose context shares objects with another window's context, so that
+ * another thread can create resources for it. Must be called on the main thread.
+ * \param title The title of the window.
+ * \param shared The window whose context objects are shared with.
+ */
+GlfwWindow::GlfwWindow(const std::string& title, const GlfwWindow& shared)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // The context hints set for the shared window still apply, so both contexts have the same version.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_window_ptr = glfwCreateWindow(1, 1, title.c_str(), nullptr, shared.m_window_ptr);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (!m_window_ptr)
+    {
+        throw std::runtime_error{ "Failed to create shared GLFW window." };
+    }
+}
+
 GlfwWindow::~GlfwWindow()
 {
     DFM_PROFILE_FUNCTION();
@@ -59,6 +80,16 @@ bool GlfwWindow::ShouldClose() const
     return glfwWindowShouldClose(m_window_ptr);
 }
 
+/**
+ * \brief Determines whether a key is held down in the window.
+ * \param key The GLFW key code, e.g. \code GLFW_KEY_F2.
+ * \return A boolean value indicating if the key is pressed.
+ */
+bool GlfwWindow::IsKeyPressed(const int key) const
+{
+    return glfwGetKey(m_window_ptr, key) == GLFW_PRESS;
+}
+
 /**
  * \brief Gets the dimensions of the window.
  * \return A \code WindowDimensions object representing the dimensions of the window.
@@ -26,6 +26,15 @@ class GlfwWindow
 {
 public:
     explicit GlfwWindow(const std::string& title, const WindowDimensions& dimensions = DEFAULT_DIMENSIONS, bool fullscreen = false);
+
+    /**
+     * \brief Creates a hidden window whose context shares objects with another window's context, so that
+     * another thread can create resources for it. Must be called on the main thread.
+     * \param title The title of the window.
+     * \param shared The window whose context objects are shared with.
+     */
+    GlfwWindow(const std::string& title, const GlfwWindow& shared);
+
     ~GlfwWindow();
 
     GlfwWindow(const GlfwWindow&) = delete;
@@ -50,6 +59,13 @@ public:
      */
     [[nodiscard]] bool ShouldClose() const;
 
+    /**
+     * \brief Determines whether a key is held down in the window.
+     * \param key The GLFW key code, e.g. \code GLFW_KEY_F2.
+     * \return A boolean value indicating if the key is pressed.
+     */
+    [[nodiscard]] bool IsKeyPressed(int key) const;
+
     /**
      * \brief Gets the dimensions of the window.
      * \return A \code WindowDimensions object representing the dimensions of the window.
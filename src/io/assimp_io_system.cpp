@@ -0,0 +1,153 @@
+/**
+ * \file assimp_io_system.cpp
+ */
+
+#include "assimp_io_system.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+VfsIOStream::VfsIOStream(FileView file)
+    : m_file{ std::move(file) },
+    m_position{}
+{
+}
+
+/**
+ * \brief Reads whole elements from the current position in the file.
+ * \param buffer The buffer to read into.
+ * \param size The size of each element in bytes.
+ * \param count The number of elements to read.
+ * \return The number of elements read.
+ */
+size_t VfsIOStream::Read(void* buffer, const size_t size, const size_t count)
+{
+    if (size == 0) return 0;
+
+    const size_t elements = std::min(count, (m_file.GetSize() - m_position) / size);
+    std::memcpy(buffer, m_file.GetData() + m_position, elements * size);
+    m_position += elements * size;
+
+    return elements;
+}
+
+/**
+ * \brief Rejects writes, since the virtual file system is read-only.
+ * \return Zero, as no elements are written.
+ */
+size_t VfsIOStream::Write(const void*, const size_t, const size_t)
+{
+    return 0;
+}
+
+/**
+ * \brief Moves the current position in the file.
+ * \param offset The offset from the origin.
+ * \param origin The position to offset from.
+ * \return A value indicating if the new position is within the file.
+ */
+aiReturn VfsIOStream::Seek(const size_t offset, const aiOrigin origin)
+{
+    size_t base = 0;
+
+    switch (origin)
+    {
+    case aiOrigin_CUR:
+        base = m_position;
+        break;
+    case aiOrigin_END:
+        base = m_file.GetSize();
+        break;
+    default:
+        break;
+    }
+
+    // Offsets from the end are passed as negative values wrapped to size_t.
+    const size_t position = base + offset;
+    if (position > m_file.GetSize())
+    {
+        return aiReturn_FAILURE;
+    }
+
+    m_position = position;
+    return aiReturn_SUCCESS;
+}
+
+/**
+ * \brief Gets the current position in the file.
+ * \return The position in bytes.
+ */
+size_t VfsIOStream::Tell() const
+{
+    return m_position;
+}
+
+/**
+ * \brief Gets the size of the file.
+ * \return The size in bytes.
+ */
+size_t VfsIOStream::FileSize() const
+{
+    return m_file.GetSize();
+}
+
+/**
+ * \brief Does nothing, since the virtual file system is read-only.
+ */
+void VfsIOStream::Flush()
+{
+}
+
+/**
+ * \brief Determines whether a file exists in a mounted archive or on disk.
+ * \param path The path to the file.
+ * \return A boolean value indicating if the file exists.
+ */
+bool VfsIOSystem::Exists(const char* path) const
+{
+    return VirtualFileSystem::Exists(path);
+}
+
+/**
+ * \brief Gets the separator used between path components.
+ * \return The separator character.
+ */
+char VfsIOSystem::getOsSeparator() const
+{
+    return '/';
+}
+
+/**
+ * \brief Opens a file for reading through the virtual file system.
+ * \param path The path to the file.
+ * \param mode The mode to open the file in, which must not request writing.
+ * \return The opened stream, or null if the file could not be read.
+ */
+Assimp::IOStream* VfsIOSystem::Open(const char* path, const char* mode)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr)
+    {
+        return nullptr;
+    }
+
+    FileView file = VirtualFileSystem::Open(path);
+    if (!file.IsValid())
+    {
+        return nullptr;
+    }
+
+    return new VfsIOStream{ std::move(file) };
+}
+
+/**
+ * \brief Closes a stream opened by this IO system.
+ * \param stream The stream to close.
+ */
+void VfsIOSystem::Close(Assimp::IOStream* stream)
+{
+    delete stream;
+}
@@ -0,0 +1,48 @@
+/**
+ * \file assimp_io_system.h
+ */
+
+#ifndef ASSIMP_IO_SYSTEM_H
+#define ASSIMP_IO_SYSTEM_H
+
+#include "virtual_file_system.h"
+
+#include "assimp/IOStream.hpp"
+#include "assimp/IOSystem.hpp"
+
+#include <cstddef>
+
+/**
+ * \brief A read-only Assimp stream over a file opened through the virtual file system.
+ */
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+    explicit VfsIOStream(FileView file);
+
+    size_t Read(void* buffer, size_t size, size_t count) override;
+    size_t Write(const void* buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    [[nodiscard]] size_t Tell() const override;
+    [[nodiscard]] size_t FileSize() const override;
+    void Flush() override;
+
+private:
+    FileView m_file;
+    size_t m_position;
+};
+
+/**
+ * \brief Routes the files Assimp opens while importing a model, such as material libraries and
+ * external buffers, through the virtual file system.
+ */
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char* path) const override;
+    [[nodiscard]] char getOsSeparator() const override;
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override;
+    void Close(Assimp::IOStream* stream) override;
+};
+
+#endif // ASSIMP_IO_SYSTEM_H
@@ -0,0 +1,508 @@
+/**
+ * \file async_file_reader.cpp
+ */
+
+#include "async_file_reader.h"
+#include "utils/job_system.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+AsyncFileReader AsyncFileReader::s_instance;
+
+AsyncFileReader::AsyncFileReader()
+    : m_queue_depth{},
+    m_running{ false },
+    m_stopping{ false },
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Creates the io_uring and starts the IO thread, falling back to the worker threads if the
+ * kernel does not support io_uring.
+ * \param queue_depth The maximum number of reads in flight at once.
+ */
+void AsyncFileReader::Initialise(const unsigned int queue_depth)
+{
+    DFM_PROFILE_FUNCTION();
+
+    AsyncFileReader& reader = Get();
+
+    if (!reader.CreateRing(queue_depth))
+    {
+        DFM_CORE_WARN("io_uring is unavailable, files will be read on the worker threads.");
+        return;
+    }
+
+    reader.m_queue_depth = queue_depth;
+    reader.m_running = true;
+    reader.m_stopping = false;
+    reader.m_thread = std::thread{ [] { Get().IoLoop(); } };
+
+    DFM_CORE_INFO("Reading files through io_uring with a queue depth of {0}.", queue_depth);
+}
+
+/**
+ * \brief Finishes any queued reads and stops the IO thread. Files requested afterwards are read
+ * on a worker thread.
+ */
+void AsyncFileReader::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    AsyncFileReader& reader = Get();
+
+    if (reader.m_thread.joinable())
+    {
+        {
+            std::lock_guard lock{ reader.m_mutex };
+            reader.m_stopping = true;
+        }
+
+        reader.m_condition.notify_one();
+        reader.m_thread.join();
+        reader.DestroyRing();
+    }
+
+    const AsyncFileReaderStatistics statistics = GetStatistics();
+    DFM_CORE_INFO("Read {0} files ({1:.2f} MiB) in {2} batches with a peak queue depth of {3}; "
+                  "{4} from archives, {5} on worker threads.",
+        statistics.reads, static_cast<double>(statistics.bytes_read) / (1024.0 * 1024.0), statistics.batches,
+        statistics.peak_queue_depth, statistics.archive_reads, statistics.fallback_reads);
+}
+
+/**
+ * \brief Reads the entire contents of a file in the background.
+ * \param path The path to the file.
+ * \param on_read The function receiving the file's contents, which is called on a worker thread.
+ */
+void AsyncFileReader::Read(const std::string& path, ReadCallback on_read)
+{
+    DFM_PROFILE_FUNCTION();
+
+    AsyncFileReader& reader = Get();
+
+    // Archived files are already mapped, so there is nothing for the kernel to batch.
+    if (VirtualFileSystem::IsArchived(path))
+    {
+        {
+            std::lock_guard lock{ reader.m_mutex };
+            reader.m_statistics.archive_reads++;
+        }
+
+        ReadOnWorkers(path, std::move(on_read));
+        return;
+    }
+
+    bool queued = false;
+
+    {
+        std::lock_guard lock{ reader.m_mutex };
+
+        if (!reader.m_running)
+        {
+            reader.m_statistics.fallback_reads++;
+        }
+        else
+        {
+            auto request = std::make_unique<Request>();
+            request->path = path;
+            request->on_read = std::move(on_read);
+            request->file = -1;
+            request->offset = 0;
+
+            reader.m_queue.push_back(std::move(request));
+            queued = true;
+        }
+    }
+
+    if (!queued)
+    {
+        ReadOnWorkers(path, std::move(on_read));
+        return;
+    }
+
+    reader.m_condition.notify_one();
+}
+
+/**
+ * \brief Reads the entire contents of a file in the background.
+ * \param path The path to the file.
+ * \return A future holding the file's contents.
+ */
+std::future<FileView> AsyncFileReader::Read(const std::string& path)
+{
+    auto promise = std::make_shared<std::promise<FileView>>();
+    std::future<FileView> future = promise->get_future();
+
+    Read(path, [promise](FileView file) { promise->set_value(std::move(file)); });
+
+    return future;
+}
+
+/**
+ * \brief Determines whether loose files are read through io_uring.
+ * \return A boolean value indicating if io_uring is in use.
+ */
+bool AsyncFileReader::IsUsingIoUring()
+{
+    std::lock_guard lock{ Get().m_mutex };
+    return Get().m_running;
+}
+
+/**
+ * \brief Gets the work done by the reader.
+ * \return The reader statistics.
+ */
+AsyncFileReaderStatistics AsyncFileReader::GetStatistics()
+{
+    std::lock_guard lock{ Get().m_mutex };
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Creates the io_uring and maps its rings.
+ * \param queue_depth The number of submission queue entries.
+ * \return A boolean value indicating if the io_uring was created.
+ */
+bool AsyncFileReader::CreateRing(const unsigned int queue_depth)
+{
+    DFM_PROFILE_FUNCTION();
+
+#ifdef __linux__
+    io_uring_params parameters{};
+
+    // liburing is not a dependency, so the ring is set up through the raw system calls.
+    const auto file = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &parameters));
+    if (file < 0)
+    {
+        return false;
+    }
+
+    m_ring.file = file;
+    m_ring.submission_ring_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned int);
+    m_ring.completion_ring_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+
+    // Newer kernels share one mapping between both rings.
+    const bool single_mapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mapping)
+    {
+        m_ring.submission_ring_size = std::max(m_ring.submission_ring_size, m_ring.completion_ring_size);
+        m_ring.completion_ring_size = 0;
+    }
+
+    m_ring.submission_ring = mmap(nullptr, m_ring.submission_ring_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, file, IORING_OFF_SQ_RING);
+    if (m_ring.submission_ring == MAP_FAILED)
+    {
+        m_ring.submission_ring = nullptr;
+        DestroyRing();
+        return false;
+    }
+
+    if (single_mapping)
+    {
+        m_ring.completion_ring = m_ring.submission_ring;
+    }
+    else
+    {
+        m_ring.completion_ring = mmap(nullptr, m_ring.completion_ring_size, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, file, IORING_OFF_CQ_RING);
+        if (m_ring.completion_ring == MAP_FAILED)
+        {
+            m_ring.completion_ring = nullptr;
+            DestroyRing();
+            return false;
+        }
+    }
+
+    m_ring.entries_size = parameters.sq_entries * sizeof(io_uring_sqe);
+    m_ring.entries = mmap(nullptr, m_ring.entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          file, IORING_OFF_SQES);
+    if (m_ring.entries == MAP_FAILED)
+    {
+        m_ring.entries = nullptr;
+        DestroyRing();
+        return false;
+    }
+
+    auto* submission = static_cast<unsigned char*>(m_ring.submission_ring);
+    m_ring.submission_head = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.head);
+    m_ring.submission_tail = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.tail);
+    m_ring.submission_mask = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.ring_mask);
+    m_ring.submission_array = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.array);
+
+    auto* completion = static_cast<unsigned char*>(m_ring.completion_ring);
+    m_ring.completion_head = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.head);
+    m_ring.completion_tail = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.tail);
+    m_ring.completion_mask = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.ring_mask);
+    m_ring.completions = completion + parameters.cq_off.cqes;
+
+    return true;
+#else
+    (void)queue_depth;
+    return false;
+#endif
+}
+
+/**
+ * \brief Unmaps the rings and closes the io_uring.
+ */
+void AsyncFileReader::DestroyRing()
+{
+#ifdef __linux__
+    if (m_ring.entries != nullptr)
+    {
+        munmap(m_ring.entries, m_ring.entries_size);
+    }
+
+    if (m_ring.completion_ring != nullptr && m_ring.completion_ring != m_ring.submission_ring)
+    {
+        munmap(m_ring.completion_ring, m_ring.completion_ring_size);
+    }
+
+    if (m_ring.submission_ring != nullptr)
+    {
+        munmap(m_ring.submission_ring, m_ring.submission_ring_size);
+    }
+
+    if (m_ring.file >= 0)
+    {
+        close(m_ring.file);
+    }
+#endif
+
+    m_ring = Ring{};
+}
+
+/**
+ * \brief Submits queued reads and completes finished ones on the IO thread until the reader is shut down.
+ */
+void AsyncFileReader::IoLoop()
+{
+    Instrumentor::SetThreadName("IO");
+
+#ifdef __linux__
+    unsigned int in_flight = 0;
+    unsigned int unsubmitted = 0;
+
+    while (true)
+    {
+        std::vector<std::unique_ptr<Request>> batch;
+
+        {
+            std::unique_lock lock{ m_mutex };
+
+            // Only sleep here when nothing is in flight, otherwise the kernel wakes the thread below.
+            if (in_flight == 0)
+            {
+                m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            }
+
+            if (m_stopping && m_queue.empty() && in_flight == 0)
+            {
+                m_running = false;
+                return;
+            }
+
+            while (!m_queue.empty() && in_flight + batch.size() < m_queue_depth)
+            {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        for (auto& request : batch)
+        {
+            if (!Open(*request))
+            {
+                Complete(std::move(request), false);
+                continue;
+            }
+
+            if (request->contents.empty())
+            {
+                Complete(std::move(request), true);
+                continue;
+            }
+
+            // The request is owned by the ring until its completion is reaped.
+            Push(*request.release());
+            in_flight++;
+            unsubmitted++;
+        }
+
+        if (in_flight == 0) continue;
+
+        if (unsubmitted != 0)
+        {
+            std::lock_guard lock{ m_mutex };
+            m_statistics.batches++;
+            m_statistics.peak_queue_depth = std::max<size_t>(m_statistics.peak_queue_depth, in_flight);
+        }
+
+        // Submit the whole batch with one system call, and wait for at least one read to finish.
+        const auto submitted = syscall(__NR_io_uring_enter, m_ring.file, unsubmitted, 1, IORING_ENTER_GETEVENTS,
+                                       nullptr, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            DFM_CORE_ERROR("io_uring_enter failed with error {0}.", errno);
+        }
+        else if (submitted > 0)
+        {
+            unsubmitted -= static_cast<unsigned int>(submitted);
+        }
+
+        unsigned int head = *m_ring.completion_head;
+        const unsigned int tail = __atomic_load_n(m_ring.completion_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++)
+        {
+            const auto& completion = static_cast<const io_uring_cqe*>(m_ring.completions)[head & *m_ring.completion_mask];
+            std::unique_ptr<Request> request{ reinterpret_cast<Request*>(completion.user_data) };
+            const int result = completion.res;
+
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                Push(*request.release());
+                unsubmitted++;
+                continue;
+            }
+
+            if (result <= 0)
+            {
+                in_flight--;
+                Complete(std::move(request), false);
+                continue;
+            }
+
+            // Large files can be read in several parts, so continue from where the last read stopped.
+            request->offset += static_cast<size_t>(result);
+            if (request->offset < request->contents.size())
+            {
+                Push(*request.release());
+                unsubmitted++;
+                continue;
+            }
+
+            in_flight--;
+            Complete(std::move(request), true);
+        }
+
+        __atomic_store_n(m_ring.completion_head, head, __ATOMIC_RELEASE);
+    }
+#endif
+}
+
+/**
+ * \brief Opens a requested file and allocates the buffer it is read into.
+ * \param request The read to start.
+ * \return A boolean value indicating if the file was opened.
+ */
+bool AsyncFileReader::Open(Request& request)
+{
+    DFM_PROFILE_FUNCTION();
+
+#ifdef __linux__
+    request.file = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (request.file < 0)
+    {
+        return false;
+    }
+
+    struct stat status{};
+    if (fstat(request.file, &status) != 0)
+    {
+        return false;
+    }
+
+    request.contents.resize(static_cast<size_t>(status.st_size));
+    return true;
+#else
+    (void)request;
+    return false;
+#endif
+}
+
+/**
+ * \brief Adds a read of the remaining part of a file to the submission ring.
+ * \param request The read to submit.
+ */
+void AsyncFileReader::Push(Request& request)
+{
+#ifdef __linux__
+    request.vector.iov_base = request.contents.data() + request.offset;
+    request.vector.iov_len = request.contents.size() - request.offset;
+
+    // The ring never holds more entries than reads in flight, so there is always a free slot.
+    const unsigned int tail = *m_ring.submission_tail;
+    const unsigned int index = tail & *m_ring.submission_mask;
+
+    io_uring_sqe& entry = static_cast<io_uring_sqe*>(m_ring.entries)[index];
+    entry = io_uring_sqe{};
+    entry.opcode = IORING_OP_READV;
+    entry.fd = request.file;
+    entry.off = request.offset;
+    entry.addr = reinterpret_cast<uint64_t>(&request.vector);
+    entry.len = 1;
+    entry.user_data = reinterpret_cast<uint64_t>(&request);
+
+    m_ring.submission_array[index] = index;
+    __atomic_store_n(m_ring.submission_tail, tail + 1, __ATOMIC_RELEASE);
+#else
+    (void)request;
+#endif
+}
+
+/**
+ * \brief Hands a finished read to its callback on a worker thread and closes the file.
+ * \param request The finished read.
+ * \param read Determines if the file was read successfully.
+ */
+void AsyncFileReader::Complete(std::unique_ptr<Request> request, const bool read)
+{
+#ifdef __linux__
+    if (request->file >= 0)
+    {
+        close(request->file);
+    }
+#endif
+
+    if (read)
+    {
+        std::lock_guard lock{ m_mutex };
+        m_statistics.reads++;
+        m_statistics.bytes_read += request->contents.size();
+    }
+
+    JobSystem::Run([on_read = std::move(request->on_read), contents = std::move(request->contents), read]() mutable
+    {
+        on_read(read ? FileView{ std::move(contents) } : FileView{});
+    });
+}
+
+/**
+ * \brief Reads a file on a worker thread of the job system.
+ * \param path The path to the file.
+ * \param on_read The function receiving the file's contents.
+ */
+void AsyncFileReader::ReadOnWorkers(const std::string& path, ReadCallback on_read)
+{
+    JobSystem::Run([path, on_read = std::move(on_read)]
+    {
+        on_read(VirtualFileSystem::Open(path));
+    });
+}
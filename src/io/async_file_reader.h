@@ -0,0 +1,207 @@
+/**
+ * \file async_file_reader.h
+ */
+
+#ifndef ASYNC_FILE_READER_H
+#define ASYNC_FILE_READER_H
+
+#include "virtual_file_system.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+/**
+ * \brief Represents the work done by the asynchronous file reader.
+ */
+struct AsyncFileReaderStatistics
+{
+    size_t reads;
+    size_t bytes_read;
+    size_t batches;
+    size_t peak_queue_depth;
+    size_t archive_reads;
+    size_t fallback_reads;
+};
+
+/**
+ * \brief A singleton class that reads whole files in the background so that reading overlaps with
+ * decoding. On Linux, loose files are read through an io_uring owned by a dedicated IO thread, which
+ * keeps many reads in flight at once and submits them in batches. Files in a mounted pak archive, and
+ * every file on platforms or kernels without io_uring, are read on the worker threads instead. Files can
+ * be requested from any thread.
+ */
+class AsyncFileReader
+{
+public:
+    /**
+     * \brief A function receiving the contents of a file, which is invalid if the file could not be read.
+     */
+    using ReadCallback = std::function<void(FileView file)>;
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader(AsyncFileReader&&) noexcept = delete;
+
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(AsyncFileReader&&) noexcept = delete;
+
+    /**
+     * \brief Creates the io_uring and starts the IO thread, falling back to the worker threads if the
+     * kernel does not support io_uring.
+     * \param queue_depth The maximum number of reads in flight at once.
+     */
+    static void Initialise(unsigned int queue_depth = 64);
+
+    /**
+     * \brief Finishes any queued reads and stops the IO thread. Files requested afterwards are read
+     * on a worker thread.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Reads the entire contents of a file in the background.
+     * \param path The path to the file.
+     * \param on_read The function receiving the file's contents, which is called on a worker thread.
+     */
+    static void Read(const std::string& path, ReadCallback on_read);
+
+    /**
+     * \brief Reads the entire contents of a file in the background.
+     * \param path The path to the file.
+     * \return A future holding the file's contents.
+     */
+    static std::future<FileView> Read(const std::string& path);
+
+    /**
+     * \brief Determines whether loose files are read through io_uring.
+     * \return A boolean value indicating if io_uring is in use.
+     */
+    [[nodiscard]] static bool IsUsingIoUring();
+
+    /**
+     * \brief Gets the work done by the reader.
+     * \return The reader statistics.
+     */
+    [[nodiscard]] static AsyncFileReaderStatistics GetStatistics();
+
+private:
+    /**
+     * \brief Represents a read waiting for or being processed by the IO thread.
+     */
+    struct Request
+    {
+        std::string path;
+        ReadCallback on_read;
+        int file;
+        std::vector<unsigned char> contents;
+        size_t offset;
+
+#ifdef __linux__
+        /**
+         * \brief The buffer description passed to the kernel, which must stay alive while the read is in flight.
+         */
+        iovec vector;
+#endif
+    };
+
+    /**
+     * \brief The memory shared with the kernel to submit and complete reads.
+     */
+    struct Ring
+    {
+        int file = -1;
+        void* submission_ring = nullptr;
+        size_t submission_ring_size = 0;
+        void* completion_ring = nullptr;
+        size_t completion_ring_size = 0;
+        void* entries = nullptr;
+        size_t entries_size = 0;
+
+        unsigned int* submission_head = nullptr;
+        unsigned int* submission_tail = nullptr;
+        unsigned int* submission_mask = nullptr;
+        unsigned int* submission_array = nullptr;
+        unsigned int* completion_head = nullptr;
+        unsigned int* completion_tail = nullptr;
+        unsigned int* completion_mask = nullptr;
+        void* completions = nullptr;
+    };
+
+    Ring m_ring;
+    std::thread m_thread;
+    std::deque<std::unique_ptr<Request>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    unsigned int m_queue_depth;
+    bool m_running;
+    bool m_stopping;
+    AsyncFileReaderStatistics m_statistics;
+
+    AsyncFileReader();
+    ~AsyncFileReader() = default;
+
+    /**
+     * \brief Creates the io_uring and maps its rings.
+     * \param queue_depth The number of submission queue entries.
+     * \return A boolean value indicating if the io_uring was created.
+     */
+    bool CreateRing(unsigned int queue_depth);
+
+    /**
+     * \brief Unmaps the rings and closes the io_uring.
+     */
+    void DestroyRing();
+
+    /**
+     * \brief Submits queued reads and completes finished ones on the IO thread until the reader is shut down.
+     */
+    void IoLoop();
+
+    /**
+     * \brief Opens a requested file and allocates the buffer it is read into.
+     * \param request The read to start.
+     * \return A boolean value indicating if the file was opened.
+     */
+    static bool Open(Request& request);
+
+    /**
+     * \brief Adds a read of the remaining part of a file to the submission ring.
+     * \param request The read to submit.
+     */
+    void Push(Request& request);
+
+    /**
+     * \brief Hands a finished read to its callback on a worker thread and closes the file.
+     * \param request The finished read.
+     * \param read Determines if the file was read successfully.
+     */
+    void Complete(std::unique_ptr<Request> request, bool read);
+
+    /**
+     * \brief Reads a file on a worker thread of the job system.
+     * \param path The path to the file.
+     * \param on_read The function receiving the file's contents.
+     */
+    static void ReadOnWorkers(const std::string& path, ReadCallback on_read);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static AsyncFileReader& Get() { return s_instance; }
+
+    static AsyncFileReader s_instance;
+};
+
+#endif // ASYNC_FILE_READER_H
@@ -0,0 +1,240 @@
+/**
+ * \file lz4.cpp
+ */
+
+#include "lz4.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_FIND_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_LOG = 16;
+
+/**
+ * \brief Reads four bytes without any alignment requirement.
+ * \param data The bytes to read.
+ * \return The bytes as an integer.
+ */
+static uint32_t Read32(const unsigned char* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/**
+ * \brief Hashes the four bytes at the start of a potential match.
+ * \param sequence The four bytes.
+ * \return The index into the match table.
+ */
+static uint32_t HashSequence(const uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+/**
+ * \brief Writes the extra bytes of a literal or match length that does not fit in its token.
+ * \param output The compressed block.
+ * \param length The remaining length, after the 15 held by the token.
+ */
+static void WriteLength(std::vector<unsigned char>& output, size_t length)
+{
+    while (length >= 255)
+    {
+        output.push_back(255);
+        length -= 255;
+    }
+
+    output.push_back(static_cast<unsigned char>(length));
+}
+
+/**
+ * \brief Writes a sequence of literals, optionally followed by a match.
+ * \param output The compressed block.
+ * \param literals The literal bytes.
+ * \param literal_length The number of literal bytes.
+ * \param offset The distance back to the match, or zero for the final literals of the block.
+ * \param match_length The length of the match.
+ */
+static void WriteSequence(std::vector<unsigned char>& output, const unsigned char* literals, const size_t literal_length,
+                          const size_t offset, const size_t match_length)
+{
+    const size_t extra_match = offset != 0 ? match_length - MIN_MATCH : 0;
+
+    output.push_back(static_cast<unsigned char>(std::min<size_t>(literal_length, 15) << 4 | std::min<size_t>(extra_match, 15)));
+
+    if (literal_length >= 15)
+    {
+        WriteLength(output, literal_length - 15);
+    }
+
+    output.insert(output.end(), literals, literals + literal_length);
+
+    if (offset == 0) return;
+
+    output.push_back(static_cast<unsigned char>(offset & 0xFF));
+    output.push_back(static_cast<unsigned char>(offset >> 8));
+
+    if (extra_match >= 15)
+    {
+        WriteLength(output, extra_match - 15);
+    }
+}
+
+/**
+ * \brief Compresses a block of bytes into the LZ4 block format.
+ * This is safe to call from any thread.
+ * \param data The bytes to compress.
+ * \param size The number of bytes to compress.
+ * \return The compressed block.
+ */
+std::vector<unsigned char> Lz4Compress(const unsigned char* data, const size_t size)
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::vector<unsigned char> output;
+    output.reserve(size + size / 255 + 16);
+
+    size_t anchor = 0;
+
+    if (size > MATCH_FIND_LIMIT)
+    {
+        // Positions are stored plus one, so zero marks an empty slot.
+        std::vector<uint32_t> table(size_t{ 1 } << HASH_LOG, 0);
+
+        // The format requires the last match to start at least 12 bytes before the end of the block,
+        // and the last 5 bytes to be literals.
+        const size_t match_limit = size - MATCH_FIND_LIMIT;
+        const size_t end_limit = size - LAST_LITERALS;
+        size_t position = 0;
+
+        while (position < match_limit)
+        {
+            const uint32_t sequence = Read32(data + position);
+            const uint32_t hash = HashSequence(sequence);
+            const size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(position + 1);
+
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(data + candidate - 1) != sequence)
+            {
+                position++;
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (position + length < end_limit && data[match + length] == data[position + length])
+            {
+                length++;
+            }
+
+            WriteSequence(output, data + anchor, position - anchor, position - match, length);
+
+            position += length;
+            anchor = position;
+        }
+    }
+
+    WriteSequence(output, data + anchor, size - anchor, 0, 0);
+
+    return output;
+}
+
+/**
+ * \brief Reads the extra bytes of a literal or match length that did not fit in its token.
+ * \param data The compressed block.
+ * \param position The position within the compressed block, which is advanced past the length.
+ * \param end The end of the compressed block.
+ * \param length The length to add the extra bytes to.
+ * \return A boolean value indicating if the length was read without overrunning the block.
+ */
+static bool ReadLength(const unsigned char* data, size_t& position, const size_t end, size_t& length)
+{
+    unsigned char byte;
+
+    do
+    {
+        if (position >= end) return false;
+
+        byte = data[position++];
+        length += byte;
+    }
+    while (byte == 255);
+
+    return true;
+}
+
+/**
+ * \brief Decompresses a block in the LZ4 block format, checking every length and offset so that
+ * corrupt data cannot read or write out of bounds. This is safe to call from any thread.
+ * \param data The compressed block.
+ * \param size The size of the compressed block in bytes.
+ * \param output The buffer to decompress into.
+ * \param output_size The exact size of the decompressed data in bytes.
+ * \return A boolean value indicating if the block was decompressed successfully.
+ */
+bool Lz4Decompress(const unsigned char* data, const size_t size, unsigned char* output, const size_t output_size)
+{
+    DFM_PROFILE_FUNCTION();
+
+    size_t position = 0;
+    size_t written = 0;
+
+    while (position < size)
+    {
+        const unsigned char token = data[position++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !ReadLength(data, position, size, literal_length)) return false;
+
+        if (literal_length > size - position || literal_length > output_size - written) return false;
+
+        if (literal_length != 0)
+        {
+            std::memcpy(output + written, data + position, literal_length);
+        }
+
+        position += literal_length;
+        written += literal_length;
+
+        // The final sequence of a block has no match.
+        if (position == size) break;
+
+        if (size - position < 2) return false;
+
+        const size_t offset = data[position] | static_cast<size_t>(data[position + 1]) << 8;
+        position += 2;
+
+        if (offset == 0 || offset > written) return false;
+
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !ReadLength(data, position, size, match_length)) return false;
+        match_length += MIN_MATCH;
+
+        if (match_length > output_size - written) return false;
+
+        const unsigned char* match = output + written - offset;
+
+        if (offset >= match_length)
+        {
+            std::memcpy(output + written, match, match_length);
+        }
+        else
+        {
+            // Overlapping matches repeat the bytes that were just written, so copy one at a time.
+            for (size_t i = 0; i < match_length; i++)
+            {
+                output[written + i] = match[i];
+            }
+        }
+
+        written += match_length;
+    }
+
+    return written == output_size;
+}
@@ -0,0 +1,31 @@
+/**
+ * \file lz4.h
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * \brief Compresses a block of bytes into the LZ4 block format.
+ * This is safe to call from any thread.
+ * \param data The bytes to compress.
+ * \param size The number of bytes to compress.
+ * \return The compressed block.
+ */
+std::vector<unsigned char> Lz4Compress(const unsigned char* data, size_t size);
+
+/**
+ * \brief Decompresses a block in the LZ4 block format, checking every length and offset so that
+ * corrupt data cannot read or write out of bounds. This is safe to call from any thread.
+ * \param data The compressed block.
+ * \param size The size of the compressed block in bytes.
+ * \param output The buffer to decompress into.
+ * \param output_size The exact size of the decompressed data in bytes.
+ * \return A boolean value indicating if the block was decompressed successfully.
+ */
+bool Lz4Decompress(const unsigned char* data, size_t size, unsigned char* output, size_t output_size);
+
+#endif // LZ4_H
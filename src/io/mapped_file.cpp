@@ -0,0 +1,149 @@
+/**
+ * \file mapped_file.cpp
+ */
+
+#include "mapped_file.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data{ std::exchange(other.m_data, nullptr) },
+#ifdef _WIN32
+    m_file{ std::exchange(other.m_file, nullptr) },
+    m_mapping{ std::exchange(other.m_mapping, nullptr) },
+#endif
+    m_size{ std::exchange(other.m_size, 0) }
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_file = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+/**
+ * \brief Maps the file at the specified path, replacing any file that is currently mapped.
+ * \param path The path to the file.
+ * \return A boolean value indicating if the file was mapped successfully.
+ */
+bool MappedFile::Open(const std::string& path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        DFM_CORE_ERROR("Failed to open '{0}' for mapping.", path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        DFM_CORE_ERROR("Failed to map '{0}', the file is empty.", path);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data == nullptr)
+    {
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+        DFM_CORE_ERROR("Failed to map '{0}'.", path);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        DFM_CORE_ERROR("Failed to open '{0}' for mapping.", path);
+        return false;
+    }
+
+    struct stat status{};
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        close(file);
+        DFM_CORE_ERROR("Failed to map '{0}', the file is empty.", path);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps its own reference to the file.
+    close(file);
+
+    if (data == MAP_FAILED)
+    {
+        DFM_CORE_ERROR("Failed to map '{0}'.", path);
+        return false;
+    }
+
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = static_cast<size_t>(status.st_size);
+#endif
+
+    return true;
+}
+
+/**
+ * \brief Unmaps the file.
+ */
+void MappedFile::Close()
+{
+    if (m_data == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * \file mapped_file.h
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \brief Represents a read-only view of an entire file mapped into the address space of the process.
+ * Pages are read from disk on first access, so mapping a large file costs a single open.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * \brief Maps the file at the specified path, replacing any file that is currently mapped.
+     * \param path The path to the file.
+     * \return A boolean value indicating if the file was mapped successfully.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * \brief Unmaps the file.
+     */
+    void Close();
+
+    /**
+     * \brief Gets the first byte of the mapped file.
+     * \return The mapped bytes, or null if no file is mapped.
+     */
+    [[nodiscard]] const unsigned char* GetData() const { return m_data; }
+
+    /**
+     * \brief Gets the size of the mapped file.
+     * \return The size in bytes.
+     */
+    [[nodiscard]] size_t GetSize() const { return m_size; }
+
+    /**
+     * \brief Determines if a file is mapped.
+     * \return A boolean value indicating if a file is mapped.
+     */
+    [[nodiscard]] bool IsOpen() const { return m_data != nullptr; }
+
+private:
+    const unsigned char* m_data = nullptr;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+
+    size_t m_size = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,363 @@
+/**
+ * \file pak_archive.cpp
+ */
+
+#include "pak_archive.h"
+#include "lz4.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifdef DFM_ZSTD
+#include <zstd.h>
+#endif
+
+constexpr unsigned char PAK_MAGIC[4] = { 'D', 'P', 'A', 'K' };
+constexpr uint32_t PAK_VERSION = 1;
+constexpr size_t PAK_HEADER_SIZE = 32;
+constexpr size_t PAK_ENTRY_FIXED_SIZE = 32;
+constexpr size_t PAK_DATA_ALIGNMENT = 16;
+
+// Compressed entries must save at least this fraction of their size to be worth decompressing.
+constexpr double PAK_MIN_COMPRESSION_RATIO = 0.95;
+
+#ifdef DFM_ZSTD
+constexpr int PAK_ZSTD_LEVEL = 19;
+#endif
+
+/**
+ * \brief Reads a little-endian value from a byte buffer.
+ * \tparam T The type of value to read.
+ * \param data The buffer to read from.
+ * \return The value.
+ */
+template <typename T>
+static T ReadValue(const unsigned char* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/**
+ * \brief Appends a little-endian value to a byte buffer.
+ * \tparam T The type of value to write.
+ * \param data The buffer to write to.
+ * \param value The value.
+ */
+template <typename T>
+static void WriteValue(std::vector<unsigned char>& data, const T value)
+{
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * \brief Compresses the data of a file being packed.
+ * \param source The file being packed.
+ * \param compressed The buffer to write the compressed data into.
+ * \return A boolean value indicating if the data was compressed.
+ */
+static bool Compress(const PakSource& source, std::vector<unsigned char>& compressed)
+{
+    DFM_PROFILE_FUNCTION();
+
+    switch (source.compression)
+    {
+    case PakCompression::Lz4:
+        compressed = Lz4Compress(source.data.data(), source.data.size());
+        return true;
+#ifdef DFM_ZSTD
+    case PakCompression::Zstd:
+    {
+        compressed.resize(ZSTD_compressBound(source.data.size()));
+        const size_t size = ZSTD_compress(compressed.data(), compressed.size(), source.data.data(), source.data.size(),
+                                          PAK_ZSTD_LEVEL);
+        if (ZSTD_isError(size))
+        {
+            return false;
+        }
+
+        compressed.resize(size);
+        return true;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * \brief Maps the archive at the specified path and reads its table of contents.
+ * \param path The path to the archive.
+ * \return A boolean value indicating if the archive was opened successfully.
+ */
+bool PakArchive::Open(const std::string& path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    Close();
+
+    if (!m_file.Open(path))
+    {
+        return false;
+    }
+
+    m_path = path;
+
+    if (!ReadTableOfContents())
+    {
+        DFM_CORE_ERROR("Failed to open pak archive '{0}', the archive is corrupt or from a different version.", path);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Unmaps the archive.
+ */
+void PakArchive::Close()
+{
+    m_file.Close();
+    m_entries.clear();
+    m_lookup.clear();
+    m_path.clear();
+}
+
+/**
+ * \brief Finds the entry holding the file at the given path.
+ * \param path The normalised path of the file.
+ * \return The entry, or null if the archive does not contain the file.
+ */
+const PakEntry* PakArchive::Find(const std::string& path) const
+{
+    const auto it = m_lookup.find(path);
+    return it != m_lookup.end() ? &m_entries[it->second] : nullptr;
+}
+
+/**
+ * \brief Gets the entry's data as it is stored in the mapped archive.
+ * \param entry The entry to access.
+ * \return A pointer to the stored data, which is only the file contents if the entry is uncompressed.
+ */
+const unsigned char* PakArchive::GetStoredData(const PakEntry& entry) const
+{
+    return m_file.GetData() + entry.offset;
+}
+
+/**
+ * \brief Reads and decompresses the entry's data.
+ * \param entry The entry to read.
+ * \param output The buffer to read into, which must hold \code entry.size bytes.
+ * \return A boolean value indicating if the entry was read successfully.
+ */
+bool PakArchive::Read(const PakEntry& entry, unsigned char* output) const
+{
+    DFM_PROFILE_FUNCTION();
+
+    const unsigned char* stored = GetStoredData(entry);
+    const auto stored_size = static_cast<size_t>(entry.stored_size);
+    const auto size = static_cast<size_t>(entry.size);
+
+    bool read = false;
+
+    switch (entry.compression)
+    {
+    case PakCompression::None:
+        std::memcpy(output, stored, size);
+        read = true;
+        break;
+    case PakCompression::Lz4:
+        read = Lz4Decompress(stored, stored_size, output, size);
+        break;
+#ifdef DFM_ZSTD
+    case PakCompression::Zstd:
+        read = ZSTD_decompress(output, size, stored, stored_size) == size;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (!read)
+    {
+        DFM_CORE_ERROR("Failed to read '{0}' from pak archive '{1}'.", entry.path, m_path);
+    }
+
+    return read;
+}
+
+/**
+ * \brief Writes an archive holding the given files. Entries that do not shrink enough when
+ * compressed are stored uncompressed instead.
+ * \param path The path of the archive to write.
+ * \param sources The files to write, in the order their data should be laid out.
+ * \return A boolean value indicating if the archive was written successfully.
+ */
+bool PakArchive::Write(const std::string& path, const std::vector<PakSource>& sources)
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::ofstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        DFM_CORE_ERROR("Failed to open '{0}' for writing.", path);
+        return false;
+    }
+
+    // The header is written last, once the position of the table of contents is known.
+    const std::vector<unsigned char> padding(PAK_HEADER_SIZE, 0);
+    file.write(reinterpret_cast<const char*>(padding.data()), PAK_HEADER_SIZE);
+
+    std::vector<unsigned char> toc;
+    std::vector<unsigned char> compressed;
+    uint64_t offset = PAK_HEADER_SIZE;
+
+    for (const PakSource& source : sources)
+    {
+        const unsigned char* stored = source.data.data();
+        size_t stored_size = source.data.size();
+        PakCompression compression = PakCompression::None;
+
+        if (source.compression != PakCompression::None && Compress(source, compressed) &&
+            static_cast<double>(compressed.size()) < static_cast<double>(source.data.size()) * PAK_MIN_COMPRESSION_RATIO)
+        {
+            stored = compressed.data();
+            stored_size = compressed.size();
+            compression = source.compression;
+        }
+
+        WriteValue<uint64_t>(toc, offset);
+        WriteValue<uint64_t>(toc, stored_size);
+        WriteValue<uint64_t>(toc, source.data.size());
+        WriteValue<uint32_t>(toc, static_cast<uint32_t>(compression));
+        WriteValue<uint32_t>(toc, static_cast<uint32_t>(source.path.size()));
+        toc.insert(toc.end(), source.path.begin(), source.path.end());
+
+        // Align every entry so uncompressed data can be used in place.
+        const size_t padding_size = (PAK_DATA_ALIGNMENT - stored_size % PAK_DATA_ALIGNMENT) % PAK_DATA_ALIGNMENT;
+
+        file.write(reinterpret_cast<const char*>(stored), static_cast<std::streamsize>(stored_size));
+        file.write(reinterpret_cast<const char*>(padding.data()), static_cast<std::streamsize>(padding_size));
+        offset += stored_size + padding_size;
+    }
+
+    file.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size()));
+
+    std::vector<unsigned char> header{ std::begin(PAK_MAGIC), std::end(PAK_MAGIC) };
+    WriteValue<uint32_t>(header, PAK_VERSION);
+    WriteValue<uint32_t>(header, static_cast<uint32_t>(sources.size()));
+    WriteValue<uint32_t>(header, 0); // Reserved
+    WriteValue<uint64_t>(header, offset);
+    WriteValue<uint64_t>(header, toc.size());
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    if (!file)
+    {
+        DFM_CORE_ERROR("Failed to write pak archive '{0}'.", path);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Determines whether entries compressed with the given method can be read by this build.
+ * \param compression The compression method.
+ * \return A boolean value indicating if the compression method is supported.
+ */
+bool PakArchive::IsCompressionSupported(const PakCompression compression)
+{
+    switch (compression)
+    {
+    case PakCompression::None:
+    case PakCompression::Lz4:
+        return true;
+    case PakCompression::Zstd:
+#ifdef DFM_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * \brief Parses the table of contents at the end of the mapped archive.
+ * \return A boolean value indicating if the table of contents is valid.
+ */
+bool PakArchive::ReadTableOfContents()
+{
+    DFM_PROFILE_FUNCTION();
+
+    const unsigned char* data = m_file.GetData();
+    const size_t size = m_file.GetSize();
+
+    if (size < PAK_HEADER_SIZE || std::memcmp(data, PAK_MAGIC, sizeof(PAK_MAGIC)) != 0 ||
+        ReadValue<uint32_t>(data + 4) != PAK_VERSION)
+    {
+        return false;
+    }
+
+    const auto entry_count = ReadValue<uint32_t>(data + 8);
+    const auto toc_offset = ReadValue<uint64_t>(data + 16);
+    const auto toc_size = ReadValue<uint64_t>(data + 24);
+
+    if (toc_offset > size || toc_size > size - toc_offset)
+    {
+        return false;
+    }
+
+    m_entries.reserve(entry_count);
+    m_lookup.reserve(entry_count);
+
+    const unsigned char* toc = data + toc_offset;
+    size_t position = 0;
+
+    for (uint32_t i = 0; i < entry_count; i++)
+    {
+        if (toc_size - position < PAK_ENTRY_FIXED_SIZE)
+        {
+            return false;
+        }
+
+        PakEntry entry;
+        entry.offset = ReadValue<uint64_t>(toc + position);
+        entry.stored_size = ReadValue<uint64_t>(toc + position + 8);
+        entry.size = ReadValue<uint64_t>(toc + position + 16);
+        entry.compression = static_cast<PakCompression>(ReadValue<uint32_t>(toc + position + 24));
+        const auto path_length = ReadValue<uint32_t>(toc + position + 28);
+        position += PAK_ENTRY_FIXED_SIZE;
+
+        if (toc_size - position < path_length || entry.offset > toc_offset ||
+            entry.stored_size > toc_offset - entry.offset ||
+            (entry.compression == PakCompression::None && entry.stored_size != entry.size))
+        {
+            return false;
+        }
+
+        entry.path.assign(reinterpret_cast<const char*>(toc + position), path_length);
+        position += path_length;
+
+        if (!IsCompressionSupported(entry.compression))
+        {
+            DFM_CORE_WARN("Skipping '{0}' in pak archive '{1}', its compression is not supported by this build.",
+                          entry.path, m_path);
+            continue;
+        }
+
+        m_lookup[entry.path] = m_entries.size();
+        m_entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
@@ -0,0 +1,158 @@
+/**
+ * \file pak_archive.h
+ */
+
+#ifndef PAK_ARCHIVE_H
+#define PAK_ARCHIVE_H
+
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief The ways an entry's data can be stored in a pak archive.
+ */
+enum class PakCompression : uint32_t
+{
+    None = 0,
+    Lz4 = 1,
+    Zstd = 2
+};
+
+/**
+ * \brief Describes a file stored in a pak archive.
+ */
+struct PakEntry
+{
+    /**
+     * \brief The normalised path of the file, relative to the directory it was packed from.
+     */
+    std::string path;
+
+    /**
+     * \brief The position of the entry's data from the start of the archive.
+     */
+    uint64_t offset;
+
+    /**
+     * \brief The size of the entry's data within the archive.
+     */
+    uint64_t stored_size;
+
+    /**
+     * \brief The size of the file once decompressed.
+     */
+    uint64_t size;
+
+    /**
+     * \brief The way the entry's data is stored within the archive.
+     */
+    PakCompression compression;
+};
+
+/**
+ * \brief Describes a file to be written into a pak archive.
+ */
+struct PakSource
+{
+    std::string path;
+    std::vector<unsigned char> data;
+    PakCompression compression;
+};
+
+/**
+ * \brief Represents a read-only archive of many asset files packed into one memory-mapped file.
+ * The table of contents is read once when the archive is opened, after which entries are read
+ * straight from the mapping. Entries stored without compression can be accessed without copying.
+ * Once opened, an archive is safe to read from any thread.
+ */
+class PakArchive
+{
+public:
+    PakArchive() = default;
+
+    PakArchive(const PakArchive&) = delete;
+    PakArchive(PakArchive&&) noexcept = default;
+
+    PakArchive& operator=(const PakArchive&) = delete;
+    PakArchive& operator=(PakArchive&&) noexcept = default;
+
+    /**
+     * \brief Maps the archive at the specified path and reads its table of contents.
+     * \param path The path to the archive.
+     * \return A boolean value indicating if the archive was opened successfully.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * \brief Unmaps the archive.
+     */
+    void Close();
+
+    /**
+     * \brief Finds the entry holding the file at the given path.
+     * \param path The normalised path of the file.
+     * \return The entry, or null if the archive does not contain the file.
+     */
+    [[nodiscard]] const PakEntry* Find(const std::string& path) const;
+
+    /**
+     * \brief Gets the entry's data as it is stored in the mapped archive.
+     * \param entry The entry to access.
+     * \return A pointer to the stored data, which is only the file contents if the entry is uncompressed.
+     */
+    [[nodiscard]] const unsigned char* GetStoredData(const PakEntry& entry) const;
+
+    /**
+     * \brief Reads and decompresses the entry's data.
+     * \param entry The entry to read.
+     * \param output The buffer to read into, which must hold \code entry.size bytes.
+     * \return A boolean value indicating if the entry was read successfully.
+     */
+    bool Read(const PakEntry& entry, unsigned char* output) const;
+
+    /**
+     * \brief Gets every entry in the archive.
+     * \return The archive's entries.
+     */
+    [[nodiscard]] const std::vector<PakEntry>& GetEntries() const { return m_entries; }
+
+    /**
+     * \brief Gets the path the archive was opened from.
+     * \return The archive's path.
+     */
+    [[nodiscard]] const std::string& GetPath() const { return m_path; }
+
+    /**
+     * \brief Writes an archive holding the given files. Entries that do not shrink enough when
+     * compressed are stored uncompressed instead.
+     * \param path The path of the archive to write.
+     * \param sources The files to write, in the order their data should be laid out.
+     * \return A boolean value indicating if the archive was written successfully.
+     */
+    static bool Write(const std::string& path, const std::vector<PakSource>& sources);
+
+    /**
+     * \brief Determines whether entries compressed with the given method can be read by this build.
+     * \param compression The compression method.
+     * \return A boolean value indicating if the compression method is supported.
+     */
+    [[nodiscard]] static bool IsCompressionSupported(PakCompression compression);
+
+private:
+    std::string m_path;
+    MappedFile m_file;
+    std::vector<PakEntry> m_entries;
+    std::unordered_map<std::string, size_t> m_lookup;
+
+    /**
+     * \brief Parses the table of contents at the end of the mapped archive.
+     * \return A boolean value indicating if the table of contents is valid.
+     */
+    bool ReadTableOfContents();
+};
+
+#endif // PAK_ARCHIVE_H
@@ -0,0 +1,288 @@
+/**
+ * \file virtual_file_system.cpp
+ */
+
+#include "virtual_file_system.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+VirtualFileSystem VirtualFileSystem::s_instance;
+
+FileView::FileView()
+    : m_data{ nullptr },
+    m_size{},
+    m_valid{ false }
+{
+}
+
+/**
+ * \brief Creates a view of bytes owned by a mounted archive.
+ * \param data The first byte of the file.
+ * \param size The size of the file in bytes.
+ */
+FileView::FileView(const unsigned char* data, const size_t size)
+    : m_data{ data },
+    m_size{ size },
+    m_valid{ true }
+{
+}
+
+/**
+ * \brief Creates a view that owns the contents of the file.
+ * \param contents The contents of the file.
+ */
+FileView::FileView(std::vector<unsigned char> contents)
+    : m_storage{ std::move(contents) },
+    m_data{ m_storage.data() },
+    m_size{ m_storage.size() },
+    m_valid{ true }
+{
+}
+
+/**
+ * \brief Takes the contents of the file, copying them only if the view points into an archive.
+ * \return The file's contents.
+ */
+std::vector<unsigned char> FileView::TakeContents()
+{
+    if (m_data != m_storage.data())
+    {
+        m_storage.assign(m_data, m_data + m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_valid = false;
+
+    return std::move(m_storage);
+}
+
+/**
+ * \brief Maps a pak archive and makes its files available.
+ * \param archive_path The path to the archive.
+ * \return A boolean value indicating if the archive was mounted successfully.
+ */
+bool VirtualFileSystem::Mount(const std::string& archive_path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    auto archive = std::make_unique<PakArchive>();
+    if (!archive->Open(archive_path))
+    {
+        return false;
+    }
+
+    DFM_CORE_INFO("Mounted pak archive '{0}' with {1} files.", archive_path, archive->GetEntries().size());
+
+    std::unique_lock lock{ Get().m_mutex };
+    Get().m_archives.push_back(std::move(archive));
+
+    return true;
+}
+
+/**
+ * \brief Unmounts a pak archive. Views into the archive must not be used afterwards.
+ * \param archive_path The path the archive was mounted from.
+ */
+void VirtualFileSystem::Unmount(const std::string& archive_path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::unique_lock lock{ Get().m_mutex };
+
+    auto& archives = Get().m_archives;
+    archives.erase(std::remove_if(archives.begin(), archives.end(),
+        [&archive_path](const std::unique_ptr<PakArchive>& archive) { return archive->GetPath() == archive_path; }),
+        archives.end());
+}
+
+/**
+ * \brief Unmounts every pak archive.
+ */
+void VirtualFileSystem::UnmountAll()
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::unique_lock lock{ Get().m_mutex };
+    Get().m_archives.clear();
+}
+
+/**
+ * \brief Determines whether a file exists in a mounted archive or on disk.
+ * \param path The path to the file.
+ * \return A boolean value indicating if the file exists.
+ */
+bool VirtualFileSystem::Exists(const std::string& path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    {
+        std::shared_lock lock{ Get().m_mutex };
+
+        const PakEntry* entry;
+        if (Get().Find(NormalisePath(path), entry) != nullptr)
+        {
+            return true;
+        }
+    }
+
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+/**
+ * \brief Determines whether a file is held by a mounted archive rather than on disk.
+ * \param path The path to the file.
+ * \return A boolean value indicating if the file is in a mounted archive.
+ */
+bool VirtualFileSystem::IsArchived(const std::string& path)
+{
+    std::shared_lock lock{ Get().m_mutex };
+
+    const PakEntry* entry;
+    return Get().Find(NormalisePath(path), entry) != nullptr;
+}
+
+/**
+ * \brief Opens a file, without copying it if it is stored uncompressed in a mounted archive.
+ * \param path The path to the file.
+ * \return The file's contents, which are invalid if the file could not be read.
+ */
+FileView VirtualFileSystem::Open(const std::string& path)
+{
+    DFM_PROFILE_FUNCTION();
+
+    {
+        std::shared_lock lock{ Get().m_mutex };
+
+        const PakEntry* entry;
+        if (const PakArchive* archive = Get().Find(NormalisePath(path), entry))
+        {
+            if (entry->compression == PakCompression::None)
+            {
+                return FileView{ archive->GetStoredData(*entry), static_cast<size_t>(entry->size) };
+            }
+
+            std::vector<unsigned char> contents(static_cast<size_t>(entry->size));
+            if (!archive->Read(*entry, contents.data()))
+            {
+                return FileView{};
+            }
+
+            return FileView{ std::move(contents) };
+        }
+    }
+
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return FileView{};
+    }
+
+    return FileView{ std::vector<unsigned char>{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} } };
+}
+
+/**
+ * \brief Reads the entire contents of a file into a buffer.
+ * \param path The path to the file.
+ * \param contents The buffer to read the contents into.
+ * \return A boolean value indicating if the file was read successfully.
+ */
+bool VirtualFileSystem::ReadFile(const std::string& path, std::vector<unsigned char>& contents)
+{
+    DFM_PROFILE_FUNCTION();
+
+    {
+        std::shared_lock lock{ Get().m_mutex };
+
+        const PakEntry* entry;
+        if (const PakArchive* archive = Get().Find(NormalisePath(path), entry))
+        {
+            contents.resize(static_cast<size_t>(entry->size));
+            return archive->Read(*entry, contents.data());
+        }
+    }
+
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+    return true;
+}
+
+/**
+ * \brief Reads the entire contents of a text file into a string.
+ * \param path The path to the file.
+ * \param contents The string to read the contents into.
+ * \return A boolean value indicating if the file was read successfully.
+ */
+bool VirtualFileSystem::ReadTextFile(const std::string& path, std::string& contents)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const FileView file = Open(path);
+    if (!file.IsValid())
+    {
+        return false;
+    }
+
+    contents.assign(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+    return true;
+}
+
+/**
+ * \brief Converts a path into the form used by archive entries: relative to the working
+ * directory, lexically normal and separated by forward slashes.
+ * \param path The path to normalise.
+ * \return The normalised path.
+ */
+std::string VirtualFileSystem::NormalisePath(const std::string& path)
+{
+    std::string separated = path;
+    std::replace(separated.begin(), separated.end(), '\\', '/');
+
+    std::filesystem::path normalised{ separated };
+
+    if (normalised.is_absolute())
+    {
+        std::error_code error;
+        const std::filesystem::path relative = normalised.lexically_relative(std::filesystem::current_path(error));
+
+        // Paths outside the working directory cannot be inside an archive, so leave them absolute.
+        if (!error && !relative.empty() && *relative.begin() != "..")
+        {
+            normalised = relative;
+        }
+    }
+
+    return normalised.lexically_normal().generic_string();
+}
+
+/**
+ * \brief Finds the most recently mounted archive containing a file.
+ * \param normalised_path The normalised path of the file.
+ * \param entry The entry holding the file, if it is found.
+ * \return The archive, or null if no mounted archive contains the file.
+ */
+const PakArchive* VirtualFileSystem::Find(const std::string& normalised_path, const PakEntry*& entry) const
+{
+    for (auto it = m_archives.rbegin(); it != m_archives.rend(); ++it)
+    {
+        if ((entry = (*it)->Find(normalised_path)) != nullptr)
+        {
+            return it->get();
+        }
+    }
+
+    return nullptr;
+}
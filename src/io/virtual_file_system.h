@@ -0,0 +1,177 @@
+/**
+ * \file virtual_file_system.h
+ */
+
+#ifndef VIRTUAL_FILE_SYSTEM_H
+#define VIRTUAL_FILE_SYSTEM_H
+
+#include "pak_archive.h"
+
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Represents the contents of a file opened through the virtual file system. Uncompressed
+ * files inside a mounted archive point straight into the mapping, while every other file owns a copy
+ * of its contents. A view into an archive is only valid while the archive stays mounted.
+ */
+class FileView
+{
+public:
+    FileView();
+
+    FileView(const FileView&) = delete;
+    FileView(FileView&&) noexcept = default;
+
+    FileView& operator=(const FileView&) = delete;
+    FileView& operator=(FileView&&) noexcept = default;
+
+    /**
+     * \brief Creates a view of bytes owned by a mounted archive.
+     * \param data The first byte of the file.
+     * \param size The size of the file in bytes.
+     */
+    FileView(const unsigned char* data, size_t size);
+
+    /**
+     * \brief Creates a view that owns the contents of the file.
+     * \param contents The contents of the file.
+     */
+    explicit FileView(std::vector<unsigned char> contents);
+
+    /**
+     * \brief Gets the first byte of the file.
+     * \return The file's contents.
+     */
+    [[nodiscard]] const unsigned char* GetData() const { return m_data; }
+
+    /**
+     * \brief Gets the size of the file.
+     * \return The size in bytes.
+     */
+    [[nodiscard]] size_t GetSize() const { return m_size; }
+
+    /**
+     * \brief Determines whether the file was opened successfully.
+     * \return A boolean value indicating if the view holds the file's contents.
+     */
+    [[nodiscard]] bool IsValid() const { return m_valid; }
+
+    /**
+     * \brief Takes the contents of the file, copying them only if the view points into an archive.
+     * \return The file's contents.
+     */
+    [[nodiscard]] std::vector<unsigned char> TakeContents();
+
+private:
+    std::vector<unsigned char> m_storage;
+    const unsigned char* m_data;
+    size_t m_size;
+    bool m_valid;
+};
+
+/**
+ * \brief A singleton class that resolves asset paths against mounted pak archives before falling
+ * back to loose files on disk. Archives mounted later take priority, so a patch archive can override
+ * files in the base one. Files can be read from any thread.
+ */
+class VirtualFileSystem
+{
+public:
+    VirtualFileSystem(const VirtualFileSystem&) = delete;
+    VirtualFileSystem(VirtualFileSystem&&) noexcept = delete;
+
+    VirtualFileSystem& operator=(const VirtualFileSystem&) = delete;
+    VirtualFileSystem& operator=(VirtualFileSystem&&) noexcept = delete;
+
+    /**
+     * \brief Maps a pak archive and makes its files available.
+     * \param archive_path The path to the archive.
+     * \return A boolean value indicating if the archive was mounted successfully.
+     */
+    static bool Mount(const std::string& archive_path);
+
+    /**
+     * \brief Unmounts a pak archive. Views into the archive must not be used afterwards.
+     * \param archive_path The path the archive was mounted from.
+     */
+    static void Unmount(const std::string& archive_path);
+
+    /**
+     * \brief Unmounts every pak archive.
+     */
+    static void UnmountAll();
+
+    /**
+     * \brief Determines whether a file exists in a mounted archive or on disk.
+     * \param path The path to the file.
+     * \return A boolean value indicating if the file exists.
+     */
+    [[nodiscard]] static bool Exists(const std::string& path);
+
+    /**
+     * \brief Determines whether a file is held by a mounted archive rather than on disk.
+     * \param path The path to the file.
+     * \return A boolean value indicating if the file is in a mounted archive.
+     */
+    [[nodiscard]] static bool IsArchived(const std::string& path);
+
+    /**
+     * \brief Opens a file, without copying it if it is stored uncompressed in a mounted archive.
+     * \param path The path to the file.
+     * \return The file's contents, which are invalid if the file could not be read.
+     */
+    static FileView Open(const std::string& path);
+
+    /**
+     * \brief Reads the entire contents of a file into a buffer.
+     * \param path The path to the file.
+     * \param contents The buffer to read the contents into.
+     * \return A boolean value indicating if the file was read successfully.
+     */
+    static bool ReadFile(const std::string& path, std::vector<unsigned char>& contents);
+
+    /**
+     * \brief Reads the entire contents of a text file into a string.
+     * \param path The path to the file.
+     * \param contents The string to read the contents into.
+     * \return A boolean value indicating if the file was read successfully.
+     */
+    static bool ReadTextFile(const std::string& path, std::string& contents);
+
+    /**
+     * \brief Converts a path into the form used by archive entries: relative to the working
+     * directory, lexically normal and separated by forward slashes.
+     * \param path The path to normalise.
+     * \return The normalised path.
+     */
+    [[nodiscard]] static std::string NormalisePath(const std::string& path);
+
+private:
+    std::vector<std::unique_ptr<PakArchive>> m_archives;
+    mutable std::shared_mutex m_mutex;
+
+    VirtualFileSystem() = default;
+    ~VirtualFileSystem() = default;
+
+    /**
+     * \brief Finds the most recently mounted archive containing a file.
+     * \param normalised_path The normalised path of the file.
+     * \param entry The entry holding the file, if it is found.
+     * \return The archive, or null if no mounted archive contains the file.
+     */
+    [[nodiscard]] const PakArchive* Find(const std::string& normalised_path, const PakEntry*& entry) const;
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static VirtualFileSystem& Get() { return s_instance; }
+
+    static VirtualFileSystem s_instance;
+};
+
+#endif // VIRTUAL_FILE_SYSTEM_H
@@ -3,19 +3,24 @@
  */
 
 #include "camera.h"
-#include "lighting.h"
-#include "ubo.h"
 #include "utils/profiling.h"
 
-#include "glm/gtc/type_ptr.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
+#include "glm/ext/matrix_transform.hpp"
 
-constexpr int VIEW_POSITION_OFFSET = 0;
+#include <algorithm>
+#include <cmath>
+
+constexpr float FIELD_OF_VIEW = 45.0f;
+constexpr float VIEWPORT_WIDTH = 800.0f;
+constexpr float VIEWPORT_HEIGHT = 600.0f;
+constexpr float NEAR_PLANE = 0.1f;
+constexpr float FAR_PLANE = 100.0f;
 
 Camera::Camera(const glm::vec3& position, const glm::vec3& target_position)
     : m_position{ position },
     m_target_position{ target_position }
 {
-    UpdateUboBlocks();
 }
 
 /**
@@ -27,7 +32,6 @@ void Camera::SetPosition(const glm::vec3& position)
     DFM_PROFILE_FUNCTION();
 
     m_position = position;
-    UpdateUboBlocks();
 }
 
 /**
@@ -39,7 +43,6 @@ void Camera::SetTarget(const glm::vec3& target_position)
     DFM_PROFILE_FUNCTION();
 
     m_target_position = target_position;
-    UpdateUboBlocks();
 }
 
 /**
@@ -52,20 +55,32 @@ glm::vec3 Camera::GetPosition() const
 }
 
 /**
-* \brief Updates the uniform buffer object (UBO) blocks for the camera.
-*/
-void Camera::UpdateUboBlocks() const
+ * \brief Gets the view matrix of the camera.
+ * \return The view matrix.
+ */
+glm::mat4 Camera::GetViewMatrix() const
 {
-    DFM_PROFILE_FUNCTION();
-
-    // Set view position
-    glm::vec4 position{ m_position.x, m_position.y, m_position.z, 0.0f };
-    UboManager::Retrieve("lighting").SetSubData(VIEW_POSITION_OFFSET, sizeof(Lighting::view_position), glm::value_ptr(position));
+    return glm::lookAt(m_position, m_target_position, { 0.0f, 1.0f, 0.0f });
+}
 
-    // Set matrices (view and projection)
-    glm::mat4 view = glm::lookAt(m_position, m_target_position, { 0.0f, 1.0f, 0.0f });
-    UboManager::Retrieve("matrices").SetSubData(0, sizeof(glm::mat4), glm::value_ptr(view));
+/**
+ * \brief Gets the projection matrix of the camera.
+ * \return The projection matrix.
+ */
+glm::mat4 Camera::GetProjectionMatrix() const
+{
+    return glm::perspective(FIELD_OF_VIEW, VIEWPORT_WIDTH / VIEWPORT_HEIGHT, NEAR_PLANE, FAR_PLANE);
+}
 
-    glm::mat4 projection = glm::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
-    UboManager::Retrieve("matrices").SetSubData(sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projection));
+/**
+ * \brief Estimates the height on screen of an object viewed by the camera.
+ * \param size The world-space size of the object.
+ * \param distance The distance from the camera to the object.
+ * \return The object's projected size in pixels.
+ */
+float Camera::GetProjectedSize(const float size, const float distance) const
+{
+    // Matches the projection matrix, which treats the field of view as radians.
+    const float visible_height = 2.0f * std::max(distance, NEAR_PLANE) * std::tan(FIELD_OF_VIEW * 0.5f);
+    return size / visible_height * VIEWPORT_HEIGHT;
 }
\ No newline at end of file
@@ -34,14 +34,29 @@ public:
      */
     [[nodiscard]] glm::vec3 GetPosition() const;
 
-private:
-    glm::vec3 m_position;
-    glm::vec3 m_target_position;
+    /**
+     * \brief Gets the view matrix of the camera.
+     * \return The view matrix.
+     */
+    [[nodiscard]] glm::mat4 GetViewMatrix() const;
+
+    /**
+     * \brief Gets the projection matrix of the camera.
+     * \return The projection matrix.
+     */
+    [[nodiscard]] glm::mat4 GetProjectionMatrix() const;
 
     /**
-     * \brief Updates the uniform buffer object (UBO) blocks for the camera.
+     * \brief Estimates the height on screen of an object viewed by the camera.
+     * \param size The world-space size of the object.
+     * \param distance The distance from the camera to the object.
+     * \return The object's projected size in pixels.
      */
-    void UpdateUboBlocks() const;
+    [[nodiscard]] float GetProjectedSize(float size, float distance) const;
+
+private:
+    glm::vec3 m_position;
+    glm::vec3 m_target_position;
 };
 
 #endif // CAMERA_H
\ No newline at end of file
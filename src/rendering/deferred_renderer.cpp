@@ -0,0 +1,175 @@
+/**
+ * \file deferred_renderer.cpp
+ */
+
+#include "deferred_renderer.h"
+#include "utils/gl_state.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+/**
+ * \brief The size of the screen tiles that lights are culled against, which must match the work group
+ * size of the lighting compute shader.
+ */
+constexpr GLuint LIGHTING_TILE_SIZE = 16;
+
+DeferredRenderer::DeferredRenderer()
+    : m_framebuffer{ 0 },
+    m_albedo_specular{ 0 },
+    m_normal{ 0 },
+    m_depth{ 0 },
+    m_output_framebuffer{ 0 },
+    m_output{ 0 },
+    m_width{ 0 },
+    m_height{ 0 }
+{
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    Destroy();
+}
+
+/**
+ * \brief Binds and clears the G-buffer, resizing it to the viewport if needed. Geometry drawn until
+ * \code EndGeometryPass writes its albedo, specular intensity and normal to the G-buffer.
+ */
+void DeferredRenderer::BeginGeometryPass()
+{
+    DFM_PROFILE_FUNCTION();
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (viewport[2] != m_width || viewport[3] != m_height)
+    {
+        Destroy();
+        Create(viewport[2], viewport[3]);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    // Depth is cleared to the far plane, which the lighting pass treats as background.
+    constexpr GLfloat clear_colour[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    constexpr GLfloat clear_depth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, clear_colour);
+    glClearBufferfv(GL_COLOR, 1, clear_colour);
+    glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+}
+
+/**
+ * \brief Binds the default framebuffer again.
+ */
+void DeferredRenderer::EndGeometryPass()
+{
+    DFM_PROFILE_FUNCTION();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * \brief Lights the G-buffer with the lighting compute shader and copies the result to the default
+ * framebuffer. Pixels without geometry are set to the current clear colour.
+ * \param lighting_shader The tiled lighting compute shader.
+ */
+void DeferredRenderer::Shade(const Shader& lighting_shader)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (m_framebuffer == 0) return;
+
+    GLfloat background[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, background);
+
+    lighting_shader.Use();
+    lighting_shader.SetVec3("backgroundColour", background[0], background[1], background[2]);
+
+    GlState::BindTexture(0, GL_TEXTURE_2D, m_albedo_specular);
+    GlState::BindTexture(1, GL_TEXTURE_2D, m_normal);
+    GlState::BindTexture(2, GL_TEXTURE_2D, m_depth);
+
+    glBindImageTexture(0, m_output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    glDispatchCompute((m_width + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE,
+                      (m_height + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE, 1);
+
+    // The blit reads the image written by the compute shader.
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+    glBlitNamedFramebuffer(m_output_framebuffer, 0, 0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                           GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+/**
+ * \brief Creates the G-buffer and output textures at the given size.
+ * \param width The width in pixels.
+ * \param height The height in pixels.
+ */
+void DeferredRenderer::Create(const GLsizei width, const GLsizei height)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_width = width;
+    m_height = height;
+
+    if (width <= 0 || height <= 0) return;
+
+    const auto create_texture = [width, height](const GLenum internal_format)
+    {
+        GLuint texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, internal_format, width, height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    };
+
+    // Albedo with specular intensity in alpha, and normals precise enough for tight highlights.
+    m_albedo_specular = create_texture(GL_RGBA8);
+    m_normal = create_texture(GL_RGBA16F);
+    m_depth = create_texture(GL_DEPTH_COMPONENT32F);
+    m_output = create_texture(GL_RGBA8);
+
+    glCreateFramebuffers(1, &m_framebuffer);
+    glNamedFramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT0, m_albedo_specular, 0);
+    glNamedFramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT1, m_normal, 0);
+    glNamedFramebufferTexture(m_framebuffer, GL_DEPTH_ATTACHMENT, m_depth, 0);
+
+    constexpr GLenum draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(m_framebuffer, 2, draw_buffers);
+
+    if (glCheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        DFM_CORE_ERROR("G-buffer framebuffer is incomplete.");
+    }
+
+    glCreateFramebuffers(1, &m_output_framebuffer);
+    glNamedFramebufferTexture(m_output_framebuffer, GL_COLOR_ATTACHMENT0, m_output, 0);
+
+    DFM_CORE_INFO("Created {0}x{1} G-buffer.", width, height);
+}
+
+/**
+ * \brief Deletes the G-buffer and output textures.
+ */
+void DeferredRenderer::Destroy()
+{
+    DFM_PROFILE_FUNCTION();
+
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteFramebuffers(1, &m_output_framebuffer);
+    GlState::DeleteTexture(m_albedo_specular);
+    GlState::DeleteTexture(m_normal);
+    GlState::DeleteTexture(m_depth);
+    GlState::DeleteTexture(m_output);
+
+    m_framebuffer = 0;
+    m_output_framebuffer = 0;
+    m_albedo_specular = 0;
+    m_normal = 0;
+    m_depth = 0;
+    m_output = 0;
+    m_width = 0;
+    m_height = 0;
+}
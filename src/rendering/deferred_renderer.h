@@ -0,0 +1,70 @@
+/**
+ * \file deferred_renderer.h
+ */
+
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include "shader.h"
+
+#include "glad/glad.h"
+
+/**
+ * \brief Owns the G-buffer of the deferred render path and runs its lighting pass. Geometry is drawn
+ * into the G-buffer, and a compute shader then culls the lights per screen tile and shades each pixel
+ * once, writing the result to the default framebuffer. The G-buffer follows the size of the viewport.
+ */
+class DeferredRenderer
+{
+public:
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer(DeferredRenderer&&) noexcept = delete;
+
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(DeferredRenderer&&) noexcept = delete;
+
+    /**
+     * \brief Binds and clears the G-buffer, resizing it to the viewport if needed. Geometry drawn until
+     * \code EndGeometryPass writes its albedo, specular intensity and normal to the G-buffer.
+     */
+    void BeginGeometryPass();
+
+    /**
+     * \brief Binds the default framebuffer again.
+     */
+    void EndGeometryPass();
+
+    /**
+     * \brief Lights the G-buffer with the lighting compute shader and copies the result to the default
+     * framebuffer. Pixels without geometry are set to the current clear colour.
+     * \param lighting_shader The tiled lighting compute shader.
+     */
+    void Shade(const Shader& lighting_shader);
+
+private:
+    GLuint m_framebuffer;
+    GLuint m_albedo_specular;
+    GLuint m_normal;
+    GLuint m_depth;
+    GLuint m_output_framebuffer;
+    GLuint m_output;
+    GLsizei m_width;
+    GLsizei m_height;
+
+    /**
+     * \brief Creates the G-buffer and output textures at the given size.
+     * \param width The width in pixels.
+     * \param height The height in pixels.
+     */
+    void Create(GLsizei width, GLsizei height);
+
+    /**
+     * \brief Deletes the G-buffer and output textures.
+     */
+    void Destroy();
+};
+
+#endif // DEFERRED_RENDERER_H
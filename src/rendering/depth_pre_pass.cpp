@@ -0,0 +1,135 @@
+/**
+ * \file depth_pre_pass.cpp
+ */
+
+#include "depth_pre_pass.h"
+#include "utils/gl_extensions.h"
+#include "utils/profiling.h"
+
+DepthPrePass::DepthPrePass()
+    : m_queries{},
+    m_frame{ 0 },
+    m_in_depth_pass{ false },
+    m_shading_query_target{ static_cast<GLenum>(GlExtensions::HasPipelineStatisticsQuery() ? GL_FRAGMENT_SHADER_INVOCATIONS_ARB : GL_SAMPLES_PASSED) },
+    m_statistics{ 0, 0, 0, GlExtensions::HasPipelineStatisticsQuery() }
+{
+    for (auto& queries : m_queries)
+    {
+        glGenQueries(1, &queries.depth_pass);
+        glGenQueries(1, &queries.shading_pass);
+    }
+}
+
+DepthPrePass::~DepthPrePass()
+{
+    for (const auto& queries : m_queries)
+    {
+        glDeleteQueries(1, &queries.depth_pass);
+        glDeleteQueries(1, &queries.shading_pass);
+    }
+}
+
+/**
+ * \brief Starts the depth-only pass, which writes depth but no colour.
+ */
+void DepthPrePass::BeginDepthPass()
+{
+    DFM_PROFILE_FUNCTION();
+
+    CollectStatistics();
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    // Each sample passing the depth test here would have been shaded by the main pass without the pre-pass.
+    glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_frame].depth_pass);
+
+    m_queries[m_frame].depth_pass_used = true;
+    m_in_depth_pass = true;
+}
+
+/**
+ * \brief Starts the main pass. After a depth pass, only the fragments closest to the camera pass
+ * the depth test and depth writes are disabled.
+ */
+void DepthPrePass::BeginShadingPass()
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (m_in_depth_pass)
+    {
+        glEndQuery(GL_SAMPLES_PASSED);
+
+        // The vertex shaders declare gl_Position invariant, so the main pass produces exactly the depth
+        // written by the pre-pass, and GL_LEQUAL lets only the closest fragment of each pixel through.
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+
+        m_in_depth_pass = false;
+    }
+    else
+    {
+        CollectStatistics();
+        m_queries[m_frame].depth_pass_used = false;
+    }
+
+    glBeginQuery(m_shading_query_target, m_queries[m_frame].shading_pass);
+}
+
+/**
+ * \brief Ends the main pass and restores the default depth state.
+ */
+void DepthPrePass::EndShadingPass()
+{
+    DFM_PROFILE_FUNCTION();
+
+    glEndQuery(m_shading_query_target);
+
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    m_queries[m_frame].pending = true;
+    m_frame = (m_frame + 1) % QUERY_FRAMES;
+}
+
+/**
+ * \brief Gets the fragment shading measured in the latest frame whose queries have completed.
+ * \return The depth pre-pass statistics.
+ */
+DepthPrePassStatistics DepthPrePass::GetStatistics() const
+{
+    return m_statistics;
+}
+
+/**
+ * \brief Reads the results of the current frame's queries from their previous use, if they are available.
+ */
+void DepthPrePass::CollectStatistics()
+{
+    DFM_PROFILE_FUNCTION();
+
+    FrameQueries& queries = m_queries[m_frame];
+    if (!queries.pending) return;
+
+    queries.pending = false;
+
+    // The shading pass ends after the depth pass, so once its result is available both are.
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(queries.shading_pass, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) return;
+
+    GLuint64 shaded = 0;
+    GLuint64 without_pre_pass = 0;
+
+    glGetQueryObjectui64v(queries.shading_pass, GL_QUERY_RESULT, &shaded);
+    if (queries.depth_pass_used)
+    {
+        glGetQueryObjectui64v(queries.depth_pass, GL_QUERY_RESULT, &without_pre_pass);
+    }
+
+    m_statistics.fragments_shaded = shaded;
+    m_statistics.fragments_without_pre_pass = without_pre_pass;
+    m_statistics.fragments_saved = without_pre_pass > shaded ? without_pre_pass - shaded : 0;
+}
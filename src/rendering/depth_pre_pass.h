@@ -0,0 +1,110 @@
+/**
+ * \file depth_pre_pass.h
+ */
+
+#ifndef DEPTH_PRE_PASS_H
+#define DEPTH_PRE_PASS_H
+
+#include "glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Represents how much fragment shading the depth pre-pass saved in a recent frame.
+ */
+struct DepthPrePassStatistics
+{
+    /**
+     * \brief The fragments shaded by the main pass, counted as fragment shader invocations when
+     * pipeline statistics queries are supported and as samples passing the depth test otherwise.
+     */
+    uint64_t fragments_shaded;
+
+    /**
+     * \brief The samples that passed the depth test during the pre-pass, which the main pass would have
+     * shaded without it. Zero when the pre-pass is disabled.
+     */
+    uint64_t fragments_without_pre_pass;
+
+    /**
+     * \brief The fragments that the pre-pass kept from being shaded.
+     */
+    uint64_t fragments_saved;
+
+    /**
+     * \brief Determines if \code fragments_shaded counts fragment shader invocations.
+     */
+    bool counting_invocations;
+};
+
+/**
+ * \brief Sets up the GL state for an optional depth-only pass before the main pass, and measures the
+ * fragment shading it saves. Query results are read a few frames later so that the CPU never waits
+ * for the GPU.
+ */
+class DepthPrePass
+{
+public:
+    DepthPrePass();
+    ~DepthPrePass();
+
+    DepthPrePass(const DepthPrePass&) = delete;
+    DepthPrePass(DepthPrePass&&) noexcept = delete;
+
+    DepthPrePass& operator=(const DepthPrePass&) = delete;
+    DepthPrePass& operator=(DepthPrePass&&) noexcept = delete;
+
+    /**
+     * \brief Starts the depth-only pass, which writes depth but no colour.
+     */
+    void BeginDepthPass();
+
+    /**
+     * \brief Starts the main pass. After a depth pass, only the fragments closest to the camera pass
+     * the depth test and depth writes are disabled.
+     */
+    void BeginShadingPass();
+
+    /**
+     * \brief Ends the main pass and restores the default depth state.
+     */
+    void EndShadingPass();
+
+    /**
+     * \brief Gets the fragment shading measured in the latest frame whose queries have completed.
+     * \return The depth pre-pass statistics.
+     */
+    [[nodiscard]] DepthPrePassStatistics GetStatistics() const;
+
+private:
+    /**
+     * \brief The number of frames whose queries can be in flight at once.
+     */
+    static constexpr size_t QUERY_FRAMES = 3;
+
+    /**
+     * \brief Represents the queries issued in one frame.
+     */
+    struct FrameQueries
+    {
+        GLuint depth_pass;
+        GLuint shading_pass;
+        bool depth_pass_used;
+        bool pending;
+    };
+
+    std::array<FrameQueries, QUERY_FRAMES> m_queries;
+    size_t m_frame;
+    bool m_in_depth_pass;
+    GLenum m_shading_query_target;
+    DepthPrePassStatistics m_statistics;
+
+    /**
+     * \brief Reads the results of the current frame's queries from their previous use, if they are available.
+     */
+    void CollectStatistics();
+};
+
+#endif // DEPTH_PRE_PASS_H
@@ -19,27 +19,4 @@ struct DirectionalLightData
     glm::vec4 specular;
 };
 
-/**
- * \brief Represents a directional light in 3D space.
- */
-class DirectionalLight
-{
-public:
-    explicit DirectionalLight(DirectionalLightData data);
-
-    /**
-     * \brief Gets the directional light data.
-     * \return The directional light data.
-     */
-    [[nodiscard]] DirectionalLightData& GetData();
-
-private:
-    DirectionalLightData m_data;
-
-    /**
-     * \brief Initialises the directional light.
-     */
-    void Initialise() const;
-};
-
 #endif // DIRECTIONAL_LIGHT_H
@@ -0,0 +1,204 @@
+/**
+ * \file image.cpp
+ */
+
+#include "image.h"
+#include "utils/profiling.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <utility>
+
+Image::Image()
+    : m_data{ nullptr },
+    m_width{},
+    m_height{},
+    m_channels{}
+{
+}
+
+Image::~Image()
+{
+    Free();
+}
+
+Image::Image(Image&& other) noexcept
+    : m_data{ std::exchange(other.m_data, nullptr) },
+    m_width{ other.m_width },
+    m_height{ other.m_height },
+    m_channels{ other.m_channels }
+{
+}
+
+Image& Image::operator=(Image&& other) noexcept
+{
+    if (this != &other)
+    {
+        Free();
+
+        m_data = std::exchange(other.m_data, nullptr);
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_channels = other.m_channels;
+    }
+
+    return *this;
+}
+
+/**
+ * \brief Decodes the image at the specified file path.
+ * This is safe to call from any thread.
+ * \param path The path to the image file.
+ * \param desired_channels The number of channels to convert to, or zero to keep the file's channel count.
+ * \param flip_on_load Determines if the image should be flipped vertically upon load.
+ * \return A boolean value indicating if the image was decoded successfully.
+ */
+bool Image::Load(const std::string& path, const int desired_channels, const bool flip_on_load)
+{
+    DFM_PROFILE_FUNCTION();
+
+    Free();
+
+    // Use the per-thread flag so that concurrent decodes do not affect each other.
+    stbi_set_flip_vertically_on_load_thread(flip_on_load);
+    m_data = stbi_load(path.c_str(), &m_width, &m_height, &m_channels, desired_channels);
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    if (m_data && desired_channels != 0)
+    {
+        m_channels = desired_channels;
+    }
+
+    return m_data != nullptr;
+}
+
+/**
+ * \brief Decodes an encoded image held in memory.
+ * This is safe to call from any thread.
+ * \param data The encoded image data.
+ * \param size The size of the encoded image data in bytes.
+ * \param desired_channels The number of channels to convert to, or zero to keep the encoded channel count.
+ * \param flip_on_load Determines if the image should be flipped vertically upon load.
+ * \return A boolean value indicating if the image was decoded successfully.
+ */
+bool Image::LoadFromMemory(const unsigned char* data, const size_t size, const int desired_channels, const bool flip_on_load)
+{
+    DFM_PROFILE_FUNCTION();
+
+    Free();
+
+    stbi_set_flip_vertically_on_load_thread(flip_on_load);
+    m_data = stbi_load_from_memory(data, static_cast<int>(size), &m_width, &m_height, &m_channels, desired_channels);
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    if (m_data && desired_channels != 0)
+    {
+        m_channels = desired_channels;
+    }
+
+    return m_data != nullptr;
+}
+
+/**
+ * \brief Halves the size of the image the given number of times with a box filter, as when
+ * generating mipmaps. This is safe to call from any thread.
+ * \param levels The number of times to halve the image.
+ */
+void Image::Downsample(const int levels)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (int level = 0; level < levels && m_data && (m_width > 1 || m_height > 1); level++)
+    {
+        const int width = std::max(m_width / 2, 1);
+        const int height = std::max(m_height / 2, 1);
+
+        // Allocate with stb's allocator so the data is still released by Free.
+        auto* data = static_cast<unsigned char*>(STBI_MALLOC(static_cast<size_t>(width) * height * m_channels));
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const int x0 = std::min(x * 2, m_width - 1), x1 = std::min(x * 2 + 1, m_width - 1);
+                const int y0 = std::min(y * 2, m_height - 1), y1 = std::min(y * 2 + 1, m_height - 1);
+
+                for (int c = 0; c < m_channels; c++)
+                {
+                    const int sum =
+                        m_data[(static_cast<size_t>(y0) * m_width + x0) * m_channels + c] +
+                        m_data[(static_cast<size_t>(y0) * m_width + x1) * m_channels + c] +
+                        m_data[(static_cast<size_t>(y1) * m_width + x0) * m_channels + c] +
+                        m_data[(static_cast<size_t>(y1) * m_width + x1) * m_channels + c];
+
+                    data[(static_cast<size_t>(y) * width + x) * m_channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        Free();
+
+        m_data = data;
+        m_width = width;
+        m_height = height;
+    }
+}
+
+/**
+ * \brief Determines whether the image holds decoded pixel data.
+ * \return A boolean value indicating if the image holds pixel data.
+ */
+bool Image::IsValid() const
+{
+    return m_data != nullptr;
+}
+
+/**
+ * \brief Gets the width of the image.
+ * \return The image's width in pixels.
+ */
+int Image::GetWidth() const
+{
+    return m_width;
+}
+
+/**
+ * \brief Gets the height of the image.
+ * \return The image's height in pixels.
+ */
+int Image::GetHeight() const
+{
+    return m_height;
+}
+
+/**
+ * \brief Gets the number of channels in each pixel of the image.
+ * \return The image's number of channels.
+ */
+int Image::GetChannels() const
+{
+    return m_channels;
+}
+
+/**
+ * \brief Gets the decoded pixel data of the image.
+ * \return A pointer to the pixel data.
+ */
+const unsigned char* Image::GetData() const
+{
+    return m_data;
+}
+
+/**
+ * \brief Frees the pixel data held by the image.
+ */
+void Image::Free()
+{
+    if (m_data)
+    {
+        stbi_image_free(m_data);
+        m_data = nullptr;
+    }
+}
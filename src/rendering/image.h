@@ -0,0 +1,95 @@
+/**
+ * \file image.h
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \brief Represents an image that has been decoded into memory.
+ */
+class Image
+{
+public:
+    Image();
+    ~Image();
+
+    Image(const Image&) = delete;
+    Image(Image&& other) noexcept;
+
+    Image& operator=(const Image&) = delete;
+    Image& operator=(Image&& other) noexcept;
+
+    /**
+     * \brief Decodes the image at the specified file path.
+     * This is safe to call from any thread.
+     * \param path The path to the image file.
+     * \param desired_channels The number of channels to convert to, or zero to keep the file's channel count.
+     * \param flip_on_load Determines if the image should be flipped vertically upon load.
+     * \return A boolean value indicating if the image was decoded successfully.
+     */
+    bool Load(const std::string& path, int desired_channels = 0, bool flip_on_load = false);
+
+    /**
+     * \brief Decodes an encoded image held in memory.
+     * This is safe to call from any thread.
+     * \param data The encoded image data.
+     * \param size The size of the encoded image data in bytes.
+     * \param desired_channels The number of channels to convert to, or zero to keep the encoded channel count.
+     * \param flip_on_load Determines if the image should be flipped vertically upon load.
+     * \return A boolean value indicating if the image was decoded successfully.
+     */
+    bool LoadFromMemory(const unsigned char* data, size_t size, int desired_channels = 0, bool flip_on_load = false);
+
+    /**
+     * \brief Halves the size of the image the given number of times with a box filter, as when
+     * generating mipmaps. This is safe to call from any thread.
+     * \param levels The number of times to halve the image.
+     */
+    void Downsample(int levels);
+
+    /**
+     * \brief Determines whether the image holds decoded pixel data.
+     * \return A boolean value indicating if the image holds pixel data.
+     */
+    [[nodiscard]] bool IsValid() const;
+
+    /**
+     * \brief Gets the width of the image.
+     * \return The image's width in pixels.
+     */
+    [[nodiscard]] int GetWidth() const;
+
+    /**
+     * \brief Gets the height of the image.
+     * \return The image's height in pixels.
+     */
+    [[nodiscard]] int GetHeight() const;
+
+    /**
+     * \brief Gets the number of channels in each pixel of the image.
+     * \return The image's number of channels.
+     */
+    [[nodiscard]] int GetChannels() const;
+
+    /**
+     * \brief Gets the decoded pixel data of the image.
+     * \return A pointer to the pixel data.
+     */
+    [[nodiscard]] const unsigned char* GetData() const;
+
+private:
+    unsigned char* m_data;
+    int m_width, m_height;
+    int m_channels;
+
+    /**
+     * \brief Frees the pixel data held by the image.
+     */
+    void Free();
+};
+
+#endif // IMAGE_H
@@ -0,0 +1,533 @@
+/**
+ * \file ktx2.cpp
+ */
+
+#include "ktx2.h"
+#include "utils/gl_extensions.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+constexpr unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+constexpr size_t KTX2_HEADER_SIZE = 80;
+constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+constexpr char KTX2_ORIENTATION_KEY[] = "KTXorientation";
+
+// Khronos data format descriptor values used by the basic descriptor block.
+constexpr uint32_t KHR_DF_VERSION = 2;
+constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint32_t KHR_DF_CHANNEL_COLOR = 0;
+constexpr uint32_t KHR_DF_CHANNEL_GREEN = 1;
+constexpr uint32_t KHR_DF_CHANNEL_BC1A_ALPHA = 1;
+constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+constexpr uint32_t KHR_DF_SAMPLE_SIGNED = 0x40;
+
+/**
+ * \brief Reads a little-endian value from a byte buffer.
+ * \tparam T The type of value to read.
+ * \param data The buffer to read from.
+ * \param offset The offset of the value within the buffer.
+ * \return The value.
+ */
+template <typename T>
+static T ReadValue(const std::vector<unsigned char>& data, const size_t offset)
+{
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+/**
+ * \brief Appends a little-endian value to a byte buffer.
+ * \tparam T The type of value to write.
+ * \param data The buffer to write to.
+ * \param value The value.
+ */
+template <typename T>
+static void WriteValue(std::vector<unsigned char>& data, const T value)
+{
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * \brief Determines whether the given Vulkan format is one that can be loaded.
+ * \param vk_format The Vulkan format.
+ * \return A boolean value indicating if the format is supported.
+ */
+static bool IsSupportedFormat(const uint32_t vk_format)
+{
+    switch (static_cast<Ktx2Format>(vk_format))
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+    case Ktx2Format::Bc1RgbSrgb:
+    case Ktx2Format::Bc1RgbaUnorm:
+    case Ktx2Format::Bc1RgbaSrgb:
+    case Ktx2Format::Bc3Unorm:
+    case Ktx2Format::Bc3Srgb:
+    case Ktx2Format::Bc5Unorm:
+    case Ktx2Format::Bc5Snorm:
+    case Ktx2Format::Bc7Unorm:
+    case Ktx2Format::Bc7Srgb:
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Gets the number of bytes in each 4x4 block of the given format.
+ * \param format The block-compressed format.
+ * \return The size of a block in bytes.
+ */
+unsigned int GetKtx2BlockSize(const Ktx2Format format)
+{
+    switch (format)
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+    case Ktx2Format::Bc1RgbSrgb:
+    case Ktx2Format::Bc1RgbaUnorm:
+    case Ktx2Format::Bc1RgbaSrgb:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+/**
+ * \brief Gets the number of channels the given format decodes to.
+ * \param format The block-compressed format.
+ * \return The number of channels.
+ */
+int GetKtx2ChannelCount(const Ktx2Format format)
+{
+    switch (format)
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+    case Ktx2Format::Bc1RgbSrgb:
+        return 3;
+    case Ktx2Format::Bc5Unorm:
+    case Ktx2Format::Bc5Snorm:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+/**
+ * \brief Gets the GL internal format equivalent to the given format.
+ * \param format The block-compressed format.
+ * \return The GL internal format.
+ */
+GLenum GetKtx2GlFormat(const Ktx2Format format)
+{
+    switch (format)
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Ktx2Format::Bc1RgbSrgb:
+        return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    case Ktx2Format::Bc1RgbaUnorm:
+        return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case Ktx2Format::Bc1RgbaSrgb:
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    case Ktx2Format::Bc3Unorm:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Ktx2Format::Bc3Srgb:
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case Ktx2Format::Bc5Unorm:
+        return GL_COMPRESSED_RG_RGTC2;
+    case Ktx2Format::Bc5Snorm:
+        return GL_COMPRESSED_SIGNED_RG_RGTC2;
+    case Ktx2Format::Bc7Unorm:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case Ktx2Format::Bc7Srgb:
+        return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    }
+
+    return 0;
+}
+
+Ktx2Texture::Ktx2Texture()
+    : m_format{ Ktx2Format::Bc1RgbUnorm },
+    m_width{},
+    m_height{},
+    m_flipped{ false }
+{
+}
+
+/**
+ * \brief Parses a KTX2 container held in memory, taking ownership of its bytes.
+ * \param contents The contents of the KTX2 file.
+ * \return A boolean value indicating if the container was parsed successfully.
+ */
+bool Ktx2Texture::Load(std::vector<unsigned char> contents)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_contents.clear();
+    m_levels.clear();
+
+    if (contents.size() < KTX2_HEADER_SIZE || std::memcmp(contents.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        DFM_CORE_ERROR("KTX2: missing file identifier.");
+        return false;
+    }
+
+    const auto vk_format = ReadValue<uint32_t>(contents, 12);
+    const auto pixel_width = ReadValue<uint32_t>(contents, 20);
+    const auto pixel_height = ReadValue<uint32_t>(contents, 24);
+    const auto pixel_depth = ReadValue<uint32_t>(contents, 28);
+    const auto layer_count = ReadValue<uint32_t>(contents, 32);
+    const auto face_count = ReadValue<uint32_t>(contents, 36);
+    const auto level_count = std::max(ReadValue<uint32_t>(contents, 40), 1u);
+    const auto supercompression_scheme = ReadValue<uint32_t>(contents, 44);
+
+    if (!IsSupportedFormat(vk_format))
+    {
+        DFM_CORE_ERROR("KTX2: unsupported format {0}, only BC1, BC3, BC5 and BC7 can be loaded.", vk_format);
+        return false;
+    }
+
+    if (pixel_depth > 1 || layer_count > 1 || face_count != 1 || pixel_width == 0 || pixel_height == 0)
+    {
+        DFM_CORE_ERROR("KTX2: only single 2D images are supported.");
+        return false;
+    }
+
+    if (supercompression_scheme != 0)
+    {
+        DFM_CORE_ERROR("KTX2: supercompressed containers are not supported.");
+        return false;
+    }
+
+    // A full mip chain ends at 1x1, and more levels than that cannot be given texture storage.
+    uint32_t max_level_count = 1;
+    for (uint32_t size = std::max(pixel_width, pixel_height); size > 1; size /= 2)
+    {
+        max_level_count++;
+    }
+
+    if (level_count > max_level_count)
+    {
+        DFM_CORE_ERROR("KTX2: {0} levels is more than a {1}x{2} image can have.", level_count, pixel_width, pixel_height);
+        return false;
+    }
+
+    if (contents.size() < KTX2_HEADER_SIZE + level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE)
+    {
+        DFM_CORE_ERROR("KTX2: truncated level index.");
+        return false;
+    }
+
+    const auto kvd_offset = ReadValue<uint32_t>(contents, 56);
+    const auto kvd_length = ReadValue<uint32_t>(contents, 60);
+
+    if (kvd_offset > contents.size() || kvd_length > contents.size() - kvd_offset)
+    {
+        DFM_CORE_ERROR("KTX2: key/value data lies outside of the file.");
+        return false;
+    }
+
+    // Only the orientation is read, where a second character of 'u' means the bottom row comes first.
+    bool flipped = false;
+    const size_t kvd_end = static_cast<size_t>(kvd_offset) + kvd_length;
+
+    for (size_t entry = kvd_offset; entry + 4 <= kvd_end;)
+    {
+        const auto pair_length = ReadValue<uint32_t>(contents, entry);
+        const size_t pair_offset = entry + 4;
+
+        if (pair_length > kvd_end - pair_offset) break;
+
+        const auto* pair = reinterpret_cast<const char*>(contents.data() + pair_offset);
+        constexpr size_t key_size = sizeof(KTX2_ORIENTATION_KEY);
+
+        if (pair_length >= key_size + 2 && std::memcmp(pair, KTX2_ORIENTATION_KEY, key_size) == 0)
+        {
+            flipped = pair[key_size + 1] == 'u';
+        }
+
+        entry = pair_offset + (static_cast<size_t>(pair_length) + 3) / 4 * 4;
+    }
+
+    for (uint32_t level = 0; level < level_count; level++)
+    {
+        const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const auto offset = ReadValue<uint64_t>(contents, entry);
+        const auto size = ReadValue<uint64_t>(contents, entry + 8);
+
+        // Both values come from the file, so their sum could wrap around.
+        if (offset > contents.size() || size > contents.size() - offset)
+        {
+            DFM_CORE_ERROR("KTX2: level {0} lies outside of the file.", level);
+            m_levels.clear();
+            return false;
+        }
+
+        // Levels are uploaded by copying whole rows of blocks, so each must hold exactly as many as its size needs.
+        const uint64_t blocks_wide = (std::max(pixel_width >> level, 1u) + 3) / 4;
+        const uint64_t blocks_high = (std::max(pixel_height >> level, 1u) + 3) / 4;
+
+        if (size != blocks_wide * blocks_high * GetKtx2BlockSize(static_cast<Ktx2Format>(vk_format)))
+        {
+            DFM_CORE_ERROR("KTX2: level {0} has the wrong size for its dimensions.", level);
+            m_levels.clear();
+            return false;
+        }
+
+        m_levels.push_back({ offset, size });
+    }
+
+    m_contents = std::move(contents);
+    m_format = static_cast<Ktx2Format>(vk_format);
+    m_width = pixel_width;
+    m_height = pixel_height;
+    m_flipped = flipped;
+
+    return true;
+}
+
+/**
+ * \brief Writes a KTX2 container holding the given mip chain.
+ * \param path The path of the file to write.
+ * \param format The block-compressed format of the levels.
+ * \param width The width of the base level in pixels.
+ * \param height The height of the base level in pixels.
+ * \param levels The compressed data of each level, starting with the base level.
+ * \param flipped Determines if the levels were flipped vertically, storing the bottom row first.
+ * \return A boolean value indicating if the file was written successfully.
+ */
+bool Ktx2Texture::Write(const std::string& path, const Ktx2Format format, const uint32_t width, const uint32_t height,
+                        const std::vector<std::vector<unsigned char>>& levels, const bool flipped)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const auto level_count = static_cast<uint32_t>(levels.size());
+    const unsigned int block_size = GetKtx2BlockSize(format);
+
+    // Describe the block layout of the format with a single basic data format descriptor block.
+    uint32_t colour_model = KHR_DF_MODEL_BC7;
+    std::vector<std::pair<uint32_t, uint32_t>> samples; // (bit offset, channel type)
+
+    switch (format)
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+    case Ktx2Format::Bc1RgbSrgb:
+        colour_model = KHR_DF_MODEL_BC1A;
+        samples = { { 0, KHR_DF_CHANNEL_COLOR } };
+        break;
+    case Ktx2Format::Bc1RgbaUnorm:
+    case Ktx2Format::Bc1RgbaSrgb:
+        colour_model = KHR_DF_MODEL_BC1A;
+        samples = { { 0, KHR_DF_CHANNEL_BC1A_ALPHA } };
+        break;
+    case Ktx2Format::Bc3Unorm:
+    case Ktx2Format::Bc3Srgb:
+        colour_model = KHR_DF_MODEL_BC3;
+        samples = { { 0, KHR_DF_CHANNEL_ALPHA }, { 64, KHR_DF_CHANNEL_COLOR } };
+        break;
+    case Ktx2Format::Bc5Unorm:
+        colour_model = KHR_DF_MODEL_BC5;
+        samples = { { 0, KHR_DF_CHANNEL_COLOR }, { 64, KHR_DF_CHANNEL_GREEN } };
+        break;
+    case Ktx2Format::Bc5Snorm:
+        colour_model = KHR_DF_MODEL_BC5;
+        samples = { { 0, KHR_DF_CHANNEL_COLOR | KHR_DF_SAMPLE_SIGNED }, { 64, KHR_DF_CHANNEL_GREEN | KHR_DF_SAMPLE_SIGNED } };
+        break;
+    case Ktx2Format::Bc7Unorm:
+    case Ktx2Format::Bc7Srgb:
+        colour_model = KHR_DF_MODEL_BC7;
+        samples = { { 0, KHR_DF_CHANNEL_COLOR } };
+        break;
+    }
+
+    const bool srgb = format == Ktx2Format::Bc1RgbSrgb || format == Ktx2Format::Bc1RgbaSrgb ||
+        format == Ktx2Format::Bc3Srgb || format == Ktx2Format::Bc7Srgb;
+    const uint32_t transfer_function = srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    const uint32_t sample_bits = samples.size() == 1 ? block_size * 8 : 64;
+
+    std::vector<unsigned char> dfd;
+    const auto descriptor_block_size = static_cast<uint32_t>(24 + 16 * samples.size());
+    WriteValue<uint32_t>(dfd, 4 + descriptor_block_size);
+    WriteValue<uint32_t>(dfd, 0);
+    WriteValue<uint32_t>(dfd, KHR_DF_VERSION | descriptor_block_size << 16);
+    WriteValue<uint32_t>(dfd, colour_model | KHR_DF_PRIMARIES_BT709 << 8 | transfer_function << 16);
+    WriteValue<uint32_t>(dfd, 3 | 3 << 8);
+    WriteValue<uint32_t>(dfd, block_size);
+    WriteValue<uint32_t>(dfd, 0);
+
+    for (const auto& [bit_offset, channel_type] : samples)
+    {
+        WriteValue<uint32_t>(dfd, bit_offset | (sample_bits - 1) << 16 | channel_type << 24);
+        WriteValue<uint32_t>(dfd, 0);
+        WriteValue<uint32_t>(dfd, 0);
+        WriteValue<uint32_t>(dfd, 0xFFFFFFFF);
+    }
+
+    // Record the row order, so that loaders can tell whether the texture matches what they expect.
+    std::vector<unsigned char> kvd;
+    const char* orientation = flipped ? "ru" : "rd";
+    WriteValue<uint32_t>(kvd, static_cast<uint32_t>(sizeof(KTX2_ORIENTATION_KEY) + 3));
+    kvd.insert(kvd.end(), std::begin(KTX2_ORIENTATION_KEY), std::end(KTX2_ORIENTATION_KEY));
+    kvd.insert(kvd.end(), orientation, orientation + 3);
+    kvd.resize((kvd.size() + 3) / 4 * 4, 0);
+
+    const size_t dfd_offset = KTX2_HEADER_SIZE + level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    const size_t kvd_offset = dfd_offset + dfd.size();
+
+    // Levels are stored smallest first, each aligned to the block size.
+    std::vector<uint64_t> level_offsets(level_count);
+    size_t offset = kvd_offset + kvd.size();
+    for (uint32_t level = level_count; level-- > 0;)
+    {
+        offset = (offset + block_size - 1) / block_size * block_size;
+        level_offsets[level] = offset;
+        offset += levels[level].size();
+    }
+
+    std::vector<unsigned char> contents;
+    contents.reserve(offset);
+    contents.insert(contents.end(), std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER));
+    WriteValue<uint32_t>(contents, static_cast<uint32_t>(format));
+    WriteValue<uint32_t>(contents, 1); // typeSize
+    WriteValue<uint32_t>(contents, width);
+    WriteValue<uint32_t>(contents, height);
+    WriteValue<uint32_t>(contents, 0); // pixelDepth
+    WriteValue<uint32_t>(contents, 0); // layerCount
+    WriteValue<uint32_t>(contents, 1); // faceCount
+    WriteValue<uint32_t>(contents, level_count);
+    WriteValue<uint32_t>(contents, 0); // supercompressionScheme
+    WriteValue<uint32_t>(contents, static_cast<uint32_t>(dfd_offset));
+    WriteValue<uint32_t>(contents, static_cast<uint32_t>(dfd.size()));
+    WriteValue<uint32_t>(contents, static_cast<uint32_t>(kvd_offset));
+    WriteValue<uint32_t>(contents, static_cast<uint32_t>(kvd.size()));
+    WriteValue<uint64_t>(contents, 0); // sgdByteOffset
+    WriteValue<uint64_t>(contents, 0); // sgdByteLength
+
+    for (uint32_t level = 0; level < level_count; level++)
+    {
+        WriteValue<uint64_t>(contents, level_offsets[level]);
+        WriteValue<uint64_t>(contents, levels[level].size());
+        WriteValue<uint64_t>(contents, levels[level].size());
+    }
+
+    contents.insert(contents.end(), dfd.begin(), dfd.end());
+    contents.insert(contents.end(), kvd.begin(), kvd.end());
+
+    for (uint32_t level = level_count; level-- > 0;)
+    {
+        contents.resize(level_offsets[level], 0);
+        contents.insert(contents.end(), levels[level].begin(), levels[level].end());
+    }
+
+    std::ofstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        DFM_CORE_ERROR("KTX2: failed to open '{0}' for writing.", path);
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    return static_cast<bool>(file);
+}
+
+/**
+ * \brief Determines whether the texture holds parsed level data.
+ * \return A boolean value indicating if the texture holds level data.
+ */
+bool Ktx2Texture::IsValid() const
+{
+    return !m_levels.empty();
+}
+
+/**
+ * \brief Gets the block-compressed format of the texture.
+ * \return The texture's format.
+ */
+Ktx2Format Ktx2Texture::GetFormat() const
+{
+    return m_format;
+}
+
+/**
+ * \brief Gets the width of the base level.
+ * \return The base level's width in pixels.
+ */
+uint32_t Ktx2Texture::GetWidth() const
+{
+    return m_width;
+}
+
+/**
+ * \brief Gets the height of the base level.
+ * \return The base level's height in pixels.
+ */
+uint32_t Ktx2Texture::GetHeight() const
+{
+    return m_height;
+}
+
+/**
+ * \brief Determines whether the levels store the bottom row first, as recorded by the container's
+ * KTXorientation value.
+ * \return A boolean value indicating if the texture was flipped vertically.
+ */
+bool Ktx2Texture::IsFlipped() const
+{
+    return m_flipped;
+}
+
+/**
+ * \brief Gets the number of mip levels in the texture.
+ * \return The number of mip levels.
+ */
+uint32_t Ktx2Texture::GetLevelCount() const
+{
+    return static_cast<uint32_t>(m_levels.size());
+}
+
+/**
+ * \brief Gets the compressed data of a mip level.
+ * \param level The mip level, where zero is the base level.
+ * \return A pointer to the level's data.
+ */
+const unsigned char* Ktx2Texture::GetLevelData(const uint32_t level) const
+{
+    return m_contents.data() + m_levels[level].offset;
+}
+
+/**
+ * \brief Gets the size of a mip level's compressed data.
+ * \param level The mip level, where zero is the base level.
+ * \return The size of the level's data in bytes.
+ */
+size_t Ktx2Texture::GetLevelSize(const uint32_t level) const
+{
+    return m_levels[level].size;
+}
+
+/**
+ * \brief Gets the total size of the compressed data of every mip level.
+ * \return The size of the texture's data in bytes.
+ */
+size_t Ktx2Texture::GetDataSize() const
+{
+    size_t size = 0;
+
+    for (const auto& level : m_levels)
+    {
+        size += level.size;
+    }
+
+    return size;
+}
@@ -0,0 +1,154 @@
+/**
+ * \file ktx2.h
+ */
+
+#ifndef KTX2_H
+#define KTX2_H
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The block-compressed Vulkan formats supported in KTX2 containers.
+ */
+enum class Ktx2Format : uint32_t
+{
+    Bc1RgbUnorm = 131,
+    Bc1RgbSrgb = 132,
+    Bc1RgbaUnorm = 133,
+    Bc1RgbaSrgb = 134,
+    Bc3Unorm = 137,
+    Bc3Srgb = 138,
+    Bc5Unorm = 141,
+    Bc5Snorm = 142,
+    Bc7Unorm = 145,
+    Bc7Srgb = 146
+};
+
+/**
+ * \brief Gets the number of bytes in each 4x4 block of the given format.
+ * \param format The block-compressed format.
+ * \return The size of a block in bytes.
+ */
+unsigned int GetKtx2BlockSize(Ktx2Format format);
+
+/**
+ * \brief Gets the number of channels the given format decodes to.
+ * \param format The block-compressed format.
+ * \return The number of channels.
+ */
+int GetKtx2ChannelCount(Ktx2Format format);
+
+/**
+ * \brief Gets the GL internal format equivalent to the given format.
+ * \param format The block-compressed format.
+ * \return The GL internal format.
+ */
+GLenum GetKtx2GlFormat(Ktx2Format format);
+
+/**
+ * \brief Represents a block-compressed 2D texture with a precomputed mip chain, stored in a KTX2 container.
+ */
+class Ktx2Texture
+{
+public:
+    Ktx2Texture();
+
+    /**
+     * \brief Parses a KTX2 container held in memory, taking ownership of its bytes.
+     * \param contents The contents of the KTX2 file.
+     * \return A boolean value indicating if the container was parsed successfully.
+     */
+    bool Load(std::vector<unsigned char> contents);
+
+    /**
+     * \brief Writes a KTX2 container holding the given mip chain.
+     * \param path The path of the file to write.
+     * \param format The block-compressed format of the levels.
+     * \param width The width of the base level in pixels.
+     * \param height The height of the base level in pixels.
+     * \param levels The compressed data of each level, starting with the base level.
+     * \param flipped Determines if the levels were flipped vertically, storing the bottom row first.
+     * \return A boolean value indicating if the file was written successfully.
+     */
+    static bool Write(const std::string& path, Ktx2Format format, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<unsigned char>>& levels, bool flipped = false);
+
+    /**
+     * \brief Determines whether the texture holds parsed level data.
+     * \return A boolean value indicating if the texture holds level data.
+     */
+    [[nodiscard]] bool IsValid() const;
+
+    /**
+     * \brief Gets the block-compressed format of the texture.
+     * \return The texture's format.
+     */
+    [[nodiscard]] Ktx2Format GetFormat() const;
+
+    /**
+     * \brief Gets the width of the base level.
+     * \return The base level's width in pixels.
+     */
+    [[nodiscard]] uint32_t GetWidth() const;
+
+    /**
+     * \brief Gets the height of the base level.
+     * \return The base level's height in pixels.
+     */
+    [[nodiscard]] uint32_t GetHeight() const;
+
+    /**
+     * \brief Determines whether the levels store the bottom row first, as recorded by the container's
+     * KTXorientation value.
+     * \return A boolean value indicating if the texture was flipped vertically.
+     */
+    [[nodiscard]] bool IsFlipped() const;
+
+    /**
+     * \brief Gets the number of mip levels in the texture.
+     * \return The number of mip levels.
+     */
+    [[nodiscard]] uint32_t GetLevelCount() const;
+
+    /**
+     * \brief Gets the compressed data of a mip level.
+     * \param level The mip level, where zero is the base level.
+     * \return A pointer to the level's data.
+     */
+    [[nodiscard]] const unsigned char* GetLevelData(uint32_t level) const;
+
+    /**
+     * \brief Gets the size of a mip level's compressed data.
+     * \param level The mip level, where zero is the base level.
+     * \return The size of the level's data in bytes.
+     */
+    [[nodiscard]] size_t GetLevelSize(uint32_t level) const;
+
+    /**
+     * \brief Gets the total size of the compressed data of every mip level.
+     * \return The size of the texture's data in bytes.
+     */
+    [[nodiscard]] size_t GetDataSize() const;
+
+private:
+    /**
+     * \brief Represents the location of a mip level within the container.
+     */
+    struct Level
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::vector<unsigned char> m_contents;
+    std::vector<Level> m_levels;
+    Ktx2Format m_format;
+    uint32_t m_width, m_height;
+    bool m_flipped;
+};
+
+#endif // KTX2_H
@@ -11,8 +11,6 @@
 
 #include "ecs/components.h"
 
-#include "ubo.h"
-
 #include "glm/ext/matrix_transform.hpp"
 
 constexpr int MAX_NO_POINT_LIGHTS = 128;
@@ -32,38 +30,6 @@ struct Lighting
     DirectionalLightData directional_light;
 };
 
-/**
- * \brief Updates the point light at the given index with new data.
- * \param index The index of the point light to update.
- * \param data The new data to update the point light with.
- */
-inline void UpdatePointLight(const unsigned int index, const PointLightData& data)
-{
-    const Ubo& lighting_ubo = UboManager::Retrieve("lighting");
-    lighting_ubo.SetSubData(offsetof(Lighting, point_lights) + sizeof(PointLightData) * index, sizeof(PointLightData), &data);
-}
-
-/**
- * \brief Updates the directional light in the scene with new data.
- * \param data The new data to update the directional light with.
- */
-inline void UpdateDirectionalLight(const DirectionalLightData& data)
-{
-    const Ubo& lighting_ubo = UboManager::Retrieve("lighting");
-    lighting_ubo.SetSubData(offsetof(Lighting, directional_light), sizeof(DirectionalLightData), &data);
-}
-
-/**
- * \brief Updates the spot light at the given index with new data.
- * \param index The index of the spot light to update.
- * \param data The new data to update the spot light with.
- */
-inline void UpdateSpotLight(const unsigned int index, const SpotLightData& data)
-{
-    const Ubo& lighting_ubo = UboManager::Retrieve("lighting");
-    lighting_ubo.SetSubData(offsetof(Lighting, spot_lights) + sizeof(SpotLightData) * index, sizeof(SpotLightData), &data);
-}
-
 /**
  * \brief Calculates a direction vector when given a world space rotation.
  * \param rotation A vector representing a world space rotation on the X, Y, and Z axes.
@@ -0,0 +1,268 @@
+/**
+ * \file loader_thread.cpp
+ */
+
+#include "loader_thread.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000;
+
+LoaderThread LoaderThread::s_instance;
+
+LoaderThread::LoaderThread()
+    : m_running{ false },
+    m_stopping{ false },
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Creates a hidden window sharing objects with the given window's context, and starts the loader
+ * thread with its context current. If the shared context cannot be created, uploads are made on the
+ * drawing context by \code Update instead. Must be called on the main thread.
+ * \param window The window whose context objects are shared with.
+ */
+void LoaderThread::Initialise(const GlfwWindow& window)
+{
+    DFM_PROFILE_FUNCTION();
+
+    LoaderThread& loader = Get();
+
+    try
+    {
+        loader.m_window = std::make_unique<GlfwWindow>("Dwarfmatic Loader", window);
+    }
+    catch (const std::runtime_error&)
+    {
+        DFM_CORE_WARN("Failed to create a shared GL context, resources will be uploaded on the rendering context.");
+        return;
+    }
+
+    // Objects created on the window's context so far, such as the texture upload ring, must be complete
+    // before the loader thread's context uses them.
+    glFinish();
+
+    // GLFW only lets windows be created on the main thread, but their contexts can be made current on any.
+    std::lock_guard lock{ loader.m_mutex };
+    loader.m_running = true;
+    loader.m_stopping = false;
+
+    // Uploads submitted before the loader thread started are made on it as well.
+    loader.m_queue.swap(loader.m_deferred);
+    loader.m_thread = std::thread{ &LoaderThread::LoaderLoop, &loader };
+
+    DFM_CORE_INFO("Loader thread started with a shared GL context.");
+}
+
+/**
+ * \brief Finishes every submitted upload, stops the loader thread and hands the remaining uploads back.
+ * Must be called on the main thread, with the window's context current.
+ */
+void LoaderThread::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    LoaderThread& loader = Get();
+
+    if (loader.m_thread.joinable())
+    {
+        {
+            std::lock_guard lock{ loader.m_mutex };
+            loader.m_stopping = true;
+        }
+
+        loader.m_condition.notify_one();
+        loader.m_thread.join();
+        loader.m_window.reset();
+    }
+
+    std::deque<Completion> completions;
+    std::deque<Job> deferred;
+
+    {
+        std::lock_guard lock{ loader.m_mutex };
+        loader.m_running = false;
+        completions.swap(loader.m_completions);
+        deferred.swap(loader.m_deferred);
+    }
+
+    for (Completion& completion : completions)
+    {
+        if (glClientWaitSync(completion.fence, 0, FENCE_TIMEOUT_NS) == GL_WAIT_FAILED)
+        {
+            DFM_CORE_ERROR("Failed to wait on a loader thread fence.");
+        }
+
+        glDeleteSync(completion.fence);
+        completion.on_ready();
+    }
+
+    MakeDeferredUploads(deferred);
+
+    const LoaderThreadStatistics statistics = GetStatistics();
+    DFM_CORE_INFO("Loader thread made {0} uploads in {1:.2f} ms.", statistics.submitted_jobs, statistics.upload_milliseconds);
+}
+
+/**
+ * \brief Queues an upload on the loader thread. When the loader thread is not running, the upload is
+ * made on the drawing context by the next call to \code Update. May be called from any thread.
+ * \param upload The function creating and filling the GL objects.
+ * \param on_ready The function called on the drawing context once the upload has completed.
+ */
+void LoaderThread::Submit(UploadFunction upload, ReadyFunction on_ready)
+{
+    DFM_PROFILE_FUNCTION();
+
+    LoaderThread& loader = Get();
+
+    std::lock_guard lock{ loader.m_mutex };
+    loader.m_statistics.submitted_jobs++;
+    loader.m_statistics.pending_jobs++;
+
+    // The submitting thread may not own a context, so without the loader thread the drawing context makes the upload.
+    if (!loader.m_running)
+    {
+        loader.m_deferred.push_back({ std::move(upload), std::move(on_ready) });
+        return;
+    }
+
+    loader.m_queue.push_back({ std::move(upload), std::move(on_ready) });
+    loader.m_condition.notify_one();
+}
+
+/**
+ * \brief Hands back the uploads whose fences have been signalled, and makes the uploads submitted while
+ * the loader thread is not running. This should be called once per frame on the thread drawing with the
+ * window's context.
+ */
+void LoaderThread::Update()
+{
+    DFM_PROFILE_FUNCTION();
+
+    LoaderThread& loader = Get();
+    std::vector<ReadyFunction> ready;
+    std::deque<Job> deferred;
+
+    {
+        std::lock_guard lock{ loader.m_mutex };
+        deferred.swap(loader.m_deferred);
+
+        // Fences on one context are signalled in order, so the first unsignalled one ends the search.
+        while (!loader.m_completions.empty())
+        {
+            Completion& front = loader.m_completions.front();
+
+            const GLenum status = glClientWaitSync(front.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) break;
+
+            if (status == GL_WAIT_FAILED)
+            {
+                DFM_CORE_ERROR("Failed to wait on a loader thread fence.");
+            }
+
+            glDeleteSync(front.fence);
+            ready.push_back(std::move(front.on_ready));
+            loader.m_completions.pop_front();
+
+            loader.m_statistics.pending_jobs--;
+            loader.m_statistics.completed_jobs++;
+        }
+    }
+
+    // The functions create objects on this context, which need not hold up the loader thread.
+    for (const ReadyFunction& on_ready : ready)
+    {
+        on_ready();
+    }
+
+    MakeDeferredUploads(deferred);
+}
+
+/**
+ * \brief Determines whether uploads are made on the loader thread.
+ * \return A boolean value indicating if the loader thread is running.
+ */
+bool LoaderThread::IsRunning()
+{
+    std::lock_guard lock{ Get().m_mutex };
+    return Get().m_running;
+}
+
+/**
+ * \brief Gets the work done by the loader thread.
+ * \return The loader thread statistics.
+ */
+LoaderThreadStatistics LoaderThread::GetStatistics()
+{
+    std::lock_guard lock{ Get().m_mutex };
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Makes uploads submitted while the loader thread was not running on the drawing context.
+ * \param deferred The uploads.
+ */
+void LoaderThread::MakeDeferredUploads(std::deque<Job>& deferred)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (Job& job : deferred)
+    {
+        // Commands on a single context run in order, so the objects can be used straight away.
+        job.upload();
+        job.on_ready();
+    }
+
+    std::lock_guard lock{ Get().m_mutex };
+    Get().m_statistics.pending_jobs -= deferred.size();
+    Get().m_statistics.completed_jobs += deferred.size();
+}
+
+/**
+ * \brief Makes queued uploads on the loader thread until it is shut down.
+ */
+void LoaderThread::LoaderLoop()
+{
+    Instrumentor::SetThreadName("Loader");
+    m_window->MakeContextCurrent();
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock lock{ m_mutex };
+            m_condition.wait(lock, [this]
+            {
+                return !m_queue.empty() || m_stopping;
+            });
+
+            // Uploads submitted before shutting down are still made.
+            if (m_queue.empty()) break;
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        const auto upload_start = std::chrono::steady_clock::now();
+        job.upload();
+
+        // The fence must be flushed, or waiting on it from another context could wait forever.
+        const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        const auto upload_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start);
+
+        std::lock_guard lock{ m_mutex };
+        m_completions.push_back({ fence, std::move(job.on_ready) });
+        m_statistics.upload_milliseconds += upload_time.count();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
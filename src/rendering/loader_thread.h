@@ -0,0 +1,160 @@
+/**
+ * \file loader_thread.h
+ */
+
+#ifndef LOADER_THREAD_H
+#define LOADER_THREAD_H
+
+#include "glfw_window.h"
+
+#include "glad/glad.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief Represents the work done by the loader thread.
+ */
+struct LoaderThreadStatistics
+{
+    size_t submitted_jobs;
+    size_t completed_jobs;
+    size_t pending_jobs;
+
+    /**
+     * \brief The total time spent creating and filling GL objects on the loader thread, in milliseconds.
+     */
+    double upload_milliseconds;
+};
+
+/**
+ * \brief A singleton class that creates and fills GL objects, such as mesh buffers and textures, on a
+ * dedicated thread, whose hidden context shares objects with the window's context, so that loading does
+ * not stall drawing. A fence is inserted after each upload, and the upload is only handed back to the
+ * drawing context once the fence has been signalled. Objects that are not shared between contexts, such
+ * as vertex arrays, must be created when the upload is handed back.
+ */
+class LoaderThread
+{
+public:
+    /**
+     * \brief A function making GL calls on the loader thread's context.
+     */
+    using UploadFunction = std::function<void()>;
+
+    /**
+     * \brief A function called on the drawing context once an upload has completed.
+     */
+    using ReadyFunction = std::function<void()>;
+
+    LoaderThread(const LoaderThread&) = delete;
+    LoaderThread(LoaderThread&&) noexcept = delete;
+
+    LoaderThread& operator=(const LoaderThread&) = delete;
+    LoaderThread& operator=(LoaderThread&&) noexcept = delete;
+
+    /**
+     * \brief Creates a hidden window sharing objects with the given window's context, and starts the loader
+     * thread with its context current. If the shared context cannot be created, uploads are made on the
+     * drawing context by \code Update instead. Must be called on the main thread.
+     * \param window The window whose context objects are shared with.
+     */
+    static void Initialise(const GlfwWindow& window);
+
+    /**
+     * \brief Finishes every submitted upload, stops the loader thread and hands the remaining uploads back.
+     * Must be called on the main thread, with the window's context current.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Queues an upload on the loader thread. When the loader thread is not running, the upload is
+     * made on the drawing context by the next call to \code Update. May be called from any thread.
+     * \param upload The function creating and filling the GL objects.
+     * \param on_ready The function called on the drawing context once the upload has completed.
+     */
+    static void Submit(UploadFunction upload, ReadyFunction on_ready);
+
+    /**
+     * \brief Hands back the uploads whose fences have been signalled, and makes the uploads submitted while
+     * the loader thread is not running. This should be called once per frame on the thread drawing with the
+     * window's context.
+     */
+    static void Update();
+
+    /**
+     * \brief Determines whether uploads are made on the loader thread.
+     * \return A boolean value indicating if the loader thread is running.
+     */
+    [[nodiscard]] static bool IsRunning();
+
+    /**
+     * \brief Gets the work done by the loader thread.
+     * \return The loader thread statistics.
+     */
+    [[nodiscard]] static LoaderThreadStatistics GetStatistics();
+
+private:
+    /**
+     * \brief Represents an upload waiting for the loader thread.
+     */
+    struct Job
+    {
+        UploadFunction upload;
+        ReadyFunction on_ready;
+    };
+
+    /**
+     * \brief Represents an upload that has been made, waiting for the GPU to finish it.
+     */
+    struct Completion
+    {
+        GLsync fence;
+        ReadyFunction on_ready;
+    };
+
+    std::unique_ptr<GlfwWindow> m_window;
+    std::thread m_thread;
+    std::deque<Job> m_queue;
+    std::deque<Completion> m_completions;
+
+    /**
+     * \brief Uploads submitted while the loader thread is not running, which are made by \code Update.
+     */
+    std::deque<Job> m_deferred;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_running;
+    bool m_stopping;
+    LoaderThreadStatistics m_statistics;
+
+    LoaderThread();
+    ~LoaderThread() = default;
+
+    /**
+     * \brief Makes uploads submitted while the loader thread was not running on the drawing context.
+     * \param deferred The uploads.
+     */
+    static void MakeDeferredUploads(std::deque<Job>& deferred);
+
+    /**
+     * \brief Makes queued uploads on the loader thread until it is shut down.
+     */
+    void LoaderLoop();
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static LoaderThread& Get() { return s_instance; }
+
+    static LoaderThread s_instance;
+};
+
+#endif // LOADER_THREAD_H
@@ -0,0 +1,210 @@
+/**
+ * \file material.cpp
+ */
+
+#include "material.h"
+#include "material_texture_table.h"
+#include "utils/gl_state.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+
+constexpr MaterialId NO_MATERIAL = UINT32_MAX;
+
+Material::Material()
+    : m_textures{},
+    m_parameters{}
+{
+    m_textures.fill(INVALID_TEXTURE_HANDLE);
+}
+
+/**
+ * \brief Sets the texture of a slot.
+ * \param slot The slot.
+ * \param handle The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE to leave the slot empty.
+ */
+void Material::SetTexture(const TextureSlot slot, const TextureHandle handle)
+{
+    m_textures[static_cast<size_t>(slot)] = handle;
+}
+
+/**
+ * \brief Gets the texture of a slot.
+ * \param slot The slot.
+ * \return The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE if the slot is empty.
+ */
+TextureHandle Material::GetTexture(const TextureSlot slot) const
+{
+    return m_textures[static_cast<size_t>(slot)];
+}
+
+/**
+ * \brief Determines whether a slot has a texture.
+ * \param slot The slot.
+ * \return A boolean value indicating if the slot has a texture.
+ */
+bool Material::HasTexture(const TextureSlot slot) const
+{
+    return GetTexture(slot) != INVALID_TEXTURE_HANDLE;
+}
+
+/**
+ * \brief Gets the textures of every slot, indexed by \code TextureSlot.
+ * \return The texture handles.
+ */
+const std::array<TextureHandle, TEXTURE_SLOT_COUNT>& Material::GetTextures() const
+{
+    return m_textures;
+}
+
+/**
+ * \brief Sets the constant parameters of the material.
+ * \param parameters The parameters.
+ */
+void Material::SetParameters(const MaterialParameters& parameters)
+{
+    m_parameters = parameters;
+}
+
+/**
+ * \brief Gets the constant parameters of the material.
+ * \return The parameters.
+ */
+const MaterialParameters& Material::GetParameters() const
+{
+    return m_parameters;
+}
+
+MaterialManager MaterialManager::s_instance;
+
+MaterialManager::MaterialManager()
+    : m_buffer{},
+    m_buffer_capacity{},
+    m_uploaded_count{},
+    m_stride{},
+    m_applied{ NO_MATERIAL }
+{
+}
+
+/**
+ * \brief Creates a material, whose textures are registered with the material texture table by the next
+ * update. May be called from any thread.
+ * \param material The material.
+ * \return The ID of the material.
+ */
+MaterialId MaterialManager::Create(const Material& material)
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialManager& manager = Get();
+    std::unique_lock lock{ manager.m_mutex };
+
+    const auto id = static_cast<MaterialId>(manager.m_materials.size());
+    manager.m_materials.push_back(material);
+
+    return id;
+}
+
+/**
+ * \brief Gets a material. May be called from any thread.
+ * \param id The ID of the material.
+ * \return The material.
+ */
+const Material& MaterialManager::GetMaterial(const MaterialId id)
+{
+    std::shared_lock lock{ Get().m_mutex };
+    return Get().m_materials[id];
+}
+
+/**
+ * \brief Registers the textures and uploads the parameters of materials created since the last update.
+ * This should be called once per frame, before the material texture table is updated.
+ */
+void MaterialManager::Update()
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialManager& manager = Get();
+    std::shared_lock lock{ manager.m_mutex };
+
+    // The material texture table is only used on this thread, so materials created elsewhere are registered here.
+    for (size_t i = manager.m_texture_indices.size(); i < manager.m_materials.size(); i++)
+    {
+        manager.m_texture_indices.push_back(MaterialTextureTable::Register(
+            manager.m_materials[i].GetTexture(TextureSlot::Diffuse), manager.m_materials[i].GetTexture(TextureSlot::Specular)));
+    }
+
+    if (manager.m_uploaded_count == manager.m_materials.size()) return;
+
+    if (manager.m_materials.size() > manager.m_buffer_capacity)
+    {
+        if (manager.m_buffer != 0)
+        {
+            GlState::DeleteBuffer(manager.m_buffer);
+        }
+
+        GLint alignment;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+        manager.m_stride = (static_cast<GLsizeiptr>(sizeof(MaterialParameters)) + alignment - 1) / alignment * alignment;
+        manager.m_buffer_capacity = std::max(manager.m_materials.size(), manager.m_buffer_capacity * 2);
+        manager.m_uploaded_count = 0;
+        manager.m_applied = NO_MATERIAL;
+
+        glCreateBuffers(1, &manager.m_buffer);
+        glNamedBufferStorage(manager.m_buffer, manager.m_stride * static_cast<GLsizeiptr>(manager.m_buffer_capacity),
+                             nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    for (size_t i = manager.m_uploaded_count; i < manager.m_materials.size(); i++)
+    {
+        glNamedBufferSubData(manager.m_buffer, manager.m_stride * static_cast<GLintptr>(i), sizeof(MaterialParameters),
+                             &manager.m_materials[i].GetParameters());
+    }
+
+    manager.m_uploaded_count = manager.m_materials.size();
+}
+
+/**
+ * \brief Applies a material to the following draws of the shader in use.
+ * \param id The ID of the material.
+ */
+void MaterialManager::Apply(const MaterialId id)
+{
+    MaterialManager& manager = Get();
+
+    // Materials of models that are ready to draw were registered by the update before they became ready.
+    if (id >= manager.m_uploaded_count) return;
+
+    // The index is a uniform of the shader in use, so it is set for every draw.
+    glUniform1ui(MATERIAL_INDEX_LOCATION, manager.m_texture_indices[id]);
+
+    if (manager.m_applied == id) return;
+
+    GlState::BindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_PARAMETERS_BINDING, manager.m_buffer,
+                             manager.m_stride * static_cast<GLintptr>(id), sizeof(MaterialParameters));
+    manager.m_applied = id;
+}
+
+/**
+ * \brief Deletes the parameter buffer and forgets every material.
+ */
+void MaterialManager::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialManager& manager = Get();
+
+    if (manager.m_buffer != 0)
+    {
+        GlState::DeleteBuffer(manager.m_buffer);
+    }
+
+    std::unique_lock lock{ manager.m_mutex };
+    manager.m_materials.clear();
+    manager.m_texture_indices.clear();
+    manager.m_buffer = 0;
+    manager.m_buffer_capacity = 0;
+    manager.m_uploaded_count = 0;
+    manager.m_applied = NO_MATERIAL;
+}
@@ -0,0 +1,209 @@
+/**
+ * \file material.h
+ */
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "texture_streamer.h"
+
+#include "glad/glad.h"
+#include "glm/vec4.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <vector>
+
+/**
+ * \brief Identifies the textures a material can have.
+ */
+enum class TextureSlot
+{
+    Diffuse,
+    Specular,
+    Normal,
+    Height
+};
+
+constexpr size_t TEXTURE_SLOT_COUNT = 4;
+
+/**
+ * \brief Identifies a material created with \code MaterialManager. Draws sorted by ID share their material state.
+ */
+using MaterialId = uint32_t;
+
+/**
+ * \brief The explicit location of the uniform selecting a draw's entry in the material texture table, which
+ * must match resources/shaders/include/material.glsl.
+ */
+constexpr GLint MATERIAL_INDEX_LOCATION = 0;
+
+/**
+ * \brief The binding point of the \code MaterialParameters uniform block, which must match
+ * resources/shaders/include/material.glsl. It is above the binding points \code Ubo hands out to the
+ * global blocks.
+ */
+constexpr GLuint MATERIAL_PARAMETERS_BINDING = 8;
+
+/**
+ * \brief Represents the constant parameters of a material.
+ * Follows the std140 standard to be used in the `MaterialParameters` UBO.
+ */
+struct MaterialParameters
+{
+    /**
+     * \brief Multiplies the diffuse texture, which is white when the material has none.
+     */
+    glm::vec4 diffuse_colour{ 1.0f };
+
+    /**
+     * \brief Multiplies the specular texture, which is white when the material has none.
+     */
+    glm::vec4 specular_colour{ 1.0f };
+};
+
+/**
+ * \brief Represents the textures and parameters that a mesh is drawn with. Materials are built once when
+ * a model is imported and then created with \code MaterialManager.
+ */
+class Material
+{
+public:
+    Material();
+
+    /**
+     * \brief Sets the texture of a slot.
+     * \param slot The slot.
+     * \param handle The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE to leave the slot empty.
+     */
+    void SetTexture(TextureSlot slot, TextureHandle handle);
+
+    /**
+     * \brief Gets the texture of a slot.
+     * \param slot The slot.
+     * \return The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE if the slot is empty.
+     */
+    [[nodiscard]] TextureHandle GetTexture(TextureSlot slot) const;
+
+    /**
+     * \brief Determines whether a slot has a texture.
+     * \param slot The slot.
+     * \return A boolean value indicating if the slot has a texture.
+     */
+    [[nodiscard]] bool HasTexture(TextureSlot slot) const;
+
+    /**
+     * \brief Gets the textures of every slot, indexed by \code TextureSlot.
+     * \return The texture handles.
+     */
+    [[nodiscard]] const std::array<TextureHandle, TEXTURE_SLOT_COUNT>& GetTextures() const;
+
+    /**
+     * \brief Sets the constant parameters of the material.
+     * \param parameters The parameters.
+     */
+    void SetParameters(const MaterialParameters& parameters);
+
+    /**
+     * \brief Gets the constant parameters of the material.
+     * \return The parameters.
+     */
+    [[nodiscard]] const MaterialParameters& GetParameters() const;
+
+private:
+    std::array<TextureHandle, TEXTURE_SLOT_COUNT> m_textures;
+    MaterialParameters m_parameters;
+};
+
+/**
+ * \brief A singleton class that owns every material and applies them to draws. The parameters of all
+ * materials live in one uniform buffer, and applying a material binds its range of the buffer and sets its
+ * index in the material texture table, without any string lookups. Materials may be created and read from
+ * any thread, and are registered with the material texture table by the next update. All other functions
+ * must be called on the thread owning the GL context.
+ */
+class MaterialManager
+{
+public:
+    MaterialManager(const MaterialManager&) = delete;
+    MaterialManager(MaterialManager&&) noexcept = delete;
+
+    MaterialManager& operator=(const MaterialManager&) = delete;
+    MaterialManager& operator=(MaterialManager&&) noexcept = delete;
+
+    /**
+     * \brief Creates a material, whose textures are registered with the material texture table by the next
+     * update. May be called from any thread.
+     * \param material The material.
+     * \return The ID of the material.
+     */
+    static MaterialId Create(const Material& material);
+
+    /**
+     * \brief Gets a material. May be called from any thread.
+     * \param id The ID of the material.
+     * \return The material.
+     */
+    [[nodiscard]] static const Material& GetMaterial(MaterialId id);
+
+    /**
+     * \brief Registers the textures and uploads the parameters of materials created since the last update.
+     * This should be called once per frame, before the material texture table is updated.
+     */
+    static void Update();
+
+    /**
+     * \brief Applies a material to the following draws of the shader in use.
+     * \param id The ID of the material.
+     */
+    static void Apply(MaterialId id);
+
+    /**
+     * \brief Deletes the parameter buffer and forgets every material.
+     */
+    static void Shutdown();
+
+private:
+    /**
+     * \brief The created materials, which keep their addresses as more are added. Guarded by \code m_mutex,
+     * as materials are created while models load.
+     */
+    std::deque<Material> m_materials;
+    mutable std::shared_mutex m_mutex;
+
+    /**
+     * \brief The index of each registered material's textures in the material texture table, which is only
+     * used on the thread owning the GL context.
+     */
+    std::vector<uint32_t> m_texture_indices;
+
+    GLuint m_buffer;
+    size_t m_buffer_capacity;
+    size_t m_uploaded_count;
+
+    /**
+     * \brief The distance between the parameters of consecutive materials in the buffer, which respects
+     * the alignment of uniform buffer ranges.
+     */
+    GLsizeiptr m_stride;
+
+    /**
+     * \brief The material whose parameters are bound, so consecutive draws of a material skip the bind.
+     */
+    MaterialId m_applied;
+
+    MaterialManager();
+    ~MaterialManager() = default;
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static MaterialManager& Get() { return s_instance; }
+
+    static MaterialManager s_instance;
+};
+
+#endif // MATERIAL_H
@@ -0,0 +1,468 @@
+/**
+ * \file material_texture_table.cpp
+ */
+
+#include "material_texture_table.h"
+#include "texture_uploader.h"
+#include "utils/gl_extensions.h"
+#include "utils/gl_state.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+
+/**
+ * \brief The number of layers a texture array pool is created with.
+ */
+constexpr GLsizei INITIAL_POOL_CAPACITY = 4;
+
+MaterialTextureTable MaterialTextureTable::s_instance;
+
+MaterialTextureTable::MaterialTextureTable()
+    : m_placeholder{},
+    m_white_texture{},
+    m_white{},
+    m_buffer{},
+    m_buffer_capacity{},
+    m_dirty{ false },
+    m_warned_pool_limit{ false }
+{
+}
+
+/**
+ * \brief Gets the index of a material with the given textures, adding it to the table if needed.
+ * \param diffuse The diffuse texture, or \code INVALID_TEXTURE_HANDLE to sample white.
+ * \param specular The specular texture, or \code INVALID_TEXTURE_HANDLE to sample white.
+ * \return The index of the material.
+ */
+uint32_t MaterialTextureTable::Register(const TextureHandle diffuse, const TextureHandle specular)
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialTextureTable& table = Get();
+    const std::pair<TextureHandle, TextureHandle> key{ diffuse, specular };
+
+    if (auto search = table.m_lookup.find(key); search != table.m_lookup.end())
+    {
+        return search->second;
+    }
+
+    const auto index = static_cast<uint32_t>(table.m_materials.size());
+    table.m_materials.push_back(key);
+    table.m_lookup[key] = index;
+
+    for (const TextureHandle handle : { diffuse, specular })
+    {
+        if (handle != INVALID_TEXTURE_HANDLE && handle >= table.m_textures.size())
+        {
+            table.m_textures.resize(static_cast<size_t>(handle) + 1, TableTexture{});
+        }
+    }
+
+    table.m_dirty = true;
+
+    return index;
+}
+
+/**
+ * \brief Points the table at the textures the streamer currently holds and uploads any changes.
+ * This should be called once per frame, after the texture streamer and uploader are updated.
+ */
+void MaterialTextureTable::Update()
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialTextureTable& table = Get();
+
+    if (table.m_white_texture == 0)
+    {
+        constexpr unsigned char WHITE_PIXEL[] = { 255, 255, 255, 255 };
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &table.m_white_texture);
+        glTextureStorage2D(table.m_white_texture, 1, GL_RGBA8, 1, 1);
+        glClearTexImage(table.m_white_texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, WHITE_PIXEL);
+    }
+
+    if (!table.m_white.has_entry && table.MakeEntry(table.m_white_texture, table.m_white.value))
+    {
+        table.m_white.has_entry = true;
+        table.m_dirty = true;
+    }
+
+    // The placeholder is uploaded like any other texture, so textures without an entry sample white until it arrives.
+    const GLuint placeholder = TextureStreamer::GetTextureId(INVALID_TEXTURE_HANDLE);
+    if (!table.m_placeholder.has_entry && !TextureUploader::IsPending(placeholder) &&
+        table.MakeEntry(placeholder, table.m_placeholder.value))
+    {
+        table.m_placeholder.has_entry = true;
+        table.m_dirty = true;
+    }
+
+    for (size_t handle = 0; handle < table.m_textures.size(); handle++)
+    {
+        // A texture sharing another's contents uses that texture's entry, so the GL texture is only made
+        // resident or copied into a pool once.
+        const TextureHandle owner = TextureStreamer::Resolve(static_cast<TextureHandle>(handle));
+        if (owner != handle)
+        {
+            if (owner >= table.m_textures.size())
+            {
+                table.m_textures.resize(static_cast<size_t>(owner) + 1, TableTexture{});
+            }
+
+            if (!table.m_textures[handle].current)
+            {
+                table.m_textures[handle].current = true;
+                table.m_dirty = true;
+            }
+
+            continue;
+        }
+
+        TableTexture& texture = table.m_textures[handle];
+        const uint32_t version = TextureStreamer::GetTextureVersion(static_cast<TextureHandle>(handle));
+
+        if (version != texture.version)
+        {
+            texture.version = version;
+            texture.current = false;
+        }
+
+        if (texture.current) continue;
+
+        // Textures that are still uploading cannot have their sampling parameters frozen by a handle, nor be
+        // copied into a pool yet.
+        const GLuint id = TextureStreamer::GetTextureId(static_cast<TextureHandle>(handle));
+        if (version == 0 || TextureUploader::IsPending(id))
+        {
+            // The replaced texture has been deleted along with its handles, so use the placeholder texture
+            // meanwhile. A pool layer is a copy, and keeps showing the replaced texture instead.
+            if (texture.has_entry && GlExtensions::HasBindlessTexture())
+            {
+                texture.has_entry = false;
+                table.m_dirty = true;
+            }
+
+            continue;
+        }
+
+        GLuint64 value;
+        if (!table.MakeEntry(id, value)) continue;
+
+        if (texture.has_entry)
+        {
+            table.ReleaseEntry(texture.value);
+        }
+
+        texture.current = true;
+        texture.has_entry = true;
+        texture.value = value;
+        table.m_dirty = true;
+    }
+
+    if (table.m_dirty)
+    {
+        table.Upload();
+        table.m_dirty = false;
+    }
+}
+
+/**
+ * \brief Binds the table, and the texture array pools if bindless textures are not supported, for the
+ * draws that follow.
+ */
+void MaterialTextureTable::Bind()
+{
+    DFM_PROFILE_FUNCTION();
+
+    const MaterialTextureTable& table = Get();
+
+    if (table.m_buffer == 0) return;
+
+    GlState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, table.m_buffer, 0,
+                             static_cast<GLsizeiptr>(table.m_buffer_capacity * sizeof(GpuMaterial)));
+
+    for (size_t i = 0; i < table.m_pools.size(); i++)
+    {
+        GlState::BindTexture(static_cast<GLuint>(i), GL_TEXTURE_2D_ARRAY, table.m_pools[i].texture);
+    }
+}
+
+/**
+ * \brief Releases the texture handles, the texture array pools and the table buffer. This must be
+ * called before the texture streamer is shut down.
+ */
+void MaterialTextureTable::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    MaterialTextureTable& table = Get();
+
+    if (GlExtensions::HasBindlessTexture())
+    {
+        for (const auto& texture : table.m_textures)
+        {
+            if (texture.has_entry)
+            {
+                GlExtensions::MakeTextureHandleNonResident(texture.value);
+            }
+        }
+
+        for (const TableTexture* texture : { &table.m_placeholder, &table.m_white })
+        {
+            if (texture->has_entry)
+            {
+                GlExtensions::MakeTextureHandleNonResident(texture->value);
+            }
+        }
+    }
+
+    if (table.m_white_texture != 0)
+    {
+        GlState::DeleteTexture(table.m_white_texture);
+    }
+
+    for (const auto& pool : table.m_pools)
+    {
+        GlState::DeleteTexture(pool.texture);
+    }
+
+    if (table.m_buffer != 0)
+    {
+        GlState::DeleteBuffer(table.m_buffer);
+    }
+
+    table.m_materials.clear();
+    table.m_lookup.clear();
+    table.m_textures.clear();
+    table.m_placeholder = {};
+    table.m_white_texture = 0;
+    table.m_white = {};
+    table.m_pools.clear();
+    table.m_buffer = 0;
+    table.m_buffer_capacity = 0;
+    table.m_dirty = false;
+}
+
+/**
+ * \brief Makes a table entry for a texture that has finished uploading.
+ * \param texture The GL texture object.
+ * \param value The value written to the table.
+ * \return A boolean value indicating if the entry could be made.
+ */
+bool MaterialTextureTable::MakeEntry(const GLuint texture, GLuint64& value)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (GlExtensions::HasBindlessTexture())
+    {
+        value = GlExtensions::GetTextureHandle(texture);
+        GlExtensions::MakeTextureHandleResident(value);
+        return true;
+    }
+
+    size_t pool_index;
+    GLsizei layer;
+    if (!CopyToPool(texture, pool_index, layer)) return false;
+
+    value = static_cast<GLuint64>(pool_index) | static_cast<GLuint64>(layer) << 32;
+    return true;
+}
+
+/**
+ * \brief Releases a table entry that is no longer used.
+ * \param value The value written to the table.
+ */
+void MaterialTextureTable::ReleaseEntry(const GLuint64 value)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Deleting a texture deletes its handles as well, and the streamer deletes the textures it replaces.
+    if (GlExtensions::HasBindlessTexture()) return;
+
+    m_pools[static_cast<size_t>(value & 0xFFFFFFFF)].free_layers.push_back(static_cast<GLsizei>(value >> 32));
+}
+
+/**
+ * \brief Copies a texture into a free layer of the pool matching its format, size and level count.
+ * \param texture The GL texture object.
+ * \param pool_index The index of the pool.
+ * \param layer The layer the texture was copied into.
+ * \return A boolean value indicating if a pool could be found or created.
+ */
+bool MaterialTextureTable::CopyToPool(const GLuint texture, size_t& pool_index, GLsizei& layer)
+{
+    DFM_PROFILE_FUNCTION();
+
+    GLint format, width, height, level_count;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &level_count);
+
+    const auto search = std::find_if(m_pools.begin(), m_pools.end(), [=](const TexturePool& pool)
+    {
+        return pool.format == static_cast<GLenum>(format) && pool.width == width && pool.height == height &&
+            pool.level_count == level_count;
+    });
+
+    if (search == m_pools.end())
+    {
+        if (m_pools.size() == MAX_TEXTURE_POOLS)
+        {
+            if (!m_warned_pool_limit)
+            {
+                DFM_CORE_WARN("Every texture array pool is in use, other textures will be drawn with the placeholder texture.");
+                m_warned_pool_limit = true;
+            }
+
+            return false;
+        }
+
+        TexturePool& pool = m_pools.emplace_back();
+        pool.format = static_cast<GLenum>(format);
+        pool.width = width;
+        pool.height = height;
+        pool.level_count = level_count;
+        pool.capacity = INITIAL_POOL_CAPACITY;
+        pool.layer_count = 0;
+
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &pool.texture);
+        glTextureStorage3D(pool.texture, level_count, pool.format, width, height, pool.capacity);
+
+        // Textures sharing a pool are sampled like the first one, which for material textures is how all of them are sampled.
+        for (const GLenum parameter : { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T })
+        {
+            GLint parameter_value;
+            glGetTextureParameteriv(texture, parameter, &parameter_value);
+            glTextureParameteri(pool.texture, parameter, parameter_value);
+        }
+
+        pool_index = m_pools.size() - 1;
+    }
+    else
+    {
+        pool_index = static_cast<size_t>(search - m_pools.begin());
+    }
+
+    TexturePool& pool = m_pools[pool_index];
+
+    if (!pool.free_layers.empty())
+    {
+        layer = pool.free_layers.back();
+        pool.free_layers.pop_back();
+    }
+    else
+    {
+        if (pool.layer_count == pool.capacity)
+        {
+            GrowPool(pool);
+        }
+
+        layer = pool.layer_count++;
+    }
+
+    for (GLint level = 0; level < level_count; level++)
+    {
+        glCopyImageSubData(
+            texture, GL_TEXTURE_2D, level, 0, 0, 0,
+            pool.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+            std::max(width >> level, 1),
+            std::max(height >> level, 1),
+            1
+        );
+    }
+
+    return true;
+}
+
+/**
+ * \brief Doubles the number of layers in a pool, copying the layers in use.
+ * \param pool The pool.
+ */
+void MaterialTextureTable::GrowPool(TexturePool& pool)
+{
+    DFM_PROFILE_FUNCTION();
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, pool.level_count, pool.format, pool.width, pool.height, pool.capacity * 2);
+
+    for (const GLenum parameter : { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T })
+    {
+        GLint parameter_value;
+        glGetTextureParameteriv(pool.texture, parameter, &parameter_value);
+        glTextureParameteri(texture, parameter, parameter_value);
+    }
+
+    for (GLint level = 0; level < pool.level_count; level++)
+    {
+        glCopyImageSubData(
+            pool.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            std::max(pool.width >> level, 1),
+            std::max(pool.height >> level, 1),
+            pool.layer_count
+        );
+    }
+
+    GlState::DeleteTexture(pool.texture);
+    pool.texture = texture;
+    pool.capacity *= 2;
+}
+
+/**
+ * \brief Gets the value written to the table for a texture.
+ * \param handle The handle of the texture.
+ * \return The value of the entry of the texture it resolves to, of the white texture for
+ * \code INVALID_TEXTURE_HANDLE, or of the placeholder texture if the texture has no entry yet.
+ */
+GLuint64 MaterialTextureTable::GetValue(const TextureHandle handle) const
+{
+    if (handle == INVALID_TEXTURE_HANDLE)
+    {
+        return m_white.value;
+    }
+
+    const TextureHandle owner = TextureStreamer::Resolve(handle);
+    if (owner >= m_textures.size() || !m_textures[owner].has_entry)
+    {
+        return m_placeholder.has_entry ? m_placeholder.value : m_white.value;
+    }
+
+    return m_textures[owner].value;
+}
+
+/**
+ * \brief Uploads the material table, growing the buffer if needed.
+ */
+void MaterialTextureTable::Upload()
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (m_materials.empty()) return;
+
+    if (m_materials.size() > m_buffer_capacity)
+    {
+        if (m_buffer != 0)
+        {
+            GlState::DeleteBuffer(m_buffer);
+        }
+
+        m_buffer_capacity = std::max<size_t>(m_materials.size(), m_buffer_capacity * 2);
+
+        glCreateBuffers(1, &m_buffer);
+        glNamedBufferStorage(m_buffer, static_cast<GLsizeiptr>(m_buffer_capacity * sizeof(GpuMaterial)), nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    std::vector<GpuMaterial> materials;
+    materials.reserve(m_materials.size());
+
+    for (const auto& [diffuse, specular] : m_materials)
+    {
+        materials.push_back({ GetValue(diffuse), GetValue(specular) });
+    }
+
+    glNamedBufferSubData(m_buffer, 0, static_cast<GLsizeiptr>(materials.size() * sizeof(GpuMaterial)), materials.data());
+}
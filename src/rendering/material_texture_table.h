@@ -0,0 +1,194 @@
+/**
+ * \file material_texture_table.h
+ */
+
+#ifndef MATERIAL_TEXTURE_TABLE_H
+#define MATERIAL_TEXTURE_TABLE_H
+
+#include "texture_streamer.h"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief The binding point of the shader storage buffer holding the material table, which must match
+ * resources/shaders/include/material.glsl.
+ */
+constexpr GLuint MATERIAL_TABLE_BINDING = 0;
+
+/**
+ * \brief The largest number of texture array pools that shaders can sample from when bindless textures
+ * are not supported. The pools are bound to the texture units starting from zero, and the number must
+ * match resources/shaders/include/material.glsl.
+ */
+constexpr size_t MAX_TEXTURE_POOLS = 16;
+
+/**
+ * \brief A singleton class that gives every combination of material textures an index into a table in a
+ * shader storage buffer, so a draw selects its textures through a single uniform rather than binding them.
+ * When \code GL_ARB_bindless_texture is supported the table holds texture handles. Otherwise each texture
+ * is copied into a layer of a \code GL_TEXTURE_2D_ARRAY pool shared by textures of the same format, size
+ * and level count, and the table holds the pool and layer. Entries follow the texture streamer as it
+ * replaces textures at other resolutions, and are keyed by the handle a texture resolves to, so textures
+ * sharing contents share one entry. All functions must be called on the thread owning the GL context.
+ */
+class MaterialTextureTable
+{
+public:
+    MaterialTextureTable(const MaterialTextureTable&) = delete;
+    MaterialTextureTable(MaterialTextureTable&&) noexcept = delete;
+
+    MaterialTextureTable& operator=(const MaterialTextureTable&) = delete;
+    MaterialTextureTable& operator=(MaterialTextureTable&&) noexcept = delete;
+
+    /**
+     * \brief Gets the index of a material with the given textures, adding it to the table if needed.
+     * \param diffuse The diffuse texture, or \code INVALID_TEXTURE_HANDLE to sample white.
+     * \param specular The specular texture, or \code INVALID_TEXTURE_HANDLE to sample white.
+     * \return The index of the material.
+     */
+    static uint32_t Register(TextureHandle diffuse, TextureHandle specular);
+
+    /**
+     * \brief Points the table at the textures the streamer currently holds and uploads any changes.
+     * This should be called once per frame, after the texture streamer and uploader are updated.
+     */
+    static void Update();
+
+    /**
+     * \brief Binds the table, and the texture array pools if bindless textures are not supported, for the
+     * draws that follow.
+     */
+    static void Bind();
+
+    /**
+     * \brief Releases the texture handles, the texture array pools and the table buffer. This must be
+     * called before the texture streamer is shut down.
+     */
+    static void Shutdown();
+
+private:
+    /**
+     * \brief Represents where shaders find a streamed texture.
+     */
+    struct TableTexture
+    {
+        /**
+         * \brief The version of the streamed texture that was last seen.
+         */
+        uint32_t version;
+
+        /**
+         * \brief Determines if the entry was made from the version that was last seen. For a texture drawn
+         * with the entry of the texture it shares contents with, determines if the table points at that entry.
+         */
+        bool current;
+
+        bool has_entry;
+
+        /**
+         * \brief The texture handle when bindless textures are supported, or the pool index in the low
+         * 32 bits and the layer in the high 32 bits otherwise.
+         */
+        GLuint64 value;
+    };
+
+    /**
+     * \brief Represents textures of the same format, size and level count sharing a texture array.
+     */
+    struct TexturePool
+    {
+        GLuint texture;
+        GLenum format;
+        GLsizei width, height;
+        GLsizei level_count;
+        GLsizei capacity;
+        GLsizei layer_count;
+        std::vector<GLsizei> free_layers;
+    };
+
+    /**
+     * \brief Represents a material's textures as laid out in the table buffer.
+     */
+    struct GpuMaterial
+    {
+        GLuint64 diffuse;
+        GLuint64 specular;
+    };
+
+    std::vector<std::pair<TextureHandle, TextureHandle>> m_materials;
+    std::map<std::pair<TextureHandle, TextureHandle>, uint32_t> m_lookup;
+    std::vector<TableTexture> m_textures;
+    TableTexture m_placeholder;
+
+    /**
+     * \brief A white texture sampled by empty slots, so material colours apply unchanged.
+     */
+    GLuint m_white_texture;
+    TableTexture m_white;
+
+    std::vector<TexturePool> m_pools;
+    GLuint m_buffer;
+    size_t m_buffer_capacity;
+    bool m_dirty;
+    bool m_warned_pool_limit;
+
+    MaterialTextureTable();
+    ~MaterialTextureTable() = default;
+
+    /**
+     * \brief Makes a table entry for a texture that has finished uploading.
+     * \param texture The GL texture object.
+     * \param value The value written to the table.
+     * \return A boolean value indicating if the entry could be made.
+     */
+    bool MakeEntry(GLuint texture, GLuint64& value);
+
+    /**
+     * \brief Releases a table entry that is no longer used.
+     * \param value The value written to the table.
+     */
+    void ReleaseEntry(GLuint64 value);
+
+    /**
+     * \brief Copies a texture into a free layer of the pool matching its format, size and level count.
+     * \param texture The GL texture object.
+     * \param pool_index The index of the pool.
+     * \param layer The layer the texture was copied into.
+     * \return A boolean value indicating if a pool could be found or created.
+     */
+    bool CopyToPool(GLuint texture, size_t& pool_index, GLsizei& layer);
+
+    /**
+     * \brief Doubles the number of layers in a pool, copying the layers in use.
+     * \param pool The pool.
+     */
+    static void GrowPool(TexturePool& pool);
+
+    /**
+     * \brief Gets the value written to the table for a texture.
+     * \param handle The handle of the texture.
+     * \return The value of the entry of the texture it resolves to, of the white texture for
+     * \code INVALID_TEXTURE_HANDLE, or of the placeholder texture if the texture has no entry yet.
+     */
+    [[nodiscard]] GLuint64 GetValue(TextureHandle handle) const;
+
+    /**
+     * \brief Uploads the material table, growing the buffer if needed.
+     */
+    void Upload();
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static MaterialTextureTable& Get() { return s_instance; }
+
+    static MaterialTextureTable s_instance;
+};
+
+#endif // MATERIAL_TEXTURE_TABLE_H
@@ -3,99 +3,154 @@
  */
 
 #include "mesh.h"
+#include "texture_streamer.h"
 #include "utils/profiling.h"
 
 #include "glad/glad.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<MeshTexture> textures)
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, const MaterialId material)
     : m_vertices{ std::move(vertices) },
     m_indices{ std::move(indices) },
-    m_textures{ std::move(textures) },
-    m_vao{}, m_vbo{}, m_ebo{}
+    m_material{ material },
+    m_vao{}, m_vbo{}, m_ebo{},
+    m_depth_vao{}, m_position_vbo{}
 {
-    SetupMesh();
 }
 
 /**
- * \brief Draws the mesh using the given shader.
- * \param shader The shader used to draw the mesh.
+ * \brief Requests the resolution needed by the mesh's textures from the texture streamer.
+ * \param screen_size The size of the mesh on screen in pixels.
  */
-void Mesh::Draw(const Shader& shader) const
+void Mesh::RequestTextureResolution(const float screen_size) const
 {
     DFM_PROFILE_FUNCTION();
 
-    unsigned int diffuse_nr = 1;
-    unsigned int specular_nr = 1;
-    unsigned int normal_nr = 1;
-    unsigned int height_nr = 1;
-
-    for (unsigned int i = 0; i < m_textures.size(); i++)
+    for (const TextureHandle texture : MaterialManager::GetMaterial(m_material).GetTextures())
     {
-        // Activate correct texture unit before binding.
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        std::string number;
-        std::string name = m_textures[i].type;
-
-        if (name == "texture_diffuse")
-        {
-            number = std::to_string(diffuse_nr++);
-        }
-        else if (name == "texture_specular")
-        {
-            number = std::to_string(specular_nr++);
-        }
-        else if (name == "texture_normal")
+        if (texture != INVALID_TEXTURE_HANDLE)
         {
-            number = std::to_string(normal_nr++);
+            TextureStreamer::RequestResolution(texture, screen_size);
         }
-        else if (name == "texture_height")
-        {
-            number = std::to_string(height_nr++);
-        }
-
-        shader.SetInt(name + number, static_cast<int>(i));
-        glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
     }
+}
+
+/**
+ * \brief Gets the vertices of the mesh.
+ * \return The mesh's vertices.
+ */
+const std::vector<Vertex>& Mesh::GetVertices() const
+{
+    return m_vertices;
+}
 
-    // Draw mesh
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
+/**
+ * \brief Gets the material the mesh is drawn with.
+ * \return The ID of the mesh's material.
+ */
+MaterialId Mesh::GetMaterialId() const
+{
+    return m_material;
 }
 
 /**
- * \brief Sets up the mesh by creating and binding a vertex array object (VAO), vertex buffer object (VBO),
- * and element buffer object (EBO).
+ * \brief Gets the vertex array the mesh is drawn with.
+ * \return The ID of the vertex array.
  */
-void Mesh::SetupMesh()
+unsigned int Mesh::GetVertexArray() const
+{
+    return m_vao;
+}
+
+/**
+ * \brief Gets the vertex array the mesh is drawn with in depth-only passes.
+ * \return The ID of the depth-only vertex array.
+ */
+unsigned int Mesh::GetDepthVertexArray() const
+{
+    return m_depth_vao;
+}
+
+/**
+ * \brief Gets the number of indices drawn for the mesh.
+ * \return The number of indices.
+ */
+uint32_t Mesh::GetIndexCount() const
+{
+    return static_cast<uint32_t>(m_indices.size());
+}
+
+/**
+ * \brief Determines whether the mesh's material has a texture in the given slot.
+ * \param slot The texture slot.
+ * \return A boolean value indicating if the mesh has the texture.
+ */
+bool Mesh::HasTexture(const TextureSlot slot) const
+{
+    return MaterialManager::GetMaterial(m_material).HasTexture(slot);
+}
+
+/**
+ * \brief Creates the vertex buffer object (VBO), element buffer object (EBO) and position buffer with
+ * immutable storage. Buffers are shared between contexts, so this may be called on any context that
+ * shares objects with the one drawing the mesh. Nothing is bound while doing so.
+ */
+void Mesh::UploadBuffers()
 {
     DFM_PROFILE_FUNCTION();
 
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
+    glCreateBuffers(1, &m_vbo);
+    glCreateBuffers(1, &m_ebo);
 
-    glBindVertexArray(m_vao);
+    glNamedBufferStorage(m_vbo, static_cast<GLsizeiptr>(m_vertices.size() * sizeof(Vertex)), m_vertices.data(), 0);
+    glNamedBufferStorage(m_ebo, static_cast<GLsizeiptr>(m_indices.size() * sizeof(unsigned int)), m_indices.data(), 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STATIC_DRAW);
+    // Positions only, for depth-only passes.
+    std::vector<glm::vec3> positions;
+    positions.reserve(m_vertices.size());
+    for (const auto& vertex : m_vertices)
+    {
+        positions.push_back(vertex.position);
+    }
+
+    glCreateBuffers(1, &m_position_vbo);
+    glNamedBufferStorage(m_position_vbo, static_cast<GLsizeiptr>(positions.size() * sizeof(glm::vec3)), positions.data(), 0);
+}
+
+/**
+ * \brief Creates the vertex array objects (VAOs) reading from the mesh's buffers. Vertex arrays are not
+ * shared between contexts, so this must be called on the context drawing the mesh, once the buffers
+ * have been uploaded.
+ */
+void Mesh::CreateVertexArrays()
+{
+    DFM_PROFILE_FUNCTION();
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW);
+    glCreateVertexArrays(1, &m_vao);
+
+    glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(Vertex));
+    glVertexArrayElementBuffer(m_vao, m_ebo);
 
     // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexArrayAttrib(m_vao, 0);
+    glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+    glVertexArrayAttribBinding(m_vao, 0, 0);
 
     // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexArrayAttrib(m_vao, 1);
+    glVertexArrayAttribFormat(m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    glVertexArrayAttribBinding(m_vao, 1, 0);
 
     // Vertex texture coordinates
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture_coordinate));
+    glEnableVertexArrayAttrib(m_vao, 2);
+    glVertexArrayAttribFormat(m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture_coordinate));
+    glVertexArrayAttribBinding(m_vao, 2, 0);
+
+    glCreateVertexArrays(1, &m_depth_vao);
+
+    glVertexArrayVertexBuffer(m_depth_vao, 0, m_position_vbo, 0, sizeof(glm::vec3));
+    glVertexArrayElementBuffer(m_depth_vao, m_ebo);
 
-    glBindVertexArray(0);
+    glEnableVertexArrayAttrib(m_depth_vao, 0);
+    glVertexArrayAttribFormat(m_depth_vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(m_depth_vao, 0, 0);
 }
\ No newline at end of file
@@ -5,12 +5,12 @@
 #ifndef MESH_H
 #define MESH_H
 
-#include "shader.h"
+#include "material.h"
 
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 
-#include <string>
+#include <cstdint>
 #include <vector>
 
 /**
@@ -23,43 +23,85 @@ struct Vertex
     glm::vec2 texture_coordinate;
 };
 
-/**
- * \brief Represents a texture that is used to draw a mesh.
- */
-struct MeshTexture
-{
-    unsigned int id{};
-    std::string type;
-    std::string path;
-};
-
 /**
  * \brief Represents a mesh in a 3D model.
  */
 class Mesh
 {
 public:
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<MeshTexture> textures);
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, MaterialId material);
+
+    /**
+     * \brief Creates the vertex buffer object (VBO), element buffer object (EBO) and position buffer with
+     * immutable storage. Buffers are shared between contexts, so this may be called on any context that
+     * shares objects with the one drawing the mesh. Nothing is bound while doing so.
+     */
+    void UploadBuffers();
+
+    /**
+     * \brief Creates the vertex array objects (VAOs) reading from the mesh's buffers. Vertex arrays are not
+     * shared between contexts, so this must be called on the context drawing the mesh, once the buffers
+     * have been uploaded.
+     */
+    void CreateVertexArrays();
+
+    /**
+     * \brief Requests the resolution needed by the mesh's textures from the texture streamer.
+     * \param screen_size The size of the mesh on screen in pixels.
+     */
+    void RequestTextureResolution(float screen_size) const;
+
+    /**
+     * \brief Gets the vertices of the mesh.
+     * \return The mesh's vertices.
+     */
+    [[nodiscard]] const std::vector<Vertex>& GetVertices() const;
+
+    /**
+     * \brief Gets the material the mesh is drawn with.
+     * \return The ID of the mesh's material.
+     */
+    [[nodiscard]] MaterialId GetMaterialId() const;
+
+    /**
+     * \brief Gets the vertex array the mesh is drawn with.
+     * \return The ID of the vertex array.
+     */
+    [[nodiscard]] unsigned int GetVertexArray() const;
+
+    /**
+     * \brief Gets the vertex array the mesh is drawn with in depth-only passes.
+     * \return The ID of the depth-only vertex array.
+     */
+    [[nodiscard]] unsigned int GetDepthVertexArray() const;
+
+    /**
+     * \brief Gets the number of indices drawn for the mesh.
+     * \return The number of indices.
+     */
+    [[nodiscard]] uint32_t GetIndexCount() const;
 
     /**
-     * \brief Draws the mesh using the given shader.
-     * \param shader The shader used to draw the mesh.
+     * \brief Determines whether the mesh's material has a texture in the given slot.
+     * \param slot The texture slot.
+     * \return A boolean value indicating if the mesh has the texture.
      */
-    void Draw(const Shader& shader) const;
+    [[nodiscard]] bool HasTexture(TextureSlot slot) const;
 
 private:
     std::vector<Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
-    std::vector<MeshTexture> m_textures;
+    MaterialId m_material;
     unsigned int m_vao;
     unsigned int m_vbo;
     unsigned int m_ebo;
 
     /**
-     * \brief Sets up the mesh by creating and binding a vertex array object (VAO), vertex buffer object (VBO),
-     * and element buffer object (EBO).
+     * \brief The vertex array used by depth-only passes, reading from a tightly packed copy of the
+     * vertex positions so they fetch a third of the vertex data.
      */
-    void SetupMesh();
+    unsigned int m_depth_vao;
+    unsigned int m_position_vbo;
 };
 
 #endif // MESH_H
\ No newline at end of file
@@ -3,28 +3,42 @@
  */
 
 #include "model.h"
+#include "loader_thread.h"
+#include "texture_streamer.h"
+#include "io/assimp_io_system.h"
+#include "utils/job_system.h"
 #include "utils/logging.h"
 #include "utils/profiling.h"
 
 #include "glad/glad.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
 #include "assimp/postprocess.h"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <limits>
 
-static unsigned int TextureFromFile(const std::string& path, const std::string& directory);
+constexpr TextureOptions MATERIAL_TEXTURE_OPTIONS{ 0, false, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR };
 
 /**
- * \brief Loads the model from the specified file path.
+ * \brief Loads the model from the specified file path, and submits its meshes to be uploaded in the
+ * background. May be called from any thread, as the GL work is left to the loader and render threads.
  * \param path The path to the model file.
  */
 void Model::Load(const std::string& path)
 {
     DFM_PROFILE_FUNCTION();
 
+    const auto start_timepoint = std::chrono::steady_clock::now();
+
     Assimp::Importer importer;
 
+    // Read the model and any files it references through the virtual file system. The importer
+    // takes ownership of the IO system.
+    importer.SetIOHandler(new VfsIOSystem);
+
     const aiScene* scene = importer.ReadFile(
         path,
         aiProcess_Triangulate |
@@ -41,21 +55,201 @@ void Model::Load(const std::string& path)
     {
         DFM_CORE_INFO("Successfully loaded model: '{0}'.", path);
         m_directory = path.substr(0, path.find_last_of('/'));
+
+        // Textures are registered with the streamer, which decodes them in the background.
+        LoadMaterials(scene);
         ProcessNode(scene->mRootNode, scene);
+        CalculateBounds();
+
+        // Meshes sharing a material are drawn one after another, so their material state is only applied once.
+        std::stable_sort(m_meshes.begin(), m_meshes.end(), [](const Mesh& a, const Mesh& b)
+        {
+            return a.GetMaterialId() < b.GetMaterialId();
+        });
+
+        // The meshes are not changed from here on, so the loader thread can fill their buffers.
+        UploadMeshes();
+
+        const auto load_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_timepoint);
+        DFM_CORE_INFO("Loaded model '{0}' in {1:.2f} ms ({2} decode workers).",
+            path, load_time.count(), JobSystem::GetWorkerCount());
     }
 }
 
 /**
-* \brief Draws the model with the specified shader.
-* \param shader The shader used to render the model.
-*/
-void Model::Draw(const Shader& shader) const
+ * \brief Determines whether the model's meshes have been uploaded and can be drawn. May be called from
+ * any thread.
+ * \return A boolean value indicating if the model is ready.
+ */
+bool Model::IsReady() const
+{
+    return m_ready.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Requests the resolution needed by the model's textures from the texture streamer.
+ * \param screen_size The size of the model on screen in pixels.
+ */
+void Model::RequestTextureResolution(const float screen_size) const
 {
     DFM_PROFILE_FUNCTION();
 
     for (const auto& mesh : m_meshes)
     {
-        mesh.Draw(shader);
+        mesh.RequestTextureResolution(screen_size);
+    }
+}
+
+/**
+ * \brief Gets the centre of the model's bounding sphere in model space.
+ * \return The centre of the bounding sphere.
+ */
+glm::vec3 Model::GetBoundingCentre() const
+{
+    return m_bounding_centre;
+}
+
+/**
+ * \brief Gets the radius of the model's bounding sphere in model space.
+ * \return The radius of the bounding sphere.
+ */
+float Model::GetBoundingRadius() const
+{
+    return m_bounding_radius;
+}
+
+/**
+ * \brief Gets the meshes of the model, ordered by material.
+ * \return The model's meshes.
+ */
+const std::vector<Mesh>& Model::GetMeshes() const
+{
+    return m_meshes;
+}
+
+/**
+ * \brief Determines whether any mesh of the model has a texture in the given slot.
+ * \param slot The texture slot.
+ * \return A boolean value indicating if a mesh has the texture.
+ */
+bool Model::HasTexture(const TextureSlot slot) const
+{
+    return std::any_of(m_meshes.begin(), m_meshes.end(), [slot](const Mesh& mesh)
+    {
+        return mesh.HasTexture(slot);
+    });
+}
+
+/**
+ * \brief Uploads the buffers of the model's meshes on the loader thread, then creates their vertex
+ * arrays on the drawing context and marks the model as ready.
+ */
+void Model::UploadMeshes()
+{
+    DFM_PROFILE_FUNCTION();
+
+    // The model is held weakly, so a model released before its upload finishes is skipped.
+    const std::weak_ptr<Model> model = weak_from_this();
+
+    // Readiness is published through the shared pointer, so any other model would silently never be drawn.
+    if (model.expired())
+    {
+        DFM_CORE_ERROR("Model '{0}' is not owned by a shared pointer, so its meshes cannot be uploaded.", m_directory);
+        return;
+    }
+
+    LoaderThread::Submit([model]
+    {
+        if (const auto loaded = model.lock())
+        {
+            for (auto& mesh : loaded->m_meshes)
+            {
+                mesh.UploadBuffers();
+            }
+        }
+    },
+    [model]
+    {
+        if (const auto loaded = model.lock())
+        {
+            for (auto& mesh : loaded->m_meshes)
+            {
+                mesh.CreateVertexArrays();
+            }
+
+            // Publishes the vertex arrays to the threads recording draws.
+            loaded->m_ready.store(true, std::memory_order_release);
+        }
+    });
+}
+
+/**
+ * \brief Calculates the bounding sphere of the model from the vertices of its meshes.
+ */
+void Model::CalculateBounds()
+{
+    DFM_PROFILE_FUNCTION();
+
+    glm::vec3 minimum{ std::numeric_limits<float>::max() };
+    glm::vec3 maximum{ std::numeric_limits<float>::lowest() };
+
+    for (const auto& mesh : m_meshes)
+    {
+        for (const auto& vertex : mesh.GetVertices())
+        {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+    }
+
+    if (minimum.x > maximum.x) return;
+
+    m_bounding_centre = (minimum + maximum) * 0.5f;
+    m_bounding_radius = glm::length(maximum - m_bounding_centre);
+}
+
+/**
+ * \brief Creates a material for each of the scene's materials, so meshes sharing one also share its state.
+ * \param scene The scene of the model.
+ */
+void Model::LoadMaterials(const aiScene* scene)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_materials.clear();
+    m_materials.reserve(scene->mNumMaterials);
+
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+    {
+        const aiMaterial* imported = scene->mMaterials[i];
+
+        Material material;
+        material.SetTexture(TextureSlot::Diffuse, LoadMaterialTexture(imported, aiTextureType_DIFFUSE));
+        material.SetTexture(TextureSlot::Specular, LoadMaterialTexture(imported, aiTextureType_SPECULAR));
+        material.SetTexture(TextureSlot::Normal, LoadMaterialTexture(imported, aiTextureType_NORMALS));
+        material.SetTexture(TextureSlot::Height, LoadMaterialTexture(imported, aiTextureType_HEIGHT));
+
+        // Exporters usually write a grey colour alongside a texture, so colours only stand in for missing textures.
+        MaterialParameters parameters;
+        aiColor3D colour;
+
+        if (!material.HasTexture(TextureSlot::Diffuse) && imported->Get(AI_MATKEY_COLOR_DIFFUSE, colour) == AI_SUCCESS)
+        {
+            parameters.diffuse_colour = glm::vec4{ colour.r, colour.g, colour.b, 1.0f };
+        }
+
+        if (!material.HasTexture(TextureSlot::Specular) && imported->Get(AI_MATKEY_COLOR_SPECULAR, colour) == AI_SUCCESS)
+        {
+            parameters.specular_colour = glm::vec4{ colour.r, colour.g, colour.b, 1.0f };
+        }
+
+        material.SetParameters(parameters);
+        m_materials.push_back(MaterialManager::Create(material));
+    }
+
+    if (m_materials.empty())
+    {
+        m_materials.push_back(MaterialManager::Create(Material{}));
     }
 }
 
@@ -94,7 +288,6 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<MeshTexture> textures;
 
     // Process vertex positions, normals and texture coordinates
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -141,127 +334,30 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
         }
     }
 
-    // Process material
-    if (scene->HasMaterials())
-    {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-        std::vector<MeshTexture> diffuse_maps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
-
-        std::vector<MeshTexture> specular_maps = LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
-
-        std::vector<MeshTexture> normal_maps = LoadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal");
-        textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
+    // Meshes refer to materials by their index in the scene.
+    const MaterialId material = mesh->mMaterialIndex < m_materials.size() ? m_materials[mesh->mMaterialIndex] : m_materials.front();
 
-        std::vector<MeshTexture> height_maps = LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_height");
-        textures.insert(textures.end(), height_maps.begin(), height_maps.end());
-    }
-
-    return Mesh{ vertices, indices, textures };
+    return Mesh{ vertices, indices, material };
 }
 
 /**
- * \brief Loads the textures of the material.
+ * \brief Loads the texture of a material. Only the first texture of each type is sampled.
  * \param material The material of the model.
  * \param type The type of texture.
- * \param type_name The name of the type of texture.
- * \return The loaded textures.
+ * \return The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE if the material has none.
  */
-std::vector<MeshTexture> Model::LoadMaterialTextures(const aiMaterial* material, const aiTextureType type,
-                                                     const std::string& type_name)
+TextureHandle Model::LoadMaterialTexture(const aiMaterial* material, const aiTextureType type)
 {
     DFM_PROFILE_FUNCTION();
 
-    std::vector<MeshTexture> textures;
-
-    for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+    if (material->GetTextureCount(type) == 0)
     {
-        aiString str;
-        material->GetTexture(type, i, &str);
-        bool skip = false;
-
-        // Check if the texture has previously been loaded, if so, skip.
-        for (const auto& loaded_texture : m_loaded_textures)
-        {
-            if (std::strcmp(m_loaded_textures[i].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(loaded_texture);
-                skip = true;
-                break;
-            }
-        }
-
-        if (!skip)
-        {
-            MeshTexture texture;
-            texture.id = TextureFromFile(str.C_Str(), m_directory);
-            texture.type = type_name;
-            texture.path = str.C_Str();
-
-            textures.push_back(texture);
-            m_loaded_textures.push_back(texture);
-        }
+        return INVALID_TEXTURE_HANDLE;
     }
 
-    return textures;
-}
-
-/**
- * \brief Loads a 2D from the specified file path and directory.
- * \param path The path to the texture from within the given directory.
- * \param directory The directory where the texture resides.
- * \return The texture ID.
- */
-unsigned int TextureFromFile(const std::string& path, const std::string& directory)
-{
-    DFM_PROFILE_FUNCTION();
-    
-    // TODO (guy): Convert texture usage to Texture2D implementation.
-
-    std::string filename = path;
-    filename = directory + '/' + filename;
-
-    unsigned int texture_id;
-    glGenTextures(1, &texture_id);
-
-    int width, height, nr_components;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nr_components, 0);
+    aiString str;
+    material->GetTexture(type, 0, &str);
 
-    // If the image loaded successfully, bind the texture, set its data and generate mipmaps.
-    if (data)
-    {
-        GLenum format = 0;
-        if (nr_components == 1)
-        {
-            format = GL_RED;
-        }
-        else if (nr_components == 3)
-        {
-            format = GL_RGB;
-        }
-        else if (nr_components == 4)
-        {
-            format = GL_RGBA;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        DFM_CORE_ERROR("Failure to load texture: '{0}'.", path);
-        stbi_image_free(data);
-    }
-
-    return texture_id;
-}
\ No newline at end of file
+    // The streamer shares textures between meshes and models, and keeps only the levels needed on screen.
+    return TextureStreamer::Register(m_directory + '/' + str.C_Str(), MATERIAL_TEXTURE_OPTIONS);
+}
@@ -10,33 +10,95 @@
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
 
+#include "glm/vec3.hpp"
+
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
 /**
- * \brief Represents a 3D model.
+ * \brief Represents a 3D model. Its GL buffers are uploaded in the background, so models must be owned by
+ * a shared pointer and are not drawn until they are ready.
  */
-class Model
+class Model : public std::enable_shared_from_this<Model>
 {
 public:
     Model() = default;
 
     /**
-     * \brief Loads the model from the specified file path.
+     * \brief Loads the model from the specified file path, and submits its meshes to be uploaded in the
+     * background. May be called from any thread, as the GL work is left to the loader and render threads.
      * \param path The path to the model file.
      */
     void Load(const std::string& path);
 
     /**
-     * \brief Draws the model with the specified shader.
-     * \param shader The shader used to render the model.
+     * \brief Determines whether the model's meshes have been uploaded and can be drawn. May be called from
+     * any thread.
+     * \return A boolean value indicating if the model is ready.
+     */
+    [[nodiscard]] bool IsReady() const;
+
+    /**
+     * \brief Requests the resolution needed by the model's textures from the texture streamer.
+     * \param screen_size The size of the model on screen in pixels.
      */
-    void Draw(const Shader& shader) const;
+    void RequestTextureResolution(float screen_size) const;
+
+    /**
+     * \brief Gets the centre of the model's bounding sphere in model space.
+     * \return The centre of the bounding sphere.
+     */
+    [[nodiscard]] glm::vec3 GetBoundingCentre() const;
+
+    /**
+     * \brief Gets the radius of the model's bounding sphere in model space.
+     * \return The radius of the bounding sphere.
+     */
+    [[nodiscard]] float GetBoundingRadius() const;
+
+    /**
+     * \brief Gets the meshes of the model, ordered by material.
+     * \return The model's meshes.
+     */
+    [[nodiscard]] const std::vector<Mesh>& GetMeshes() const;
+
+    /**
+     * \brief Determines whether any mesh of the model has a texture in the given slot.
+     * \param slot The texture slot.
+     * \return A boolean value indicating if a mesh has the texture.
+     */
+    [[nodiscard]] bool HasTexture(TextureSlot slot) const;
 
 private:
     std::vector<Mesh> m_meshes;
-    std::vector<MeshTexture> m_loaded_textures;
+    std::vector<MaterialId> m_materials;
     std::string m_directory;
+    glm::vec3 m_bounding_centre{};
+    float m_bounding_radius{};
+
+    /**
+     * \brief Set on the drawing thread once the meshes' vertex arrays exist, after which they are not changed.
+     */
+    std::atomic<bool> m_ready{ false };
+
+    /**
+     * \brief Uploads the buffers of the model's meshes on the loader thread, then creates their vertex
+     * arrays on the drawing context and marks the model as ready.
+     */
+    void UploadMeshes();
+
+    /**
+     * \brief Calculates the bounding sphere of the model from the vertices of its meshes.
+     */
+    void CalculateBounds();
+
+    /**
+     * \brief Creates a material for each of the scene's materials, so meshes sharing one also share its state.
+     * \param scene The scene of the model.
+     */
+    void LoadMaterials(const aiScene* scene);
 
     /**
      * \brief Processes the nodes of the model.
@@ -54,13 +116,12 @@ private:
     Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
 
     /**
-     * \brief Loads the textures of the material.
+     * \brief Loads the texture of a material. Only the first texture of each type is sampled.
      * \param material The material of the model.
      * \param type The type of texture.
-     * \param type_name The name of the type of texture.
-     * \return The loaded textures.
+     * \return The handle of the streamed texture, or \code INVALID_TEXTURE_HANDLE if the material has none.
      */
-    std::vector<MeshTexture> LoadMaterialTextures(const aiMaterial* material, aiTextureType type, const std::string& type_name);
+    TextureHandle LoadMaterialTexture(const aiMaterial* material, aiTextureType type);
 };
 
 #endif // MODEL_H
\ No newline at end of file
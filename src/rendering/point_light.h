@@ -23,36 +23,4 @@ struct PointLightData
     alignas(16) glm::vec4 specular;
 };
 
-/**
- * \brief Represents a point light in 3D space.
- */
-class PointLight
-{
-public:
-    explicit PointLight(PointLightData data);
-
-    /**
-     * \brief Gets the point light data.
-     * \return The point light data.
-     */
-    [[nodiscard]] PointLightData& GetData();
-
-    /**
-     * \brief Gets the index of the point light.
-     * \return The point light's index.
-     */
-    [[nodiscard]] unsigned int GetIndex() const;
-
-private:
-    PointLightData m_data;
-    unsigned int m_index;
-
-    /**
-     * \brief Initialises the point light.
-     */
-    void Initialise() const;
-
-    static unsigned int s_index;
-};
-
 #endif // POINT_LIGHT_H
\ No newline at end of file
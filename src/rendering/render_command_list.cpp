@@ -0,0 +1,209 @@
+/**
+ * \file render_command_list.cpp
+ */
+
+#include "render_command_list.h"
+
+#include <algorithm>
+#include <utility>
+
+// The sort key packs, from the most significant bits down, the pass, part of the program key, the
+// material and the vertex array. Fields that do not fit are truncated, which only costs a few redundant
+// state changes when two values share their low bits.
+constexpr int SORT_KEY_PASS_SHIFT = 62;
+constexpr int SORT_KEY_PROGRAM_SHIFT = 40;
+constexpr int SORT_KEY_MATERIAL_SHIFT = 24;
+
+constexpr uint64_t SORT_KEY_PROGRAM_MASK = (1ull << 22) - 1;
+constexpr uint64_t SORT_KEY_MATERIAL_MASK = (1ull << 16) - 1;
+constexpr uint64_t SORT_KEY_VERTEX_ARRAY_MASK = (1ull << 24) - 1;
+
+/**
+ * \brief Builds the key a draw is sorted by, which groups draws by pass, then program, then material,
+ * then vertex array, so that replaying them in order changes as little state as possible.
+ * \param pass The pass of the draw.
+ * \param program_key The key of the draw's program.
+ * \param material The material of the draw.
+ * \param vertex_array The vertex array of the draw.
+ * \return The sort key.
+ */
+uint64_t RenderCommandList::MakeSortKey(const RenderPass pass, const uint64_t program_key, const MaterialId material,
+                                        const uint32_t vertex_array)
+{
+    return static_cast<uint64_t>(pass) << SORT_KEY_PASS_SHIFT
+        | (program_key & SORT_KEY_PROGRAM_MASK) << SORT_KEY_PROGRAM_SHIFT
+        | (material & SORT_KEY_MATERIAL_MASK) << SORT_KEY_MATERIAL_SHIFT
+        | (vertex_array & SORT_KEY_VERTEX_ARRAY_MASK);
+}
+
+/**
+ * \brief Gets the pass a sort key was built for.
+ * \param sort_key The sort key.
+ * \return The pass.
+ */
+RenderPass RenderCommandList::GetPass(const uint64_t sort_key)
+{
+    return static_cast<RenderPass>(sort_key >> SORT_KEY_PASS_SHIFT);
+}
+
+/**
+ * \brief Finds the list's request for a program.
+ * \param key The key of the program.
+ * \return The index of the request, or \code NO_PROGRAM if the list has none.
+ */
+uint32_t RenderCommandList::FindProgram(const uint64_t key) const
+{
+    // A frame only uses a handful of programs, so a linear search beats hashing.
+    for (size_t i = 0; i < m_programs.size(); i++)
+    {
+        if (m_programs[i].key == key)
+        {
+            return static_cast<uint32_t>(i);
+        }
+    }
+
+    return NO_PROGRAM;
+}
+
+/**
+ * \brief Adds a request for a program.
+ * \param request The request.
+ * \return The index of the request.
+ */
+uint32_t RenderCommandList::AddProgram(ProgramRequest request)
+{
+    m_programs.push_back(std::move(request));
+    return static_cast<uint32_t>(m_programs.size() - 1);
+}
+
+/**
+ * \brief Adds the constants of one or more draws.
+ * \param model_matrix The model matrix.
+ * \return The index of the constants.
+ */
+uint32_t RenderCommandList::AddConstants(const glm::mat4& model_matrix)
+{
+    m_constants.push_back(model_matrix);
+    return static_cast<uint32_t>(m_constants.size() - 1);
+}
+
+/**
+ * \brief Starts recording a draw. Commands recorded until \code EndItem belong to it.
+ * \param sort_key The key the draw is sorted by.
+ */
+void RenderCommandList::BeginItem(const uint64_t sort_key)
+{
+    m_items.push_back({ sort_key, static_cast<uint32_t>(m_commands.size()), 0 });
+}
+
+/**
+ * \brief Finishes recording the current draw.
+ */
+void RenderCommandList::EndItem()
+{
+    RenderItem& item = m_items.back();
+    item.command_count = static_cast<uint32_t>(m_commands.size()) - item.first_command;
+}
+
+/**
+ * \brief Records the use of a program.
+ * \param program The index of the program request.
+ */
+void RenderCommandList::BindProgram(const uint32_t program)
+{
+    m_commands.push_back({ RenderCommandType::BindProgram, program });
+}
+
+/**
+ * \brief Records the binding of a vertex array.
+ * \param vertex_array The ID of the vertex array.
+ */
+void RenderCommandList::BindVertexArray(const uint32_t vertex_array)
+{
+    m_commands.push_back({ RenderCommandType::BindVertexArray, vertex_array });
+}
+
+/**
+ * \brief Records the application of a material.
+ * \param material The ID of the material.
+ */
+void RenderCommandList::BindMaterial(const MaterialId material)
+{
+    m_commands.push_back({ RenderCommandType::BindMaterial, material });
+}
+
+/**
+ * \brief Records the setting of the per-draw constants.
+ * \param constants The index of the constants.
+ */
+void RenderCommandList::SetConstants(const uint32_t constants)
+{
+    m_commands.push_back({ RenderCommandType::SetConstants, constants });
+}
+
+/**
+ * \brief Records an indexed draw.
+ * \param index_count The number of indices.
+ */
+void RenderCommandList::DrawIndexed(const uint32_t index_count)
+{
+    m_commands.push_back({ RenderCommandType::DrawIndexed, index_count });
+}
+
+/**
+ * \brief Sorts the recorded draws by their keys.
+ */
+void RenderCommandList::Sort()
+{
+    std::sort(m_items.begin(), m_items.end(), [](const RenderItem& a, const RenderItem& b)
+    {
+        return a.sort_key < b.sort_key;
+    });
+}
+
+/**
+ * \brief Empties the list for reuse, keeping the capacity of its buffers.
+ */
+void RenderCommandList::Clear()
+{
+    m_commands.clear();
+    m_items.clear();
+    m_constants.clear();
+    m_programs.clear();
+}
+
+/**
+ * \brief Gets the recorded commands.
+ * \return The commands.
+ */
+const std::vector<RenderCommand>& RenderCommandList::GetCommands() const
+{
+    return m_commands;
+}
+
+/**
+ * \brief Gets the recorded draws, in sort key order once sorted.
+ * \return The draws.
+ */
+const std::vector<RenderItem>& RenderCommandList::GetItems() const
+{
+    return m_items;
+}
+
+/**
+ * \brief Gets the per-draw constants.
+ * \return The constants.
+ */
+const std::vector<glm::mat4>& RenderCommandList::GetConstants() const
+{
+    return m_constants;
+}
+
+/**
+ * \brief Gets the programs the draws are recorded with.
+ * \return The program requests.
+ */
+const std::vector<ProgramRequest>& RenderCommandList::GetPrograms() const
+{
+    return m_programs;
+}
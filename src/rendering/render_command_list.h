@@ -0,0 +1,242 @@
+/**
+ * \file render_command_list.h
+ */
+
+#ifndef RENDER_COMMAND_LIST_H
+#define RENDER_COMMAND_LIST_H
+
+#include "rendering/material.h"
+#include "rendering/shader.h"
+#include "rendering/shader_preprocessor.h"
+
+#include "glm/mat4x4.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The types of command a render command list can hold.
+ */
+enum class RenderCommandType : uint8_t
+{
+    /**
+     * \brief Uses a program, given as an index into the list's program requests.
+     */
+    BindProgram,
+
+    /**
+     * \brief Binds a vertex array, which holds the vertex and index buffers of a mesh.
+     */
+    BindVertexArray,
+
+    /**
+     * \brief Applies a material to the following draws of the program in use.
+     */
+    BindMaterial,
+
+    /**
+     * \brief Sets the per-draw constants, given as an index into the list's constants.
+     */
+    SetConstants,
+
+    /**
+     * \brief Draws indexed triangles from the bound vertex array, given the number of indices.
+     */
+    DrawIndexed
+};
+
+/**
+ * \brief A single recorded command. Resources are referred to by plain handles, so commands can be
+ * recorded on any thread and replayed by whichever backend owns the graphics context.
+ */
+struct RenderCommand
+{
+    RenderCommandType type;
+    uint32_t value;
+};
+
+/**
+ * \brief The passes a recorded draw belongs to, in the order they are replayed.
+ */
+enum class RenderPass : uint8_t
+{
+    /**
+     * \brief The depth-only pass drawn before shading when the depth pre-pass is enabled.
+     */
+    Depth,
+
+    /**
+     * \brief The main pass of the forward path, or the geometry pass of the deferred path.
+     */
+    Shading
+};
+
+/**
+ * \brief A draw of one mesh, as a run of commands and the key it is sorted by.
+ */
+struct RenderItem
+{
+    uint64_t sort_key;
+    uint32_t first_command;
+    uint32_t command_count;
+};
+
+/**
+ * \brief A program a list's draws are recorded with. Programs are compiled and looked up on the thread
+ * that owns the graphics context, so lists only describe the program they need.
+ */
+struct ProgramRequest
+{
+    /**
+     * \brief Identifies the program, so that draws with the same program are sorted together.
+     */
+    uint64_t key;
+
+    /**
+     * \brief The program used when \code name is empty.
+     */
+    Shader shader;
+
+    /**
+     * \brief The name of the shader in the resource manager whose variant is used, if any.
+     */
+    std::string name;
+
+    ShaderPermutation permutation;
+};
+
+/**
+ * \brief A list of render commands recorded by a single thread. Each thread records its share of the
+ * draws into its own list and sorts them, and the lists are then merged in sort key order and replayed.
+ */
+class alignas(64) RenderCommandList
+{
+public:
+    /**
+     * \brief Returned by \code FindProgram when the list has no request for a program.
+     */
+    static constexpr uint32_t NO_PROGRAM = UINT32_MAX;
+
+    /**
+     * \brief Builds the key a draw is sorted by, which groups draws by pass, then program, then material,
+     * then vertex array, so that replaying them in order changes as little state as possible.
+     * \param pass The pass of the draw.
+     * \param program_key The key of the draw's program.
+     * \param material The material of the draw.
+     * \param vertex_array The vertex array of the draw.
+     * \return The sort key.
+     */
+    [[nodiscard]] static uint64_t MakeSortKey(RenderPass pass, uint64_t program_key, MaterialId material, uint32_t vertex_array);
+
+    /**
+     * \brief Gets the pass a sort key was built for.
+     * \param sort_key The sort key.
+     * \return The pass.
+     */
+    [[nodiscard]] static RenderPass GetPass(uint64_t sort_key);
+
+    /**
+     * \brief Finds the list's request for a program.
+     * \param key The key of the program.
+     * \return The index of the request, or \code NO_PROGRAM if the list has none.
+     */
+    [[nodiscard]] uint32_t FindProgram(uint64_t key) const;
+
+    /**
+     * \brief Adds a request for a program.
+     * \param request The request.
+     * \return The index of the request.
+     */
+    uint32_t AddProgram(ProgramRequest request);
+
+    /**
+     * \brief Adds the constants of one or more draws.
+     * \param model_matrix The model matrix.
+     * \return The index of the constants.
+     */
+    uint32_t AddConstants(const glm::mat4& model_matrix);
+
+    /**
+     * \brief Starts recording a draw. Commands recorded until \code EndItem belong to it.
+     * \param sort_key The key the draw is sorted by.
+     */
+    void BeginItem(uint64_t sort_key);
+
+    /**
+     * \brief Finishes recording the current draw.
+     */
+    void EndItem();
+
+    /**
+     * \brief Records the use of a program.
+     * \param program The index of the program request.
+     */
+    void BindProgram(uint32_t program);
+
+    /**
+     * \brief Records the binding of a vertex array.
+     * \param vertex_array The ID of the vertex array.
+     */
+    void BindVertexArray(uint32_t vertex_array);
+
+    /**
+     * \brief Records the application of a material.
+     * \param material The ID of the material.
+     */
+    void BindMaterial(MaterialId material);
+
+    /**
+     * \brief Records the setting of the per-draw constants.
+     * \param constants The index of the constants.
+     */
+    void SetConstants(uint32_t constants);
+
+    /**
+     * \brief Records an indexed draw.
+     * \param index_count The number of indices.
+     */
+    void DrawIndexed(uint32_t index_count);
+
+    /**
+     * \brief Sorts the recorded draws by their keys.
+     */
+    void Sort();
+
+    /**
+     * \brief Empties the list for reuse, keeping the capacity of its buffers.
+     */
+    void Clear();
+
+    /**
+     * \brief Gets the recorded commands.
+     * \return The commands.
+     */
+    [[nodiscard]] const std::vector<RenderCommand>& GetCommands() const;
+
+    /**
+     * \brief Gets the recorded draws, in sort key order once sorted.
+     * \return The draws.
+     */
+    [[nodiscard]] const std::vector<RenderItem>& GetItems() const;
+
+    /**
+     * \brief Gets the per-draw constants.
+     * \return The constants.
+     */
+    [[nodiscard]] const std::vector<glm::mat4>& GetConstants() const;
+
+    /**
+     * \brief Gets the programs the draws are recorded with.
+     * \return The program requests.
+     */
+    [[nodiscard]] const std::vector<ProgramRequest>& GetPrograms() const;
+
+private:
+    std::vector<RenderCommand> m_commands;
+    std::vector<RenderItem> m_items;
+    std::vector<glm::mat4> m_constants;
+    std::vector<ProgramRequest> m_programs;
+};
+
+#endif // RENDER_COMMAND_LIST_H
@@ -0,0 +1,143 @@
+/**
+ * \file render_snapshot.h
+ */
+
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include "rendering/directional_light.h"
+#include "rendering/model.h"
+#include "rendering/point_light.h"
+#include "rendering/render_command_list.h"
+#include "rendering/spot_light.h"
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * \brief Represents the ways a scene can be rendered.
+ */
+enum class RenderPath
+{
+    /**
+     * \brief Each entity is drawn with its own shader, which lights every fragment with every light.
+     */
+    Forward,
+
+    /**
+     * \brief Entities are drawn into a G-buffer, which is then lit once per pixel by the lights culled
+     * per screen tile. Suits scenes with many lights.
+     */
+    Deferred
+};
+
+/**
+ * \brief The resolution a model's textures need on screen, which the renderer passes on to the texture
+ * streamer.
+ */
+struct TextureRequest
+{
+    /**
+     * \brief The model, shared with the entity's mesh component so that it outlives the entity while
+     * the snapshot is drawn.
+     */
+    std::shared_ptr<const Model> model;
+
+    /**
+     * \brief The height of the model on screen in pixels.
+     */
+    float screen_size;
+};
+
+/**
+ * \brief The camera a frame is drawn from.
+ */
+struct CameraSnapshot
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 position;
+};
+
+/**
+ * \brief The lights of a frame, in the layout of the lighting UBO.
+ */
+struct LightSnapshot
+{
+    std::vector<PointLightData> point_lights;
+    std::vector<SpotLightData> spot_lights;
+    DirectionalLightData directional_light;
+    bool has_directional_light;
+};
+
+/**
+ * \brief An immutable copy of the state a frame is drawn from, written by the simulation and read by the
+ * renderer. Nothing in it refers to the registry, so the simulation can change the scene while the
+ * snapshot is drawn.
+ */
+struct RenderSnapshot
+{
+    /**
+     * \brief The number of the frame, counted from zero.
+     */
+    uint64_t frame;
+
+    CameraSnapshot camera;
+    LightSnapshot lights;
+
+    /**
+     * \brief The draws of the frame, recorded in parallel with one list per thread. Each list is sorted,
+     * so the renderer only has to merge them.
+     */
+    std::vector<RenderCommandList> command_lists;
+
+    std::vector<TextureRequest> texture_requests;
+
+    RenderPath render_path;
+    bool depth_pre_pass;
+
+    /**
+     * \brief The time at which the simulation started writing the snapshot, which frame latency is
+     * measured from.
+     */
+    std::chrono::steady_clock::time_point simulation_start;
+
+    /**
+     * \brief The time at which the simulation sampled the input the snapshot reflects, which the latency
+     * to presenting it is measured from.
+     */
+    std::chrono::steady_clock::time_point input_time;
+
+    /**
+     * \brief The time the simulation took to write the snapshot, in milliseconds.
+     */
+    double simulation_milliseconds;
+
+    /**
+     * \brief The time the simulation waited for the renderer to free the snapshot, in milliseconds.
+     */
+    double wait_milliseconds;
+
+    /**
+     * \brief Empties the snapshot for reuse, keeping the capacity of its lists.
+     */
+    void Clear()
+    {
+        for (RenderCommandList& command_list : command_lists)
+        {
+            command_list.Clear();
+        }
+
+        texture_requests.clear();
+        lights.point_lights.clear();
+        lights.spot_lights.clear();
+        lights.has_directional_light = false;
+    }
+};
+
+#endif // RENDER_SNAPSHOT_H
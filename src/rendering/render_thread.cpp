@@ -0,0 +1,532 @@
+/**
+ * \file render_thread.cpp
+ */
+
+#include "render_thread.h"
+
+#include "rendering/loader_thread.h"
+#include "rendering/material.h"
+#include "rendering/material_texture_table.h"
+#include "rendering/texture_streamer.h"
+
+#include "resource_manager.h"
+
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+
+RenderThread RenderThread::s_instance;
+
+/**
+ * \brief The weight of the latest frame in the averaged frame statistics.
+ */
+constexpr double FRAME_AVERAGE_WEIGHT = 0.05;
+
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000;
+
+/**
+ * \brief Adds a sample to an exponential moving average, which starts at the first sample.
+ * \param average The average.
+ * \param sample The sample.
+ * \param first Determines if this is the first sample.
+ */
+static void Accumulate(double& average, const double sample, const bool first)
+{
+    average = first ? sample : average + (sample - average) * FRAME_AVERAGE_WEIGHT;
+}
+
+/**
+ * \brief Gets the time between two points in milliseconds.
+ * \param start The earlier point.
+ * \param end The later point.
+ * \return The time in milliseconds.
+ */
+static double Milliseconds(const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+RenderThread::RenderThread()
+    : m_threaded{ false },
+    m_snapshots{},
+    m_write_index{ 0 },
+    m_submitted{ NO_SNAPSHOT },
+    m_frame{ 0 },
+    m_running{ false },
+    m_frame_fences{},
+    m_fenced_frames{ 0 },
+    m_completed_frames{ 0 },
+    m_input_prepared{ false },
+    m_timer_queries{},
+    m_timed_frames{ 0 },
+    m_statistics{},
+    m_frame_interval_milliseconds{ 0.0 }
+{
+}
+
+/**
+ * \brief Creates the scene renderer and, when threaded, hands the window's GL context to a new
+ * render thread. Must be called on the thread whose context is current.
+ * \param window The window drawn to.
+ * \param threaded Determines if snapshots are drawn on a dedicated render thread.
+ * \param pacing How far the renderer may run ahead of the GPU and how frames are presented.
+ */
+void RenderThread::Initialise(std::shared_ptr<GlfwWindow> window, const bool threaded, const FramePacing& pacing)
+{
+    DFM_PROFILE_FUNCTION();
+
+    RenderThread& render_thread = Get();
+
+    render_thread.m_window = std::move(window);
+    render_thread.m_renderer = std::make_unique<SceneRenderer>();
+    render_thread.m_threaded = threaded;
+    render_thread.m_write_index = 0;
+    render_thread.m_submitted = NO_SNAPSHOT;
+    render_thread.m_statistics = {};
+
+    render_thread.m_pacing = pacing;
+    render_thread.m_pacing.frames_in_flight = std::clamp(pacing.frames_in_flight, 1u, MAX_FRAMES_IN_FLIGHT);
+    render_thread.m_frame_fences = {};
+    render_thread.m_fenced_frames = 0;
+    render_thread.m_completed_frames = 0;
+    render_thread.m_input_prepared = false;
+
+    DFM_CORE_INFO("Frame pacing: swap interval {0}, {1} frames in flight, low-latency mode {2}.",
+        render_thread.m_pacing.swap_interval, render_thread.m_pacing.frames_in_flight,
+        render_thread.m_pacing.low_latency ? "on" : "off");
+
+    glCreateQueries(GL_TIMESTAMP, static_cast<GLsizei>(render_thread.m_timer_queries.size()), render_thread.m_timer_queries.data());
+    render_thread.m_timed_frames = 0;
+
+    if (!threaded)
+    {
+        render_thread.ApplySwapInterval();
+        return;
+    }
+
+    // A context can only be current on one thread at a time, so it is released before the render thread
+    // makes it current.
+    glfwMakeContextCurrent(nullptr);
+
+    render_thread.m_running = true;
+    render_thread.m_thread = std::thread{ &RenderThread::RenderLoop, &render_thread };
+}
+
+/**
+ * \brief Draws any submitted snapshot, stops the render thread and makes the GL context current on the
+ * calling thread again.
+ */
+void RenderThread::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    RenderThread& render_thread = Get();
+
+    if (render_thread.m_threaded)
+    {
+        {
+            std::lock_guard lock{ render_thread.m_mutex };
+            render_thread.m_running = false;
+        }
+
+        render_thread.m_condition.notify_all();
+        render_thread.m_thread.join();
+
+        render_thread.m_window->MakeContextCurrent();
+        render_thread.m_threaded = false;
+    }
+
+    // Models held by the snapshots are released here, so the scene is free to destroy the last references.
+    for (RenderSnapshot& snapshot : render_thread.m_snapshots)
+    {
+        snapshot.Clear();
+    }
+
+    for (FrameFence& frame_fence : render_thread.m_frame_fences)
+    {
+        if (frame_fence.fence)
+        {
+            glDeleteSync(frame_fence.fence);
+            frame_fence.fence = nullptr;
+        }
+    }
+
+    glDeleteQueries(static_cast<GLsizei>(render_thread.m_timer_queries.size()), render_thread.m_timer_queries.data());
+    render_thread.m_timer_queries = {};
+
+    render_thread.m_renderer.reset();
+    render_thread.m_window.reset();
+}
+
+/**
+ * \brief Marks the point at which the simulation samples input, which frame latency is measured from.
+ * In low-latency mode, first waits until the GPU has finished every submitted frame, so that input is
+ * sampled as late as possible before the next frame is drawn.
+ */
+void RenderThread::PrepareInput()
+{
+    DFM_PROFILE_FUNCTION();
+
+    RenderThread& render_thread = Get();
+
+    // When not threaded, frames are finished before Submit returns in low-latency mode.
+    if (render_thread.m_threaded && render_thread.m_pacing.low_latency)
+    {
+        std::unique_lock lock{ render_thread.m_mutex };
+        render_thread.m_condition.wait(lock, [&render_thread]
+        {
+            return render_thread.m_completed_frames >= render_thread.m_frame || !render_thread.m_running;
+        });
+    }
+
+    render_thread.m_input_time = std::chrono::steady_clock::now();
+    render_thread.m_input_prepared = true;
+}
+
+/**
+ * \brief Gets an empty snapshot for the simulation to write the next frame into, waiting while the
+ * renderer still needs both snapshots.
+ * \return The snapshot.
+ */
+RenderSnapshot& RenderThread::BeginFrame()
+{
+    DFM_PROFILE_FUNCTION();
+
+    RenderThread& render_thread = Get();
+    const auto wait_start = std::chrono::steady_clock::now();
+
+    if (render_thread.m_threaded)
+    {
+        // Once the render thread has taken the previous snapshot, it only reads that one, so the other
+        // is free. Waiting here keeps the simulation at most one frame ahead of the renderer.
+        std::unique_lock lock{ render_thread.m_mutex };
+        render_thread.m_condition.wait(lock, [&render_thread]
+        {
+            return render_thread.m_submitted == NO_SNAPSHOT;
+        });
+    }
+
+    RenderSnapshot& snapshot = render_thread.m_snapshots[render_thread.m_write_index];
+    snapshot.Clear();
+    snapshot.frame = render_thread.m_frame++;
+    snapshot.simulation_start = std::chrono::steady_clock::now();
+    snapshot.wait_milliseconds = Milliseconds(wait_start, snapshot.simulation_start);
+
+    // Without an input sample, latency is measured from the start of the simulation.
+    snapshot.input_time = render_thread.m_input_prepared ? render_thread.m_input_time : snapshot.simulation_start;
+    render_thread.m_input_prepared = false;
+
+    return snapshot;
+}
+
+/**
+ * \brief Hands the snapshot returned by \code BeginFrame to the renderer. When not threaded, the
+ * snapshot is drawn and the buffers swapped before returning.
+ */
+void RenderThread::Submit()
+{
+    DFM_PROFILE_FUNCTION();
+
+    RenderThread& render_thread = Get();
+
+    RenderSnapshot& snapshot = render_thread.m_snapshots[render_thread.m_write_index];
+    snapshot.simulation_milliseconds = Milliseconds(snapshot.simulation_start, std::chrono::steady_clock::now());
+
+    if (!render_thread.m_threaded)
+    {
+        render_thread.RenderFrame(snapshot);
+        return;
+    }
+
+    {
+        std::lock_guard lock{ render_thread.m_mutex };
+        render_thread.m_submitted = render_thread.m_write_index;
+    }
+
+    render_thread.m_condition.notify_all();
+    render_thread.m_write_index = 1 - render_thread.m_write_index;
+}
+
+/**
+ * \brief Determines whether snapshots are drawn on a dedicated render thread.
+ * \return A boolean value indicating if the render thread is running.
+ */
+bool RenderThread::IsThreaded()
+{
+    return Get().m_threaded;
+}
+
+/**
+ * \brief Gets the frame rate and latency of recent frames, with the renderer's statistics of the last one.
+ * \return The frame statistics.
+ */
+FrameStatistics RenderThread::GetStatistics()
+{
+    std::lock_guard lock{ Get().m_statistics_mutex };
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Draws the snapshots submitted by the simulation on the render thread until it is shut down.
+ */
+void RenderThread::RenderLoop()
+{
+    Instrumentor::SetThreadName("Render");
+    m_window->MakeContextCurrent();
+
+    // The swap interval belongs to the context, so it is set on the thread the context is current on.
+    ApplySwapInterval();
+
+    while (true)
+    {
+        size_t index;
+
+        {
+            std::unique_lock lock{ m_mutex };
+            m_condition.wait(lock, [this]
+            {
+                return m_submitted != NO_SNAPSHOT || !m_running;
+            });
+
+            // A snapshot submitted before shutting down is still drawn.
+            if (m_submitted == NO_SNAPSHOT) break;
+
+            index = m_submitted;
+            m_submitted = NO_SNAPSHOT;
+        }
+
+        // Taking the snapshot frees the simulation to start writing the other one.
+        m_condition.notify_all();
+
+        RenderFrame(m_snapshots[index]);
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+/**
+ * \brief Runs the per-frame GL work, draws a snapshot and swaps the buffers.
+ * \param snapshot The snapshot.
+ */
+void RenderThread::RenderFrame(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    PollFrameFences();
+
+    // Wait for the frame that last used this fence, so the GPU never queues more than the allowed number of
+    // frames behind the renderer.
+    FrameFence& frame_fence = m_frame_fences[m_fenced_frames % m_pacing.frames_in_flight];
+
+    if (frame_fence.fence)
+    {
+        WaitForFrameFence(frame_fence);
+    }
+
+    const auto render_start = std::chrono::steady_clock::now();
+
+    const size_t timer = (m_timed_frames % GPU_TIMER_FRAMES) * 2;
+    glQueryCounter(m_timer_queries[timer], GL_TIMESTAMP);
+
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Register and upload the materials created since the last frame, then point the material table at the
+    // textures the streamer holds for this frame's draws.
+    MaterialManager::Update();
+    MaterialTextureTable::Update();
+
+    m_renderer->Render(snapshot);
+
+    // Adjust texture residency to this frame's draws, which queues uploads for the loader thread.
+    TextureStreamer::Update();
+
+    // Finish meshes and textures the loader thread has uploaded, and hand out any shaders that finished
+    // compiling on driver threads.
+    LoaderThread::Update();
+    ResourceManager::PollShaders();
+
+    glQueryCounter(m_timer_queries[timer + 1], GL_TIMESTAMP);
+    const auto render_end = std::chrono::steady_clock::now();
+
+    // Swapping may block for a while, so catch the frames that finished while this one was recorded.
+    PollFrameFences();
+
+    m_window->SwapBuffers();
+    GlState::EndFrame();
+
+    // The fence is flushed straight away, so that polling it without flushing can see it signalled.
+    frame_fence.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame_fence.input_time = snapshot.input_time;
+    m_fenced_frames++;
+    glFlush();
+
+    // In low-latency mode the frame is finished before the simulation samples input for the next one.
+    if (m_pacing.low_latency)
+    {
+        WaitForFrameFence(frame_fence);
+    }
+
+    // Each frame's queries are read just before they are reused, by which time the GPU has usually drawn it.
+    m_timed_frames++;
+    const double gpu_milliseconds = m_timed_frames >= GPU_TIMER_FRAMES ? ReadGpuTime() : -1.0;
+
+    RecordFrame(snapshot, render_start, render_end, gpu_milliseconds);
+}
+
+/**
+ * \brief Sets the swap interval of the current context, falling back to waiting for every vertical
+ * blank if late swaps are not supported.
+ */
+void RenderThread::ApplySwapInterval() const
+{
+    DFM_PROFILE_FUNCTION();
+
+    int swap_interval = m_pacing.swap_interval;
+
+    if (swap_interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+    {
+        DFM_CORE_WARN("Adaptive swap interval is not supported, waiting for every vertical blank instead.");
+        swap_interval = 1;
+    }
+
+    glfwSwapInterval(swap_interval);
+}
+
+/**
+ * \brief Retires the fenced frames that the GPU has already finished, without waiting.
+ */
+void RenderThread::PollFrameFences()
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Fences are signalled in order, so the oldest unsignalled one ends the search.
+    while (m_completed_frames < m_fenced_frames)
+    {
+        FrameFence& frame_fence = m_frame_fences[m_completed_frames % m_pacing.frames_in_flight];
+
+        const GLenum status = glClientWaitSync(frame_fence.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+        RetireFrameFence(frame_fence);
+    }
+}
+
+/**
+ * \brief Waits for the GPU to finish a fenced frame, then retires it along with every older frame.
+ * \param frame_fence The frame's fence.
+ */
+void RenderThread::WaitForFrameFence(FrameFence& frame_fence)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const GLenum status = glClientWaitSync(frame_fence.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+    {
+        DFM_CORE_ERROR("Failed to wait for the GPU to finish a frame.");
+    }
+
+    // Older frames finished before this one, so they are retired first, in order.
+    while (frame_fence.fence)
+    {
+        RetireFrameFence(m_frame_fences[m_completed_frames % m_pacing.frames_in_flight]);
+    }
+}
+
+/**
+ * \brief Records the latency of a frame that the GPU has finished and frees its fence.
+ * \param frame_fence The frame's fence, which must belong to the oldest fenced frame.
+ */
+void RenderThread::RetireFrameFence(FrameFence& frame_fence)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const double latency = Milliseconds(frame_fence.input_time, std::chrono::steady_clock::now());
+
+    glDeleteSync(frame_fence.fence);
+    frame_fence.fence = nullptr;
+
+    {
+        std::lock_guard lock{ m_statistics_mutex };
+        Accumulate(m_statistics.present_latency_milliseconds, latency, m_statistics.present_latency_histogram.count == 0);
+        m_statistics.present_latency_histogram.Add(latency);
+    }
+
+    {
+        std::lock_guard lock{ m_mutex };
+        m_completed_frames++;
+    }
+
+    m_condition.notify_all();
+}
+
+/**
+ * \brief Reads the GPU time of the oldest measured frame, whose queries are reused by the next frame.
+ * \return The GPU time in milliseconds, or a negative value if the GPU has not finished the frame.
+ */
+double RenderThread::ReadGpuTime() const
+{
+    DFM_PROFILE_FUNCTION();
+
+    const size_t timer = (m_timed_frames % GPU_TIMER_FRAMES) * 2;
+
+    // Results only arrive in order, so the end of the frame being available means the start is too. A
+    // frame the GPU is still drawing is skipped rather than waited for.
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(m_timer_queries[timer + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available == GL_FALSE) return -1.0;
+
+    GLuint64 start, end;
+    glGetQueryObjectui64v(m_timer_queries[timer], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(m_timer_queries[timer + 1], GL_QUERY_RESULT, &end);
+
+    return static_cast<double>(end - start) / 1'000'000.0;
+}
+
+/**
+ * \brief Adds a drawn frame to the frame statistics.
+ * \param snapshot The snapshot that was drawn.
+ * \param render_start The time at which drawing started.
+ * \param render_end The time at which drawing finished, before the buffers were swapped.
+ * \param gpu_milliseconds The GPU time of an earlier frame, or a negative value if it was not available.
+ */
+void RenderThread::RecordFrame(const RenderSnapshot& snapshot, const std::chrono::steady_clock::time_point render_start,
+                               const std::chrono::steady_clock::time_point render_end, const double gpu_milliseconds)
+{
+    const auto present = std::chrono::steady_clock::now();
+
+    std::lock_guard lock{ m_statistics_mutex };
+
+    const bool first = m_statistics.frames == 0;
+
+    Accumulate(m_statistics.simulation_milliseconds, snapshot.simulation_milliseconds, first);
+    Accumulate(m_statistics.wait_milliseconds, snapshot.wait_milliseconds, first);
+    Accumulate(m_statistics.render_milliseconds, Milliseconds(render_start, present), first);
+    Accumulate(m_statistics.latency_milliseconds, Milliseconds(snapshot.simulation_start, present), first);
+
+    const double cpu_milliseconds = snapshot.simulation_milliseconds + Milliseconds(render_start, render_end);
+    Accumulate(m_statistics.cpu_milliseconds, cpu_milliseconds, first);
+    m_statistics.cpu_histogram.Add(cpu_milliseconds);
+
+    if (gpu_milliseconds >= 0.0)
+    {
+        Accumulate(m_statistics.gpu_milliseconds, gpu_milliseconds, m_statistics.gpu_histogram.count == 0);
+        m_statistics.gpu_histogram.Add(gpu_milliseconds);
+    }
+
+    // The frame rate is measured between presents, so it covers whichever of the simulation or the
+    // renderer is slower.
+    if (!first)
+    {
+        Accumulate(m_frame_interval_milliseconds, Milliseconds(m_last_present, present), m_statistics.frames == 1);
+        m_statistics.frames_per_second = m_frame_interval_milliseconds > 0.0 ? 1000.0 / m_frame_interval_milliseconds : 0.0;
+    }
+
+    m_last_present = present;
+    m_statistics.frames++;
+    m_statistics.gl_state = GlState::GetStatistics();
+    m_statistics.depth_pre_pass = m_renderer->GetDepthPrePassStatistics();
+}
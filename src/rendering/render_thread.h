@@ -0,0 +1,319 @@
+/**
+ * \file render_thread.h
+ */
+
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "glfw_window.h"
+
+#include "rendering/depth_pre_pass.h"
+#include "rendering/render_snapshot.h"
+#include "rendering/scene_renderer.h"
+
+#include "utils/frame_clock.h"
+#include "utils/gl_state.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief Represents how quickly frames are produced and how long they take to reach the screen. Times
+ * are averaged over recent frames.
+ */
+struct FrameStatistics
+{
+    /**
+     * \brief The number of frames drawn.
+     */
+    uint64_t frames;
+
+    /**
+     * \brief The time the simulation took to write a snapshot, in milliseconds.
+     */
+    double simulation_milliseconds;
+
+    /**
+     * \brief The time the simulation waited for the renderer to free a snapshot, in milliseconds.
+     */
+    double wait_milliseconds;
+
+    /**
+     * \brief The time the renderer took to draw a snapshot and swap the buffers, in milliseconds.
+     */
+    double render_milliseconds;
+
+    /**
+     * \brief The time from the simulation starting a snapshot to the buffers being swapped with it
+     * drawn, in milliseconds.
+     */
+    double latency_milliseconds;
+
+    /**
+     * \brief The rate at which frames are presented.
+     */
+    double frames_per_second;
+
+    /**
+     * \brief The CPU time spent on a snapshot by the simulation and the renderer, leaving out waits for
+     * each other and for the buffers to swap, in milliseconds.
+     */
+    double cpu_milliseconds;
+
+    /**
+     * \brief The time the GPU took to draw a snapshot, in milliseconds. Measured with timestamp queries
+     * that are read a few frames later, so that reading them does not stall.
+     */
+    double gpu_milliseconds;
+
+    /**
+     * \brief The distributions of the CPU and GPU times of every frame since the renderer was initialised.
+     */
+    FrameTimeHistogram cpu_histogram;
+    FrameTimeHistogram gpu_histogram;
+
+    /**
+     * \brief The time from the simulation sampling input to the GPU finishing the frame's commands and
+     * buffer swap, in milliseconds. Outstanding fences are polled twice a frame, so it is taken at most
+     * part of a frame after the GPU finished, and exactly when the renderer blocks on the fence.
+     */
+    double present_latency_milliseconds;
+
+    FrameTimeHistogram present_latency_histogram;
+
+    GlStateStatistics gl_state;
+    DepthPrePassStatistics depth_pre_pass;
+};
+
+/**
+ * \brief The largest number of frames the GPU may queue behind the renderer.
+ */
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+/**
+ * \brief Controls how far the renderer runs ahead of the GPU and how frames are presented.
+ */
+struct FramePacing
+{
+    /**
+     * \brief The number of vertical blanks to wait for before each swap. Zero presents immediately, and -1
+     * waits unless the frame is late, where the driver supports it.
+     */
+    int swap_interval{ 1 };
+
+    /**
+     * \brief The number of frames the GPU may queue behind the renderer, from 1 to \code MAX_FRAMES_IN_FLIGHT.
+     * Fewer frames lower latency, while more absorb frames that take the GPU longer than others.
+     */
+    uint32_t frames_in_flight{ 2 };
+
+    /**
+     * \brief Determines if the GPU finishes each frame before the simulation samples input for the next
+     * one. This gives the lowest latency at the cost of the CPU and GPU no longer overlapping across frames.
+     */
+    bool low_latency{ false };
+};
+
+/**
+ * \brief A singleton class that draws the render snapshots written by the simulation. When threaded, a
+ * dedicated render thread owns the GL context and draws frame N while the simulation writes frame N + 1
+ * into the other of two snapshots. Otherwise each snapshot is drawn on the thread that submits it. The
+ * simulation calls \code BeginFrame and \code Submit in turn; nothing else may make GL calls while the
+ * render thread runs. A fence after each swap limits how many frames the GPU may queue behind the renderer.
+ */
+class RenderThread
+{
+public:
+    RenderThread(const RenderThread&) = delete;
+    RenderThread(RenderThread&&) noexcept = delete;
+
+    RenderThread& operator=(const RenderThread&) = delete;
+    RenderThread& operator=(RenderThread&&) noexcept = delete;
+
+    /**
+     * \brief Creates the scene renderer and, when threaded, hands the window's GL context to a new
+     * render thread. Must be called on the thread whose context is current.
+     * \param window The window drawn to.
+     * \param threaded Determines if snapshots are drawn on a dedicated render thread.
+     * \param pacing How far the renderer may run ahead of the GPU and how frames are presented.
+     */
+    static void Initialise(std::shared_ptr<GlfwWindow> window, bool threaded, const FramePacing& pacing = {});
+
+    /**
+     * \brief Draws any submitted snapshot, stops the render thread and makes the GL context current on the
+     * calling thread again.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Marks the point at which the simulation samples input, which frame latency is measured from.
+     * In low-latency mode, first waits until the GPU has finished every submitted frame, so that input is
+     * sampled as late as possible before the next frame is drawn.
+     */
+    static void PrepareInput();
+
+    /**
+     * \brief Gets an empty snapshot for the simulation to write the next frame into, waiting while the
+     * renderer still needs both snapshots.
+     * \return The snapshot.
+     */
+    static RenderSnapshot& BeginFrame();
+
+    /**
+     * \brief Hands the snapshot returned by \code BeginFrame to the renderer. When not threaded, the
+     * snapshot is drawn and the buffers swapped before returning.
+     */
+    static void Submit();
+
+    /**
+     * \brief Determines whether snapshots are drawn on a dedicated render thread.
+     * \return A boolean value indicating if the render thread is running.
+     */
+    [[nodiscard]] static bool IsThreaded();
+
+    /**
+     * \brief Gets the frame rate and latency of recent frames, with the renderer's statistics of the last one.
+     * \return The frame statistics.
+     */
+    [[nodiscard]] static FrameStatistics GetStatistics();
+
+private:
+    /**
+     * \brief Marks that no snapshot is waiting to be drawn.
+     */
+    static constexpr size_t NO_SNAPSHOT = 2;
+
+    /**
+     * \brief The number of frames whose GPU times are measured at once, which is how many frames later
+     * each measurement is read.
+     */
+    static constexpr size_t GPU_TIMER_FRAMES = 4;
+
+    /**
+     * \brief A fence inserted after a frame's swap, which is signalled once the GPU has finished the frame.
+     */
+    struct FrameFence
+    {
+        GLsync fence;
+        std::chrono::steady_clock::time_point input_time;
+    };
+
+    std::shared_ptr<GlfwWindow> m_window;
+    std::unique_ptr<SceneRenderer> m_renderer;
+    std::thread m_thread;
+    bool m_threaded;
+
+    std::array<RenderSnapshot, 2> m_snapshots;
+
+    /**
+     * \brief The snapshot the simulation writes next. Only touched by the simulation.
+     */
+    size_t m_write_index;
+
+    /**
+     * \brief The snapshot submitted but not yet taken by the render thread, or \code NO_SNAPSHOT.
+     */
+    size_t m_submitted;
+
+    uint64_t m_frame;
+    bool m_running;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    FramePacing m_pacing;
+    std::array<FrameFence, MAX_FRAMES_IN_FLIGHT> m_frame_fences;
+    uint64_t m_fenced_frames;
+
+    /**
+     * \brief The number of frames the GPU has been seen to finish, which is also the index of the oldest
+     * fenced frame. Only changed by the rendering thread under \code m_mutex, so it reads it without locking.
+     */
+    uint64_t m_completed_frames;
+
+    /**
+     * \brief The time at which input was last sampled, and whether it has been since the last snapshot.
+     * Only touched by the simulation.
+     */
+    std::chrono::steady_clock::time_point m_input_time;
+    bool m_input_prepared;
+
+    /**
+     * \brief Pairs of timestamp queries taken at the start and end of each measured frame.
+     */
+    std::array<GLuint, 2 * GPU_TIMER_FRAMES> m_timer_queries;
+    uint64_t m_timed_frames;
+
+    FrameStatistics m_statistics;
+    std::chrono::steady_clock::time_point m_last_present;
+    double m_frame_interval_milliseconds;
+    std::mutex m_statistics_mutex;
+
+    RenderThread();
+    ~RenderThread() = default;
+
+    /**
+     * \brief Draws the snapshots submitted by the simulation on the render thread until it is shut down.
+     */
+    void RenderLoop();
+
+    /**
+     * \brief Runs the per-frame GL work, draws a snapshot and swaps the buffers.
+     * \param snapshot The snapshot.
+     */
+    void RenderFrame(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Sets the swap interval of the current context, falling back to waiting for every vertical
+     * blank if late swaps are not supported.
+     */
+    void ApplySwapInterval() const;
+
+    /**
+     * \brief Retires the fenced frames that the GPU has already finished, without waiting.
+     */
+    void PollFrameFences();
+
+    /**
+     * \brief Waits for the GPU to finish a fenced frame, then retires it along with every older frame.
+     * \param frame_fence The frame's fence.
+     */
+    void WaitForFrameFence(FrameFence& frame_fence);
+
+    /**
+     * \brief Records the latency of a frame that the GPU has finished and frees its fence.
+     * \param frame_fence The frame's fence, which must belong to the oldest fenced frame.
+     */
+    void RetireFrameFence(FrameFence& frame_fence);
+
+    /**
+     * \brief Reads the GPU time of the oldest measured frame, whose queries are reused by the next frame.
+     * \return The GPU time in milliseconds, or a negative value if the GPU has not finished the frame.
+     */
+    [[nodiscard]] double ReadGpuTime() const;
+
+    /**
+     * \brief Adds a drawn frame to the frame statistics.
+     * \param snapshot The snapshot that was drawn.
+     * \param render_start The time at which drawing started.
+     * \param render_end The time at which drawing finished, before the buffers were swapped.
+     * \param gpu_milliseconds The GPU time of an earlier frame, or a negative value if it was not available.
+     */
+    void RecordFrame(const RenderSnapshot& snapshot, std::chrono::steady_clock::time_point render_start,
+                     std::chrono::steady_clock::time_point render_end, double gpu_milliseconds);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static RenderThread& Get() { return s_instance; }
+
+    static RenderThread s_instance;
+};
+
+#endif // RENDER_THREAD_H
@@ -0,0 +1,289 @@
+/**
+ * \file scene_renderer.cpp
+ */
+
+#include "scene_renderer.h"
+
+#include "rendering/lighting.h"
+#include "rendering/material.h"
+#include "rendering/material_texture_table.h"
+
+#include "resource_manager.h"
+#include "ubo.h"
+
+#include "utils/gl_state.h"
+#include "utils/profiling.h"
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+
+/**
+ * \brief Marks replay state that has not been set since the program was last changed.
+ */
+constexpr uint32_t UNSET = UINT32_MAX;
+
+/**
+ * \brief Uploads a snapshot's camera and lights, then replays its command lists.
+ * \param snapshot The render snapshot.
+ */
+void SceneRenderer::Render(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    UploadFrameData(snapshot);
+    ResolvePrograms(snapshot);
+    MergeCommandLists(snapshot);
+
+    if (snapshot.render_path == RenderPath::Deferred)
+    {
+        RenderDeferred(snapshot);
+    }
+    else
+    {
+        // Depth pass draws sort before shading pass draws, so the passes split the merged order in two.
+        const auto shading_begin = std::partition_point(m_merged.begin(), m_merged.end(), [&snapshot](const MergedItem& merged)
+        {
+            const RenderItem& item = snapshot.command_lists[merged.list].GetItems()[merged.item];
+            return RenderCommandList::GetPass(item.sort_key) == RenderPass::Depth;
+        });
+
+        RenderForward(snapshot, static_cast<size_t>(shading_begin - m_merged.begin()));
+    }
+
+    // Let the texture streamer know how much detail each model's textures need on screen.
+    for (const TextureRequest& request : snapshot.texture_requests)
+    {
+        request.model->RequestTextureResolution(request.screen_size);
+    }
+}
+
+/**
+ * \brief Gets how much fragment shading the depth pre-pass saved in a recent frame.
+ * \return The depth pre-pass statistics.
+ */
+DepthPrePassStatistics SceneRenderer::GetDepthPrePassStatistics() const
+{
+    return m_depth_pre_pass.GetStatistics();
+}
+
+/**
+ * \brief Writes the camera and lights of a snapshot to the matrices and lighting UBOs.
+ * \param snapshot The render snapshot.
+ */
+void SceneRenderer::UploadFrameData(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const CameraSnapshot& camera = snapshot.camera;
+    const LightSnapshot& lights = snapshot.lights;
+
+    const Ubo& matrices_ubo = UboManager::Retrieve("matrices");
+    matrices_ubo.SetSubData(0, sizeof(glm::mat4), glm::value_ptr(camera.view));
+    matrices_ubo.SetSubData(sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(camera.projection));
+
+    const Ubo& lighting_ubo = UboManager::Retrieve("lighting");
+
+    const glm::vec4 view_position{ camera.position, 0.0f };
+    lighting_ubo.SetSubData(offsetof(Lighting, view_position), sizeof(Lighting::view_position), glm::value_ptr(view_position));
+
+    const int point_lights_size = static_cast<int>(lights.point_lights.size());
+    lighting_ubo.SetSubData(offsetof(Lighting, point_lights_size), sizeof(Lighting::point_lights_size), &point_lights_size);
+    lighting_ubo.SetSubData(offsetof(Lighting, point_lights), sizeof(PointLightData) * lights.point_lights.size(), lights.point_lights.data());
+
+    const int spot_lights_size = static_cast<int>(lights.spot_lights.size());
+    lighting_ubo.SetSubData(offsetof(Lighting, spot_lights_size), sizeof(Lighting::spot_lights_size), &spot_lights_size);
+    lighting_ubo.SetSubData(offsetof(Lighting, spot_lights), sizeof(SpotLightData) * lights.spot_lights.size(), lights.spot_lights.data());
+
+    if (lights.has_directional_light)
+    {
+        lighting_ubo.SetSubData(offsetof(Lighting, directional_light), sizeof(DirectionalLightData), &lights.directional_light);
+    }
+}
+
+/**
+ * \brief Looks up the programs requested by a snapshot's command lists, compiling any missing variants.
+ * \param snapshot The render snapshot.
+ */
+void SceneRenderer::ResolvePrograms(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_programs.resize(snapshot.command_lists.size());
+
+    for (size_t i = 0; i < snapshot.command_lists.size(); i++)
+    {
+        m_programs[i].clear();
+
+        for (const ProgramRequest& request : snapshot.command_lists[i].GetPrograms())
+        {
+            m_programs[i].push_back(request.name.empty() ? &request.shader : &ResourceManager::GetShaderVariant(request.name, request.permutation));
+        }
+    }
+}
+
+/**
+ * \brief Merges the draws of a snapshot's sorted command lists into a single order.
+ * \param snapshot The render snapshot.
+ */
+void SceneRenderer::MergeCommandLists(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const auto& lists = snapshot.command_lists;
+
+    size_t count = 0;
+    for (const RenderCommandList& list : lists)
+    {
+        count += list.GetItems().size();
+    }
+
+    m_merged.clear();
+    m_merged.reserve(count);
+
+    // There is one list per thread, so the smallest head is found with a scan rather than a heap.
+    std::vector<uint32_t> heads(lists.size(), 0);
+
+    while (m_merged.size() < count)
+    {
+        uint32_t smallest = 0;
+        uint64_t smallest_key = UINT64_MAX;
+
+        for (uint32_t i = 0; i < lists.size(); i++)
+        {
+            const auto& items = lists[i].GetItems();
+
+            if (heads[i] < items.size() && items[heads[i]].sort_key < smallest_key)
+            {
+                smallest = i;
+                smallest_key = items[heads[i]].sort_key;
+            }
+        }
+
+        m_merged.push_back({ smallest, heads[smallest]++ });
+    }
+}
+
+/**
+ * \brief Replays a range of the merged draws.
+ * \param snapshot The render snapshot.
+ * \param begin The index of the first merged draw.
+ * \param end One past the index of the last merged draw.
+ */
+void SceneRenderer::Replay(const RenderSnapshot& snapshot, const size_t begin, const size_t end) const
+{
+    DFM_PROFILE_FUNCTION();
+
+    // The draws are sorted by program and material, so most of their binds repeat the previous draw's
+    // and are skipped. Constants are indices into a list, so they are only comparable within one.
+    GLint current_program = 0;
+    GLint model_location = -1;
+    uint32_t current_list = UNSET;
+    uint32_t current_constants = UNSET;
+    MaterialId current_material = UNSET;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const MergedItem& merged = m_merged[i];
+        const RenderCommandList& list = snapshot.command_lists[merged.list];
+        const RenderItem& item = list.GetItems()[merged.item];
+
+        if (merged.list != current_list)
+        {
+            current_list = merged.list;
+            current_constants = UNSET;
+        }
+
+        const RenderCommand* commands = list.GetCommands().data() + item.first_command;
+
+        for (uint32_t j = 0; j < item.command_count; j++)
+        {
+            const RenderCommand& command = commands[j];
+
+            switch (command.type)
+            {
+            case RenderCommandType::BindProgram:
+                if (const Shader& program = *m_programs[merged.list][command.value]; program.GetId() != current_program)
+                {
+                    program.Use();
+                    current_program = program.GetId();
+                    model_location = glGetUniformLocation(current_program, "model");
+
+                    // Uniforms belong to the program, so they are set again after changing it.
+                    current_constants = UNSET;
+                    current_material = UNSET;
+                }
+
+                break;
+
+            case RenderCommandType::BindVertexArray:
+                GlState::BindVertexArray(command.value);
+                break;
+
+            case RenderCommandType::BindMaterial:
+                if (command.value != current_material)
+                {
+                    MaterialManager::Apply(command.value);
+                    current_material = command.value;
+                }
+
+                break;
+
+            case RenderCommandType::SetConstants:
+                if (command.value != current_constants)
+                {
+                    glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(list.GetConstants()[command.value]));
+                    current_constants = command.value;
+                }
+
+                break;
+
+            case RenderCommandType::DrawIndexed:
+                glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(command.value), GL_UNSIGNED_INT, nullptr);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Draws the entities with their own shaders, each lighting every fragment it draws.
+ * \param snapshot The render snapshot.
+ * \param shading_begin The index of the first merged draw of the shading pass.
+ */
+void SceneRenderer::RenderForward(const RenderSnapshot& snapshot, const size_t shading_begin)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (snapshot.depth_pre_pass)
+    {
+        // Lay down depth first, so the main pass only shades the closest surface of each pixel.
+        m_depth_pre_pass.BeginDepthPass();
+        Replay(snapshot, 0, shading_begin);
+    }
+
+    m_depth_pre_pass.BeginShadingPass();
+    MaterialTextureTable::Bind();
+
+    Replay(snapshot, shading_begin, m_merged.size());
+
+    m_depth_pre_pass.EndShadingPass();
+}
+
+/**
+ * \brief Draws the entities into the G-buffer, then lights every pixel once with the lights culled per
+ * screen tile.
+ * \param snapshot The render snapshot.
+ */
+void SceneRenderer::RenderDeferred(const RenderSnapshot& snapshot)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_deferred_renderer.BeginGeometryPass();
+    MaterialTextureTable::Bind();
+
+    Replay(snapshot, 0, m_merged.size());
+
+    m_deferred_renderer.EndGeometryPass();
+    m_deferred_renderer.Shade(ResourceManager::GetShader("deferred_lighting_shader"));
+}
@@ -0,0 +1,105 @@
+/**
+ * \file scene_renderer.h
+ */
+
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include "rendering/deferred_renderer.h"
+#include "rendering/depth_pre_pass.h"
+#include "rendering/render_snapshot.h"
+#include "rendering/shader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Draws render snapshots with the forward or deferred render path. The snapshot's command lists
+ * are merged in sort key order and replayed with GL, skipping state that is already set. Every GL call
+ * of a frame's scene is made here, on the thread that owns the GL context.
+ */
+class SceneRenderer
+{
+public:
+    SceneRenderer() = default;
+
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer(SceneRenderer&&) noexcept = delete;
+
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(SceneRenderer&&) noexcept = delete;
+
+    /**
+     * \brief Uploads a snapshot's camera and lights, then replays its command lists.
+     * \param snapshot The render snapshot.
+     */
+    void Render(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Gets how much fragment shading the depth pre-pass saved in a recent frame.
+     * \return The depth pre-pass statistics.
+     */
+    [[nodiscard]] DepthPrePassStatistics GetDepthPrePassStatistics() const;
+
+private:
+    /**
+     * \brief A recorded draw, in the order the command lists are merged into.
+     */
+    struct MergedItem
+    {
+        uint32_t list;
+        uint32_t item;
+    };
+
+    DepthPrePass m_depth_pre_pass;
+    DeferredRenderer m_deferred_renderer;
+
+    /**
+     * \brief The programs requested by each command list, looked up for the current snapshot.
+     */
+    std::vector<std::vector<const Shader*>> m_programs;
+    std::vector<MergedItem> m_merged;
+
+    /**
+     * \brief Writes the camera and lights of a snapshot to the matrices and lighting UBOs.
+     * \param snapshot The render snapshot.
+     */
+    static void UploadFrameData(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Looks up the programs requested by a snapshot's command lists, compiling any missing variants.
+     * \param snapshot The render snapshot.
+     */
+    void ResolvePrograms(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Merges the draws of a snapshot's sorted command lists into a single order.
+     * \param snapshot The render snapshot.
+     */
+    void MergeCommandLists(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Replays a range of the merged draws.
+     * \param snapshot The render snapshot.
+     * \param begin The index of the first merged draw.
+     * \param end One past the index of the last merged draw.
+     */
+    void Replay(const RenderSnapshot& snapshot, size_t begin, size_t end) const;
+
+    /**
+     * \brief Draws the entities with their own shaders, each lighting every fragment it draws.
+     * \param snapshot The render snapshot.
+     * \param shading_begin The index of the first merged draw of the shading pass.
+     */
+    void RenderForward(const RenderSnapshot& snapshot, size_t shading_begin);
+
+    /**
+     * \brief Draws the entities into the G-buffer, then lights every pixel once with the lights culled per
+     * screen tile.
+     * \param snapshot The render snapshot.
+     */
+    void RenderDeferred(const RenderSnapshot& snapshot);
+};
+
+#endif // SCENE_RENDERER_H
@@ -3,6 +3,9 @@
  */
 
 #include "shader.h"
+#include "shader_cache.h"
+#include "utils/gl_extensions.h"
+#include "utils/gl_state.h"
 #include "utils/logging.h"
 #include "utils/profiling.h"
 
@@ -11,7 +14,8 @@
 #include <iostream>
 
 Shader::Shader()
-    : m_id{}, m_compiled{ false }
+    : m_id{}, m_compiled{ false },
+    m_vertex_shader{}, m_fragment_shader{}, m_compute_shader{}, m_cache_key{}
 {
 
 }
@@ -25,40 +29,131 @@ void Shader::Compile(const std::string& vertex_shader_code, const std::string& f
 {
     DFM_PROFILE_FUNCTION();
 
+    BeginCompile(vertex_shader_code, fragment_shader_code);
+    FinishCompile();
+}
+
+/**
+ * \brief Submits the vertex and fragment shader code for compiling and linking without waiting
+ * for the driver, so that several programs can be compiled at once.
+ * \param vertex_shader_code The vertex shader code.
+ * \param fragment_shader_code The fragment shader code.
+ */
+void Shader::BeginCompile(const std::string& vertex_shader_code, const std::string& fragment_shader_code)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_id = glCreateProgram();
+
+    // Skip compilation entirely when the driver accepts a binary linked on a previous run.
+    m_cache_key = ShaderCache::MakeKey(vertex_shader_code, fragment_shader_code);
+    if (ShaderCache::Load(m_cache_key, m_id))
+    {
+        m_compiled = true;
+        return;
+    }
+
     const char* vertex_code_c = vertex_shader_code.c_str();
     const char* fragment_code_c = fragment_shader_code.c_str();
 
-    int success = 0;
-    char info_log[512];
+    m_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    m_fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 
-    const GLint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    const GLint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(m_vertex_shader, 1, &vertex_code_c, nullptr);
+    glShaderSource(m_fragment_shader, 1, &fragment_code_c, nullptr);
 
-    glShaderSource(vertex_shader, 1, &vertex_code_c, nullptr);
-    glShaderSource(fragment_shader, 1, &fragment_code_c, nullptr);
+    glCompileShader(m_vertex_shader);
+    glCompileShader(m_fragment_shader);
 
-    glCompileShader(vertex_shader);
-    glCompileShader(fragment_shader);
+    // Linking straight away queues it behind the compiles, rather than querying their status now
+    // and forcing the driver to finish them on this thread.
+    glAttachShader(m_id, m_vertex_shader);
+    glAttachShader(m_id, m_fragment_shader);
+    glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(m_id);
+}
 
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+/**
+ * \brief Compiles and links compute shader code into the shader program.
+ * \param compute_shader_code The compute shader code.
+ */
+void Shader::CompileCompute(const std::string& compute_shader_code)
+{
+    DFM_PROFILE_FUNCTION();
+
+    BeginComputeCompile(compute_shader_code);
+    FinishCompile();
+}
+
+/**
+ * \brief Submits compute shader code for compiling and linking without waiting for the driver.
+ * \param compute_shader_code The compute shader code.
+ */
+void Shader::BeginComputeCompile(const std::string& compute_shader_code)
+{
+    DFM_PROFILE_FUNCTION();
+
+    m_id = glCreateProgram();
+
+    m_cache_key = ShaderCache::MakeKey({}, {}, compute_shader_code);
+    if (ShaderCache::Load(m_cache_key, m_id))
     {
-        glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
-        DFM_CORE_ERROR("Failed to compile vertex shader.\n{0}", info_log);
+        m_compiled = true;
+        return;
     }
 
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    const char* compute_code_c = compute_shader_code.c_str();
+
+    m_compute_shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(m_compute_shader, 1, &compute_code_c, nullptr);
+    glCompileShader(m_compute_shader);
+
+    glAttachShader(m_id, m_compute_shader);
+    glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(m_id);
+}
+
+/**
+ * \brief Determines whether the driver has finished compiling and linking the program, so that
+ * finishing the compile will not block.
+ * \return A boolean value indicating if the compile is complete.
+ */
+bool Shader::IsCompileComplete() const
+{
+    DFM_PROFILE_FUNCTION();
+
+    if ((m_vertex_shader == 0 && m_compute_shader == 0) || !GlExtensions::HasParallelShaderCompile())
     {
-        glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
-        DFM_CORE_ERROR("Failed to compile fragment shader.\n{0}", info_log);
+        return true;
     }
 
-    m_id = glCreateProgram();
+    GLint complete = GL_FALSE;
+    glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &complete);
 
-    glAttachShader(m_id, vertex_shader);
-    glAttachShader(m_id, fragment_shader);
-    glLinkProgram(m_id);
+    return complete == GL_TRUE;
+}
+
+/**
+ * \brief Checks the result of a compile started with \code BeginCompile, waiting for the driver if
+ * it has not finished yet.
+ * \return A boolean value indicating if the program was linked successfully.
+ */
+bool Shader::FinishCompile()
+{
+    DFM_PROFILE_FUNCTION();
+
+    // The program was loaded from the shader cache, or has already been finished.
+    if (m_vertex_shader == 0 && m_compute_shader == 0)
+    {
+        return m_compiled;
+    }
+
+    int success = 0;
+    char info_log[512];
+
+    CheckCompileStatus(m_vertex_shader, "vertex");
+    CheckCompileStatus(m_fragment_shader, "fragment");
+    CheckCompileStatus(m_compute_shader, "compute");
 
     glGetProgramiv(m_id, GL_LINK_STATUS, &success);
     if (!success)
@@ -68,10 +163,17 @@ void Shader::Compile(const std::string& vertex_shader_code, const std::string& f
     } else
     {
         m_compiled = true;
+        ShaderCache::Store(m_cache_key, m_id);
     }
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    glDeleteShader(m_vertex_shader);
+    glDeleteShader(m_fragment_shader);
+    glDeleteShader(m_compute_shader);
+    m_vertex_shader = 0;
+    m_fragment_shader = 0;
+    m_compute_shader = 0;
+
+    return m_compiled;
 }
 
 /**
@@ -87,7 +189,7 @@ void Shader::Use() const
         return;
     }
 
-    glUseProgram(m_id);
+    GlState::UseProgram(m_id);
 }
 
 /**
@@ -112,6 +214,17 @@ void Shader::SetInt(const std::string& name, const int value) const
     glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+/**
+ * \brief Sets an unsigned integer uniform in the shader program.
+ * \param name The name of the uniform.
+ * \param value The value to set the uniform to.
+ */
+void Shader::SetUInt(const std::string& name, const unsigned int value) const
+{
+    DFM_PROFILE_FUNCTION();
+    glUniform1ui(glGetUniformLocation(m_id, name.c_str()), value);
+}
+
 /**
  * \brief Sets an float uniform in the shader program.
  * \param name The name of the uniform.
@@ -152,7 +265,7 @@ void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
  * \param name The name of the uniform.
  * \param value The value to set the uniform to.
  */
-void Shader::SetMat4(const std::string& name, glm::mat4& value) const
+void Shader::SetMat4(const std::string& name, const glm::mat4& value) const
 {
     DFM_PROFILE_FUNCTION();
     glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
@@ -165,4 +278,33 @@ void Shader::SetMat4(const std::string& name, glm::mat4& value) const
 GLint Shader::GetId() const
 {
     return m_id;
+}
+
+/**
+ * \brief Determines whether the shader program was compiled and linked successfully.
+ * \return A boolean value indicating if the shader program can be used.
+ */
+bool Shader::IsCompiled() const
+{
+    return m_compiled;
+}
+
+/**
+ * \brief Logs the compile errors of a shader stage, if it failed to compile.
+ * \param shader The shader object.
+ * \param stage_name The name of the shader stage, used in the log.
+ */
+void Shader::CheckCompileStatus(const GLuint shader, const char* stage_name)
+{
+    if (shader == 0) return;
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+    if (!success)
+    {
+        char info_log[512];
+        glGetShaderInfoLog(shader, 512, nullptr, info_log);
+        DFM_CORE_ERROR("Failed to compile {0} shader.\n{1}", stage_name, info_log);
+    }
 }
\ No newline at end of file
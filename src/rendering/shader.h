@@ -9,6 +9,7 @@
 #include "glad/glad.h"
 #include "glm/mat4x4.hpp"
 
+#include <cstdint>
 #include <string>
 
 /**
@@ -26,6 +27,40 @@ public:
      */
     void Compile(const std::string& vertex_shader_code, const std::string& fragment_shader_code);
 
+    /**
+     * \brief Submits the vertex and fragment shader code for compiling and linking without waiting
+     * for the driver, so that several programs can be compiled at once.
+     * \param vertex_shader_code The vertex shader code.
+     * \param fragment_shader_code The fragment shader code.
+     */
+    void BeginCompile(const std::string& vertex_shader_code, const std::string& fragment_shader_code);
+
+    /**
+     * \brief Compiles and links compute shader code into the shader program.
+     * \param compute_shader_code The compute shader code.
+     */
+    void CompileCompute(const std::string& compute_shader_code);
+
+    /**
+     * \brief Submits compute shader code for compiling and linking without waiting for the driver.
+     * \param compute_shader_code The compute shader code.
+     */
+    void BeginComputeCompile(const std::string& compute_shader_code);
+
+    /**
+     * \brief Determines whether the driver has finished compiling and linking the program, so that
+     * finishing the compile will not block.
+     * \return A boolean value indicating if the compile is complete.
+     */
+    [[nodiscard]] bool IsCompileComplete() const;
+
+    /**
+     * \brief Checks the result of a compile started with \code BeginCompile, waiting for the driver if
+     * it has not finished yet.
+     * \return A boolean value indicating if the program was linked successfully.
+     */
+    bool FinishCompile();
+
     /**
      * \brief Uses the shader program for rendering.
      */
@@ -45,6 +80,13 @@ public:
      */
     void SetInt(const std::string& name, int value) const;
 
+    /**
+     * \brief Sets an unsigned integer uniform in the shader program.
+     * \param name The name of the uniform.
+     * \param value The value to set the uniform to.
+     */
+    void SetUInt(const std::string& name, unsigned int value) const;
+
     /**
      * \brief Sets an float uniform in the shader program.
      * \param name The name of the uniform.
@@ -73,7 +115,7 @@ public:
      * \param name The name of the uniform.
      * \param value The value to set the uniform to.
      */
-    void SetMat4(const std::string& name, glm::mat4& value) const;
+    void SetMat4(const std::string& name, const glm::mat4& value) const;
 
     /**
      * \brief Gets the ID of the shader program.
@@ -81,9 +123,27 @@ public:
      */
     [[nodiscard]] GLint GetId() const;
 
+    /**
+     * \brief Determines whether the shader program was compiled and linked successfully.
+     * \return A boolean value indicating if the shader program can be used.
+     */
+    [[nodiscard]] bool IsCompiled() const;
+
 private:
     GLint m_id;
     bool m_compiled;
+
+    GLuint m_vertex_shader;
+    GLuint m_fragment_shader;
+    GLuint m_compute_shader;
+    uint64_t m_cache_key;
+
+    /**
+     * \brief Logs the compile errors of a shader stage, if it failed to compile.
+     * \param shader The shader object.
+     * \param stage_name The name of the shader stage, used in the log.
+     */
+    static void CheckCompileStatus(GLuint shader, const char* stage_name);
 };
 
 #endif // SHADER_H
\ No newline at end of file
@@ -0,0 +1,259 @@
+/**
+ * \file shader_cache.cpp
+ */
+
+#include "shader_cache.h"
+#include "utils/hash.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+constexpr unsigned char SHADER_BINARY_MAGIC[4] = { 'D', 'F', 'M', 'S' };
+constexpr uint32_t SHADER_BINARY_VERSION = 1;
+constexpr size_t SHADER_BINARY_HEADER_SIZE = 24;
+
+ShaderCache ShaderCache::s_instance;
+
+ShaderCache::ShaderCache()
+    : m_driver_hash{},
+    m_enabled{ false },
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Gets a string describing the GL implementation.
+ * \param name The name of the string to get.
+ * \return The string, or an empty string if it is unavailable.
+ */
+static std::string GetGlString(const GLenum name)
+{
+    const auto* string = reinterpret_cast<const char*>(glGetString(name));
+    return string != nullptr ? string : "";
+}
+
+/**
+ * \brief Identifies the driver and prepares the cache directory.
+ * \param directory The directory binaries are stored in.
+ */
+void ShaderCache::Initialise(const std::string& directory)
+{
+    DFM_PROFILE_FUNCTION();
+
+    ShaderCache& cache = Get();
+
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+    if (format_count == 0)
+    {
+        DFM_CORE_WARN("The driver does not support program binaries, shaders will always be compiled.");
+        return;
+    }
+
+    // Binaries are only valid for the exact driver that produced them.
+    const std::string vendor = GetGlString(GL_VENDOR);
+    const std::string renderer = GetGlString(GL_RENDERER);
+    const std::string version = GetGlString(GL_VERSION);
+
+    cache.m_driver_hash = HashString(version, HashString(renderer, HashString(vendor)));
+    cache.m_directory = directory;
+
+    std::error_code error;
+    std::filesystem::create_directories(cache.m_directory, error);
+
+    if (error)
+    {
+        DFM_CORE_WARN("Failed to create the shader cache directory '{0}', shaders will always be compiled.", directory);
+        return;
+    }
+
+    cache.m_enabled = true;
+    DFM_CORE_INFO("Caching shader binaries for '{0}' ({1}) in '{2}'.", renderer, version, directory);
+}
+
+/**
+ * \brief Creates the key identifying a program built from the given sources on the current driver.
+ * \param vertex_shader_code The vertex shader code.
+ * \param fragment_shader_code The fragment shader code.
+ * \param defines The preprocessor definitions the program is built with.
+ * \return The cache key.
+ */
+uint64_t ShaderCache::MakeKey(const std::string& vertex_shader_code, const std::string& fragment_shader_code,
+                              const std::string& defines)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Lengths are mixed in so that moving text between the stages changes the key.
+    uint64_t key = Get().m_driver_hash;
+    for (const std::string* part : { &vertex_shader_code, &fragment_shader_code, &defines })
+    {
+        const uint64_t length = part->size();
+        key = HashBytes(&length, sizeof(length), key);
+        key = HashString(*part, key);
+    }
+
+    return key;
+}
+
+/**
+ * \brief Loads a cached binary into a program.
+ * \param key The cache key of the program.
+ * \param program The program object to load the binary into.
+ * \return A boolean value indicating if the program was loaded and linked successfully.
+ */
+bool ShaderCache::Load(const uint64_t key, const GLuint program)
+{
+    DFM_PROFILE_FUNCTION();
+
+    ShaderCache& cache = Get();
+    if (!cache.m_enabled) return false;
+
+    const std::filesystem::path path = cache.GetBinaryPath(key);
+
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        cache.m_statistics.misses++;
+        return false;
+    }
+
+    const std::vector<unsigned char> contents{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    file.close();
+
+    uint32_t version = 0, format = 0, size = 0;
+    uint64_t stored_key = 0;
+
+    if (contents.size() >= SHADER_BINARY_HEADER_SIZE)
+    {
+        std::memcpy(&version, contents.data() + 4, sizeof(version));
+        std::memcpy(&format, contents.data() + 8, sizeof(format));
+        std::memcpy(&size, contents.data() + 12, sizeof(size));
+        std::memcpy(&stored_key, contents.data() + 16, sizeof(stored_key));
+    }
+
+    GLint success = 0;
+
+    if (contents.size() >= SHADER_BINARY_HEADER_SIZE &&
+        std::memcmp(contents.data(), SHADER_BINARY_MAGIC, sizeof(SHADER_BINARY_MAGIC)) == 0 &&
+        version == SHADER_BINARY_VERSION && stored_key == key && size == contents.size() - SHADER_BINARY_HEADER_SIZE)
+    {
+        glProgramBinary(program, format, contents.data() + SHADER_BINARY_HEADER_SIZE, static_cast<GLsizei>(size));
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+    }
+
+    if (!success)
+    {
+        // Driver updates can invalidate binaries, so remove the file and let the program be compiled again.
+        DFM_CORE_WARN("Discarding rejected shader binary '{0}'.", path.string());
+
+        std::error_code error;
+        std::filesystem::remove(path, error);
+
+        cache.m_statistics.rejected++;
+        cache.m_statistics.misses++;
+        return false;
+    }
+
+    cache.m_statistics.hits++;
+    return true;
+}
+
+/**
+ * \brief Stores the binary of a linked program, which must have been linked with
+ * \code GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+ * \param key The cache key of the program.
+ * \param program The linked program object.
+ */
+void ShaderCache::Store(const uint64_t key, const GLuint program)
+{
+    DFM_PROFILE_FUNCTION();
+
+    ShaderCache& cache = Get();
+    if (!cache.m_enabled) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<unsigned char> contents(SHADER_BINARY_HEADER_SIZE + static_cast<size_t>(length));
+
+    GLenum format = 0;
+    GLsizei size = 0;
+    glGetProgramBinary(program, length, &size, &format, contents.data() + SHADER_BINARY_HEADER_SIZE);
+    if (size <= 0) return;
+
+    contents.resize(SHADER_BINARY_HEADER_SIZE + static_cast<size_t>(size));
+
+    const uint32_t header_format = format;
+    const auto header_size = static_cast<uint32_t>(size);
+
+    std::memcpy(contents.data(), SHADER_BINARY_MAGIC, sizeof(SHADER_BINARY_MAGIC));
+    std::memcpy(contents.data() + 4, &SHADER_BINARY_VERSION, sizeof(SHADER_BINARY_VERSION));
+    std::memcpy(contents.data() + 8, &header_format, sizeof(header_format));
+    std::memcpy(contents.data() + 12, &header_size, sizeof(header_size));
+    std::memcpy(contents.data() + 16, &key, sizeof(key));
+
+    // Write to a temporary file first, so a crash never leaves a truncated binary behind.
+    const std::filesystem::path path = cache.GetBinaryPath(key);
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file{ temporary_path, std::ios::binary };
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+
+        if (!file)
+        {
+            DFM_CORE_WARN("Failed to write shader binary '{0}'.", path.string());
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        return;
+    }
+
+    cache.m_statistics.stored++;
+}
+
+/**
+ * \brief Determines whether the driver supports program binaries.
+ * \return A boolean value indicating if the cache is enabled.
+ */
+bool ShaderCache::IsEnabled()
+{
+    return Get().m_enabled;
+}
+
+/**
+ * \brief Gets how many programs were loaded from the cache.
+ * \return The cache statistics.
+ */
+ShaderCacheStatistics ShaderCache::GetStatistics()
+{
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Gets the path of the file holding a cached binary.
+ * \param key The cache key of the program.
+ * \return The path to the binary.
+ */
+std::filesystem::path ShaderCache::GetBinaryPath(const uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+
+    return m_directory / name;
+}
@@ -0,0 +1,110 @@
+/**
+ * \file shader_cache.h
+ */
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * \brief Represents how many shader programs were loaded from the shader cache.
+ */
+struct ShaderCacheStatistics
+{
+    size_t hits;
+    size_t misses;
+    size_t rejected;
+    size_t stored;
+};
+
+/**
+ * \brief A singleton class that stores linked shader program binaries on disk, so programs only
+ * have to be compiled the first time they are seen. Binaries are keyed by their source code, defines
+ * and the driver that produced them, and a binary that the driver rejects is discarded so the program
+ * is compiled again. All functions must be called on the thread owning the GL context.
+ */
+class ShaderCache
+{
+public:
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache(ShaderCache&&) noexcept = delete;
+
+    ShaderCache& operator=(const ShaderCache&) = delete;
+    ShaderCache& operator=(ShaderCache&&) noexcept = delete;
+
+    /**
+     * \brief Identifies the driver and prepares the cache directory.
+     * \param directory The directory binaries are stored in.
+     */
+    static void Initialise(const std::string& directory = "cache/shaders");
+
+    /**
+     * \brief Creates the key identifying a program built from the given sources on the current driver.
+     * \param vertex_shader_code The vertex shader code.
+     * \param fragment_shader_code The fragment shader code.
+     * \param defines The preprocessor definitions the program is built with.
+     * \return The cache key.
+     */
+    [[nodiscard]] static uint64_t MakeKey(const std::string& vertex_shader_code, const std::string& fragment_shader_code,
+                                          const std::string& defines = {});
+
+    /**
+     * \brief Loads a cached binary into a program.
+     * \param key The cache key of the program.
+     * \param program The program object to load the binary into.
+     * \return A boolean value indicating if the program was loaded and linked successfully.
+     */
+    static bool Load(uint64_t key, GLuint program);
+
+    /**
+     * \brief Stores the binary of a linked program, which must have been linked with
+     * \code GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     * \param key The cache key of the program.
+     * \param program The linked program object.
+     */
+    static void Store(uint64_t key, GLuint program);
+
+    /**
+     * \brief Determines whether the driver supports program binaries.
+     * \return A boolean value indicating if the cache is enabled.
+     */
+    [[nodiscard]] static bool IsEnabled();
+
+    /**
+     * \brief Gets how many programs were loaded from the cache.
+     * \return The cache statistics.
+     */
+    [[nodiscard]] static ShaderCacheStatistics GetStatistics();
+
+private:
+    std::filesystem::path m_directory;
+    uint64_t m_driver_hash;
+    bool m_enabled;
+    ShaderCacheStatistics m_statistics;
+
+    ShaderCache();
+    ~ShaderCache() = default;
+
+    /**
+     * \brief Gets the path of the file holding a cached binary.
+     * \param key The cache key of the program.
+     * \return The path to the binary.
+     */
+    [[nodiscard]] std::filesystem::path GetBinaryPath(uint64_t key) const;
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static ShaderCache& Get() { return s_instance; }
+
+    static ShaderCache s_instance;
+};
+
+#endif // SHADER_CACHE_H
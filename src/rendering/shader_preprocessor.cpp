@@ -0,0 +1,257 @@
+/**
+ * \file shader_preprocessor.cpp
+ */
+
+#include "shader_preprocessor.h"
+#include "io/virtual_file_system.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+/**
+ * \brief Adds a preprocessor definition to the permutation.
+ * \param name The name of the definition.
+ * \param value The value of the definition, or an empty string for a flag.
+ * \return The permutation, so definitions can be chained.
+ */
+ShaderPermutation& ShaderPermutation::Define(const std::string& name, const std::string& value)
+{
+    m_defines[name] = value;
+    return *this;
+}
+
+/**
+ * \brief Adds a preprocessor definition with an integer value to the permutation.
+ * \param name The name of the definition.
+ * \param value The value of the definition.
+ * \return The permutation, so definitions can be chained.
+ */
+ShaderPermutation& ShaderPermutation::Define(const std::string& name, const int value)
+{
+    return Define(name, std::to_string(value));
+}
+
+/**
+ * \brief Determines whether the permutation contains a definition.
+ * \param name The name of the definition.
+ * \return A boolean value indicating if the definition is present.
+ */
+bool ShaderPermutation::IsDefined(const std::string& name) const
+{
+    return m_defines.count(name) != 0;
+}
+
+/**
+ * \brief Determines whether the permutation has no definitions and so selects the default variant.
+ * \return A boolean value indicating if the permutation is empty.
+ */
+bool ShaderPermutation::IsEmpty() const
+{
+    return m_defines.empty();
+}
+
+/**
+ * \brief Gets a string uniquely identifying the permutation, such as "NO_SPOT_LIGHTS;POINT_LIGHT_COUNT=4".
+ * \return The permutation key, which is empty for the default variant.
+ */
+std::string ShaderPermutation::GetKey() const
+{
+    std::string key;
+
+    for (const auto& [name, value] : m_defines)
+    {
+        if (!key.empty())
+        {
+            key += ';';
+        }
+
+        key += name;
+
+        if (!value.empty())
+        {
+            key += '=';
+            key += value;
+        }
+    }
+
+    return key;
+}
+
+/**
+ * \brief Gets the definitions as GLSL preprocessor directives.
+ * \return A line of \code #define for each definition.
+ */
+std::string ShaderPermutation::GetSource() const
+{
+    std::string source;
+
+    for (const auto& [name, value] : m_defines)
+    {
+        source += "#define " + name;
+
+        if (!value.empty())
+        {
+            source += ' ';
+            source += value;
+        }
+
+        source += '\n';
+    }
+
+    return source;
+}
+
+/**
+ * \brief Determines whether a line is a preprocessor directive and gets what follows its name.
+ * \param line The line of shader code.
+ * \param directive The name of the directive, such as "include".
+ * \param argument The text after the directive's name, with surrounding whitespace removed.
+ * \return A boolean value indicating if the line is the directive.
+ */
+static bool ParseDirective(const std::string& line, const std::string& directive, std::string& argument)
+{
+    size_t position = line.find_first_not_of(" \t");
+    if (position == std::string::npos || line[position] != '#') return false;
+
+    position = line.find_first_not_of(" \t", position + 1);
+    if (position == std::string::npos || line.compare(position, directive.size(), directive) != 0) return false;
+
+    position += directive.size();
+    if (position < line.size() && !std::isspace(static_cast<unsigned char>(line[position]))) return false;
+
+    const size_t begin = line.find_first_not_of(" \t", position);
+    const size_t end = line.find_last_not_of(" \t");
+    argument = begin == std::string::npos ? std::string{} : line.substr(begin, end - begin + 1);
+
+    return true;
+}
+
+/**
+ * \brief Copies shader code into the output, replacing each \code #include directive with the included
+ * file's expanded code.
+ * \param path The path of the file being expanded.
+ * \param code The code of the file being expanded.
+ * \param source_number The GLSL source string number given to the file.
+ * \param files The files expanded so far, indexed by source string number.
+ * \param version The \code #version directive of the shader, which is taken out of the main file.
+ * \param output The expanded code.
+ * \return A boolean value indicating if every included file could be read.
+ */
+static bool ExpandIncludes(const std::string& path, const std::string& code, const int source_number,
+                           std::vector<std::string>& files, std::string& version, std::string& output)
+{
+    std::istringstream stream{ code };
+    std::string line;
+    std::string argument;
+    int line_number = 0;
+
+    while (std::getline(stream, line))
+    {
+        line_number++;
+
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        // The definitions have to follow the version directive, so it is moved to the top of the output
+        // and a blank line is left in its place to keep the line numbers.
+        if (source_number == 0 && version.empty() && ParseDirective(line, "version", argument))
+        {
+            version = line;
+            output += '\n';
+            continue;
+        }
+
+        if (!ParseDirective(line, "include", argument))
+        {
+            output += line;
+            output += '\n';
+            continue;
+        }
+
+        if (argument.size() < 2 || !((argument.front() == '"' && argument.back() == '"') ||
+                                     (argument.front() == '<' && argument.back() == '>')))
+        {
+            DFM_CORE_ERROR("Malformed include directive in {0} on line {1}.", path, line_number);
+            return false;
+        }
+
+        const std::string include_path = (std::filesystem::path{ path }.parent_path() /
+                                          argument.substr(1, argument.size() - 2)).lexically_normal().generic_string();
+
+        if (std::find(files.begin(), files.end(), include_path) != files.end())
+        {
+            output += '\n';
+            continue;
+        }
+
+        std::string include_code;
+        if (!VirtualFileSystem::ReadTextFile(include_path, include_code))
+        {
+            DFM_CORE_ERROR("Failed to read {0}, included by {1} on line {2}.", include_path, path, line_number);
+            return false;
+        }
+
+        const int include_number = static_cast<int>(files.size());
+        files.push_back(include_path);
+
+        output += "#line 1 " + std::to_string(include_number) + '\n';
+
+        if (!ExpandIncludes(include_path, include_code, include_number, files, version, output)) return false;
+
+        output += "#line " + std::to_string(line_number + 1) + ' ' + std::to_string(source_number) + '\n';
+    }
+
+    return true;
+}
+
+/**
+ * \brief Expands the \code #include directives of a shader and inserts the definitions of a permutation
+ * after its \code #version directive. Included paths are relative to the including file, and each file
+ * is included at most once. Every file is given its own GLSL source string number through \code #line
+ * directives, so compile errors point at the right file and line; the numbers are listed in a comment
+ * in the output. This is safe to call from any thread.
+ * \param path The path of the shader, used to resolve included files.
+ * \param code The shader code.
+ * \param permutation The definitions selecting the shader variant.
+ * \param output The preprocessed shader code.
+ * \return A boolean value indicating if every included file could be read.
+ */
+bool PreprocessShader(const std::string& path, const std::string& code, const ShaderPermutation& permutation,
+                      std::string& output)
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::vector<std::string> files{ std::filesystem::path{ path }.lexically_normal().generic_string() };
+    std::string version;
+    std::string body;
+
+    if (!ExpandIncludes(files.front(), code, 0, files, version, body)) return false;
+
+    output.clear();
+    output.reserve(version.size() + body.size() + 256);
+
+    if (!version.empty())
+    {
+        output += version;
+        output += '\n';
+    }
+
+    output += permutation.GetSource();
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        output += "// Source string " + std::to_string(i) + ": " + files[i] + '\n';
+    }
+
+    output += "#line 1 0\n";
+    output += body;
+
+    return true;
+}
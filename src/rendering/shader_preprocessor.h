@@ -0,0 +1,78 @@
+/**
+ * \file shader_preprocessor.h
+ */
+
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <map>
+#include <string>
+
+/**
+ * \brief Represents the set of preprocessor definitions that selects one variant of a shader.
+ * Definitions are kept sorted, so the same set always produces the same key.
+ */
+class ShaderPermutation
+{
+public:
+    /**
+     * \brief Adds a preprocessor definition to the permutation.
+     * \param name The name of the definition.
+     * \param value The value of the definition, or an empty string for a flag.
+     * \return The permutation, so definitions can be chained.
+     */
+    ShaderPermutation& Define(const std::string& name, const std::string& value = {});
+
+    /**
+     * \brief Adds a preprocessor definition with an integer value to the permutation.
+     * \param name The name of the definition.
+     * \param value The value of the definition.
+     * \return The permutation, so definitions can be chained.
+     */
+    ShaderPermutation& Define(const std::string& name, int value);
+
+    /**
+     * \brief Determines whether the permutation contains a definition.
+     * \param name The name of the definition.
+     * \return A boolean value indicating if the definition is present.
+     */
+    [[nodiscard]] bool IsDefined(const std::string& name) const;
+
+    /**
+     * \brief Determines whether the permutation has no definitions and so selects the default variant.
+     * \return A boolean value indicating if the permutation is empty.
+     */
+    [[nodiscard]] bool IsEmpty() const;
+
+    /**
+     * \brief Gets a string uniquely identifying the permutation, such as "NO_SPOT_LIGHTS;POINT_LIGHT_COUNT=4".
+     * \return The permutation key, which is empty for the default variant.
+     */
+    [[nodiscard]] std::string GetKey() const;
+
+    /**
+     * \brief Gets the definitions as GLSL preprocessor directives.
+     * \return A line of \code #define for each definition.
+     */
+    [[nodiscard]] std::string GetSource() const;
+
+private:
+    std::map<std::string, std::string> m_defines;
+};
+
+/**
+ * \brief Expands the \code #include directives of a shader and inserts the definitions of a permutation
+ * after its \code #version directive. Included paths are relative to the including file, and each file
+ * is included at most once. Every file is given its own GLSL source string number through \code #line
+ * directives, so compile errors point at the right file and line; the numbers are listed in a comment
+ * in the output. This is safe to call from any thread.
+ * \param path The path of the shader, used to resolve included files.
+ * \param code The shader code.
+ * \param permutation The definitions selecting the shader variant.
+ * \param output The preprocessed shader code.
+ * \return A boolean value indicating if every included file could be read.
+ */
+bool PreprocessShader(const std::string& path, const std::string& code, const ShaderPermutation& permutation,
+                      std::string& output);
+
+#endif // SHADER_PREPROCESSOR_H
@@ -28,36 +28,4 @@ struct SpotLightData
     alignas(16) glm::vec4 specular;
 };
 
-/**
- * \brief Represents a spot light in 3D space.
- */
-class SpotLight
-{
-public:
-    explicit SpotLight(SpotLightData data);
-
-    /**
-     * \brief Gets the spot light data.
-     * \return The spot light data.
-     */
-    [[nodiscard]] SpotLightData& GetData();
-
-    /**
-     * \brief Gets the index of the spot light.
-     * \return The spot light's index.
-     */
-    [[nodiscard]] unsigned int GetIndex() const;
-
-private:
-    SpotLightData m_data;
-    unsigned int m_index;
-
-    /**
-     * \brief Initialises the spot light.
-     */
-    void Initialise() const;
-
-    static unsigned int s_index;
-};
-
 #endif // SPOT_LIGHT_H
\ No newline at end of file
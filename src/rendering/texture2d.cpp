@@ -3,9 +3,16 @@
  */
 
 #include "texture2d.h"
+#include "ktx2.h"
+#include "texture_uploader.h"
+#include "utils/gl_state.h"
 #include "utils/logging.h"
 #include "utils/profiling.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 Texture2D::Texture2D()
     : m_id{},
     m_internal_format{ GL_RGB },
@@ -15,18 +22,56 @@ Texture2D::Texture2D()
     m_filter_min{ GL_LINEAR },
     m_filter_mag{ GL_LINEAR },
     m_width{},
-    m_height{}
+    m_height{},
+    m_level_count{}
 {
 }
 
-Texture2D::~Texture2D()
+/**
+ * \brief Gets the sized internal format used to allocate immutable storage for an internal format.
+ * \param format The internal format.
+ * \return The sized internal format, which is the given format if it is already sized.
+ */
+static GLenum GetSizedFormat(const GLint format)
 {
-    DFM_PROFILE_FUNCTION();
-    glDeleteTextures(1, &m_id);
+    switch (format)
+    {
+    case GL_RED:
+        return GL_R8;
+    case GL_RG:
+        return GL_RG8;
+    case GL_RGB:
+        return GL_RGB8;
+    case GL_RGBA:
+        return GL_RGBA8;
+    default:
+        return static_cast<GLenum>(format);
+    }
 }
 
 /**
- * \brief Generates a 2D texture.
+ * \brief Gets the number of bytes in each pixel of a given pixel format.
+ * \param format The pixel format, with one byte per channel.
+ * \return The number of bytes in each pixel.
+ */
+static size_t GetPixelSize(const GLint format)
+{
+    switch (format)
+    {
+    case GL_RED:
+        return 1;
+    case GL_RG:
+        return 2;
+    case GL_RGBA:
+        return 4;
+    default:
+        return 3;
+    }
+}
+
+/**
+ * \brief Generates a 2D texture. The data is copied, and the texture is created and uploaded on the
+ * loader thread by the \code TextureUploader\endcode.
  * \param width The width of the texture.
  * \param height The height of the texture. 
  * \param data The texture data.
@@ -35,41 +80,183 @@ void Texture2D::Generate(const int width, const int height, const unsigned char*
 {
     DFM_PROFILE_FUNCTION();
 
-    glGenTextures(1, &m_id);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    if (!data)
+    {
+        DFM_CORE_ERROR("Failed to generate texture.");
+        return;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_wrap_s);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_wrap_t);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_filter_min);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_filter_mag);
+    const size_t size = static_cast<size_t>(width) * height * GetPixelSize(m_image_format);
+    auto copy = std::make_shared<std::vector<unsigned char>>(data, data + size);
+
+    Generate(width, height, copy->data(), copy);
+}
+
+/**
+ * \brief Generates a 2D texture, uploading the data on the loader thread without copying it.
+ * \param width The width of the texture.
+ * \param height The height of the texture.
+ * \param data The texture data.
+ * \param owner Keeps the texture data alive until it has been uploaded.
+ */
+void Texture2D::Generate(const int width, const int height, const unsigned char* data, std::shared_ptr<const void> owner)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (!data)
+    {
+        DFM_CORE_ERROR("Failed to generate texture.");
+        return;
+    }
 
     m_width = width;
     m_height = height;
 
-    if (data)
+    m_level_count = static_cast<GLsizei>(std::log2(std::max(m_width, m_height))) + 1;
+
+    // Only the name is reserved here, and the loader thread creates the texture along with its storage.
+    glGenTextures(1, &m_id);
+
+    TextureUploader::Enqueue({
+        m_id,
+        [texture = *this] { texture.Allocate(); },
+        static_cast<GLenum>(m_image_format),
+        false,
+        m_width,
+        m_height,
+        GetPixelSize(m_image_format),
+        true,
+        std::move(owner),
+        { data }
+    });
+}
+
+/**
+ * \brief Generates a 2D texture from block-compressed data with a precomputed mip chain.
+ * No mipmaps are generated at runtime. The data is copied and uploaded on the loader thread.
+ * \param compressed The compressed texture.
+ */
+void Texture2D::GenerateCompressed(const Ktx2Texture& compressed)
+{
+    DFM_PROFILE_FUNCTION();
+
+    GenerateCompressed(std::make_shared<const Ktx2Texture>(compressed));
+}
+
+/**
+ * \brief Generates a 2D texture from block-compressed data with a precomputed mip chain, uploading
+ * the levels on the loader thread without copying them.
+ * \param compressed The compressed texture, which is kept alive until it has been uploaded.
+ * \param first_level The level of the compressed texture used as the base level.
+ */
+void Texture2D::GenerateCompressed(std::shared_ptr<const Ktx2Texture> compressed, const uint32_t first_level)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (!compressed || !compressed->IsValid() || first_level >= compressed->GetLevelCount())
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_image_format, GL_UNSIGNED_BYTE, data);
+        DFM_CORE_ERROR("Failed to generate compressed texture.");
+        return;
     }
-    else
+
+    m_width = std::max(static_cast<GLsizei>(compressed->GetWidth() >> first_level), 1);
+    m_height = std::max(static_cast<GLsizei>(compressed->GetHeight() >> first_level), 1);
+    m_internal_format = static_cast<GLint>(GetKtx2GlFormat(compressed->GetFormat()));
+    m_level_count = static_cast<GLsizei>(compressed->GetLevelCount() - first_level);
+
+    // Without a mip chain in the file there is nothing to sample below the base level.
+    if (m_level_count == 1 && m_filter_min != GL_LINEAR && m_filter_min != GL_NEAREST)
     {
-        DFM_CORE_ERROR("Failed to generate texture.");
-        return;
+        m_filter_min = GL_LINEAR;
+    }
+
+    glGenTextures(1, &m_id);
+
+    TextureUploadJob job{
+        m_id,
+        [texture = *this] { texture.Allocate(); },
+        static_cast<GLenum>(m_internal_format),
+        true,
+        m_width,
+        m_height,
+        GetKtx2BlockSize(compressed->GetFormat()),
+        false,
+        nullptr,
+        {}
+    };
+
+    for (GLsizei level = 0; level < m_level_count; level++)
+    {
+        job.levels.push_back(compressed->GetLevelData(first_level + static_cast<uint32_t>(level)));
     }
 
-    glGenerateMipmap(GL_TEXTURE_2D);
+    job.owner = std::move(compressed);
+    TextureUploader::Enqueue(std::move(job));
+}
+
+/**
+ * \brief Creates a smaller copy of the texture without its largest levels. The remaining levels
+ * are copied on the GPU, and the original texture is left untouched.
+ * \param dropped_levels The number of levels to drop from the top of the mip chain.
+ * \return The reduced texture.
+ */
+Texture2D Texture2D::CreateReduced(const GLint dropped_levels) const
+{
+    DFM_PROFILE_FUNCTION();
+
+    Texture2D reduced{ *this };
+    reduced.m_width = std::max(m_width >> dropped_levels, 1);
+    reduced.m_height = std::max(m_height >> dropped_levels, 1);
+    reduced.m_level_count = std::max(m_level_count - dropped_levels, 1);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &reduced.m_id);
+
+    glTextureParameteri(reduced.m_id, GL_TEXTURE_WRAP_S, m_wrap_s);
+    glTextureParameteri(reduced.m_id, GL_TEXTURE_WRAP_T, m_wrap_t);
+    glTextureParameteri(reduced.m_id, GL_TEXTURE_MIN_FILTER, m_filter_min);
+    glTextureParameteri(reduced.m_id, GL_TEXTURE_MAG_FILTER, m_filter_mag);
+
+    glTextureStorage2D(reduced.m_id, reduced.m_level_count, GetSizedFormat(m_internal_format), reduced.m_width, reduced.m_height);
 
-    // Unbind texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    for (GLint level = 0; level < reduced.m_level_count; level++)
+    {
+        glCopyImageSubData(
+            m_id, GL_TEXTURE_2D, level + dropped_levels, 0, 0, 0,
+            reduced.m_id, GL_TEXTURE_2D, level, 0, 0, 0,
+            std::max(reduced.m_width >> level, 1),
+            std::max(reduced.m_height >> level, 1),
+            1
+        );
+    }
+
+    return reduced;
 }
 
 /**
  * \brief Binds the texture for use.
+ * \param unit The index of the texture unit to bind the texture to.
  */
-void Texture2D::Bind() const
+void Texture2D::Bind(const GLuint unit) const
 {
     DFM_PROFILE_FUNCTION();
 
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GlState::BindTexture(unit, GL_TEXTURE_2D, m_id);
+}
+
+/**
+ * \brief Deletes the GL texture object. Copies of the texture must not be used afterwards.
+ */
+void Texture2D::Dispose()
+{
+    DFM_PROFILE_FUNCTION();
+
+    // A texture still being uploaded is deleted once the loader thread has finished with it.
+    if (!TextureUploader::Cancel(m_id))
+    {
+        GlState::DeleteTexture(m_id);
+    }
+
+    m_id = 0;
 }
 
 /**
@@ -91,3 +278,102 @@ void Texture2D::EnableAlpha(const bool enable)
         m_image_format = GL_RGB;
     }
 }
+
+/**
+ * \brief Sets the texture's format from the number of channels in its data.
+ * \param channels The number of channels in each pixel of the texture data.
+ */
+void Texture2D::SetChannels(const int channels)
+{
+    DFM_PROFILE_FUNCTION();
+
+    switch (channels)
+    {
+    case 1:
+        m_internal_format = GL_RED;
+        m_image_format = GL_RED;
+        break;
+    case 2:
+        m_internal_format = GL_RG;
+        m_image_format = GL_RG;
+        break;
+    case 4:
+        m_internal_format = GL_RGBA;
+        m_image_format = GL_RGBA;
+        break;
+    default:
+        m_internal_format = GL_RGB;
+        m_image_format = GL_RGB;
+        break;
+    }
+}
+
+/**
+ * \brief Sets the filters used when sampling the texture.
+ * \param filter_min The minifying filter.
+ * \param filter_mag The magnifying filter.
+ */
+void Texture2D::SetFilter(const GLint filter_min, const GLint filter_mag)
+{
+    m_filter_min = filter_min;
+    m_filter_mag = filter_mag;
+}
+
+/**
+ * \brief Gets the ID of the texture.
+ * \return The texture's ID.
+ */
+GLuint Texture2D::GetId() const
+{
+    return m_id;
+}
+
+/**
+ * \brief Gets the width of the texture.
+ * \return The texture's width in pixels.
+ */
+GLsizei Texture2D::GetWidth() const
+{
+    return m_width;
+}
+
+/**
+ * \brief Gets the height of the texture.
+ * \return The texture's height in pixels.
+ */
+GLsizei Texture2D::GetHeight() const
+{
+    return m_height;
+}
+
+/**
+ * \brief Gets the number of levels allocated for the texture.
+ * \return The texture's level count.
+ */
+GLsizei Texture2D::GetLevelCount() const
+{
+    return m_level_count;
+}
+
+/**
+ * \brief Creates the texture object for the reserved name and allocates its immutable storage.
+ * This is called on the context making the upload.
+ */
+void Texture2D::Allocate() const
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Binding a reserved name creates the texture object. The previous binding is restored, as the drawing
+    // context makes uploads when there is no loader thread, and GlState tracks its bindings.
+    GLint previous_texture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+
+    glTextureParameteri(m_id, GL_TEXTURE_WRAP_S, m_wrap_s);
+    glTextureParameteri(m_id, GL_TEXTURE_WRAP_T, m_wrap_t);
+    glTextureParameteri(m_id, GL_TEXTURE_MIN_FILTER, m_filter_min);
+    glTextureParameteri(m_id, GL_TEXTURE_MAG_FILTER, m_filter_mag);
+
+    glTextureStorage2D(m_id, m_level_count, GetSizedFormat(m_internal_format), m_width, m_height);
+}
@@ -7,14 +7,20 @@
 
 #include "glad/glad.h"
 
+#include <cstdint>
+#include <memory>
+
+class Ktx2Texture;
+
 /**
  * \brief Represents a 2D texture.
+ * Copies share the same GL texture object, which is owned by whoever created it (usually the
+ * \code TextureCache\endcode) and released with \code Dispose\endcode.
  */
 class Texture2D
 {
 public:
     Texture2D();
-    ~Texture2D();
 
     Texture2D(const Texture2D&) = default;
     Texture2D(Texture2D&&) noexcept = default;
@@ -23,17 +29,56 @@ public:
     Texture2D& operator=(Texture2D&&) noexcept = default;
 
     /**
-     * \brief Generates a 2D texture.
+     * \brief Generates a 2D texture. The data is copied, and the texture is created and uploaded on the
+     * loader thread by the \code TextureUploader\endcode.
      * \param width The width of the texture.
      * \param height The height of the texture.
      * \param data The texture data.
      */
     void Generate(int width, int height, const unsigned char* data);
 
+    /**
+     * \brief Generates a 2D texture, uploading the data on the loader thread without copying it.
+     * \param width The width of the texture.
+     * \param height The height of the texture.
+     * \param data The texture data.
+     * \param owner Keeps the texture data alive until it has been uploaded.
+     */
+    void Generate(int width, int height, const unsigned char* data, std::shared_ptr<const void> owner);
+
+    /**
+     * \brief Generates a 2D texture from block-compressed data with a precomputed mip chain.
+     * No mipmaps are generated at runtime. The data is copied and uploaded on the loader thread.
+     * \param compressed The compressed texture.
+     */
+    void GenerateCompressed(const Ktx2Texture& compressed);
+
+    /**
+     * \brief Generates a 2D texture from block-compressed data with a precomputed mip chain, uploading
+     * the levels on the loader thread without copying them.
+     * \param compressed The compressed texture, which is kept alive until it has been uploaded.
+     * \param first_level The level of the compressed texture used as the base level.
+     */
+    void GenerateCompressed(std::shared_ptr<const Ktx2Texture> compressed, uint32_t first_level = 0);
+
+    /**
+     * \brief Creates a smaller copy of the texture without its largest levels. The remaining levels
+     * are copied on the GPU, and the original texture is left untouched.
+     * \param dropped_levels The number of levels to drop from the top of the mip chain.
+     * \return The reduced texture.
+     */
+    [[nodiscard]] Texture2D CreateReduced(GLint dropped_levels) const;
+
     /**
      * \brief Binds the texture for use.
+     * \param unit The index of the texture unit to bind the texture to.
      */
-    void Bind() const;
+    void Bind(GLuint unit = 0) const;
+
+    /**
+     * \brief Deletes the GL texture object. Copies of the texture must not be used afterwards.
+     */
+    void Dispose();
 
     /**
      * \brief Enables the texture's alpha channel.
@@ -41,13 +86,57 @@ public:
      */
     void EnableAlpha(bool enable);
 
+    /**
+     * \brief Sets the texture's format from the number of channels in its data.
+     * \param channels The number of channels in each pixel of the texture data.
+     */
+    void SetChannels(int channels);
+
+    /**
+     * \brief Sets the filters used when sampling the texture.
+     * \param filter_min The minifying filter.
+     * \param filter_mag The magnifying filter.
+     */
+    void SetFilter(GLint filter_min, GLint filter_mag);
+
+    /**
+     * \brief Gets the ID of the texture.
+     * \return The texture's ID.
+     */
+    [[nodiscard]] GLuint GetId() const;
+
+    /**
+     * \brief Gets the width of the texture.
+     * \return The texture's width in pixels.
+     */
+    [[nodiscard]] GLsizei GetWidth() const;
+
+    /**
+     * \brief Gets the height of the texture.
+     * \return The texture's height in pixels.
+     */
+    [[nodiscard]] GLsizei GetHeight() const;
+
+    /**
+     * \brief Gets the number of levels allocated for the texture.
+     * \return The texture's level count.
+     */
+    [[nodiscard]] GLsizei GetLevelCount() const;
+
 private:
+    /**
+     * \brief Creates the texture object for the reserved name and allocates its immutable storage.
+     * This is called on the context making the upload.
+     */
+    void Allocate() const;
+
     GLuint m_id;
     GLint m_internal_format;
     GLint m_image_format;
     GLint m_wrap_s, m_wrap_t;
     GLint m_filter_min, m_filter_mag;
     GLsizei m_width, m_height;
+    GLsizei m_level_count;
 };
 
 #endif // TEXTURE2D_H
\ No newline at end of file
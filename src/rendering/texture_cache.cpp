@@ -0,0 +1,501 @@
+/**
+ * \file texture_cache.cpp
+ */
+
+#include "texture_cache.h"
+#include "io/async_file_reader.h"
+#include "utils/gl_extensions.h"
+#include "utils/hash.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+TextureCache TextureCache::s_instance;
+
+TextureCache::TextureCache()
+    : m_statistics{}
+{
+}
+
+/**
+ * \brief Gets the texture at the given path, uploading it if it has not been seen before.
+ * \param path The path to the texture.
+ * \param options The options used to decode and sample the texture.
+ * \return The cached texture, or an empty texture if the file could not be loaded.
+ */
+Texture2D TextureCache::Acquire(const std::string& path, const TextureOptions& options)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureCache& cache = Get();
+
+    const std::string canonical_path = Canonicalise(path);
+    const std::string key = MakePathKey(canonical_path, options);
+
+    // The same file has already been uploaded with these options.
+    if (Texture2D texture; AcquireCached(key, texture))
+    {
+        return texture;
+    }
+
+    // The decoded data stays alive until the uploader has streamed it to the GPU, so it is never copied.
+    const auto owner = std::make_shared<const DecodedTexture>(Decode(canonical_path, options,
+        [&canonical_path, &options](const uint64_t content_hash)
+        {
+            return ClaimContent(MakeContentKey(content_hash, options), canonical_path, false);
+        }));
+
+    const DecodedTexture& decoded = *owner;
+
+    if (!decoded.read || (!decoded.skipped && !decoded.image.IsValid() && !decoded.compressed.IsValid()))
+    {
+        DFM_CORE_ERROR("Failure to load texture: '{0}'.", path);
+        return Texture2D{};
+    }
+
+    // A different path refers to identical contents, so alias it rather than uploading a copy.
+    const uint64_t content_key = MakeContentKey(decoded.content_hash, options);
+    if (auto search = cache.m_content_lookup.find(content_key); search != cache.m_content_lookup.end())
+    {
+        CachedTexture& cached = cache.m_textures[search->second];
+        cached.references++;
+        cache.m_path_lookup[key] = search->second;
+        cache.m_statistics.content_hits++;
+        return cached.texture;
+    }
+
+    // Another path claimed the same contents before this one was decoded, so share its texture.
+    if (decoded.skipped)
+    {
+        const std::string owner_path = GetContentClaim(content_key).path;
+
+        if (owner_path.empty())
+        {
+            DFM_CORE_ERROR("Failure to load texture: '{0}'.", path);
+            return Texture2D{};
+        }
+
+        const Texture2D texture = Acquire(owner_path, options);
+
+        if (auto search = cache.m_content_lookup.find(content_key); search != cache.m_content_lookup.end())
+        {
+            cache.m_path_lookup[key] = search->second;
+            cache.m_statistics.content_hits++;
+        }
+
+        return texture;
+    }
+
+    Texture2D texture;
+    texture.SetFilter(options.filter_min, options.filter_mag);
+    size_t size_bytes;
+
+    if (decoded.compressed.IsValid())
+    {
+        // The mip chain was generated offline, so the levels are uploaded as they are.
+        texture.GenerateCompressed(std::shared_ptr<const Ktx2Texture>{ owner, &decoded.compressed });
+        size_bytes = decoded.compressed.GetDataSize();
+    }
+    else
+    {
+        const Image& image = decoded.image;
+
+        texture.SetChannels(image.GetChannels());
+        texture.Generate(image.GetWidth(), image.GetHeight(), image.GetData(), owner);
+
+        // Account for the full mip chain, which adds roughly a third on top of the base level.
+        const size_t base_bytes = static_cast<size_t>(image.GetWidth()) * image.GetHeight() * image.GetChannels();
+        size_bytes = base_bytes + base_bytes / 3;
+    }
+
+    const size_t index = cache.m_textures.size();
+    cache.m_textures.push_back({ texture, canonical_path, decoded.content_hash, size_bytes, 1 });
+    cache.m_path_lookup[key] = index;
+    cache.m_content_lookup[content_key] = index;
+
+    cache.m_statistics.texture_count++;
+    cache.m_statistics.total_bytes += size_bytes;
+    cache.m_statistics.misses++;
+
+    return texture;
+}
+
+/**
+ * \brief Releases a texture acquired from the cache, deleting it once it has been released as many
+ * times as it was acquired.
+ * \param texture The texture returned by \code Acquire.
+ */
+void TextureCache::Release(const Texture2D& texture)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureCache& cache = Get();
+
+    // Released slots keep a reference count of zero, so a reused texture name only matches the live texture.
+    const auto search = std::find_if(cache.m_textures.begin(), cache.m_textures.end(), [&texture](const CachedTexture& cached)
+    {
+        return cached.references > 0 && cached.texture.GetId() == texture.GetId();
+    });
+
+    if (search == cache.m_textures.end())
+    {
+        DFM_CORE_WARN("Released texture {0} is not in the texture cache.", texture.GetId());
+        return;
+    }
+
+    const auto index = static_cast<size_t>(search - cache.m_textures.begin());
+    CachedTexture& cached = *search;
+
+    if (--cached.references > 0) return;
+
+    cached.texture.Dispose();
+
+    // Every path aliasing the texture is forgotten with it. Content claims are kept, so the contents
+    // are decoded for the same path if they are acquired again.
+    for (auto it = cache.m_path_lookup.begin(); it != cache.m_path_lookup.end();)
+    {
+        it = it->second == index ? cache.m_path_lookup.erase(it) : std::next(it);
+    }
+
+    for (auto it = cache.m_content_lookup.begin(); it != cache.m_content_lookup.end();)
+    {
+        it = it->second == index ? cache.m_content_lookup.erase(it) : std::next(it);
+    }
+
+    cache.m_statistics.texture_count--;
+    cache.m_statistics.total_bytes -= cached.size_bytes;
+}
+
+/**
+ * \brief Gets the current memory usage and hit rates of the cache.
+ * \return The cache statistics.
+ */
+TextureCacheStatistics TextureCache::GetStatistics()
+{
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Logs the current memory usage and hit rates of the cache.
+ */
+void TextureCache::LogStatistics()
+{
+    const TextureCacheStatistics& statistics = Get().m_statistics;
+
+    DFM_CORE_INFO("Texture cache: {0} textures, {1:.2f} MiB ({2} path hits, {3} content hits, {4} uploads).",
+        statistics.texture_count,
+        static_cast<double>(statistics.total_bytes) / (1024.0 * 1024.0),
+        statistics.path_hits,
+        statistics.content_hits,
+        statistics.misses);
+}
+
+/**
+ * \brief Deletes every cached texture.
+ */
+void TextureCache::Clear()
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (auto& cached : Get().m_textures)
+    {
+        cached.texture.Dispose();
+    }
+
+    Get().m_textures.clear();
+    Get().m_path_lookup.clear();
+    Get().m_content_lookup.clear();
+    Get().m_statistics = {};
+
+    std::lock_guard lock{ Get().m_claims_mutex };
+    Get().m_content_claims.clear();
+}
+
+/**
+ * \brief Reads a texture file in the background and decodes it on a worker thread as soon as it
+ * has been read. This is safe to call from any thread.
+ * \param path The canonical path to the texture.
+ * \param options The options used to decode the texture.
+ * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+ * \param on_decoded The function receiving the decoded texture, which is called on a worker thread.
+ */
+void TextureCache::DecodeAsync(const std::string& path, const TextureOptions& options, ShouldDecodeFunction should_decode,
+                               std::function<void(DecodedTexture)> on_decoded)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Prefer a block-compressed version of the texture, only reading the image if there is none.
+    AsyncFileReader::Read(GetCompressedPath(path),
+        [path, options, should_decode = std::move(should_decode), on_decoded = std::move(on_decoded)](FileView compressed)
+        {
+            DecodedTexture decoded{ false, 0, false, Image{}, Ktx2Texture{} };
+
+            if (compressed.IsValid() && DecodeCompressed(path, std::move(compressed), options, should_decode, decoded))
+            {
+                on_decoded(std::move(decoded));
+                return;
+            }
+
+            AsyncFileReader::Read(path, [options, should_decode, on_decoded](FileView file)
+            {
+                DecodedTexture decoded{ false, 0, false, Image{}, Ktx2Texture{} };
+                DecodeImage(file, options, should_decode, decoded);
+                on_decoded(std::move(decoded));
+            });
+        });
+}
+
+/**
+ * \brief Reads, hashes and decodes a texture file on the calling thread. This is safe to call from any thread.
+ * \param path The canonical path to the texture.
+ * \param options The options used to decode the texture.
+ * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+ * \return The decoded texture.
+ */
+TextureCache::DecodedTexture TextureCache::Decode(const std::string& path, const TextureOptions& options,
+                                                  const ShouldDecodeFunction& should_decode)
+{
+    DFM_PROFILE_FUNCTION();
+
+    DecodedTexture decoded{ false, 0, false, Image{}, Ktx2Texture{} };
+
+    FileView compressed = VirtualFileSystem::Open(GetCompressedPath(path));
+    if (compressed.IsValid() && DecodeCompressed(path, std::move(compressed), options, should_decode, decoded))
+    {
+        return decoded;
+    }
+
+    DecodeImage(VirtualFileSystem::Open(path), options, should_decode, decoded);
+    return decoded;
+}
+
+/**
+ * \brief Hashes and parses a block-compressed KTX2 file read from next to a texture.
+ * \param path The canonical path to the texture.
+ * \param file The contents of the KTX2 file.
+ * \param options The options used to decode the texture.
+ * \param should_decode The function deciding whether the file's contents are parsed once hashed.
+ * \param decoded The decoded texture to fill in.
+ * \return A boolean value indicating if the file can be used in place of the texture.
+ */
+bool TextureCache::DecodeCompressed(const std::string& path, FileView file, const TextureOptions& options,
+                                    const ShouldDecodeFunction& should_decode, DecodedTexture& decoded)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const uint64_t content_hash = HashBytes(file.GetData(), file.GetSize());
+
+    if (!should_decode(content_hash))
+    {
+        decoded.read = true;
+        decoded.content_hash = content_hash;
+        decoded.skipped = true;
+        return true;
+    }
+
+    if (decoded.compressed.Load(file.TakeContents()) && IsCompressedFormatSupported(decoded.compressed.GetFormat()) &&
+        CanUseCompressed(decoded.compressed, options))
+    {
+        decoded.read = true;
+        decoded.content_hash = content_hash;
+        return true;
+    }
+
+    decoded.compressed = Ktx2Texture{};
+    DFM_CORE_WARN("Ignoring compressed texture '{0}', falling back to '{1}'.", GetCompressedPath(path), path);
+
+    return false;
+}
+
+/**
+ * \brief Hashes and decodes an image file.
+ * \param file The contents of the image file.
+ * \param options The options used to decode the texture.
+ * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+ * \param decoded The decoded texture to fill in.
+ */
+void TextureCache::DecodeImage(const FileView& file, const TextureOptions& options, const ShouldDecodeFunction& should_decode,
+                               DecodedTexture& decoded)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (!file.IsValid())
+    {
+        return;
+    }
+
+    decoded.read = true;
+    decoded.content_hash = HashBytes(file.GetData(), file.GetSize());
+
+    // Contents already claimed by another path are never decoded a second time.
+    if (!should_decode(decoded.content_hash))
+    {
+        decoded.skipped = true;
+        return;
+    }
+
+    // Decode straight from the archive mapping when the image is stored uncompressed.
+    decoded.image.LoadFromMemory(file.GetData(), file.GetSize(), options.desired_channels, options.flip_on_load);
+}
+
+/**
+ * \brief Gets the cached texture for a path and options, if it has already been uploaded.
+ * \param path_key The key made from the canonical path and options.
+ * \param texture The cached texture, which is acquired once more.
+ * \return A boolean value indicating if the texture is cached.
+ */
+bool TextureCache::AcquireCached(const std::string& path_key, Texture2D& texture)
+{
+    TextureCache& cache = Get();
+
+    const auto search = cache.m_path_lookup.find(path_key);
+    if (search == cache.m_path_lookup.end()) return false;
+
+    CachedTexture& cached = cache.m_textures[search->second];
+    cached.references++;
+    cache.m_statistics.path_hits++;
+    texture = cached.texture;
+
+    return true;
+}
+
+/**
+ * \brief Claims a texture's contents for the given path, unless another path has claimed them first.
+ * Streamed paths can be drawn with a cached texture, but a cached texture must stay valid while it is
+ * held, so the cache takes over contents claimed by a streamed path instead of sharing its levels.
+ * This is safe to call from any thread.
+ * \param content_key The key of the texture's contents and options.
+ * \param canonical_path The canonical path to the texture.
+ * \param streamed Determines if the path is streamed by the texture streamer.
+ * \return A boolean value indicating if the contents should be decoded for the given path.
+ */
+bool TextureCache::ClaimContent(const uint64_t content_key, const std::string& canonical_path, const bool streamed)
+{
+    std::lock_guard lock{ Get().m_claims_mutex };
+
+    const auto [claim, inserted] = Get().m_content_claims.try_emplace(content_key, ContentClaim{ canonical_path, streamed });
+    if (inserted) return true;
+
+    // The streamed texture keeps its own levels, and textures streamed from now on are drawn with the cached one.
+    if (!streamed && claim->second.streamed)
+    {
+        claim->second = { canonical_path, false };
+        return true;
+    }
+
+    return claim->second.path == canonical_path;
+}
+
+/**
+ * \brief Gets the path that claimed a texture's contents. This is safe to call from any thread.
+ * \param content_key The key of the texture's contents and options.
+ * \return The claim, whose path is empty if the contents have not been claimed.
+ */
+TextureCache::ContentClaim TextureCache::GetContentClaim(const uint64_t content_key)
+{
+    std::lock_guard lock{ Get().m_claims_mutex };
+
+    const auto search = Get().m_content_claims.find(content_key);
+    return search != Get().m_content_claims.end() ? search->second : ContentClaim{ std::string{}, false };
+}
+
+/**
+ * \brief Determines whether a block-compressed version of a texture holds the image the given options
+ * would decode, with the same row order and channel count.
+ * \param compressed The block-compressed texture.
+ * \param options The options used to decode the texture.
+ * \return A boolean value indicating if the texture can be used in place of the image.
+ */
+bool TextureCache::CanUseCompressed(const Ktx2Texture& compressed, const TextureOptions& options)
+{
+    if (compressed.IsFlipped() != options.flip_on_load) return false;
+
+    return options.desired_channels == 0 || options.desired_channels == GetKtx2ChannelCount(compressed.GetFormat());
+}
+
+/**
+ * \brief Gets the path of the block-compressed version of a texture produced by the texture compiler.
+ * \param path The path to the texture.
+ * \return The path to the KTX2 file.
+ */
+std::string TextureCache::GetCompressedPath(const std::string& path)
+{
+    std::filesystem::path compressed_path{ path };
+    compressed_path.replace_extension(".ktx2");
+
+    return compressed_path.string();
+}
+
+/**
+ * \brief Determines whether the current context can sample the given block-compressed format.
+ * \param format The block-compressed format.
+ * \return A boolean value indicating if the format is supported.
+ */
+bool TextureCache::IsCompressedFormatSupported(const Ktx2Format format)
+{
+    switch (format)
+    {
+    case Ktx2Format::Bc1RgbUnorm:
+    case Ktx2Format::Bc1RgbaUnorm:
+    case Ktx2Format::Bc3Unorm:
+        return GlExtensions::IsSupported("GL_EXT_texture_compression_s3tc");
+    case Ktx2Format::Bc1RgbSrgb:
+    case Ktx2Format::Bc1RgbaSrgb:
+    case Ktx2Format::Bc3Srgb:
+        return GlExtensions::IsSupported("GL_EXT_texture_compression_s3tc") &&
+            GlExtensions::IsSupported("GL_EXT_texture_sRGB");
+    default:
+        // RGTC (BC5) and BPTC (BC7) are core since OpenGL 3.0 and 4.2.
+        return true;
+    }
+}
+
+/**
+ * \brief Gets the canonical form of the given path.
+ * \param path The path to canonicalise.
+ * \return The canonical path.
+ */
+std::string TextureCache::Canonicalise(const std::string& path)
+{
+    std::error_code error;
+    const std::filesystem::path canonical_path = std::filesystem::weakly_canonical(path, error);
+
+    if (error)
+    {
+        return std::filesystem::path{ path }.lexically_normal().generic_string();
+    }
+
+    return canonical_path.generic_string();
+}
+
+/**
+ * \brief Creates the key used to look up a texture by its path and options.
+ * \param canonical_path The canonical path to the texture.
+ * \param options The options used to decode and sample the texture.
+ * \return The lookup key.
+ */
+std::string TextureCache::MakePathKey(const std::string& canonical_path, const TextureOptions& options)
+{
+    return canonical_path + '|' +
+        std::to_string(options.desired_channels) + '|' +
+        std::to_string(options.flip_on_load) + '|' +
+        std::to_string(options.filter_min) + '|' +
+        std::to_string(options.filter_mag);
+}
+
+/**
+ * \brief Combines the hash of a texture's contents with its options.
+ * \param content_hash The hash of the texture's file contents.
+ * \param options The options used to decode and sample the texture.
+ * \return The lookup key.
+ */
+uint64_t TextureCache::MakeContentKey(const uint64_t content_hash, const TextureOptions& options)
+{
+    const int values[] = { options.desired_channels, options.flip_on_load, options.filter_min, options.filter_mag };
+    return HashBytes(values, sizeof(values), content_hash);
+}
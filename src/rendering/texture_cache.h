@@ -0,0 +1,304 @@
+/**
+ * \file texture_cache.h
+ */
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "image.h"
+#include "ktx2.h"
+#include "texture2d.h"
+#include "io/virtual_file_system.h"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Describes how a texture should be decoded and sampled.
+ */
+struct TextureOptions
+{
+    /**
+     * \brief The number of channels to decode to, or zero to keep the file's channel count.
+     */
+    int desired_channels = 0;
+
+    /**
+     * \brief Determines if the texture should be flipped vertically upon load.
+     */
+    bool flip_on_load = false;
+
+    GLint filter_min = GL_LINEAR_MIPMAP_LINEAR;
+    GLint filter_mag = GL_LINEAR;
+};
+
+/**
+ * \brief Represents a texture that has been uploaded by the texture cache.
+ */
+struct CachedTexture
+{
+    Texture2D texture;
+    std::string path;
+    uint64_t content_hash;
+    size_t size_bytes;
+
+    /**
+     * \brief The number of times the texture has been acquired and not released, under any of its paths.
+     */
+    unsigned int references;
+};
+
+/**
+ * \brief Represents the memory usage and hit rates of the texture cache.
+ */
+struct TextureCacheStatistics
+{
+    size_t texture_count;
+    size_t total_bytes;
+    size_t path_hits;
+    size_t content_hits;
+    size_t misses;
+};
+
+/**
+ * \brief A singleton class used to share textures across every model and resource in the process.
+ * Textures are keyed by their canonical path and by a hash of their file contents, so each image is
+ * decoded and uploaded exactly once. Files are hashed as soon as they have been read, and contents
+ * already claimed by another path are not decoded again. The claims are shared with the texture streamer,
+ * which draws a streamed path with the cached texture when their contents and options match. When a
+ * block-compressed KTX2 file sits next to the requested image and matches the options, it is loaded
+ * instead of decoding the image. All functions must be called on the thread owning the GL context.
+ */
+class TextureCache
+{
+public:
+    TextureCache(const TextureCache&) = delete;
+    TextureCache(TextureCache&&) noexcept = delete;
+
+    TextureCache& operator=(const TextureCache&) = delete;
+    TextureCache& operator=(TextureCache&&) noexcept = delete;
+
+    /**
+     * \brief Gets the texture at the given path, uploading it if it has not been seen before.
+     * \param path The path to the texture.
+     * \param options The options used to decode and sample the texture.
+     * \return The cached texture, or an empty texture if the file could not be loaded.
+     */
+    static Texture2D Acquire(const std::string& path, const TextureOptions& options = {});
+
+    /**
+     * \brief Releases a texture acquired from the cache, deleting it once it has been released as many
+     * times as it was acquired.
+     * \param texture The texture returned by \code Acquire.
+     */
+    static void Release(const Texture2D& texture);
+
+    /**
+     * \brief Gets the current memory usage and hit rates of the cache.
+     * \return The cache statistics.
+     */
+    [[nodiscard]] static TextureCacheStatistics GetStatistics();
+
+    /**
+     * \brief Logs the current memory usage and hit rates of the cache.
+     */
+    static void LogStatistics();
+
+    /**
+     * \brief Deletes every cached texture.
+     */
+    static void Clear();
+
+private:
+    friend class TextureStreamer;
+
+    /**
+     * \brief Represents a texture file that has been read and decoded off the GL thread.
+     */
+    struct DecodedTexture
+    {
+        bool read;
+        uint64_t content_hash;
+
+        /**
+         * \brief Determines if decoding was skipped because the contents had already been claimed.
+         */
+        bool skipped;
+
+        Image image;
+        Ktx2Texture compressed;
+    };
+
+    /**
+     * \brief Represents the path whose contents are decoded for a content key.
+     */
+    struct ContentClaim
+    {
+        std::string path;
+
+        /**
+         * \brief Determines if the path is streamed by the texture streamer rather than held by the cache.
+         */
+        bool streamed;
+    };
+
+    /**
+     * \brief A function deciding, once a texture file has been read and hashed, whether its contents
+     * should be decoded. It is called on a worker thread.
+     */
+    using ShouldDecodeFunction = std::function<bool(uint64_t content_hash)>;
+
+    /**
+     * \brief The slots of released textures are kept empty, so that the indices of the others stay valid.
+     */
+    std::deque<CachedTexture> m_textures;
+
+    std::unordered_map<std::string, size_t> m_path_lookup;
+    std::unordered_map<uint64_t, size_t> m_content_lookup;
+
+    /**
+     * \brief The canonical path that claimed each content key, which is the only path the contents are
+     * decoded for, whether by the cache or by the texture streamer. Guarded by \code m_claims_mutex, as
+     * claims are made on the worker threads.
+     */
+    std::unordered_map<uint64_t, ContentClaim> m_content_claims;
+    std::mutex m_claims_mutex;
+
+    TextureCacheStatistics m_statistics;
+
+    TextureCache();
+    ~TextureCache() = default;
+
+    /**
+     * \brief Reads a texture file in the background and decodes it on a worker thread as soon as it
+     * has been read. This is safe to call from any thread.
+     * \param path The canonical path to the texture.
+     * \param options The options used to decode the texture.
+     * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+     * \param on_decoded The function receiving the decoded texture, which is called on a worker thread.
+     */
+    static void DecodeAsync(const std::string& path, const TextureOptions& options, ShouldDecodeFunction should_decode,
+                            std::function<void(DecodedTexture)> on_decoded);
+
+    /**
+     * \brief Reads, hashes and decodes a texture file on the calling thread. This is safe to call from any thread.
+     * \param path The canonical path to the texture.
+     * \param options The options used to decode the texture.
+     * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+     * \return The decoded texture.
+     */
+    static DecodedTexture Decode(const std::string& path, const TextureOptions& options,
+                                 const ShouldDecodeFunction& should_decode);
+
+    /**
+     * \brief Hashes and parses a block-compressed KTX2 file read from next to a texture.
+     * \param path The canonical path to the texture.
+     * \param file The contents of the KTX2 file.
+     * \param options The options used to decode the texture.
+     * \param should_decode The function deciding whether the file's contents are parsed once hashed.
+     * \param decoded The decoded texture to fill in.
+     * \return A boolean value indicating if the file can be used in place of the texture.
+     */
+    static bool DecodeCompressed(const std::string& path, FileView file, const TextureOptions& options,
+                                 const ShouldDecodeFunction& should_decode, DecodedTexture& decoded);
+
+    /**
+     * \brief Hashes and decodes an image file.
+     * \param file The contents of the image file.
+     * \param options The options used to decode the texture.
+     * \param should_decode The function deciding whether the file's contents are decoded once hashed.
+     * \param decoded The decoded texture to fill in.
+     */
+    static void DecodeImage(const FileView& file, const TextureOptions& options, const ShouldDecodeFunction& should_decode,
+                            DecodedTexture& decoded);
+
+    /**
+     * \brief Gets the cached texture for a path and options, if it has already been uploaded.
+     * \param path_key The key made from the canonical path and options.
+     * \param texture The cached texture, which is acquired once more.
+     * \return A boolean value indicating if the texture is cached.
+     */
+    static bool AcquireCached(const std::string& path_key, Texture2D& texture);
+
+    /**
+     * \brief Claims a texture's contents for the given path, unless another path has claimed them first.
+     * Streamed paths can be drawn with a cached texture, but a cached texture must stay valid while it is
+     * held, so the cache takes over contents claimed by a streamed path instead of sharing its levels.
+     * This is safe to call from any thread.
+     * \param content_key The key of the texture's contents and options.
+     * \param canonical_path The canonical path to the texture.
+     * \param streamed Determines if the path is streamed by the texture streamer.
+     * \return A boolean value indicating if the contents should be decoded for the given path.
+     */
+    static bool ClaimContent(uint64_t content_key, const std::string& canonical_path, bool streamed);
+
+    /**
+     * \brief Gets the path that claimed a texture's contents. This is safe to call from any thread.
+     * \param content_key The key of the texture's contents and options.
+     * \return The claim, whose path is empty if the contents have not been claimed.
+     */
+    static ContentClaim GetContentClaim(uint64_t content_key);
+
+    /**
+     * \brief Determines whether a block-compressed version of a texture holds the image the given options
+     * would decode, with the same row order and channel count.
+     * \param compressed The block-compressed texture.
+     * \param options The options used to decode the texture.
+     * \return A boolean value indicating if the texture can be used in place of the image.
+     */
+    static bool CanUseCompressed(const Ktx2Texture& compressed, const TextureOptions& options);
+
+    /**
+     * \brief Gets the path of the block-compressed version of a texture produced by the texture compiler.
+     * \param path The path to the texture.
+     * \return The path to the KTX2 file.
+     */
+    static std::string GetCompressedPath(const std::string& path);
+
+    /**
+     * \brief Determines whether the current context can sample the given block-compressed format.
+     * \param format The block-compressed format.
+     * \return A boolean value indicating if the format is supported.
+     */
+    static bool IsCompressedFormatSupported(Ktx2Format format);
+
+    /**
+     * \brief Gets the canonical form of the given path.
+     * \param path The path to canonicalise.
+     * \return The canonical path.
+     */
+    static std::string Canonicalise(const std::string& path);
+
+    /**
+     * \brief Creates the key used to look up a texture by its path and options.
+     * \param canonical_path The canonical path to the texture.
+     * \param options The options used to decode and sample the texture.
+     * \return The lookup key.
+     */
+    static std::string MakePathKey(const std::string& canonical_path, const TextureOptions& options);
+
+    /**
+     * \brief Combines the hash of a texture's contents with its options.
+     * \param content_hash The hash of the texture's file contents.
+     * \param options The options used to decode and sample the texture.
+     * \return The lookup key.
+     */
+    static uint64_t MakeContentKey(uint64_t content_hash, const TextureOptions& options);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static TextureCache& Get() { return s_instance; }
+
+    static TextureCache s_instance;
+};
+
+#endif // TEXTURE_CACHE_H
@@ -0,0 +1,652 @@
+/**
+ * \file texture_streamer.cpp
+ */
+
+#include "texture_streamer.h"
+#include "texture_uploader.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+constexpr size_t MAX_PENDING_LOADS = 4;
+
+TextureStreamer TextureStreamer::s_instance;
+
+TextureStreamer::TextureStreamer()
+    : m_handle_count{},
+    m_budget_bytes{},
+    m_initial_resolution{},
+    m_frame{},
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Creates the placeholder texture sampled while textures are loading.
+ * \param budget_bytes The amount of video memory that streamed textures may occupy.
+ * \param initial_resolution The size of the largest dimension a texture is first loaded at.
+ */
+void TextureStreamer::Initialise(const size_t budget_bytes, const int initial_resolution)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureStreamer& streamer = Get();
+    streamer.m_budget_bytes = budget_bytes;
+    streamer.m_initial_resolution = std::max(initial_resolution, 1);
+    streamer.m_statistics.budget_bytes = budget_bytes;
+
+    constexpr unsigned char PLACEHOLDER_PIXEL[] = { 128, 128, 128, 255 };
+
+    streamer.m_placeholder.SetChannels(4);
+    streamer.m_placeholder.SetFilter(GL_NEAREST, GL_NEAREST);
+    streamer.m_placeholder.Generate(1, 1, PLACEHOLDER_PIXEL);
+
+    DFM_CORE_INFO("Texture streamer initialised with a {0} MiB budget.", budget_bytes / (1024 * 1024));
+}
+
+/**
+ * \brief Waits for outstanding loads and deletes every streamed texture.
+ */
+void TextureStreamer::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureStreamer& streamer = Get();
+
+    LogStatistics();
+
+    for (auto& texture : streamer.m_textures)
+    {
+        if (texture.pending.valid())
+        {
+            texture.pending.wait();
+        }
+
+        if (texture.cached)
+        {
+            TextureCache::Release(texture.texture);
+        }
+        else if (texture.resident)
+        {
+            texture.texture.Dispose();
+        }
+    }
+
+    streamer.m_placeholder.Dispose();
+    streamer.m_textures.clear();
+    streamer.m_statistics = {};
+
+    std::lock_guard lock{ streamer.m_registration_mutex };
+    streamer.m_lookup.clear();
+    streamer.m_handle_count = 0;
+    streamer.m_registrations.clear();
+}
+
+/**
+ * \brief Starts streaming the texture at the given path from the next update, unless it is already streamed.
+ * If its contents match another streamed or cached texture, the handle refers to that texture once the file
+ * has been read. May be called from any thread.
+ * \param path The path to the texture.
+ * \param options The options used to decode and sample the texture.
+ * \return The handle of the texture.
+ */
+TextureHandle TextureStreamer::Register(const std::string& path, const TextureOptions& options)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureStreamer& streamer = Get();
+
+    std::string canonical_path = TextureCache::Canonicalise(path);
+    const std::string key = TextureCache::MakePathKey(canonical_path, options);
+
+    std::lock_guard lock{ streamer.m_registration_mutex };
+
+    if (auto search = streamer.m_lookup.find(key); search != streamer.m_lookup.end())
+    {
+        return search->second;
+    }
+
+    // Handles are given out in the order the textures are added, so the handle is known straight away.
+    const auto handle = static_cast<TextureHandle>(streamer.m_handle_count++);
+    streamer.m_lookup[key] = handle;
+    streamer.m_registrations.push_back({ std::move(canonical_path), options });
+
+    return handle;
+}
+
+/**
+ * \brief Adds the textures registered since the last update, and starts loading them.
+ */
+void TextureStreamer::AddRegistered()
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::vector<Registration> registrations;
+
+    {
+        std::lock_guard lock{ m_registration_mutex };
+        registrations.swap(m_registrations);
+    }
+
+    for (Registration& registration : registrations)
+    {
+        StreamedTexture& texture = m_textures.emplace_back();
+        texture.path = std::move(registration.path);
+        texture.options = registration.options;
+        texture.resident = false;
+        texture.cached = false;
+        texture.compressed = false;
+        texture.full_width = 0;
+        texture.full_height = 0;
+        texture.unit_size = 0;
+        texture.resident_level = 0;
+        texture.size_bytes = 0;
+        texture.version = 0;
+        texture.requested_size = 0.0f;
+        texture.last_used_frame = 0;
+        texture.alias = INVALID_TEXTURE_HANDLE;
+
+        // The file has already been uploaded with these options, for example by the resource manager.
+        if (Texture2D cached; TextureCache::AcquireCached(TextureCache::MakePathKey(texture.path, texture.options), cached))
+        {
+            UseCached(texture, cached);
+            continue;
+        }
+
+        StartLoad(texture, -1);
+        m_statistics.texture_count++;
+    }
+}
+
+/**
+ * \brief Gets the GL texture object currently holding the texture's resident levels.
+ * \param handle The handle of the texture.
+ * \return The texture's ID, or the placeholder texture's ID if nothing is resident yet.
+ */
+GLuint TextureStreamer::GetTextureId(TextureHandle handle)
+{
+    const TextureStreamer& streamer = Get();
+    handle = Resolve(handle);
+
+    if (handle >= streamer.m_textures.size() || !streamer.m_textures[handle].resident)
+    {
+        return streamer.m_placeholder.GetId();
+    }
+
+    return streamer.m_textures[handle].texture.GetId();
+}
+
+/**
+ * \brief Gets how many times the texture's GL texture object has been replaced. Deleted texture names may
+ * be reused, so this tells a replacement apart from the same texture where the ID alone cannot.
+ * \param handle The handle of the texture.
+ * \return The number of replacements, which is zero while the placeholder texture is used.
+ */
+uint32_t TextureStreamer::GetTextureVersion(TextureHandle handle)
+{
+    const TextureStreamer& streamer = Get();
+    handle = Resolve(handle);
+
+    if (handle >= streamer.m_textures.size())
+    {
+        return 0;
+    }
+
+    return streamer.m_textures[handle].version;
+}
+
+/**
+ * \brief Gets the texture that a handle is drawn with, following it to the texture it shares contents with.
+ * \param handle The handle of the texture.
+ * \return The handle of the texture holding the levels.
+ */
+TextureHandle TextureStreamer::Resolve(const TextureHandle handle)
+{
+    const TextureStreamer& streamer = Get();
+
+    // Only the texture that claimed the contents decodes them, so an alias never points at another alias.
+    if (handle < streamer.m_textures.size() && streamer.m_textures[handle].alias != INVALID_TEXTURE_HANDLE)
+    {
+        return streamer.m_textures[handle].alias;
+    }
+
+    return handle;
+}
+
+/**
+ * \brief Records that the texture is drawn this frame across the given number of pixels.
+ * \param handle The handle of the texture.
+ * \param screen_size The size on screen of the mesh using the texture, in pixels.
+ */
+void TextureStreamer::RequestResolution(TextureHandle handle, const float screen_size)
+{
+    TextureStreamer& streamer = Get();
+    handle = Resolve(handle);
+
+    if (handle >= streamer.m_textures.size()) return;
+
+    StreamedTexture& texture = streamer.m_textures[handle];
+
+    // Several meshes may share the texture, and the largest one on screen decides its resolution.
+    if (texture.last_used_frame != streamer.m_frame)
+    {
+        texture.requested_size = 0.0f;
+        texture.last_used_frame = streamer.m_frame;
+    }
+
+    texture.requested_size = std::max(texture.requested_size, screen_size);
+}
+
+/**
+ * \brief Applies finished loads, raises textures that need more detail and evicts levels while
+ * the budget is exceeded. This should be called once per frame, after drawing.
+ */
+void TextureStreamer::Update()
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureStreamer& streamer = Get();
+    size_t pending_loads = 0;
+
+    streamer.AddRegistered();
+
+    for (auto& texture : streamer.m_textures)
+    {
+        if (!texture.pending.valid()) continue;
+
+        if (texture.pending.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+        {
+            streamer.FinishLoad(texture);
+        }
+        else
+        {
+            pending_loads++;
+        }
+    }
+
+    // Raise the textures drawn this frame that are coarser than their on-screen size needs,
+    // as far as the budget allows.
+    for (auto& texture : streamer.m_textures)
+    {
+        if (pending_loads >= MAX_PENDING_LOADS) break;
+
+        if (!texture.resident || texture.cached || texture.pending.valid() || texture.last_used_frame != streamer.m_frame)
+        {
+            continue;
+        }
+
+        int level = GetWantedLevel(texture, texture.requested_size);
+
+        while (level < texture.resident_level &&
+               streamer.m_statistics.resident_bytes - texture.size_bytes + EstimateSize(texture, level) > streamer.m_budget_bytes)
+        {
+            level++;
+        }
+
+        if (level < texture.resident_level)
+        {
+            streamer.StartLoad(texture, level);
+            pending_loads++;
+        }
+    }
+
+    // Drop the largest levels of the least recently used textures until the budget is met. Textures
+    // drawn this frame only lose levels that are finer than they currently need.
+    if (streamer.m_statistics.resident_bytes > streamer.m_budget_bytes)
+    {
+        std::vector<StreamedTexture*> candidates;
+        for (auto& texture : streamer.m_textures)
+        {
+            if (texture.resident && !texture.cached && !texture.pending.valid())
+            {
+                candidates.push_back(&texture);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+        {
+            return a->last_used_frame < b->last_used_frame;
+        });
+
+        for (StreamedTexture* texture : candidates)
+        {
+            const bool visible = texture->last_used_frame == streamer.m_frame;
+            const int wanted_level = GetWantedLevel(*texture, texture->requested_size);
+
+            while (streamer.m_statistics.resident_bytes > streamer.m_budget_bytes &&
+                   (!visible || texture->resident_level < wanted_level) &&
+                   streamer.Evict(*texture))
+            {
+            }
+
+            if (streamer.m_statistics.resident_bytes <= streamer.m_budget_bytes) break;
+        }
+    }
+
+    streamer.m_statistics.pending_loads = pending_loads;
+    streamer.m_frame++;
+}
+
+/**
+ * \brief Sets the amount of video memory that streamed textures may occupy.
+ * \param budget_bytes The budget in bytes.
+ */
+void TextureStreamer::SetBudget(const size_t budget_bytes)
+{
+    Get().m_budget_bytes = budget_bytes;
+    Get().m_statistics.budget_bytes = budget_bytes;
+}
+
+/**
+ * \brief Gets the residency of the streamed textures.
+ * \return The streamer statistics.
+ */
+TextureStreamerStatistics TextureStreamer::GetStatistics()
+{
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Logs the residency of the streamed textures.
+ */
+void TextureStreamer::LogStatistics()
+{
+    const TextureStreamerStatistics& statistics = Get().m_statistics;
+
+    DFM_CORE_INFO("Texture streamer: {0} textures ({1} shared), {2:.2f} of {3:.2f} MiB resident ({4} pending, {5} loads, {6} evictions).",
+        statistics.texture_count,
+        statistics.shared_textures,
+        static_cast<double>(statistics.resident_bytes) / (1024.0 * 1024.0),
+        static_cast<double>(statistics.budget_bytes) / (1024.0 * 1024.0),
+        statistics.pending_loads,
+        statistics.loads,
+        statistics.evictions);
+}
+
+/**
+ * \brief Keeps only the levels of a decoded texture from the given one downwards.
+ * This is safe to call from any thread.
+ * \param decoded The decoded texture.
+ * \param level The level to start at, or a negative value to pick the level from the initial resolution.
+ * \param initial_resolution The size of the largest dimension a texture is first loaded at.
+ * \return The decoded levels.
+ */
+TextureStreamer::StreamedLevels TextureStreamer::Load(TextureCache::DecodedTexture decoded, int level,
+                                                      const int initial_resolution)
+{
+    DFM_PROFILE_FUNCTION();
+
+    StreamedLevels levels{ false, decoded.skipped, decoded.content_hash, 0, 0, 0, Image{}, nullptr };
+
+    // Image formats cannot be decoded at a reduced size, so the whole file is decoded and reduced here.
+    if (decoded.compressed.IsValid())
+    {
+        levels.full_width = static_cast<int>(decoded.compressed.GetWidth());
+        levels.full_height = static_cast<int>(decoded.compressed.GetHeight());
+
+        if (level < 0)
+        {
+            level = GetLevelForResolution(levels.full_width, levels.full_height, initial_resolution);
+        }
+
+        levels.level = std::min(level, static_cast<int>(decoded.compressed.GetLevelCount()) - 1);
+        levels.compressed = std::make_shared<Ktx2Texture>(std::move(decoded.compressed));
+        levels.valid = true;
+    }
+    else if (decoded.image.IsValid())
+    {
+        levels.full_width = decoded.image.GetWidth();
+        levels.full_height = decoded.image.GetHeight();
+
+        if (level < 0)
+        {
+            level = GetLevelForResolution(levels.full_width, levels.full_height, initial_resolution);
+        }
+
+        levels.level = level;
+        levels.image = std::move(decoded.image);
+        levels.image.Downsample(level);
+        levels.valid = true;
+    }
+
+    return levels;
+}
+
+/**
+ * \brief Starts reading a texture in the background and loading it at the given level on a worker thread.
+ * \param texture The streamed texture.
+ * \param level The level to load, or a negative value to pick the level from the initial resolution.
+ */
+void TextureStreamer::StartLoad(StreamedTexture& texture, const int level)
+{
+    DFM_PROFILE_FUNCTION();
+
+    auto loaded = std::make_shared<std::promise<StreamedLevels>>();
+    texture.pending = loaded->get_future().share();
+
+    TextureCache::DecodeAsync(texture.path, texture.options,
+        [path = texture.path, options = texture.options](const uint64_t content_hash)
+        {
+            return TextureCache::ClaimContent(TextureCache::MakeContentKey(content_hash, options), path, true);
+        },
+        [loaded, level, initial_resolution = m_initial_resolution](TextureCache::DecodedTexture decoded)
+        {
+            loaded->set_value(Load(std::move(decoded), level, initial_resolution));
+        });
+}
+
+/**
+ * \brief Replaces a texture's resident levels with ones that have finished loading.
+ * \param texture The streamed texture.
+ */
+void TextureStreamer::FinishLoad(StreamedTexture& texture)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // The loaded data stays alive until the uploader has streamed it to the GPU.
+    const auto owner = std::make_shared<std::shared_future<StreamedLevels>>(std::move(texture.pending));
+    texture.pending = {};
+
+    const StreamedLevels& loaded = owner->get();
+
+    // Another path claimed the same contents first, so this one is drawn with its texture from now on.
+    if (loaded.shared)
+    {
+        const TextureCache::ContentClaim claim =
+            TextureCache::GetContentClaim(TextureCache::MakeContentKey(loaded.content_hash, texture.options));
+
+        m_statistics.texture_count--;
+
+        if (!claim.streamed)
+        {
+            UseCached(texture, TextureCache::Acquire(claim.path, texture.options));
+            return;
+        }
+
+        // Contents are claimed with the options a path is registered with, so the owner has the same options.
+        std::lock_guard lock{ m_registration_mutex };
+
+        const auto search = m_lookup.find(TextureCache::MakePathKey(claim.path, texture.options));
+        if (search == m_lookup.end())
+        {
+            DFM_CORE_ERROR("Failure to load texture: '{0}'.", texture.path);
+            return;
+        }
+
+        texture.alias = search->second;
+        m_statistics.shared_textures++;
+        return;
+    }
+
+    if (!loaded.valid)
+    {
+        DFM_CORE_ERROR("Failure to load texture: '{0}'.", texture.path);
+        return;
+    }
+
+    Texture2D replacement;
+    replacement.SetFilter(texture.options.filter_min, texture.options.filter_mag);
+
+    if (loaded.compressed)
+    {
+        replacement.GenerateCompressed(loaded.compressed, static_cast<uint32_t>(loaded.level));
+        texture.compressed = true;
+        texture.unit_size = GetKtx2BlockSize(loaded.compressed->GetFormat());
+    }
+    else
+    {
+        replacement.SetChannels(loaded.image.GetChannels());
+        replacement.Generate(loaded.image.GetWidth(), loaded.image.GetHeight(), loaded.image.GetData(), owner);
+        texture.compressed = false;
+        texture.unit_size = static_cast<size_t>(loaded.image.GetChannels());
+    }
+
+    if (texture.resident)
+    {
+        texture.texture.Dispose();
+    }
+
+    texture.texture = replacement;
+    texture.resident = true;
+    texture.version++;
+    texture.full_width = loaded.full_width;
+    texture.full_height = loaded.full_height;
+    texture.resident_level = loaded.level;
+
+    m_statistics.resident_bytes -= texture.size_bytes;
+    texture.size_bytes = EstimateSize(texture, texture.resident_level);
+    m_statistics.resident_bytes += texture.size_bytes;
+    m_statistics.loads++;
+}
+
+/**
+ * \brief Draws a texture with one held by the texture cache rather than streaming it.
+ * \param texture The streamed texture.
+ * \param cached The cached texture, which has been acquired for the streamed texture.
+ */
+void TextureStreamer::UseCached(StreamedTexture& texture, const Texture2D& cached)
+{
+    if (cached.GetId() == 0)
+    {
+        DFM_CORE_ERROR("Failure to load texture: '{0}'.", texture.path);
+        return;
+    }
+
+    // A streamed texture whose contents the cache has since taken over gives up its own levels.
+    if (texture.resident)
+    {
+        texture.texture.Dispose();
+        m_statistics.resident_bytes -= texture.size_bytes;
+        texture.size_bytes = 0;
+    }
+
+    // The cache owns the texture's memory, so it is not counted against the budget.
+    texture.texture = cached;
+    texture.resident = true;
+    texture.cached = true;
+    texture.version++;
+
+    m_statistics.shared_textures++;
+}
+
+/**
+ * \brief Drops the largest resident level of a texture.
+ * \param texture The streamed texture.
+ * \return A boolean value indicating if a level was dropped.
+ */
+bool TextureStreamer::Evict(StreamedTexture& texture)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const int minimum_level = GetLevelForResolution(texture.full_width, texture.full_height, m_initial_resolution);
+
+    // Levels can only be copied once they have arrived on the GPU.
+    if (!texture.resident || texture.resident_level >= minimum_level || texture.texture.GetLevelCount() <= 1 ||
+        TextureUploader::IsPending(texture.texture.GetId()))
+    {
+        return false;
+    }
+
+    const Texture2D reduced = texture.texture.CreateReduced(1);
+    texture.texture.Dispose();
+    texture.texture = reduced;
+    texture.version++;
+    texture.resident_level++;
+
+    m_statistics.resident_bytes -= texture.size_bytes;
+    texture.size_bytes = EstimateSize(texture, texture.resident_level);
+    m_statistics.resident_bytes += texture.size_bytes;
+    m_statistics.evictions++;
+
+    return true;
+}
+
+/**
+ * \brief Gets the level of the full mip chain that covers the given screen size with one texel per pixel.
+ * \param texture The streamed texture.
+ * \param screen_size The size on screen in pixels.
+ * \return The wanted level.
+ */
+int TextureStreamer::GetWantedLevel(const StreamedTexture& texture, const float screen_size)
+{
+    const int size = std::max(texture.full_width, texture.full_height);
+    const int max_level = static_cast<int>(std::log2(std::max(size, 1)));
+
+    if (screen_size < 1.0f) return max_level;
+
+    const int level = static_cast<int>(std::floor(std::log2(static_cast<float>(size) / screen_size)));
+    return std::clamp(level, 0, max_level);
+}
+
+/**
+ * \brief Gets the level at which the largest dimension of a texture fits within a given resolution.
+ * \param width The width of the base level.
+ * \param height The height of the base level.
+ * \param resolution The resolution in pixels.
+ * \return The level.
+ */
+int TextureStreamer::GetLevelForResolution(const int width, const int height, const int resolution)
+{
+    int level = 0;
+    for (int size = std::max(width, height); size > resolution && size > 1; size /= 2)
+    {
+        level++;
+    }
+
+    return level;
+}
+
+/**
+ * \brief Estimates the video memory used by a texture when a given level is its base level.
+ * \param texture The streamed texture.
+ * \param level The base level.
+ * \return The size in bytes.
+ */
+size_t TextureStreamer::EstimateSize(const StreamedTexture& texture, const int level)
+{
+    size_t size = 0;
+    int width = std::max(texture.full_width >> level, 1);
+    int height = std::max(texture.full_height >> level, 1);
+
+    while (true)
+    {
+        if (texture.compressed)
+        {
+            size += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * texture.unit_size;
+        }
+        else
+        {
+            size += static_cast<size_t>(width) * height * texture.unit_size;
+        }
+
+        if (width == 1 && height == 1) break;
+
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    return size;
+}
@@ -0,0 +1,311 @@
+/**
+ * \file texture_streamer.h
+ */
+
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "image.h"
+#include "ktx2.h"
+#include "texture2d.h"
+#include "texture_cache.h"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief A stable reference to a streamed texture, which stays valid while its GL texture object
+ * is replaced at different resolutions.
+ */
+using TextureHandle = uint32_t;
+
+constexpr TextureHandle INVALID_TEXTURE_HANDLE = UINT32_MAX;
+
+/**
+ * \brief Represents the residency of the textures managed by the texture streamer.
+ */
+struct TextureStreamerStatistics
+{
+    size_t texture_count;
+
+    /**
+     * \brief The number of registered paths drawn with another streamed texture or with a texture held by
+     * the texture cache, because their contents matched.
+     */
+    size_t shared_textures;
+
+    size_t resident_bytes;
+    size_t budget_bytes;
+    size_t pending_loads;
+    size_t loads;
+    size_t evictions;
+};
+
+/**
+ * \brief A singleton class that keeps only the mip levels that are needed on screen resident.
+ * Textures start at a low resolution, are raised as the meshes using them cover more of the screen,
+ * and lose their largest levels, least recently used first, when the total exceeds the VRAM budget.
+ * Raising a texture decodes the file again on a worker thread, whereas dropping levels copies the
+ * remaining ones into a smaller texture on the GPU. Files are hashed before they are decoded, so paths
+ * with identical contents share a single streamed texture. Content claims are shared with the texture
+ * cache, and a path whose contents and options match a cached texture is drawn with that texture, kept
+ * at full resolution outside the budget, instead of being uploaded again. Textures may be registered from
+ * any thread, and start loading at the next update. All other functions must be called on the thread
+ * owning the GL context.
+ */
+class TextureStreamer
+{
+public:
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer(TextureStreamer&&) noexcept = delete;
+
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(TextureStreamer&&) noexcept = delete;
+
+    /**
+     * \brief Creates the placeholder texture sampled while textures are loading.
+     * \param budget_bytes The amount of video memory that streamed textures may occupy.
+     * \param initial_resolution The size of the largest dimension a texture is first loaded at.
+     */
+    static void Initialise(size_t budget_bytes = 256 * 1024 * 1024, int initial_resolution = 64);
+
+    /**
+     * \brief Waits for outstanding loads and deletes every streamed texture.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Starts streaming the texture at the given path from the next update, unless it is already streamed.
+     * If its contents match another streamed or cached texture, the handle refers to that texture once the file
+     * has been read. May be called from any thread.
+     * \param path The path to the texture.
+     * \param options The options used to decode and sample the texture.
+     * \return The handle of the texture.
+     */
+    static TextureHandle Register(const std::string& path, const TextureOptions& options = {});
+
+    /**
+     * \brief Gets the GL texture object currently holding the texture's resident levels.
+     * \param handle The handle of the texture.
+     * \return The texture's ID, or the placeholder texture's ID if nothing is resident yet.
+     */
+    [[nodiscard]] static GLuint GetTextureId(TextureHandle handle);
+
+    /**
+     * \brief Gets how many times the texture's GL texture object has been replaced. Deleted texture names may
+     * be reused, so this tells a replacement apart from the same texture where the ID alone cannot.
+     * \param handle The handle of the texture.
+     * \return The number of replacements, which is zero while the placeholder texture is used.
+     */
+    [[nodiscard]] static uint32_t GetTextureVersion(TextureHandle handle);
+
+    /**
+     * \brief Gets the texture that a handle is drawn with, following it to the texture it shares contents with.
+     * \param handle The handle of the texture.
+     * \return The handle of the texture holding the levels.
+     */
+    [[nodiscard]] static TextureHandle Resolve(TextureHandle handle);
+
+    /**
+     * \brief Records that the texture is drawn this frame across the given number of pixels.
+     * \param handle The handle of the texture.
+     * \param screen_size The size on screen of the mesh using the texture, in pixels.
+     */
+    static void RequestResolution(TextureHandle handle, float screen_size);
+
+    /**
+     * \brief Applies finished loads, raises textures that need more detail and evicts levels while
+     * the budget is exceeded. This should be called once per frame, after drawing.
+     */
+    static void Update();
+
+    /**
+     * \brief Sets the amount of video memory that streamed textures may occupy.
+     * \param budget_bytes The budget in bytes.
+     */
+    static void SetBudget(size_t budget_bytes);
+
+    /**
+     * \brief Gets the residency of the streamed textures.
+     * \return The streamer statistics.
+     */
+    [[nodiscard]] static TextureStreamerStatistics GetStatistics();
+
+    /**
+     * \brief Logs the residency of the streamed textures.
+     */
+    static void LogStatistics();
+
+private:
+    /**
+     * \brief Represents a texture file decoded at a given level on a worker thread.
+     */
+    struct StreamedLevels
+    {
+        bool valid;
+
+        /**
+         * \brief Determines if the file was not decoded because another texture had claimed its contents.
+         */
+        bool shared;
+
+        uint64_t content_hash;
+        int full_width, full_height;
+        int level;
+        Image image;
+        std::shared_ptr<Ktx2Texture> compressed;
+    };
+
+    /**
+     * \brief Represents a texture managed by the streamer.
+     */
+    struct StreamedTexture
+    {
+        std::string path;
+        TextureOptions options;
+        Texture2D texture;
+        bool resident;
+
+        /**
+         * \brief Determines if the texture is held by the texture cache, and so is never raised or evicted.
+         */
+        bool cached;
+
+        bool compressed;
+        int full_width, full_height;
+
+        /**
+         * \brief The number of bytes in each pixel, or in each 4x4 block of block-compressed textures.
+         */
+        size_t unit_size;
+
+        /**
+         * \brief The level of the full mip chain that the resident texture starts at.
+         */
+        int resident_level;
+
+        size_t size_bytes;
+        uint32_t version;
+        float requested_size;
+        uint64_t last_used_frame;
+        std::shared_future<StreamedLevels> pending;
+
+        /**
+         * \brief The texture with identical contents that this one is drawn with, or \code INVALID_TEXTURE_HANDLE.
+         */
+        TextureHandle alias;
+    };
+
+    /**
+     * \brief Represents a texture that has been given a handle, but not yet added to the streamed textures.
+     */
+    struct Registration
+    {
+        std::string path;
+        TextureOptions options;
+    };
+
+    std::vector<StreamedTexture> m_textures;
+
+    /**
+     * \brief The handles of registered paths, the number of handles given out and the registrations waiting
+     * for the next update. Guarded by \code m_registration_mutex, as textures are registered while models load.
+     */
+    std::unordered_map<std::string, TextureHandle> m_lookup;
+    size_t m_handle_count;
+    std::vector<Registration> m_registrations;
+    std::mutex m_registration_mutex;
+
+    Texture2D m_placeholder;
+    size_t m_budget_bytes;
+    int m_initial_resolution;
+    uint64_t m_frame;
+    TextureStreamerStatistics m_statistics;
+
+    TextureStreamer();
+    ~TextureStreamer() = default;
+
+    /**
+     * \brief Keeps only the levels of a decoded texture from the given one downwards.
+     * This is safe to call from any thread.
+     * \param decoded The decoded texture.
+     * \param level The level to start at, or a negative value to pick the level from the initial resolution.
+     * \param initial_resolution The size of the largest dimension a texture is first loaded at.
+     * \return The decoded levels.
+     */
+    static StreamedLevels Load(TextureCache::DecodedTexture decoded, int level, int initial_resolution);
+
+    /**
+     * \brief Adds the textures registered since the last update, and starts loading them.
+     */
+    void AddRegistered();
+
+    /**
+     * \brief Starts reading a texture in the background and loading it at the given level on a worker thread.
+     * \param texture The streamed texture.
+     * \param level The level to load, or a negative value to pick the level from the initial resolution.
+     */
+    void StartLoad(StreamedTexture& texture, int level);
+
+    /**
+     * \brief Replaces a texture's resident levels with ones that have finished loading.
+     * \param texture The streamed texture.
+     */
+    void FinishLoad(StreamedTexture& texture);
+
+    /**
+     * \brief Draws a texture with one held by the texture cache rather than streaming it.
+     * \param texture The streamed texture.
+     * \param cached The cached texture, which has been acquired for the streamed texture.
+     */
+    void UseCached(StreamedTexture& texture, const Texture2D& cached);
+
+    /**
+     * \brief Drops the largest resident level of a texture.
+     * \param texture The streamed texture.
+     * \return A boolean value indicating if a level was dropped.
+     */
+    bool Evict(StreamedTexture& texture);
+
+    /**
+     * \brief Gets the level of the full mip chain that covers the given screen size with one texel per pixel.
+     * \param texture The streamed texture.
+     * \param screen_size The size on screen in pixels.
+     * \return The wanted level.
+     */
+    static int GetWantedLevel(const StreamedTexture& texture, float screen_size);
+
+    /**
+     * \brief Gets the level at which the largest dimension of a texture fits within a given resolution.
+     * \param width The width of the base level.
+     * \param height The height of the base level.
+     * \param resolution The resolution in pixels.
+     * \return The level.
+     */
+    static int GetLevelForResolution(int width, int height, int resolution);
+
+    /**
+     * \brief Estimates the video memory used by a texture when a given level is its base level.
+     * \param texture The streamed texture.
+     * \param level The base level.
+     * \return The size in bytes.
+     */
+    static size_t EstimateSize(const StreamedTexture& texture, int level);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static TextureStreamer& Get() { return s_instance; }
+
+    static TextureStreamer s_instance;
+};
+
+#endif // TEXTURE_STREAMER_H
@@ -0,0 +1,401 @@
+/**
+ * \file texture_uploader.cpp
+ */
+
+#include "texture_uploader.h"
+#include "loader_thread.h"
+#include "utils/gl_state.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t RING_ALIGNMENT = 16;
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000;
+
+TextureUploader TextureUploader::s_instance;
+
+TextureUploader::TextureUploader()
+    : m_buffer{},
+    m_mapping{},
+    m_ring_size{},
+    m_ring_head{},
+    m_ring_used{},
+    m_ring_unfenced{},
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Creates and maps the pixel buffer ring. This must be called before the loader thread is started.
+ * \param ring_size The size of the ring in bytes.
+ */
+void TextureUploader::Initialise(const size_t ring_size)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureUploader& uploader = Get();
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glCreateBuffers(1, &uploader.m_buffer);
+    glNamedBufferStorage(uploader.m_buffer, static_cast<GLsizeiptr>(ring_size), nullptr, flags);
+    uploader.m_mapping = static_cast<unsigned char*>(
+        glMapNamedBufferRange(uploader.m_buffer, 0, static_cast<GLsizeiptr>(ring_size), flags));
+
+    if (!uploader.m_mapping)
+    {
+        DFM_CORE_WARN("Failed to map the texture upload ring, textures will be uploaded from client memory.");
+        GlState::DeleteBuffer(uploader.m_buffer);
+        uploader.m_buffer = 0;
+        return;
+    }
+
+    uploader.m_ring_size = ring_size;
+    uploader.m_ring_head = 0;
+    uploader.m_ring_used = 0;
+    uploader.m_ring_unfenced = 0;
+
+    DFM_CORE_INFO("Texture uploader initialised with a {0} MiB ring.", ring_size / (1024 * 1024));
+}
+
+/**
+ * \brief Deletes the pixel buffer ring. This must be called after the loader thread has been shut down.
+ */
+void TextureUploader::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureUploader& uploader = Get();
+
+    while (!uploader.m_fences.empty())
+    {
+        uploader.Retire(true);
+    }
+
+    // Deleting a persistently mapped buffer also unmaps it.
+    GlState::DeleteBuffer(uploader.m_buffer);
+    uploader.m_buffer = 0;
+    uploader.m_mapping = nullptr;
+    uploader.m_ring_size = 0;
+    uploader.m_pending.clear();
+}
+
+/**
+ * \brief Queues a texture to be created and uploaded on the loader thread.
+ * \param job The upload to queue.
+ */
+void TextureUploader::Enqueue(TextureUploadJob job)
+{
+    DFM_PROFILE_FUNCTION();
+
+    TextureUploader& uploader = Get();
+    const GLuint texture = job.texture;
+
+    uploader.m_pending.emplace(texture, false);
+
+    {
+        std::lock_guard lock{ uploader.m_statistics_mutex };
+        uploader.m_statistics.pending_jobs++;
+    }
+
+    // The loader thread fences the upload, so the texture is only handed back once the GPU has filled it.
+    const auto shared_job = std::make_shared<const TextureUploadJob>(std::move(job));
+
+    LoaderThread::Submit([shared_job]
+    {
+        Get().Upload(*shared_job);
+    },
+    [texture]
+    {
+        Get().Finish(texture);
+    });
+}
+
+/**
+ * \brief Marks a texture whose upload has not been handed back yet as disposed, so it is deleted once
+ * the loader thread has finished with it.
+ * \param texture The GL texture object.
+ * \return A boolean value indicating if the uploader deletes the texture, rather than the caller.
+ */
+bool TextureUploader::Cancel(const GLuint texture)
+{
+    const auto search = Get().m_pending.find(texture);
+    if (search == Get().m_pending.end()) return false;
+
+    search->second = true;
+    return true;
+}
+
+/**
+ * \brief Determines whether the given texture has not been handed back to the drawing context yet.
+ * \param texture The GL texture object.
+ * \return A boolean value indicating if an upload into the texture is pending.
+ */
+bool TextureUploader::IsPending(const GLuint texture)
+{
+    return Get().m_pending.count(texture) != 0;
+}
+
+/**
+ * \brief Gets the throughput and backlog of the uploader.
+ * \return The uploader statistics.
+ */
+TextureUploaderStatistics TextureUploader::GetStatistics()
+{
+    std::lock_guard lock{ Get().m_statistics_mutex };
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Creates a texture and uploads every level of its data on the current context.
+ * \param job The upload.
+ */
+void TextureUploader::Upload(const TextureUploadJob& job)
+{
+    DFM_PROFILE_FUNCTION();
+
+    job.allocate();
+
+    for (GLint level = 0; level < static_cast<GLint>(job.levels.size()); level++)
+    {
+        const GLsizei row_count = GetRowCount(job, level);
+
+        for (GLsizei row = 0; row < row_count;)
+        {
+            row += UploadBand(job, level, row);
+        }
+    }
+
+    if (job.generate_mipmaps)
+    {
+        glGenerateTextureMipmap(job.texture);
+    }
+
+    Fence();
+}
+
+/**
+ * \brief Uploads the next band of rows of a level.
+ * \param job The upload.
+ * \param level The level.
+ * \param row The first row of the band.
+ * \return The number of rows uploaded.
+ */
+GLsizei TextureUploader::UploadBand(const TextureUploadJob& job, const GLint level, const GLsizei row)
+{
+    DFM_PROFILE_FUNCTION();
+
+    const size_t row_size = GetRowSize(job, level);
+    GLsizei rows = GetRowCount(job, level) - row;
+
+    const bool use_ring = m_mapping && row_size <= m_ring_size;
+    if (use_ring)
+    {
+        rows = static_cast<GLsizei>(std::min(static_cast<size_t>(rows), m_ring_size / row_size));
+    }
+
+    const size_t size = row_size * static_cast<size_t>(rows);
+    const unsigned char* source = job.levels[level] + row_size * static_cast<size_t>(row);
+
+    const void* pixels = source;
+
+    if (use_ring)
+    {
+        size_t offset;
+        while (!Allocate(size, offset))
+        {
+            // The ring is full of data the GPU has not consumed yet.
+            Fence();
+            Retire(true);
+
+            std::lock_guard lock{ m_statistics_mutex };
+            m_statistics.ring_stalls++;
+        }
+
+        std::memcpy(m_mapping + offset, source, size);
+
+        // With a pixel unpack buffer bound, the pointer is interpreted as an offset into the buffer. The
+        // binding usually belongs to the loader thread's context, which GlState does not track.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+        pixels = reinterpret_cast<const void*>(offset);
+    }
+
+    const GLsizei level_width = std::max(job.width >> level, 1);
+    const GLsizei level_height = std::max(job.height >> level, 1);
+
+    if (job.compressed)
+    {
+        // Rows are rows of 4x4 blocks, and the last one may overhang the level.
+        const GLsizei y = row * 4;
+        const GLsizei height = std::min(rows * 4, level_height - y);
+
+        glCompressedTextureSubImage2D(job.texture, level, 0, y, level_width, height, job.format,
+                                      static_cast<GLsizei>(size), pixels);
+    }
+    else
+    {
+        // Rows of 1 or 3 channel images are not necessarily 4-byte aligned.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTextureSubImage2D(job.texture, level, 0, row, level_width, rows, job.format, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    // Other texture uploads pass pointers to client memory, which would be read as offsets into a bound
+    // pixel unpack buffer.
+    if (use_ring)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    std::lock_guard lock{ m_statistics_mutex };
+    m_statistics.uploaded_bytes += size;
+
+    return rows;
+}
+
+/**
+ * \brief Hands a texture whose upload has completed back to the drawing context, deleting it if it
+ * was disposed meanwhile.
+ * \param texture The GL texture object.
+ */
+void TextureUploader::Finish(const GLuint texture)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (const auto search = m_pending.find(texture); search != m_pending.end())
+    {
+        if (search->second)
+        {
+            GlState::DeleteTexture(texture);
+        }
+
+        m_pending.erase(search);
+    }
+
+    std::lock_guard lock{ m_statistics_mutex };
+    m_statistics.pending_jobs--;
+    m_statistics.completed_jobs++;
+}
+
+/**
+ * \brief Reserves a range of the ring, retiring fenced ranges that the GPU has finished with.
+ * \param size The size of the range in bytes.
+ * \param offset The offset of the reserved range within the ring.
+ * \return A boolean value indicating if the range could be reserved.
+ */
+bool TextureUploader::Allocate(const size_t size, size_t& offset)
+{
+    size_t start = (m_ring_head + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+    size_t padding = start - m_ring_head;
+
+    // Skip the end of the ring if the range does not fit before it.
+    if (start + size > m_ring_size)
+    {
+        start = 0;
+        padding = m_ring_size - m_ring_head;
+    }
+
+    if (m_ring_used + padding + size > m_ring_size)
+    {
+        Retire(false);
+
+        if (m_ring_used == 0)
+        {
+            // Everything has been retired, so start again from the beginning of the ring.
+            m_ring_head = 0;
+            start = 0;
+            padding = 0;
+        }
+
+        if (m_ring_used + padding + size > m_ring_size)
+        {
+            return false;
+        }
+    }
+
+    offset = start;
+    m_ring_head = start + size;
+    m_ring_used += padding + size;
+    m_ring_unfenced += padding + size;
+
+    return true;
+}
+
+/**
+ * \brief Inserts a fence after the commands reading the ring ranges reserved since the last fence.
+ */
+void TextureUploader::Fence()
+{
+    if (m_ring_unfenced == 0) return;
+
+    m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_ring_unfenced });
+    m_ring_unfenced = 0;
+}
+
+/**
+ * \brief Releases ranges of the ring whose fences have been signalled.
+ * \param wait Determines if the oldest range should be waited on when none have been signalled.
+ */
+void TextureUploader::Retire(const bool wait)
+{
+    DFM_PROFILE_FUNCTION();
+
+    bool waited = false;
+
+    while (!m_fences.empty())
+    {
+        const RingFence& front = m_fences.front();
+
+        const GLuint64 timeout = wait && !waited ? FENCE_TIMEOUT_NS : 0;
+        const GLenum status = glClientWaitSync(front.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        waited = true;
+
+        if (status == GL_TIMEOUT_EXPIRED) break;
+
+        if (status == GL_WAIT_FAILED)
+        {
+            DFM_CORE_ERROR("Failed to wait on a texture upload fence.");
+        }
+
+        glDeleteSync(front.fence);
+        m_ring_used -= front.size;
+        m_fences.pop_front();
+    }
+}
+
+/**
+ * \brief Gets the number of bytes in a row of pixels, or a row of 4x4 blocks, of a level.
+ * \param job The upload.
+ * \param level The level.
+ * \return The row size in bytes.
+ */
+size_t TextureUploader::GetRowSize(const TextureUploadJob& job, const GLint level)
+{
+    const size_t level_width = static_cast<size_t>(std::max(job.width >> level, 1));
+
+    if (job.compressed)
+    {
+        return (level_width + 3) / 4 * job.unit_size;
+    }
+
+    return level_width * job.unit_size;
+}
+
+/**
+ * \brief Gets the number of rows of pixels, or rows of 4x4 blocks, in a level.
+ * \param job The upload.
+ * \param level The level.
+ * \return The number of rows.
+ */
+GLsizei TextureUploader::GetRowCount(const TextureUploadJob& job, const GLint level)
+{
+    const GLsizei level_height = std::max(job.height >> level, 1);
+
+    if (job.compressed)
+    {
+        return (level_height + 3) / 4;
+    }
+
+    return level_height;
+}
@@ -0,0 +1,235 @@
+/**
+ * \file texture_uploader.h
+ */
+
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Describes a texture to be created and filled with texels.
+ */
+struct TextureUploadJob
+{
+    /**
+     * \brief The name of the GL texture object, which has been reserved with \code glGenTextures\endcode
+     * but not yet created.
+     */
+    GLuint texture;
+
+    /**
+     * \brief Creates the texture object and its immutable storage for every level that will be written.
+     * It is called on the context making the upload.
+     */
+    std::function<void()> allocate;
+
+    /**
+     * \brief The pixel format of uncompressed data, or the internal format of block-compressed data.
+     */
+    GLenum format;
+
+    bool compressed;
+    GLsizei width, height;
+
+    /**
+     * \brief The number of bytes in each pixel of uncompressed data, or in each 4x4 block of
+     * block-compressed data.
+     */
+    size_t unit_size;
+
+    /**
+     * \brief Determines if the remaining levels of the texture are generated once the data is uploaded.
+     */
+    bool generate_mipmaps;
+
+    /**
+     * \brief Keeps the data alive until the upload has finished.
+     */
+    std::shared_ptr<const void> owner;
+
+    /**
+     * \brief The data of each level to upload, starting with the base level.
+     */
+    std::vector<const unsigned char*> levels;
+};
+
+/**
+ * \brief Represents the throughput and backlog of the texture uploader.
+ */
+struct TextureUploaderStatistics
+{
+    size_t pending_jobs;
+    size_t uploaded_bytes;
+    size_t completed_jobs;
+
+    /**
+     * \brief The number of times the ring was full and the upload waited for the GPU to read it.
+     */
+    size_t ring_stalls;
+};
+
+/**
+ * \brief A singleton class that creates textures and streams their texel data to the GPU on the loader
+ * thread, through a persistently mapped pixel buffer ring, so allocating storage, copying texels and
+ * generating mipmaps never stall drawing. A texture's name is reserved when its upload is queued, and
+ * the texture is handed back to the drawing context once the loader thread's fence after the upload has
+ * been signalled. Fences also guard the parts of the ring that the GPU may still be reading. Uploads are
+ * queued, cancelled and checked on the thread owning the GL context, and the ring is only used by the
+ * loader thread, or by the drawing context when the loader thread is not running.
+ */
+class TextureUploader
+{
+public:
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader(TextureUploader&&) noexcept = delete;
+
+    TextureUploader& operator=(const TextureUploader&) = delete;
+    TextureUploader& operator=(TextureUploader&&) noexcept = delete;
+
+    /**
+     * \brief Creates and maps the pixel buffer ring. This must be called before the loader thread is started.
+     * \param ring_size The size of the ring in bytes.
+     */
+    static void Initialise(size_t ring_size = 32 * 1024 * 1024);
+
+    /**
+     * \brief Deletes the pixel buffer ring. This must be called after the loader thread has been shut down.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Queues a texture to be created and uploaded on the loader thread.
+     * \param job The upload to queue.
+     */
+    static void Enqueue(TextureUploadJob job);
+
+    /**
+     * \brief Marks a texture whose upload has not been handed back yet as disposed, so it is deleted once
+     * the loader thread has finished with it.
+     * \param texture The GL texture object.
+     * \return A boolean value indicating if the uploader deletes the texture, rather than the caller.
+     */
+    static bool Cancel(GLuint texture);
+
+    /**
+     * \brief Determines whether the given texture has not been handed back to the drawing context yet.
+     * \param texture The GL texture object.
+     * \return A boolean value indicating if an upload into the texture is pending.
+     */
+    [[nodiscard]] static bool IsPending(GLuint texture);
+
+    /**
+     * \brief Gets the throughput and backlog of the uploader.
+     * \return The uploader statistics.
+     */
+    [[nodiscard]] static TextureUploaderStatistics GetStatistics();
+
+private:
+    /**
+     * \brief Represents a range of the ring that the GPU may still be reading.
+     */
+    struct RingFence
+    {
+        GLsync fence;
+        size_t size;
+    };
+
+    GLuint m_buffer;
+    unsigned char* m_mapping;
+    size_t m_ring_size;
+    size_t m_ring_head;
+    size_t m_ring_used;
+    size_t m_ring_unfenced;
+    std::deque<RingFence> m_fences;
+
+    /**
+     * \brief The textures whose uploads have not been handed back, and whether each has been disposed
+     * meanwhile. Only used on the thread owning the GL context.
+     */
+    std::unordered_map<GLuint, bool> m_pending;
+
+    /**
+     * \brief Guards the statistics, which are updated by both the loader thread and the drawing context.
+     */
+    std::mutex m_statistics_mutex;
+    TextureUploaderStatistics m_statistics;
+
+    TextureUploader();
+    ~TextureUploader() = default;
+
+    /**
+     * \brief Creates a texture and uploads every level of its data on the current context.
+     * \param job The upload.
+     */
+    void Upload(const TextureUploadJob& job);
+
+    /**
+     * \brief Uploads the next band of rows of a level.
+     * \param job The upload.
+     * \param level The level.
+     * \param row The first row of the band.
+     * \return The number of rows uploaded.
+     */
+    GLsizei UploadBand(const TextureUploadJob& job, GLint level, GLsizei row);
+
+    /**
+     * \brief Hands a texture whose upload has completed back to the drawing context, deleting it if it
+     * was disposed meanwhile.
+     * \param texture The GL texture object.
+     */
+    void Finish(GLuint texture);
+
+    /**
+     * \brief Reserves a range of the ring, retiring fenced ranges that the GPU has finished with.
+     * \param size The size of the range in bytes.
+     * \param offset The offset of the reserved range within the ring.
+     * \return A boolean value indicating if the range could be reserved.
+     */
+    bool Allocate(size_t size, size_t& offset);
+
+    /**
+     * \brief Inserts a fence after the commands reading the ring ranges reserved since the last fence.
+     */
+    void Fence();
+
+    /**
+     * \brief Releases ranges of the ring whose fences have been signalled.
+     * \param wait Determines if the oldest range should be waited on when none have been signalled.
+     */
+    void Retire(bool wait);
+
+    /**
+     * \brief Gets the number of bytes in a row of pixels, or a row of 4x4 blocks, of a level.
+     * \param job The upload.
+     * \param level The level.
+     * \return The row size in bytes.
+     */
+    static size_t GetRowSize(const TextureUploadJob& job, GLint level);
+
+    /**
+     * \brief Gets the number of rows of pixels, or rows of 4x4 blocks, in a level.
+     * \param job The upload.
+     * \param level The level.
+     * \return The number of rows.
+     */
+    static GLsizei GetRowCount(const TextureUploadJob& job, GLint level);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static TextureUploader& Get() { return s_instance; }
+
+    static TextureUploader s_instance;
+};
+
+#endif // TEXTURE_UPLOADER_H
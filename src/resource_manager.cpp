@@ -3,14 +3,16 @@
  */
 
 #include "resource_manager.h"
+#include "io/async_file_reader.h"
+#include "rendering/texture_cache.h"
+#include "ubo.h"
 #include "utils/logging.h"
 #include "utils/profiling.h"
 
-#include "stb/stb_image.h"
-
-#include <fstream>
+#include <chrono>
 #include <iostream>
-#include <sstream>
+#include <utility>
+#include <vector>
 
 ResourceManager ResourceManager::s_instance;
 
@@ -25,21 +27,206 @@ Shader ResourceManager::LoadShader(const std::string& name, const std::string& v
 {
     DFM_PROFILE_FUNCTION();
 
-    Get().m_shaders[name] = LoadShaderFromFile(vertex_shader_path, fragment_shader_path);
-    return Get().m_shaders[name];
+    QueueShader(name, vertex_shader_path, fragment_shader_path);
+    return FinishShader(name);
+}
+
+/**
+ * \brief Loads and compiles a compute \code Shader, waiting for it to be linked.
+ * \param name The name used to identify the shader.
+ * \param path The path to the compute shader code.
+ * \param permutation The preprocessor definitions the shader is compiled with.
+ * \return The loaded shader.
+ */
+Shader ResourceManager::LoadComputeShader(const std::string& name, const std::string& path, const ShaderPermutation& permutation)
+{
+    DFM_PROFILE_FUNCTION();
+
+    std::string code;
+    if (!VirtualFileSystem::ReadTextFile(path, code))
+    {
+        DFM_CORE_ERROR("Failed to read shader file {0}.", path);
+    }
+
+    std::string compute_code;
+    PreprocessShader(path, code, permutation, compute_code);
+
+    Shader& shader = Get().m_shaders[name];
+    shader = Shader{};
+    shader.CompileCompute(compute_code);
+
+    return shader;
+}
+
+/**
+ * \brief Starts reading and compiling a \code Shader without waiting for it. Queued shaders are
+ * compiled together by the driver and handed out by \code PollShaders as each becomes ready.
+ * \param name The name used to identify the shader.
+ * \param vertex_shader_path The path to the vertex shader code.
+ * \param fragment_shader_path The path to the fragment shader code.
+ * \param permutation The preprocessor definitions the shader is compiled with.
+ * \param on_ready An optional function called with the shader once it has been linked.
+ */
+void ResourceManager::QueueShader(const std::string& name, const std::string& vertex_shader_path,
+                                  const std::string& fragment_shader_path, const ShaderPermutation& permutation,
+                                  std::function<void(const std::string&, Shader&)> on_ready)
+{
+    DFM_PROFILE_FUNCTION();
+
+    Get().m_shader_sources.insert_or_assign(name, ShaderSource{ vertex_shader_path, fragment_shader_path });
+
+    // Both stages are read at once, so the second read does not wait behind the first.
+    PendingShader pending{
+        vertex_shader_path,
+        fragment_shader_path,
+        permutation,
+        AsyncFileReader::Read(vertex_shader_path),
+        AsyncFileReader::Read(fragment_shader_path),
+        Shader{},
+        false,
+        std::move(on_ready)
+    };
+
+    Get().m_pending_shaders.insert_or_assign(name, std::move(pending));
+}
+
+/**
+ * \brief Submits queued shaders whose code has been read and finishes those that the driver has
+ * compiled, without blocking. This should be called once per frame.
+ * \return The number of shaders still being compiled.
+ */
+size_t ResourceManager::PollShaders()
+{
+    DFM_PROFILE_FUNCTION();
+
+    auto& pending_shaders = Get().m_pending_shaders;
+    std::vector<std::string> ready;
+
+    for (auto& [name, pending] : pending_shaders)
+    {
+        if (!pending.compiling &&
+            pending.vertex_shader_file.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready &&
+            pending.fragment_shader_file.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+        {
+            BeginShaderCompile(pending);
+        }
+
+        if (pending.compiling && pending.shader.IsCompileComplete())
+        {
+            ready.push_back(name);
+        }
+    }
+
+    for (const std::string& name : ready)
+    {
+        FinishShader(name);
+    }
+
+    return pending_shaders.size();
 }
 
 /**
- * \brief Gets a shader with the specified name.
+ * \brief Waits for every queued shader to be compiled.
+ */
+void ResourceManager::FinishShaders()
+{
+    DFM_PROFILE_FUNCTION();
+
+    auto& pending_shaders = Get().m_pending_shaders;
+
+    // Submit everything before waiting on anything, so the driver can compile them side by side.
+    for (auto& [_, pending] : pending_shaders)
+    {
+        if (!pending.compiling)
+        {
+            BeginShaderCompile(pending);
+        }
+    }
+
+    while (!pending_shaders.empty())
+    {
+        FinishShader(pending_shaders.begin()->first);
+    }
+}
+
+/**
+ * \brief Determines whether a shader has been compiled and can be used without waiting.
+ * \param name The name used to identify the shader.
+ * \return A boolean value indicating if the shader is ready.
+ */
+bool ResourceManager::IsShaderReady(const std::string& name)
+{
+    return Get().m_pending_shaders.count(name) == 0 && Get().m_shaders.count(name) != 0;
+}
+
+/**
+ * \brief Gets a shader with the specified name, waiting for it to be compiled if it is queued.
  * \param name The name used to identify the shader.
  * \return The retrieved shader.
  */
 Shader& ResourceManager::GetShader(const std::string& name)
 {
     DFM_PROFILE_FUNCTION();
+
+    if (Get().m_pending_shaders.count(name) != 0)
+    {
+        return FinishShader(name);
+    }
+
     return Get().m_shaders[name];
 }
 
+/**
+ * \brief Gets the variant of a shader compiled with the given preprocessor definitions. Each variant
+ * is compiled the first time it is requested, and the shader's default variant is returned until
+ * it is ready, so requesting a variant never blocks once the default variant has been compiled.
+ * \param name The name used to identify the shader.
+ * \param permutation The preprocessor definitions selecting the variant.
+ * \return The variant, or the default variant if it is not ready.
+ */
+Shader& ResourceManager::GetShaderVariant(const std::string& name, const ShaderPermutation& permutation)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (permutation.IsEmpty())
+    {
+        return GetShader(name);
+    }
+
+    auto& instance = Get();
+    const std::string variant_name = GetVariantName(name, permutation);
+
+    if (instance.m_pending_shaders.count(variant_name) != 0)
+    {
+        return GetShader(name);
+    }
+
+    // A variant that failed to compile is kept, so it is not compiled again, but never handed out.
+    if (const auto search = instance.m_shaders.find(variant_name); search != instance.m_shaders.end())
+    {
+        return search->second.IsCompiled() ? search->second : GetShader(name);
+    }
+
+    const auto source = instance.m_shader_sources.find(name);
+    if (source == instance.m_shader_sources.end())
+    {
+        DFM_CORE_ERROR("Failed to compile variant {0} of unknown shader {1}.", permutation.GetKey(), name);
+        return GetShader(name);
+    }
+
+    // Variants are compiled after the UBOs have been created, so they bind to them once linked.
+    QueueShader(variant_name, source->second.vertex_shader_path, source->second.fragment_shader_path, permutation,
+                [](const std::string&, Shader& shader)
+                {
+                    if (shader.IsCompiled())
+                    {
+                        UboManager::BindShaderBlocks(shader);
+                    }
+                });
+
+    return GetShader(name);
+}
+
 /**
  * \brief Loads and gets a \code Texture2D at a particular path.
  * \param name The name used to identify the texture.
@@ -52,8 +239,16 @@ Texture2D ResourceManager::LoadTexture(const std::string& name, const std::strin
 {
     DFM_PROFILE_FUNCTION();
 
-    Get().m_textures[name] = LoadTextureFromFile(path, alpha, flip_on_load);
-    return Get().m_textures[name];
+    const Texture2D texture = LoadTextureFromFile(path, alpha, flip_on_load);
+
+    // The texture is acquired before the one it replaces is released, so reloading the same file keeps it uploaded.
+    if (auto search = Get().m_textures.find(name); search != Get().m_textures.end() && search->second.GetId() != 0)
+    {
+        TextureCache::Release(search->second);
+    }
+
+    Get().m_textures[name] = texture;
+    return texture;
 }
 
 /**
@@ -68,48 +263,77 @@ Texture2D ResourceManager::GetTexture(const std::string& name)
 }
 
 /**
- * \brief Loads and returns a \code Shader object using the specified paths.
- * \param vertex_shader_path The path to the vertex shader code.
- * \param fragment_shader_path The path to the fragment shader code.
- * \return The loaded shader.
+ * \brief Submits a pending shader's code to the driver, waiting for the code to be read if needed.
+ * \param pending The pending shader.
  */
-Shader ResourceManager::LoadShaderFromFile(const std::string& vertex_shader_path, const std::string& fragment_shader_path)
+void ResourceManager::BeginShaderCompile(PendingShader& pending)
 {
     DFM_PROFILE_FUNCTION();
 
-    std::string vertex_code, fragment_code;
-    std::ifstream vertex_shader_file, fragment_shader_file;
-
-    vertex_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragment_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    const FileView vertex_shader = pending.vertex_shader_file.get();
+    const FileView fragment_shader = pending.fragment_shader_file.get();
 
-    try
+    if (!vertex_shader.IsValid() || !fragment_shader.IsValid())
     {
-        vertex_shader_file.open(vertex_shader_path);
-        fragment_shader_file.open(fragment_shader_path);
+        DFM_CORE_ERROR("Failed to read shader file.");
+    }
 
-        std::stringstream vertex_shader_stream, fragment_shader_stream;
+    std::string vertex_code;
+    std::string fragment_code;
 
-        vertex_shader_stream << vertex_shader_file.rdbuf();
-        fragment_shader_stream << fragment_shader_file.rdbuf();
+    PreprocessShader(pending.vertex_shader_path,
+                     { reinterpret_cast<const char*>(vertex_shader.GetData()), vertex_shader.GetSize() },
+                     pending.permutation, vertex_code);
+    PreprocessShader(pending.fragment_shader_path,
+                     { reinterpret_cast<const char*>(fragment_shader.GetData()), fragment_shader.GetSize() },
+                     pending.permutation, fragment_code);
 
-        vertex_shader_file.close();
-        fragment_shader_file.close();
+    pending.shader.BeginCompile(vertex_code, fragment_code);
+    pending.compiling = true;
+}
 
-        vertex_code = vertex_shader_stream.str();
-        fragment_code = fragment_shader_stream.str();
-    }
-    catch (std::ifstream::failure& e)
+/**
+ * \brief Finishes compiling a pending shader and makes it available by name.
+ * \param name The name used to identify the shader.
+ * \return The compiled shader.
+ */
+Shader& ResourceManager::FinishShader(const std::string& name)
+{
+    DFM_PROFILE_FUNCTION();
+
+    auto search = Get().m_pending_shaders.find(name);
+    PendingShader pending = std::move(search->second);
+    Get().m_pending_shaders.erase(search);
+
+    if (!pending.compiling)
     {
-        DFM_CORE_ERROR("Failed to read shader file.");
+        BeginShaderCompile(pending);
     }
 
-    Shader shader{};
-    shader.Compile(vertex_code, fragment_code);
+    pending.shader.FinishCompile();
+
+    Shader& shader = Get().m_shaders[name];
+    shader = pending.shader;
+
+    if (pending.on_ready)
+    {
+        pending.on_ready(name, shader);
+    }
 
     return shader;
 }
 
+/**
+ * \brief Gets the name a shader variant is stored under.
+ * \param name The name used to identify the shader.
+ * \param permutation The preprocessor definitions selecting the variant.
+ * \return The name of the variant.
+ */
+std::string ResourceManager::GetVariantName(const std::string& name, const ShaderPermutation& permutation)
+{
+    return permutation.IsEmpty() ? name : name + '[' + permutation.GetKey() + ']';
+}
+
 /**
  * \brief Loads and returns a \code Texture2D object using the specified path.
  * \param path The path to the texture.
@@ -121,27 +345,13 @@ Texture2D ResourceManager::LoadTextureFromFile(const std::string& path, const bo
 {
     DFM_PROFILE_FUNCTION();
 
-    Texture2D texture;
-
-    if (alpha)
-    {
-        texture.EnableAlpha(true);
-    }
-
-    if (flip_on_load)
-    {
-        stbi_set_flip_vertically_on_load(flip_on_load);
-    }
-
-    int width, height, no_channels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &no_channels, 0);
+    // The texture cache uploads each file once for these options. Models stream their textures, and only draw
+    // with this one when they use the same file, or identical contents, with the same options.
+    TextureOptions options;
+    options.desired_channels = alpha ? 4 : 3;
+    options.flip_on_load = flip_on_load;
+    options.filter_min = GL_LINEAR;
+    options.filter_mag = GL_LINEAR;
 
-    texture.Generate(width, height, data);
-
-    stbi_image_free(data);
-
-    // Disable flipping vertically on load after texture has been loaded.
-    stbi_set_flip_vertically_on_load(false);
-
-    return texture;
+    return TextureCache::Acquire(path, options);
 }
\ No newline at end of file
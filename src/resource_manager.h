@@ -5,9 +5,14 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
+#include "io/virtual_file_system.h"
 #include "rendering/shader.h"
+#include "rendering/shader_preprocessor.h"
 #include "rendering/texture2d.h"
 
+#include <functional>
+#include <future>
+#include <string>
 #include <unordered_map>
 
 /**
@@ -26,12 +31,63 @@ public:
     static Shader LoadShader(const std::string& name, const std::string& vertex_shader_path, const std::string& fragment_shader_path);
 
     /**
-     * \brief Gets a shader with the specified name.
+     * \brief Loads and compiles a compute \code Shader, waiting for it to be linked.
+     * \param name The name used to identify the shader.
+     * \param path The path to the compute shader code.
+     * \param permutation The preprocessor definitions the shader is compiled with.
+     * \return The loaded shader.
+     */
+    static Shader LoadComputeShader(const std::string& name, const std::string& path, const ShaderPermutation& permutation = {});
+
+    /**
+     * \brief Starts reading and compiling a \code Shader without waiting for it. Queued shaders are
+     * compiled together by the driver and handed out by \code PollShaders as each becomes ready.
+     * \param name The name used to identify the shader.
+     * \param vertex_shader_path The path to the vertex shader code.
+     * \param fragment_shader_path The path to the fragment shader code.
+     * \param permutation The preprocessor definitions the shader is compiled with.
+     * \param on_ready An optional function called with the shader once it has been linked.
+     */
+    static void QueueShader(const std::string& name, const std::string& vertex_shader_path,
+                            const std::string& fragment_shader_path, const ShaderPermutation& permutation = {},
+                            std::function<void(const std::string&, Shader&)> on_ready = {});
+
+    /**
+     * \brief Submits queued shaders whose code has been read and finishes those that the driver has
+     * compiled, without blocking. This should be called once per frame.
+     * \return The number of shaders still being compiled.
+     */
+    static size_t PollShaders();
+
+    /**
+     * \brief Waits for every queued shader to be compiled.
+     */
+    static void FinishShaders();
+
+    /**
+     * \brief Determines whether a shader has been compiled and can be used without waiting.
+     * \param name The name used to identify the shader.
+     * \return A boolean value indicating if the shader is ready.
+     */
+    [[nodiscard]] static bool IsShaderReady(const std::string& name);
+
+    /**
+     * \brief Gets a shader with the specified name, waiting for it to be compiled if it is queued.
      * \param name The name used to identify the shader.
      * \return The retrieved shader.
      */
     static Shader& GetShader(const std::string& name);
 
+    /**
+     * \brief Gets the variant of a shader compiled with the given preprocessor definitions. Each variant
+     * is compiled the first time it is requested, and the shader's default variant is returned until
+     * it is ready, so requesting a variant never blocks once the default variant has been compiled.
+     * \param name The name used to identify the shader.
+     * \param permutation The preprocessor definitions selecting the variant.
+     * \return The variant, or the default variant if it is not ready.
+     */
+    static Shader& GetShaderVariant(const std::string& name, const ShaderPermutation& permutation);
+
     /**
      * \brief Loads and gets a \code Texture2D at a particular path.
      * \param name The name used to identify the texture.
@@ -50,18 +106,57 @@ public:
     static Texture2D GetTexture(const std::string& name);
 
 private:
+    /**
+     * \brief Represents a shader whose code is being read or compiled.
+     */
+    struct PendingShader
+    {
+        std::string vertex_shader_path;
+        std::string fragment_shader_path;
+        ShaderPermutation permutation;
+        std::future<FileView> vertex_shader_file;
+        std::future<FileView> fragment_shader_file;
+        Shader shader;
+        bool compiling;
+        std::function<void(const std::string&, Shader&)> on_ready;
+    };
+
+    /**
+     * \brief Represents the files a shader is built from, so that more variants can be compiled later.
+     */
+    struct ShaderSource
+    {
+        std::string vertex_shader_path;
+        std::string fragment_shader_path;
+    };
+
     std::unordered_map<std::string, Shader> m_shaders;
+    std::unordered_map<std::string, ShaderSource> m_shader_sources;
+    std::unordered_map<std::string, PendingShader> m_pending_shaders;
     std::unordered_map<std::string, Texture2D> m_textures;
 
     ResourceManager() = default;
 
     /**
-     * \brief Loads and returns a \code Shader object using the specified paths.
-     * \param vertex_shader_path The path to the vertex shader code.
-     * \param fragment_shader_path The path to the fragment shader code.
-     * \return The loaded shader.
+     * \brief Submits a pending shader's code to the driver, waiting for the code to be read if needed.
+     * \param pending The pending shader.
+     */
+    static void BeginShaderCompile(PendingShader& pending);
+
+    /**
+     * \brief Finishes compiling a pending shader and makes it available by name.
+     * \param name The name used to identify the shader.
+     * \return The compiled shader.
+     */
+    static Shader& FinishShader(const std::string& name);
+
+    /**
+     * \brief Gets the name a shader variant is stored under.
+     * \param name The name used to identify the shader.
+     * \param permutation The preprocessor definitions selecting the variant.
+     * \return The name of the variant.
      */
-    static Shader LoadShaderFromFile(const std::string& vertex_shader_path, const std::string& fragment_shader_path);
+    [[nodiscard]] static std::string GetVariantName(const std::string& name, const ShaderPermutation& permutation);
 
     /**
      * \brief Loads and returns a \code Texture2D object using the specified path.
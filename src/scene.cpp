@@ -13,7 +13,15 @@
 #include "utils/profiling.h"
 
 Scene::Scene()
+    : m_depth_pre_pass{ false },
+    m_render_path{ RenderPath::Forward },
+    m_render_snapshot{ nullptr },
+    m_interpolation{ 1.0f }
 {
+    // Groups take ownership of their components' storage, so they are created before any entity.
+    GetRenderables();
+    GetLights();
+
     m_system_manager.RegisterSystem<RenderingSystem>(this);
     m_system_manager.RegisterSystem<LightingSystem>(this);
 }
@@ -25,31 +33,39 @@ Scene::~Scene()
 }
 
 /**
- * \brief Updates the scene using the given delta time.
- * \param dt The delta time.
+ * \brief Advances the simulation by one fixed step. The transforms are kept as the previous state
+ * first, so the systems of the simulation phases and any other changes made during the step move
+ * entities away from it.
+ * \param step The length of the step in seconds.
  */
-void Scene::Update(const double dt)
+void Scene::FixedUpdate(const double step)
 {
     DFM_PROFILE_FUNCTION();
 
-    m_system_manager.Update(dt);
+    m_registry.view<const TransformComponent, PreviousTransformComponent>().each(
+        [](const TransformComponent& transform, PreviousTransformComponent& previous)
+    {
+        previous = { transform.position, transform.rotation, transform.scale };
+    });
+
+    m_system_manager.Update(step, SystemPhase::PreUpdate, SystemPhase::Update);
 }
 
 /**
- * \brief Updates the given type of light sources within the scene via the lighting system.
- * \param update_type The type of light source to update.
+ * \brief Copies the state needed to draw the scene into a render snapshot, by running the systems of
+ * the render phases. Entities are drawn between their previous and current transforms.
+ * \param dt The real time since the previous frame in seconds.
+ * \param interpolation How far the frame is between the last two simulated states, from 0 to 1.
+ * \param snapshot The render snapshot to write, which must have been cleared.
  */
-void Scene::UpdateLightSources(const LightUpdateType update_type)
+void Scene::Extract(const double dt, const float interpolation, RenderSnapshot& snapshot)
 {
-    try
-    {
-        auto& lighting_system = m_system_manager.GetSystem<LightingSystem>();
-        lighting_system.UpdateLightSources(update_type);
-    }
-    catch (std::out_of_range& e)
-    {
-        DFM_CORE_ERROR("{0}", e.what());
-    }
+    DFM_PROFILE_FUNCTION();
+
+    m_render_snapshot = &snapshot;
+    m_interpolation = interpolation;
+    m_system_manager.Update(dt, SystemPhase::PreRender, SystemPhase::Render);
+    m_render_snapshot = nullptr;
 }
 
 /**
@@ -69,6 +85,7 @@ Entity Scene::CreateEntity(const std::string& name)
     position = { 0.0f, 0.0f, 0.0f };
     rotation = { 0.0f, 0.0f, 0.0f };
     scale = { 1.0f, 1.0f, 1.0f };
+    entity.AddComponent<PreviousTransformComponent>(PreviousTransformComponent{ position, rotation, scale });
 
     return entity;
 }
@@ -83,4 +100,50 @@ void Scene::DestroyEntity(Entity& entity)
 
     m_registry.destroy(entity.GetHandle());
     entity.Destroy();
+}
+
+/**
+ * \brief Enables or disables the depth-only pass that runs before the scene is shaded, which saves
+ * shading fragments that end up hidden behind others at the cost of drawing the scene twice.
+ * \param enabled Determines if the depth pre-pass is used.
+ */
+void Scene::SetDepthPrePassEnabled(const bool enabled)
+{
+    m_depth_pre_pass = enabled;
+}
+
+/**
+ * \brief Determines whether the scene is rendered with a depth pre-pass.
+ * \return A boolean value indicating if the depth pre-pass is used.
+ */
+bool Scene::IsDepthPrePassEnabled() const
+{
+    return m_depth_pre_pass;
+}
+
+/**
+ * \brief Sets the way the scene is rendered, which can be changed between any two frames.
+ * \param render_path The render path.
+ */
+void Scene::SetRenderPath(const RenderPath render_path)
+{
+    m_render_path = render_path;
+}
+
+/**
+ * \brief Gets the way the scene is rendered.
+ * \return The render path.
+ */
+RenderPath Scene::GetRenderPath() const
+{
+    return m_render_path;
+}
+
+/**
+ * \brief Gets how long each of the scene's systems took to update.
+ * \return The timings of the systems, in the order they are scheduled.
+ */
+std::vector<SystemTiming> Scene::GetSystemTimings() const
+{
+    return m_system_manager.GetTimings();
 }
\ No newline at end of file
@@ -5,15 +5,25 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include "ecs/components.h"
 #include "ecs/system_manager.h"
 
+#include "rendering/render_snapshot.h"
+
+#include "utils/job_system.h"
+
 #include "entt/entity/registry.hpp"
 
 #include <string>
+#include <vector>
 
-enum class LightUpdateType;
 class Entity;
 
+/**
+ * \brief The default number of entities handed to one job by \code Scene::ParallelEach.
+ */
+constexpr size_t DEFAULT_PARALLEL_EACH_GRAIN = 256;
+
 /**
  * \brief Represents a game scene used to manage currently existing entities.
  */
@@ -30,16 +40,21 @@ public:
     Scene& operator=(Scene&&) noexcept = default;
 
     /**
-     * \brief Updates the scene using the given delta time.
-     * \param dt The delta time.
+     * \brief Advances the simulation by one fixed step. The transforms are kept as the previous state
+     * first, so the systems of the simulation phases and any other changes made during the step move
+     * entities away from it.
+     * \param step The length of the step in seconds.
      */
-    void Update(double dt);
+    void FixedUpdate(double step);
 
     /**
-     * \brief Updates the given type of light sources within the scene via the lighting system.
-     * \param update_type The type of light source to update.
+     * \brief Copies the state needed to draw the scene into a render snapshot, by running the systems of
+     * the render phases. Entities are drawn between their previous and current transforms.
+     * \param dt The real time since the previous frame in seconds.
+     * \param interpolation How far the frame is between the last two simulated states, from 0 to 1.
+     * \param snapshot The render snapshot to write, which must have been cleared.
      */
-    void UpdateLightSources(LightUpdateType update_type);
+    void Extract(double dt, float interpolation, RenderSnapshot& snapshot);
 
     /**
      * \brief Creates an entity in the scene with the given name and returns a copy.
@@ -54,9 +69,132 @@ public:
      */
     void DestroyEntity(Entity& entity);
 
+    /**
+     * \brief Enables or disables the depth-only pass that runs before the scene is shaded, which saves
+     * shading fragments that end up hidden behind others at the cost of drawing the scene twice.
+     * \param enabled Determines if the depth pre-pass is used.
+     */
+    void SetDepthPrePassEnabled(bool enabled);
+
+    /**
+     * \brief Determines whether the scene is rendered with a depth pre-pass.
+     * \return A boolean value indicating if the depth pre-pass is used.
+     */
+    [[nodiscard]] bool IsDepthPrePassEnabled() const;
+
+    /**
+     * \brief Sets the way the scene is rendered, which can be changed between any two frames.
+     * \param render_path The render path.
+     */
+    void SetRenderPath(RenderPath render_path);
+
+    /**
+     * \brief Gets the way the scene is rendered.
+     * \return The render path.
+     */
+    [[nodiscard]] RenderPath GetRenderPath() const;
+
+    /**
+     * \brief Calls a function for every entity with the given components, splitting the entities into
+     * contiguous chunks that run on the job system's workers, and waits for them all. The function may
+     * write the components it is given, but must not add or remove components or entities; results are
+     * best emitted through a \code ThreadScratch.
+     * \tparam Components The types of the components.
+     * \tparam F The type of the function, which is called with the entity and a reference to each component.
+     * \param function The function.
+     * \param grain The largest number of entities handed to one job.
+     */
+    template <typename... Components, typename F>
+    void ParallelEach(F&& function, const size_t grain = DEFAULT_PARALLEL_EACH_GRAIN)
+    {
+        const auto view = m_registry.view<Components...>();
+
+        // A view with several components is filtered while it is iterated, so its entities are gathered
+        // before they can be split into chunks.
+        std::vector<entt::entity> entities;
+        entities.reserve(view.size_hint());
+
+        for (const auto entity : view)
+        {
+            entities.push_back(entity);
+        }
+
+        JobSystem::ParallelForRange(entities.size(), grain, [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                function(entities[i], view.template get<Components>(entities[i])...);
+            }
+        });
+    }
+
+    /**
+     * \brief Calls a function for every entity of a group, splitting the group's packed entities into
+     * contiguous chunks that run on the job system's workers, and waits for them all. Unlike a view, a
+     * group's entities can be split without gathering them first.
+     * \tparam Components The types of the components passed to the function, which the group must have.
+     * \tparam Group The type of the group.
+     * \tparam F The type of the function, which is called with the entity and a reference to each component.
+     * \param group The group.
+     * \param function The function.
+     * \param grain The largest number of entities handed to one job.
+     */
+    template <typename... Components, typename Group, typename F>
+    static void ParallelEachIn(const Group& group, F&& function, const size_t grain = DEFAULT_PARALLEL_EACH_GRAIN)
+    {
+        const entt::entity* entities = group.data();
+
+        JobSystem::ParallelForRange(group.size(), grain, [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                function(entities[i], group.template get<Components>(entities[i])...);
+            }
+        });
+    }
+
+    /**
+     * \brief Gets how long each of the scene's systems took to update.
+     * \return The timings of the systems, in the order they are scheduled.
+     */
+    [[nodiscard]] std::vector<SystemTiming> GetSystemTimings() const;
+
 private:
     entt::registry m_registry;
+
+    /**
+     * \brief Gets the group that owns the components of drawn entities. Their transforms, meshes and shaders
+     * are packed in the same order, so iterating the group reads each array linearly.
+     * \return The group of renderable entities.
+     */
+    auto GetRenderables()
+    {
+        return m_registry.group<TransformComponent, PreviousTransformComponent, MeshComponent, ShaderComponent>();
+    }
+
+    /**
+     * \brief Gets the group that owns the light components. Transforms are owned by the renderables, so
+     * lights' transforms and IDs are looked up rather than packed alongside.
+     * \return The group of lights.
+     */
+    auto GetLights()
+    {
+        return m_registry.group<LightComponent>(entt::get<TransformComponent, PreviousTransformComponent, IdComponent>);
+    }
+
     SystemManager m_system_manager;
+    bool m_depth_pre_pass;
+    RenderPath m_render_path;
+
+    /**
+     * \brief The render snapshot written by the systems during \code Extract.
+     */
+    RenderSnapshot* m_render_snapshot;
+
+    /**
+     * \brief How far the snapshot being written is between the last two simulated states.
+     */
+    float m_interpolation;
 
     friend class Entity;
     friend class RenderingSystem;
@@ -3,6 +3,7 @@
  */
 
 #include "ubo.h"
+#include "utils/gl_state.h"
 #include "utils/profiling.h"
 
 unsigned int Ubo::s_binding_point = 0;
@@ -41,6 +42,10 @@ void Ubo::BindShaderBlock(const Shader& shader)
 
     const GLint shader_id = shader.GetId();
     const unsigned int uniform_block_index = glGetUniformBlockIndex(shader_id, m_block_name.c_str());
+
+    // The block may have been compiled out of this shader.
+    if (uniform_block_index == GL_INVALID_INDEX) return;
+
     glUniformBlockBinding(shader_id, uniform_block_index, m_binding_point);
 
     m_binded_shader_ids.push_back(shader_id);
@@ -53,13 +58,10 @@ void Ubo::Create()
 {
     DFM_PROFILE_FUNCTION();
 
-    glGenBuffers(1, &m_id);
-
-    Bind();
-    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_size), nullptr, GL_STATIC_DRAW);
-    Unbind();
+    glCreateBuffers(1, &m_id);
+    glNamedBufferStorage(m_id, static_cast<GLsizeiptr>(m_size), nullptr, GL_DYNAMIC_STORAGE_BIT);
 
-    glBindBufferRange(GL_UNIFORM_BUFFER, m_binding_point, m_id, 0, m_size);
+    GlState::BindBufferRange(GL_UNIFORM_BUFFER, m_binding_point, m_id, 0, static_cast<GLsizeiptr>(m_size));
 }
 
 /**
@@ -72,9 +74,7 @@ void Ubo::SetSubData(const unsigned int offset, const size_t size, const void* d
 {
     DFM_PROFILE_FUNCTION();
 
-    Bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, offset, static_cast<GLsizeiptr>(size), data);
-    Unbind();
+    glNamedBufferSubData(m_id, offset, static_cast<GLsizeiptr>(size), data);
 }
 
 /**
@@ -86,24 +86,6 @@ unsigned int Ubo::GetId() const
     return m_id;
 }
 
-/**
- * \brief Binds the UBO object.
- */
-void Ubo::Bind() const
-{
-    DFM_PROFILE_FUNCTION();
-    glBindBuffer(GL_UNIFORM_BUFFER, m_id);
-}
-
-/**
- * \brief Unbinds the UBO object.
- */
-void Ubo::Unbind()
-{
-    DFM_PROFILE_FUNCTION();
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-}
-
 UboManager UboManager::s_instance;
 
 /**
@@ -126,4 +108,19 @@ Ubo& UboManager::Retrieve(const std::string& name)
 {
     DFM_PROFILE_FUNCTION();
     return Get().m_registered_ubos[name];
+}
+
+/**
+ * \brief Binds every registered UBO to the given shader, such as a shader variant compiled after
+ * the UBOs were created. Blocks that the shader does not declare are skipped.
+ * \param shader The shader to be bound with the UBOs.
+ */
+void UboManager::BindShaderBlocks(const Shader& shader)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (auto& [_, ubo] : Get().m_registered_ubos)
+    {
+        ubo.BindShaderBlock(shader);
+    }
 }
\ No newline at end of file
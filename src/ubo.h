@@ -60,16 +60,6 @@ private:
     unsigned int m_binding_point;
     size_t m_size;
 
-    /**
-     * \brief Binds the UBO object.
-     */
-    void Bind() const;
-
-    /**
-     * \brief Unbinds the UBO object.
-     */
-    static void Unbind();
-
     static unsigned int s_binding_point;
 };
 
@@ -93,6 +83,13 @@ public:
      */
     [[nodiscard]] static Ubo& Retrieve(const std::string& name);
 
+    /**
+     * \brief Binds every registered UBO to the given shader, such as a shader variant compiled after
+     * the UBOs were created. Blocks that the shader does not declare are skipped.
+     * \param shader The shader to be bound with the UBOs.
+     */
+    static void BindShaderBlocks(const Shader& shader);
+
 private:
     std::unordered_map<std::string, Ubo> m_registered_ubos;
 
@@ -0,0 +1,161 @@
+/**
+ * \file frame_clock.cpp
+ */
+
+#include "frame_clock.h"
+#include "utils/profiling.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \brief Adds a frame to the histogram.
+ * \param milliseconds The time the frame took, in milliseconds.
+ */
+void FrameTimeHistogram::Add(const double milliseconds)
+{
+    const auto bucket = static_cast<size_t>(std::max(milliseconds, 0.0));
+    buckets[std::min(bucket, FRAME_HISTOGRAM_BUCKETS - 1)]++;
+    count++;
+}
+
+/**
+ * \brief Gets the time that the given fraction of frames took at most, to the nearest millisecond
+ * above. Frames in the last bucket are reported as taking its lower bound.
+ * \param percentile The fraction of frames, between 0 and 1.
+ * \return The time in milliseconds, or zero if no frames have been added.
+ */
+double FrameTimeHistogram::GetPercentile(const double percentile) const
+{
+    if (count == 0) return 0.0;
+
+    const auto target = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 1.0) * static_cast<double>(count)));
+    uint64_t counted = 0;
+
+    for (size_t i = 0; i < FRAME_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        counted += buckets[i];
+
+        if (counted >= target && counted > 0)
+        {
+            return static_cast<double>(i + 1);
+        }
+    }
+
+    return static_cast<double>(FRAME_HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * \brief Creates a clock, which starts at the first call to \code Tick.
+ * \param fixed_step The length of a fixed simulation step, in seconds.
+ * \param max_steps_per_frame The largest number of steps simulated in one frame. Time beyond it is
+ * dropped, so a slow frame does not make the next one slower still.
+ */
+FrameClock::FrameClock(const double fixed_step, const uint32_t max_steps_per_frame)
+    : m_fixed_step{ fixed_step },
+    m_max_steps_per_frame{ std::max(max_steps_per_frame, 1u) },
+    m_started{ false },
+    m_delta_time{ 0.0 },
+    m_accumulator{ 0.0 },
+    m_simulation_time{ 0.0 },
+    m_statistics{}
+{
+}
+
+/**
+ * \brief Starts a frame, measuring the time since the previous one and adding it to the time left to
+ * simulate.
+ */
+void FrameClock::Tick()
+{
+    DFM_PROFILE_FUNCTION();
+
+    const auto now = std::chrono::steady_clock::now();
+
+    if (m_started)
+    {
+        m_delta_time = std::chrono::duration<double>(now - m_last_tick).count();
+        m_accumulator += m_delta_time;
+    }
+    else
+    {
+        // The first frame simulates one step, so that there are two states to interpolate between.
+        m_started = true;
+        m_delta_time = 0.0;
+        m_accumulator = m_fixed_step;
+    }
+
+    m_last_tick = now;
+    m_statistics.frames++;
+
+    // Catching up on every step after a long frame would make the next frame longer still, so the
+    // simulation falls behind real time instead.
+    const double max_accumulator = m_fixed_step * m_max_steps_per_frame;
+
+    if (m_accumulator > max_accumulator)
+    {
+        m_statistics.dropped_steps += static_cast<uint64_t>((m_accumulator - max_accumulator) / m_fixed_step);
+        m_accumulator = max_accumulator;
+    }
+}
+
+/**
+ * \brief Takes a fixed step from the time left to simulate, if a whole step is left. Called in a loop
+ * after \code Tick, with the simulation advanced by one step each time it returns true.
+ * \return A boolean value indicating if a step was taken.
+ */
+bool FrameClock::Step()
+{
+    if (m_accumulator < m_fixed_step) return false;
+
+    m_accumulator -= m_fixed_step;
+    m_simulation_time += m_fixed_step;
+    m_statistics.fixed_steps++;
+
+    return true;
+}
+
+/**
+ * \brief Gets the real time between the last two frames.
+ * \return The delta time in seconds.
+ */
+double FrameClock::GetDeltaTime() const
+{
+    return m_delta_time;
+}
+
+/**
+ * \brief Gets the length of a fixed simulation step.
+ * \return The fixed step in seconds.
+ */
+double FrameClock::GetFixedStep() const
+{
+    return m_fixed_step;
+}
+
+/**
+ * \brief Gets the total time simulated by the steps taken.
+ * \return The simulated time in seconds.
+ */
+double FrameClock::GetSimulationTime() const
+{
+    return m_simulation_time;
+}
+
+/**
+ * \brief Gets how far the frame is between the last two simulated states, as a fraction of a step.
+ * \return The interpolation factor, from 0 up to but excluding 1.
+ */
+float FrameClock::GetInterpolation() const
+{
+    return static_cast<float>(std::min(m_accumulator / m_fixed_step, 1.0));
+}
+
+/**
+ * \brief Gets the steps taken by the clock.
+ * \return The frame clock statistics.
+ */
+FrameClockStatistics FrameClock::GetStatistics() const
+{
+    return m_statistics;
+}
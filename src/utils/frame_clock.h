@@ -0,0 +1,147 @@
+/**
+ * \file frame_clock.h
+ */
+
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief The default length of a fixed simulation step, in seconds.
+ */
+constexpr double DEFAULT_FIXED_STEP = 1.0 / 60.0;
+
+/**
+ * \brief The default largest number of fixed steps simulated in one frame.
+ */
+constexpr uint32_t DEFAULT_MAX_STEPS_PER_FRAME = 5;
+
+/**
+ * \brief The number of buckets in a frame time histogram, each one millisecond wide. The last bucket
+ * also counts every longer frame.
+ */
+constexpr size_t FRAME_HISTOGRAM_BUCKETS = 64;
+
+/**
+ * \brief A histogram of frame times in one millisecond buckets.
+ */
+struct FrameTimeHistogram
+{
+    std::array<uint32_t, FRAME_HISTOGRAM_BUCKETS> buckets{};
+
+    /**
+     * \brief The number of frames added.
+     */
+    uint64_t count{};
+
+    /**
+     * \brief Adds a frame to the histogram.
+     * \param milliseconds The time the frame took, in milliseconds.
+     */
+    void Add(double milliseconds);
+
+    /**
+     * \brief Gets the time that the given fraction of frames took at most, to the nearest millisecond
+     * above. Frames in the last bucket are reported as taking its lower bound.
+     * \param percentile The fraction of frames, between 0 and 1.
+     * \return The time in milliseconds, or zero if no frames have been added.
+     */
+    [[nodiscard]] double GetPercentile(double percentile) const;
+};
+
+/**
+ * \brief Represents the steps taken by a frame clock.
+ */
+struct FrameClockStatistics
+{
+    uint64_t frames;
+    uint64_t fixed_steps;
+
+    /**
+     * \brief The number of steps skipped because a frame fell too far behind, which slows the simulation
+     * down rather than letting it fall further behind.
+     */
+    uint64_t dropped_steps;
+};
+
+/**
+ * \brief Measures the real time between frames and divides it into fixed simulation steps, so that the
+ * simulation advances at the same rate whatever the frame rate. Time that does not make up a whole step
+ * is carried over to the next frame, and the fraction of a step it represents is used to interpolate
+ * between the last two simulated states when drawing.
+ */
+class FrameClock
+{
+public:
+    /**
+     * \brief Creates a clock, which starts at the first call to \code Tick.
+     * \param fixed_step The length of a fixed simulation step, in seconds.
+     * \param max_steps_per_frame The largest number of steps simulated in one frame. Time beyond it is
+     * dropped, so a slow frame does not make the next one slower still.
+     */
+    explicit FrameClock(double fixed_step = DEFAULT_FIXED_STEP, uint32_t max_steps_per_frame = DEFAULT_MAX_STEPS_PER_FRAME);
+
+    /**
+     * \brief Starts a frame, measuring the time since the previous one and adding it to the time left to
+     * simulate.
+     */
+    void Tick();
+
+    /**
+     * \brief Takes a fixed step from the time left to simulate, if a whole step is left. Called in a loop
+     * after \code Tick, with the simulation advanced by one step each time it returns true.
+     * \return A boolean value indicating if a step was taken.
+     */
+    bool Step();
+
+    /**
+     * \brief Gets the real time between the last two frames.
+     * \return The delta time in seconds.
+     */
+    [[nodiscard]] double GetDeltaTime() const;
+
+    /**
+     * \brief Gets the length of a fixed simulation step.
+     * \return The fixed step in seconds.
+     */
+    [[nodiscard]] double GetFixedStep() const;
+
+    /**
+     * \brief Gets the total time simulated by the steps taken.
+     * \return The simulated time in seconds.
+     */
+    [[nodiscard]] double GetSimulationTime() const;
+
+    /**
+     * \brief Gets how far the frame is between the last two simulated states, as a fraction of a step.
+     * \return The interpolation factor, from 0 up to but excluding 1.
+     */
+    [[nodiscard]] float GetInterpolation() const;
+
+    /**
+     * \brief Gets the steps taken by the clock.
+     * \return The frame clock statistics.
+     */
+    [[nodiscard]] FrameClockStatistics GetStatistics() const;
+
+private:
+    double m_fixed_step;
+    uint32_t m_max_steps_per_frame;
+    std::chrono::steady_clock::time_point m_last_tick;
+    bool m_started;
+    double m_delta_time;
+
+    /**
+     * \brief The real time not yet simulated, in seconds.
+     */
+    double m_accumulator;
+
+    double m_simulation_time;
+    FrameClockStatistics m_statistics;
+};
+
+#endif // FRAME_CLOCK_H
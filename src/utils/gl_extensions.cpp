@@ -0,0 +1,111 @@
+/**
+ * \file gl_extensions.cpp
+ */
+
+#include "utils/gl_extensions.h"
+#include "utils/logging.h"
+#include "utils/profiling.h"
+
+GlExtensions GlExtensions::s_instance;
+
+/**
+ * \brief Reads the extensions supported by the current context and loads their entry points.
+ * Must be called after GLAD is loaded.
+ * \param load_proc The function used to look up GL entry points.
+ */
+void GlExtensions::Initialise(const GLADloadproc load_proc)
+{
+    DFM_PROFILE_FUNCTION();
+
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+    Get().m_extensions.clear();
+
+    for (GLint i = 0; i < extension_count; i++)
+    {
+        const auto* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        Get().m_extensions.emplace(name);
+    }
+
+    DFM_CORE_INFO("OpenGL {0} on {1} ({2} extensions).",
+        reinterpret_cast<const char*>(glGetString(GL_VERSION)),
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+        extension_count);
+
+    // Let the driver compile on as many threads as it sees fit.
+    const bool parallel_shader_compile = IsSupported("GL_KHR_parallel_shader_compile") ||
+        IsSupported("GL_ARB_parallel_shader_compile");
+    const auto max_shader_compiler_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+        load_proc(IsSupported("GL_KHR_parallel_shader_compile") ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+
+    Get().m_parallel_shader_compile = parallel_shader_compile && max_shader_compiler_threads != nullptr;
+
+    if (Get().m_parallel_shader_compile)
+    {
+        max_shader_compiler_threads(0xFFFFFFFF);
+        DFM_CORE_INFO("Compiling shaders on driver threads.");
+    }
+
+    Get().m_pipeline_statistics_query = IsSupported("GL_ARB_pipeline_statistics_query");
+
+    Get().m_get_texture_handle = nullptr;
+    Get().m_make_texture_handle_resident = nullptr;
+    Get().m_make_texture_handle_non_resident = nullptr;
+
+    if (IsSupported("GL_ARB_bindless_texture"))
+    {
+        const auto get_texture_handle = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(load_proc("glGetTextureHandleARB"));
+        const auto make_resident = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(load_proc("glMakeTextureHandleResidentARB"));
+        const auto make_non_resident = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(
+            load_proc("glMakeTextureHandleNonResidentARB"));
+
+        // Only report support when every entry point could be found.
+        if (get_texture_handle && make_resident && make_non_resident)
+        {
+            Get().m_get_texture_handle = get_texture_handle;
+            Get().m_make_texture_handle_resident = make_resident;
+            Get().m_make_texture_handle_non_resident = make_non_resident;
+            DFM_CORE_INFO("Sampling material textures through bindless handles.");
+        }
+    }
+}
+
+/**
+ * \brief Determines whether the current context supports the given extension.
+ * \param name The name of the extension, e.g. "GL_EXT_texture_compression_s3tc".
+ * \return A boolean value indicating if the extension is supported.
+ */
+bool GlExtensions::IsSupported(const std::string& name)
+{
+    return Get().m_extensions.count(name) != 0;
+}
+
+/**
+ * \brief Gets the bindless handle of a texture, which uses the texture's own sampling parameters.
+ * The texture's parameters can no longer be changed afterwards.
+ * \param texture The texture object.
+ * \return The texture handle.
+ */
+GLuint64 GlExtensions::GetTextureHandle(const GLuint texture)
+{
+    return Get().m_get_texture_handle(texture);
+}
+
+/**
+ * \brief Makes a bindless texture handle resident, so shaders may sample through it.
+ * \param handle The texture handle.
+ */
+void GlExtensions::MakeTextureHandleResident(const GLuint64 handle)
+{
+    Get().m_make_texture_handle_resident(handle);
+}
+
+/**
+ * \brief Makes a bindless texture handle non-resident.
+ * \param handle The texture handle.
+ */
+void GlExtensions::MakeTextureHandleNonResident(const GLuint64 handle)
+{
+    Get().m_make_texture_handle_non_resident(handle);
+}
@@ -0,0 +1,125 @@
+/**
+ * \file gl_extensions.h
+ */
+
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include "glad/glad.h"
+
+#include <string>
+#include <unordered_set>
+
+// The GL loader is generated for the core profile only, so extension tokens are declared here.
+
+// EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+// EXT_texture_sRGB
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+
+// KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// ARB_pipeline_statistics_query
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+
+// ARB_bindless_texture
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+/**
+ * \brief A singleton class used to query which OpenGL extensions the current context supports.
+ */
+class GlExtensions
+{
+public:
+    GlExtensions(const GlExtensions&) = delete;
+    GlExtensions(GlExtensions&&) noexcept = delete;
+
+    GlExtensions& operator=(const GlExtensions&) = delete;
+    GlExtensions& operator=(GlExtensions&&) noexcept = delete;
+
+    /**
+     * \brief Reads the extensions supported by the current context and loads their entry points.
+     * Must be called after GLAD is loaded.
+     * \param load_proc The function used to look up GL entry points.
+     */
+    static void Initialise(GLADloadproc load_proc);
+
+    /**
+     * \brief Determines whether the current context supports the given extension.
+     * \param name The name of the extension, e.g. "GL_EXT_texture_compression_s3tc".
+     * \return A boolean value indicating if the extension is supported.
+     */
+    [[nodiscard]] static bool IsSupported(const std::string& name);
+
+    /**
+     * \brief Determines whether shaders and programs can be compiled and linked on driver threads,
+     * with their progress polled through \code GL_COMPLETION_STATUS_KHR.
+     * \return A boolean value indicating if parallel shader compilation is supported.
+     */
+    [[nodiscard]] static bool HasParallelShaderCompile() { return Get().m_parallel_shader_compile; }
+
+    /**
+     * \brief Determines whether pipeline statistics, such as the number of fragment shader invocations,
+     * can be counted with queries.
+     * \return A boolean value indicating if pipeline statistics queries are supported.
+     */
+    [[nodiscard]] static bool HasPipelineStatisticsQuery() { return Get().m_pipeline_statistics_query; }
+
+    /**
+     * \brief Determines whether shaders can sample textures through 64-bit handles instead of texture units.
+     * \return A boolean value indicating if bindless textures are supported.
+     */
+    [[nodiscard]] static bool HasBindlessTexture() { return Get().m_get_texture_handle != nullptr; }
+
+    /**
+     * \brief Gets the bindless handle of a texture, which uses the texture's own sampling parameters.
+     * The texture's parameters can no longer be changed afterwards.
+     * \param texture The texture object.
+     * \return The texture handle.
+     */
+    [[nodiscard]] static GLuint64 GetTextureHandle(GLuint texture);
+
+    /**
+     * \brief Makes a bindless texture handle resident, so shaders may sample through it.
+     * \param handle The texture handle.
+     */
+    static void MakeTextureHandleResident(GLuint64 handle);
+
+    /**
+     * \brief Makes a bindless texture handle non-resident.
+     * \param handle The texture handle.
+     */
+    static void MakeTextureHandleNonResident(GLuint64 handle);
+
+private:
+    std::unordered_set<std::string> m_extensions;
+    bool m_parallel_shader_compile = false;
+    bool m_pipeline_statistics_query = false;
+    PFNGLGETTEXTUREHANDLEARBPROC m_get_texture_handle = nullptr;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC m_make_texture_handle_resident = nullptr;
+    PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC m_make_texture_handle_non_resident = nullptr;
+
+    GlExtensions() = default;
+    ~GlExtensions() = default;
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static GlExtensions& Get() { return s_instance; }
+
+    static GlExtensions s_instance;
+};
+
+#endif // GL_EXTENSIONS_H
@@ -0,0 +1,345 @@
+/**
+ * \file gl_state.cpp
+ */
+
+#include "utils/gl_state.h"
+#include "utils/profiling.h"
+
+/**
+ * \brief Marks a binding whose value is not known, so that the next bind is always passed to GL.
+ */
+constexpr GLuint UNKNOWN_BINDING = 0xFFFFFFFF;
+
+GlState GlState::s_instance;
+
+GlState::GlState()
+    : m_program{ UNKNOWN_BINDING },
+    m_vertex_array{ UNKNOWN_BINDING },
+    m_active_texture_unit{ UNKNOWN_BINDING },
+    m_buffers{},
+    m_textures{},
+    m_samplers{},
+    m_frame_statistics{},
+    m_statistics{}
+{
+    Invalidate();
+}
+
+/**
+ * \brief Uses a program for rendering.
+ * \param program The program object.
+ */
+void GlState::UseProgram(const GLuint program)
+{
+    GlState& state = Get();
+
+    if (state.m_program == program)
+    {
+        state.m_frame_statistics.programs.skipped++;
+        return;
+    }
+
+    glUseProgram(program);
+    state.m_program = program;
+    state.m_frame_statistics.programs.issued++;
+}
+
+/**
+ * \brief Binds a vertex array object.
+ * \param vertex_array The vertex array object.
+ */
+void GlState::BindVertexArray(const GLuint vertex_array)
+{
+    GlState& state = Get();
+
+    if (state.m_vertex_array == vertex_array)
+    {
+        state.m_frame_statistics.vertex_arrays.skipped++;
+        return;
+    }
+
+    glBindVertexArray(vertex_array);
+    state.m_vertex_array = vertex_array;
+    state.m_frame_statistics.vertex_arrays.issued++;
+}
+
+/**
+ * \brief Binds a buffer object to a target. Element array buffers are part of the bound vertex
+ * array's state, so they are always bound.
+ * \param target The buffer target, such as \code GL_UNIFORM_BUFFER.
+ * \param buffer The buffer object.
+ */
+void GlState::BindBuffer(const GLenum target, const GLuint buffer)
+{
+    GlState& state = Get();
+    const size_t slot = GetBufferSlot(target);
+
+    if (slot < TRACKED_BUFFER_TARGETS)
+    {
+        if (state.m_buffers[slot] == buffer)
+        {
+            state.m_frame_statistics.buffers.skipped++;
+            return;
+        }
+
+        state.m_buffers[slot] = buffer;
+    }
+
+    glBindBuffer(target, buffer);
+    state.m_frame_statistics.buffers.issued++;
+}
+
+/**
+ * \brief Binds a range of a buffer object to an indexed binding point. This also binds the buffer to the
+ * target's generic binding point, which is tracked like \code BindBuffer.
+ * \param target The indexed buffer target, such as \code GL_UNIFORM_BUFFER.
+ * \param index The index of the binding point.
+ * \param buffer The buffer object.
+ * \param offset The offset of the range in bytes.
+ * \param size The size of the range in bytes.
+ */
+void GlState::BindBufferRange(const GLenum target, const GLuint index, const GLuint buffer, const GLintptr offset,
+                              const GLsizeiptr size)
+{
+    GlState& state = Get();
+    const size_t slot = GetBufferSlot(target);
+
+    // Indexed bindings are set once per buffer, so they are not tracked themselves.
+    glBindBufferRange(target, index, buffer, offset, size);
+    state.m_frame_statistics.buffers.issued++;
+
+    if (slot < TRACKED_BUFFER_TARGETS)
+    {
+        state.m_buffers[slot] = buffer;
+    }
+}
+
+/**
+ * \brief Binds a texture object to a texture unit, making the unit active only if the binding changes.
+ * \param unit The index of the texture unit, starting from zero.
+ * \param target The texture target, such as \code GL_TEXTURE_2D.
+ * \param texture The texture object.
+ */
+void GlState::BindTexture(const GLuint unit, const GLenum target, const GLuint texture)
+{
+    GlState& state = Get();
+    const size_t slot = GetTextureSlot(target);
+    const bool tracked = unit < TRACKED_TEXTURE_UNITS && slot < TRACKED_TEXTURE_TARGETS;
+
+    if (tracked)
+    {
+        if (state.m_textures[unit][slot] == texture)
+        {
+            state.m_frame_statistics.textures.skipped++;
+            return;
+        }
+
+        state.m_textures[unit][slot] = texture;
+    }
+
+    if (state.m_active_texture_unit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state.m_active_texture_unit = unit;
+    }
+
+    glBindTexture(target, texture);
+    state.m_frame_statistics.textures.issued++;
+}
+
+/**
+ * \brief Binds a sampler object to a texture unit.
+ * \param unit The index of the texture unit, starting from zero.
+ * \param sampler The sampler object, or zero to use the texture's own sampling parameters.
+ */
+void GlState::BindSampler(const GLuint unit, const GLuint sampler)
+{
+    GlState& state = Get();
+
+    if (unit < TRACKED_TEXTURE_UNITS)
+    {
+        if (state.m_samplers[unit] == sampler)
+        {
+            state.m_frame_statistics.samplers.skipped++;
+            return;
+        }
+
+        state.m_samplers[unit] = sampler;
+    }
+
+    glBindSampler(unit, sampler);
+    state.m_frame_statistics.samplers.issued++;
+}
+
+/**
+ * \brief Deletes a program and forgets it if it is in use.
+ * \param program The program object.
+ */
+void GlState::DeleteProgram(const GLuint program)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // A program in use is only deleted once it is no longer in use, so its name cannot be reused before then.
+    // Forgetting it anyway keeps the next UseProgram from being skipped.
+    if (Get().m_program == program)
+    {
+        Get().m_program = UNKNOWN_BINDING;
+    }
+
+    glDeleteProgram(program);
+}
+
+/**
+ * \brief Deletes a vertex array object and forgets it if it is bound.
+ * \param vertex_array The vertex array object.
+ */
+void GlState::DeleteVertexArray(const GLuint vertex_array)
+{
+    DFM_PROFILE_FUNCTION();
+
+    // Deleting the bound vertex array binds zero in its place.
+    if (Get().m_vertex_array == vertex_array)
+    {
+        Get().m_vertex_array = 0;
+    }
+
+    glDeleteVertexArrays(1, &vertex_array);
+}
+
+/**
+ * \brief Deletes a buffer object and forgets it wherever it is bound.
+ * \param buffer The buffer object.
+ */
+void GlState::DeleteBuffer(const GLuint buffer)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (GLuint& binding : Get().m_buffers)
+    {
+        if (binding == buffer)
+        {
+            binding = 0;
+        }
+    }
+
+    glDeleteBuffers(1, &buffer);
+}
+
+/**
+ * \brief Deletes a texture object and forgets it wherever it is bound.
+ * \param texture The texture object.
+ */
+void GlState::DeleteTexture(const GLuint texture)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (auto& unit : Get().m_textures)
+    {
+        for (GLuint& binding : unit)
+        {
+            if (binding == texture)
+            {
+                binding = 0;
+            }
+        }
+    }
+
+    glDeleteTextures(1, &texture);
+}
+
+/**
+ * \brief Deletes a sampler object and forgets it wherever it is bound.
+ * \param sampler The sampler object.
+ */
+void GlState::DeleteSampler(const GLuint sampler)
+{
+    DFM_PROFILE_FUNCTION();
+
+    for (GLuint& binding : Get().m_samplers)
+    {
+        if (binding == sampler)
+        {
+            binding = 0;
+        }
+    }
+
+    glDeleteSamplers(1, &sampler);
+}
+
+/**
+ * \brief Forgets every tracked binding, so the next bind of each kind is passed to GL. Call this
+ * after code that changes bindings without going through this class.
+ */
+void GlState::Invalidate()
+{
+    GlState& state = Get();
+
+    state.m_program = UNKNOWN_BINDING;
+    state.m_vertex_array = UNKNOWN_BINDING;
+    state.m_active_texture_unit = UNKNOWN_BINDING;
+    state.m_buffers.fill(UNKNOWN_BINDING);
+    state.m_samplers.fill(UNKNOWN_BINDING);
+
+    for (auto& unit : state.m_textures)
+    {
+        unit.fill(UNKNOWN_BINDING);
+    }
+}
+
+/**
+ * \brief Ends the frame, making its bind counts available through \code GetStatistics.
+ */
+void GlState::EndFrame()
+{
+    GlState& state = Get();
+
+    state.m_statistics = state.m_frame_statistics;
+    state.m_frame_statistics = {};
+}
+
+/**
+ * \brief Gets the binds made during the last frame.
+ * \return The bind statistics.
+ */
+GlStateStatistics GlState::GetStatistics()
+{
+    return Get().m_statistics;
+}
+
+/**
+ * \brief Gets the slot tracking a buffer target.
+ * \param target The buffer target.
+ * \return The index of the slot, or \code TRACKED_BUFFER_TARGETS if the target is not tracked.
+ */
+size_t GlState::GetBufferSlot(const GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_UNIFORM_BUFFER: return 1;
+    case GL_SHADER_STORAGE_BUFFER: return 2;
+    case GL_PIXEL_UNPACK_BUFFER: return 3;
+    case GL_PIXEL_PACK_BUFFER: return 4;
+    case GL_COPY_READ_BUFFER: return 5;
+    case GL_COPY_WRITE_BUFFER: return 6;
+    case GL_DRAW_INDIRECT_BUFFER: return 7;
+    case GL_DISPATCH_INDIRECT_BUFFER: return 8;
+    default: return TRACKED_BUFFER_TARGETS;
+    }
+}
+
+/**
+ * \brief Gets the slot tracking a texture target on each unit.
+ * \param target The texture target.
+ * \return The index of the slot, or \code TRACKED_TEXTURE_TARGETS if the target is not tracked.
+ */
+size_t GlState::GetTextureSlot(const GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_CUBE_MAP: return 2;
+    default: return TRACKED_TEXTURE_TARGETS;
+    }
+}
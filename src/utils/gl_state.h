@@ -0,0 +1,194 @@
+/**
+ * \file gl_state.h
+ */
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include "glad/glad.h"
+
+#include <array>
+#include <cstddef>
+
+/**
+ * \brief Represents how many binds of one kind were passed to GL, and how many were skipped because
+ * the object was already bound.
+ */
+struct GlBindCounts
+{
+    size_t issued;
+    size_t skipped;
+};
+
+/**
+ * \brief Represents the binds made through \code GlState during one frame.
+ */
+struct GlStateStatistics
+{
+    GlBindCounts programs;
+    GlBindCounts vertex_arrays;
+    GlBindCounts buffers;
+    GlBindCounts textures;
+    GlBindCounts samplers;
+};
+
+/**
+ * \brief A singleton class that tracks the program, vertex array, buffer, texture and sampler bindings
+ * of the GL context, and skips binds that would not change anything. Every bind of these kinds must go
+ * through this class, and tracked objects must be deleted through it, so that the tracked state never
+ * goes stale. All functions must be called on the thread owning the GL context.
+ */
+class GlState
+{
+public:
+    GlState(const GlState&) = delete;
+    GlState(GlState&&) noexcept = delete;
+
+    GlState& operator=(const GlState&) = delete;
+    GlState& operator=(GlState&&) noexcept = delete;
+
+    /**
+     * \brief Uses a program for rendering.
+     * \param program The program object.
+     */
+    static void UseProgram(GLuint program);
+
+    /**
+     * \brief Binds a vertex array object.
+     * \param vertex_array The vertex array object.
+     */
+    static void BindVertexArray(GLuint vertex_array);
+
+    /**
+     * \brief Binds a buffer object to a target. Element array buffers are part of the bound vertex
+     * array's state, so they are always bound.
+     * \param target The buffer target, such as \code GL_UNIFORM_BUFFER.
+     * \param buffer The buffer object.
+     */
+    static void BindBuffer(GLenum target, GLuint buffer);
+
+    /**
+     * \brief Binds a range of a buffer object to an indexed binding point. This also binds the buffer to the
+     * target's generic binding point, which is tracked like \code BindBuffer.
+     * \param target The indexed buffer target, such as \code GL_UNIFORM_BUFFER.
+     * \param index The index of the binding point.
+     * \param buffer The buffer object.
+     * \param offset The offset of the range in bytes.
+     * \param size The size of the range in bytes.
+     */
+    static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    /**
+     * \brief Binds a texture object to a texture unit, making the unit active only if the binding changes.
+     * \param unit The index of the texture unit, starting from zero.
+     * \param target The texture target, such as \code GL_TEXTURE_2D.
+     * \param texture The texture object.
+     */
+    static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    /**
+     * \brief Binds a sampler object to a texture unit.
+     * \param unit The index of the texture unit, starting from zero.
+     * \param sampler The sampler object, or zero to use the texture's own sampling parameters.
+     */
+    static void BindSampler(GLuint unit, GLuint sampler);
+
+    /**
+     * \brief Deletes a program and forgets it if it is in use.
+     * \param program The program object.
+     */
+    static void DeleteProgram(GLuint program);
+
+    /**
+     * \brief Deletes a vertex array object and forgets it if it is bound.
+     * \param vertex_array The vertex array object.
+     */
+    static void DeleteVertexArray(GLuint vertex_array);
+
+    /**
+     * \brief Deletes a buffer object and forgets it wherever it is bound.
+     * \param buffer The buffer object.
+     */
+    static void DeleteBuffer(GLuint buffer);
+
+    /**
+     * \brief Deletes a texture object and forgets it wherever it is bound.
+     * \param texture The texture object.
+     */
+    static void DeleteTexture(GLuint texture);
+
+    /**
+     * \brief Deletes a sampler object and forgets it wherever it is bound.
+     * \param sampler The sampler object.
+     */
+    static void DeleteSampler(GLuint sampler);
+
+    /**
+     * \brief Forgets every tracked binding, so the next bind of each kind is passed to GL. Call this
+     * after code that changes bindings without going through this class.
+     */
+    static void Invalidate();
+
+    /**
+     * \brief Ends the frame, making its bind counts available through \code GetStatistics.
+     */
+    static void EndFrame();
+
+    /**
+     * \brief Gets the binds made during the last frame.
+     * \return The bind statistics.
+     */
+    [[nodiscard]] static GlStateStatistics GetStatistics();
+
+private:
+    /**
+     * \brief The number of texture units whose bindings are tracked. Binds to higher units are always passed to GL.
+     */
+    static constexpr size_t TRACKED_TEXTURE_UNITS = 32;
+
+    /**
+     * \brief The number of texture targets whose bindings are tracked on each unit.
+     */
+    static constexpr size_t TRACKED_TEXTURE_TARGETS = 3;
+
+    /**
+     * \brief The number of buffer targets whose bindings are tracked.
+     */
+    static constexpr size_t TRACKED_BUFFER_TARGETS = 9;
+
+    GLuint m_program;
+    GLuint m_vertex_array;
+    GLuint m_active_texture_unit;
+    std::array<GLuint, TRACKED_BUFFER_TARGETS> m_buffers;
+    std::array<std::array<GLuint, TRACKED_TEXTURE_TARGETS>, TRACKED_TEXTURE_UNITS> m_textures;
+    std::array<GLuint, TRACKED_TEXTURE_UNITS> m_samplers;
+    GlStateStatistics m_frame_statistics;
+    GlStateStatistics m_statistics;
+
+    GlState();
+    ~GlState() = default;
+
+    /**
+     * \brief Gets the slot tracking a buffer target.
+     * \param target The buffer target.
+     * \return The index of the slot, or \code TRACKED_BUFFER_TARGETS if the target is not tracked.
+     */
+    static size_t GetBufferSlot(GLenum target);
+
+    /**
+     * \brief Gets the slot tracking a texture target on each unit.
+     * \param target The texture target.
+     * \return The index of the slot, or \code TRACKED_TEXTURE_TARGETS if the target is not tracked.
+     */
+    static size_t GetTextureSlot(GLenum target);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static GlState& Get() { return s_instance; }
+
+    static GlState s_instance;
+};
+
+#endif // GL_STATE_H
@@ -0,0 +1,47 @@
+/**
+ * \file hash.h
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+/**
+ * \brief Hashes a block of bytes using the 64-bit FNV-1a algorithm.
+ * \param data The bytes to hash.
+ * \param size The number of bytes to hash.
+ * \param seed The hash to continue from, allowing several blocks to be hashed together.
+ * \return The hash of the bytes.
+ */
+inline uint64_t HashBytes(const void* data, const size_t size, const uint64_t seed = FNV_OFFSET_BASIS)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * \brief Hashes a string using the 64-bit FNV-1a algorithm.
+ * \param string The string to hash.
+ * \param seed The hash to continue from, allowing several strings to be hashed together.
+ * \return The hash of the string.
+ */
+inline uint64_t HashString(const std::string_view string, const uint64_t seed = FNV_OFFSET_BASIS)
+{
+    return HashBytes(string.data(), string.size(), seed);
+}
+
+#endif // HASH_H
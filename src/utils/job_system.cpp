@@ -0,0 +1,455 @@
+/**
+ * \file job_system.cpp
+ */
+
+#include "utils/job_system.h"
+#include "utils/profiling.h"
+
+#include <string>
+
+JobSystem JobSystem::s_instance;
+
+/**
+ * \brief The index of the worker running on this thread, or -1 on threads that are not workers.
+ */
+static thread_local int s_worker_index = -1;
+
+/**
+ * \brief Rotates the first deque each thread steals from, so thieves spread out over the workers.
+ */
+static thread_local size_t s_steal_start = 0;
+
+/**
+ * \brief Determines whether every job counted by the counter has finished.
+ * \return A boolean value indicating if the counter is zero.
+ */
+bool JobCounter::IsDone() const
+{
+    return m_count.load(std::memory_order_acquire) == 0;
+}
+
+JobDeque::JobDeque()
+    : m_top{ 0 },
+    m_bottom{ 0 },
+    m_jobs{ std::make_unique<std::atomic<Job*>[]>(CAPACITY) }
+{
+}
+
+/**
+ * \brief Pushes a job to the bottom of the deque. May only be called by the owning worker.
+ * \param job The job.
+ * \return A boolean value indicating if the job was pushed, which fails when the deque is full.
+ */
+bool JobDeque::Push(Job* job)
+{
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+
+    if (bottom - top >= CAPACITY)
+    {
+        return false;
+    }
+
+    m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+
+    // Publish the job before the new bottom, so a thief that sees the bottom also sees the job.
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+/**
+ * \brief Pops the most recently pushed job from the bottom of the deque. May only be called by the
+ * owning worker.
+ * \return The job, or null if the deque is empty.
+ */
+Job* JobDeque::Pop()
+{
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+
+    // Thieves must see the reserved bottom before the top is read, or both sides could take the last job.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    // The last job is raced for with thieves through the top.
+    if (top == bottom)
+    {
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+/**
+ * \brief Steals the oldest job from the top of the deque. May be called by any thread.
+ * \return The job, or null if the deque is empty or the steal lost a race.
+ */
+Job* JobDeque::Steal()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+
+    return job;
+}
+
+JobSystem::JobSystem()
+    : m_queued{ 0 },
+    m_sleeping{ 0 },
+    m_stopping{ false }
+{
+}
+
+/**
+ * \brief Starts the worker threads of the job system.
+ * \param worker_count The number of worker threads to start. When zero, one less than the number of
+ * hardware threads is used so that the main thread keeps a core to itself.
+ */
+void JobSystem::Initialise(size_t worker_count)
+{
+    DFM_PROFILE_FUNCTION();
+
+    if (worker_count == 0)
+    {
+        const size_t hardware_threads = std::thread::hardware_concurrency();
+        worker_count = std::max<size_t>(hardware_threads, 2) - 1;
+    }
+
+    JobSystem& system = Get();
+    system.m_stopping = false;
+
+    // Every deque exists before any worker starts, so workers can steal from each other straight away.
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        system.m_deques.push_back(std::make_unique<JobDeque>());
+    }
+
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        system.m_workers.emplace_back([i] { Get().WorkerLoop(static_cast<int>(i)); });
+    }
+}
+
+/**
+ * \brief Finishes any queued jobs and joins the worker threads.
+ */
+void JobSystem::Shutdown()
+{
+    DFM_PROFILE_FUNCTION();
+
+    JobSystem& system = Get();
+
+    {
+        std::lock_guard lock{ system.m_sleep_mutex };
+        system.m_stopping = true;
+    }
+
+    system.m_wake.notify_all();
+
+    for (auto& worker : system.m_workers)
+    {
+        worker.join();
+    }
+
+    system.m_workers.clear();
+    system.m_deques.clear();
+}
+
+/**
+ * \brief Queues a job. If the job system has no workers, the job is run immediately on the calling thread.
+ * \param function The function run by the job.
+ * \param counter An optional counter tracking the job, which must outlive it.
+ */
+void JobSystem::Run(std::function<void()> function, JobCounter* counter)
+{
+    if (counter)
+    {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job* job = new Job{ std::move(function), counter };
+
+    if (Get().m_workers.empty())
+    {
+        Execute(job);
+        return;
+    }
+
+    Enqueue(job);
+}
+
+/**
+ * \brief Queues a job to start once every job counted by a dependency has finished.
+ * \param dependency The counter the job waits for.
+ * \param function The function run by the job.
+ * \param counter An optional counter tracking the job, which must outlive it. It is incremented straight
+ * away, so waiting on it also waits for the dependency.
+ */
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter)
+{
+    if (counter)
+    {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job* job = new Job{ std::move(function), counter };
+
+    {
+        std::lock_guard lock{ dependency.m_mutex };
+
+        // Finish takes the continuations under the same lock once the count reaches zero.
+        if (dependency.m_count.load(std::memory_order_acquire) != 0)
+        {
+            dependency.m_continuations.push_back(job);
+            return;
+        }
+    }
+
+    if (Get().m_workers.empty())
+    {
+        Execute(job);
+        return;
+    }
+
+    Enqueue(job);
+}
+
+/**
+ * \brief Waits for every job counted by a counter to finish, running queued jobs on the calling thread
+ * in the meantime.
+ * \param counter The counter.
+ */
+void JobSystem::Wait(const JobCounter& counter)
+{
+    DFM_PROFILE_FUNCTION();
+
+    while (!counter.IsDone())
+    {
+        // The remaining jobs are running on other threads.
+        if (!TryRunJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job may still be releasing the counter, which the caller is free to destroy once this returns.
+    std::lock_guard lock{ counter.m_mutex };
+}
+
+/**
+ * \brief Runs one queued job on the calling thread, for threads that wait on something other than a counter.
+ * \return A boolean value indicating if a job was run.
+ */
+bool JobSystem::TryRunJob()
+{
+    Job* job = TakeJob();
+
+    if (!job)
+    {
+        return false;
+    }
+
+    Execute(job);
+    return true;
+}
+
+/**
+ * \brief Gets the number of worker threads in the job system.
+ * \return The number of worker threads.
+ */
+size_t JobSystem::GetWorkerCount()
+{
+    return Get().m_workers.size();
+}
+
+/**
+ * \brief Gets the index of the worker running on the calling thread.
+ * \return The index of the worker, or -1 if the calling thread is not a worker.
+ */
+int JobSystem::GetWorkerIndex()
+{
+    return s_worker_index;
+}
+
+/**
+ * \brief Queues a job on the calling worker's deque, or on the shared queue.
+ * \param job The job.
+ */
+void JobSystem::Enqueue(Job* job)
+{
+    JobSystem& system = Get();
+
+    const bool pushed = s_worker_index >= 0 && system.m_deques[s_worker_index]->Push(job);
+
+    if (!pushed)
+    {
+        std::lock_guard lock{ system.m_shared_mutex };
+        system.m_shared_jobs.push_back(job);
+    }
+
+    system.m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+    // Sleeping workers check the queued count under the lock, so taking it here means none can miss the job.
+    if (system.m_sleeping.load(std::memory_order_seq_cst) != 0)
+    {
+        {
+            std::lock_guard lock{ system.m_sleep_mutex };
+        }
+
+        system.m_wake.notify_one();
+    }
+}
+
+/**
+ * \brief Takes a queued job, preferring the calling worker's own deque, then the shared queue, then
+ * stealing from the other workers.
+ * \return The job, or null if none could be taken.
+ */
+Job* JobSystem::TakeJob()
+{
+    JobSystem& system = Get();
+    Job* job = nullptr;
+
+    if (s_worker_index >= 0)
+    {
+        job = system.m_deques[s_worker_index]->Pop();
+    }
+
+    if (!job)
+    {
+        std::lock_guard lock{ system.m_shared_mutex };
+
+        if (!system.m_shared_jobs.empty())
+        {
+            job = system.m_shared_jobs.front();
+            system.m_shared_jobs.pop_front();
+        }
+    }
+
+    const size_t deque_count = system.m_deques.size();
+
+    for (size_t i = 0; !job && i < deque_count; i++)
+    {
+        const size_t victim = (s_steal_start + i) % deque_count;
+
+        if (static_cast<int>(victim) != s_worker_index)
+        {
+            job = system.m_deques[victim]->Steal();
+        }
+    }
+
+    if (job)
+    {
+        s_steal_start++;
+        system.m_queued.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+/**
+ * \brief Runs a job, then finishes its counter and deletes it.
+ * \param job The job.
+ */
+void JobSystem::Execute(Job* job)
+{
+    job->function();
+
+    if (job->counter)
+    {
+        Finish(*job->counter);
+    }
+
+    delete job;
+}
+
+/**
+ * \brief Decrements a counter, queueing the jobs waiting for it once it reaches zero.
+ * \param counter The counter.
+ */
+void JobSystem::Finish(JobCounter& counter)
+{
+    std::vector<Job*> continuations;
+
+    // The count is decremented under the lock, so a waiter that takes the lock afterwards knows this thread
+    // is done with the counter.
+    {
+        std::lock_guard lock{ counter.m_mutex };
+
+        if (counter.m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            continuations.swap(counter.m_continuations);
+        }
+    }
+
+    for (Job* job : continuations)
+    {
+        if (Get().m_workers.empty())
+        {
+            Execute(job);
+        }
+        else
+        {
+            Enqueue(job);
+        }
+    }
+}
+
+/**
+ * \brief Runs queued jobs on a worker thread until the job system is shut down.
+ * \param index The index of the worker.
+ */
+void JobSystem::WorkerLoop(const int index)
+{
+    s_worker_index = index;
+    s_steal_start = static_cast<size_t>(index) + 1;
+
+    Instrumentor::SetThreadName("Worker " + std::to_string(index));
+
+    while (true)
+    {
+        if (Job* job = TakeJob())
+        {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock lock{ m_sleep_mutex };
+
+        if (m_stopping && m_queued.load(std::memory_order_seq_cst) == 0)
+        {
+            return;
+        }
+
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_seq_cst) != 0; });
+        m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,290 @@
+/**
+ * \file job_system.h
+ */
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+/**
+ * \brief Counts the jobs of a group that have not finished yet. Jobs run with a counter increment it
+ * when they are queued and decrement it when they finish, so waiting on the counter waits for the
+ * whole group. Jobs can also be queued to start once a counter reaches zero. A counter may only be
+ * destroyed once \code JobSystem::Wait has returned for it.
+ */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter(JobCounter&&) noexcept = delete;
+
+    JobCounter& operator=(const JobCounter&) = delete;
+    JobCounter& operator=(JobCounter&&) noexcept = delete;
+
+    /**
+     * \brief Determines whether every job counted by the counter has finished.
+     * \return A boolean value indicating if the counter is zero.
+     */
+    [[nodiscard]] bool IsDone() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_count{ 0 };
+
+    /**
+     * \brief Guards the count reaching zero and the continuations, so a job added as the counter reaches
+     * zero is never lost.
+     */
+    mutable std::mutex m_mutex;
+    std::vector<Job*> m_continuations;
+};
+
+/**
+ * \brief A job queued with \code JobSystem.
+ */
+struct Job
+{
+    std::function<void()> function;
+    JobCounter* counter;
+};
+
+/**
+ * \brief A fixed-size Chase-Lev work-stealing deque. Its owning worker pushes and pops jobs at the
+ * bottom without locking, while other threads steal from the top.
+ */
+class JobDeque
+{
+public:
+    JobDeque();
+
+    /**
+     * \brief Pushes a job to the bottom of the deque. May only be called by the owning worker.
+     * \param job The job.
+     * \return A boolean value indicating if the job was pushed, which fails when the deque is full.
+     */
+    bool Push(Job* job);
+
+    /**
+     * \brief Pops the most recently pushed job from the bottom of the deque. May only be called by the
+     * owning worker.
+     * \return The job, or null if the deque is empty.
+     */
+    Job* Pop();
+
+    /**
+     * \brief Steals the oldest job from the top of the deque. May be called by any thread.
+     * \return The job, or null if the deque is empty or the steal lost a race.
+     */
+    Job* Steal();
+
+private:
+    /**
+     * \brief The number of jobs a deque can hold, which must be a power of two.
+     */
+    static constexpr int64_t CAPACITY = 4096;
+
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+    std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+};
+
+/**
+ * \brief A singleton work-stealing job system. Each worker thread owns a deque of jobs, and idle workers
+ * steal from the others. Threads that are not workers queue jobs through a shared queue, and help run
+ * jobs while they wait on a counter rather than blocking.
+ */
+class JobSystem
+{
+public:
+    JobSystem(const JobSystem&) = delete;
+    JobSystem(JobSystem&&) noexcept = delete;
+
+    JobSystem& operator=(const JobSystem&) = delete;
+    JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+    /**
+     * \brief Starts the worker threads of the job system.
+     * \param worker_count The number of worker threads to start. When zero, one less than the number of
+     * hardware threads is used so that the main thread keeps a core to itself.
+     */
+    static void Initialise(size_t worker_count = 0);
+
+    /**
+     * \brief Finishes any queued jobs and joins the worker threads.
+     */
+    static void Shutdown();
+
+    /**
+     * \brief Queues a job. If the job system has no workers, the job is run immediately on the calling thread.
+     * \param function The function run by the job.
+     * \param counter An optional counter tracking the job, which must outlive it.
+     */
+    static void Run(std::function<void()> function, JobCounter* counter = nullptr);
+
+    /**
+     * \brief Queues a job to start once every job counted by a dependency has finished.
+     * \param dependency The counter the job waits for.
+     * \param function The function run by the job.
+     * \param counter An optional counter tracking the job, which must outlive it. It is incremented straight
+     * away, so waiting on it also waits for the dependency.
+     */
+    static void RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+    /**
+     * \brief Waits for every job counted by a counter to finish, running queued jobs on the calling thread
+     * in the meantime.
+     * \param counter The counter.
+     */
+    static void Wait(const JobCounter& counter);
+
+    /**
+     * \brief Runs one queued job on the calling thread, for threads that wait on something other than a counter.
+     * \return A boolean value indicating if a job was run.
+     */
+    static bool TryRunJob();
+
+    /**
+     * \brief Calls a function for every range of a batch of indices in parallel, and waits for them all.
+     * \tparam F The type of the function, which is called with the first index and one past the last
+     * index of each range.
+     * \param count The number of indices.
+     * \param batch_size The largest number of indices handed to one job.
+     * \param function The function.
+     */
+    template <typename F>
+    static void ParallelForRange(const size_t count, const size_t batch_size, F&& function)
+    {
+        if (count == 0) return;
+
+        const size_t batch = std::max<size_t>(batch_size, 1);
+
+        // A single batch is not worth the trip through a queue.
+        if (count <= batch || GetWorkerCount() == 0)
+        {
+            function(size_t{ 0 }, count);
+            return;
+        }
+
+        JobCounter counter;
+
+        for (size_t begin = batch; begin < count; begin += batch)
+        {
+            const size_t end = std::min(begin + batch, count);
+            Run([&function, begin, end] { function(begin, end); }, &counter);
+        }
+
+        // The calling thread takes the first batch itself.
+        function(size_t{ 0 }, batch);
+
+        Wait(counter);
+    }
+
+    /**
+     * \brief Calls a function for every index in parallel, and waits for them all.
+     * \tparam F The type of the function, which is called with each index.
+     * \param count The number of indices.
+     * \param batch_size The largest number of indices handed to one job.
+     * \param function The function.
+     */
+    template <typename F>
+    static void ParallelFor(const size_t count, const size_t batch_size, F&& function)
+    {
+        ParallelForRange(count, batch_size, [&function](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                function(i);
+            }
+        });
+    }
+
+    /**
+     * \brief Gets the number of worker threads in the job system.
+     * \return The number of worker threads.
+     */
+    [[nodiscard]] static size_t GetWorkerCount();
+
+    /**
+     * \brief Gets the index of the worker running on the calling thread.
+     * \return The index of the worker, or -1 if the calling thread is not a worker.
+     */
+    [[nodiscard]] static int GetWorkerIndex();
+
+private:
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<JobDeque>> m_deques;
+
+    /**
+     * \brief Jobs queued by threads that are not workers, and jobs that did not fit in a worker's deque.
+     */
+    std::deque<Job*> m_shared_jobs;
+    std::mutex m_shared_mutex;
+
+    /**
+     * \brief The number of jobs queued but not yet taken by any thread, which idle workers sleep on.
+     */
+    std::atomic<size_t> m_queued;
+    std::atomic<size_t> m_sleeping;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopping;
+
+    JobSystem();
+    ~JobSystem() = default;
+
+    /**
+     * \brief Queues a job on the calling worker's deque, or on the shared queue.
+     * \param job The job.
+     */
+    static void Enqueue(Job* job);
+
+    /**
+     * \brief Takes a queued job, preferring the calling worker's own deque, then the shared queue, then
+     * stealing from the other workers.
+     * \return The job, or null if none could be taken.
+     */
+    static Job* TakeJob();
+
+    /**
+     * \brief Runs a job, then finishes its counter and deletes it.
+     * \param job The job.
+     */
+    static void Execute(Job* job);
+
+    /**
+     * \brief Decrements a counter, queueing the jobs waiting for it once it reaches zero.
+     * \param counter The counter.
+     */
+    static void Finish(JobCounter& counter);
+
+    /**
+     * \brief Runs queued jobs on a worker thread until the job system is shut down.
+     * \param index The index of the worker.
+     */
+    void WorkerLoop(int index);
+
+    /**
+     * \brief Gets a reference to the singleton instance.
+     * \return The singleton instance.
+     */
+    static JobSystem& Get() { return s_instance; }
+
+    static JobSystem s_instance;
+};
+
+#endif // JOB_SYSTEM_H
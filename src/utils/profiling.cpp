@@ -21,6 +21,7 @@ Instrumentor::Instrumentor()
  */
 void Instrumentor::BeginSession(const std::string& name, const std::string& filepath)
 {
+    std::lock_guard lock{ Get().m_mutex };
 
     Get().m_output_stream.open(filepath);
     WriteHeader();
@@ -32,6 +33,8 @@ void Instrumentor::BeginSession(const std::string& name, const std::string& file
  */
 void Instrumentor::EndSession()
 {
+    std::lock_guard lock{ Get().m_mutex };
+
     WriteFooter();
     Get().m_output_stream.close();
     delete Get().m_current_session;
@@ -45,6 +48,10 @@ void Instrumentor::EndSession()
  */
 void Instrumentor::WriteProfile(const ProfileResult& result)
 {
+    std::lock_guard lock{ Get().m_mutex };
+
+    if (!Get().m_current_session) return;
+
     if (Get().m_profile_count++ > 0)
     {
         Get().m_output_stream << ", ";
@@ -66,6 +73,25 @@ void Instrumentor::WriteProfile(const ProfileResult& result)
     Get().m_output_stream.flush();
 }
 
+/**
+ * \brief Names the calling thread, so that its results are shown under the name in the trace.
+ * \param name The name of the thread.
+ */
+void Instrumentor::SetThreadName(const std::string& name)
+{
+    std::lock_guard lock{ Get().m_mutex };
+    Get().m_thread_names.insert_or_assign(GetThreadId(), name);
+}
+
+/**
+ * \brief Gets the ID the calling thread is recorded under.
+ * \return The ID of the thread.
+ */
+size_t Instrumentor::GetThreadId()
+{
+    return std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
+
 /**
  * \brief Writes a profiling results header to the profiling results file.
  */
@@ -76,10 +102,23 @@ void Instrumentor::WriteHeader()
 }
 
 /**
- * \brief Writes a profiling results footer to the profiling results file.
+ * \brief Writes the names of the threads and a profiling results footer to the profiling results file.
  */
 void Instrumentor::WriteFooter()
 {
+    // Threads are named with metadata events, which apply to the whole trace wherever they appear.
+    for (const auto& [thread_id, thread_name] : Get().m_thread_names)
+    {
+        if (Get().m_profile_count++ > 0)
+        {
+            Get().m_output_stream << ", ";
+        }
+
+        Get().m_output_stream << R"({"name":"thread_name","ph":"M","pid":0,)";
+        Get().m_output_stream << R"("tid":")" << thread_id << "\",";
+        Get().m_output_stream << R"("args":{"name":")" << thread_name << "\"}}";
+    }
+
     Get().m_output_stream << "]}";
     Get().m_output_stream.flush();
 }
@@ -108,9 +147,7 @@ void InstrumentationTimer::Stop()
     const long long start = std::chrono::time_point_cast<std::chrono::microseconds>(m_start_timepoint).time_since_epoch().count();
     const long long end = std::chrono::time_point_cast<std::chrono::microseconds>(end_timepoint).time_since_epoch().count();
 
-    const size_t thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
-
-    Instrumentor::WriteProfile({ m_name, start, end, thread_id });
+    Instrumentor::WriteProfile({ m_name, start, end, Instrumentor::GetThreadId() });
 
     m_stopped = true;
 }
\ No newline at end of file
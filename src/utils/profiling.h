@@ -7,7 +7,9 @@
 
 #include <chrono>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 const std::string DEFAULT_RESULTS_PATH = "./profile-results.json";
 
@@ -51,23 +53,41 @@ public:
     static void WriteProfile(const ProfileResult& result);
 
     /**
-     * \brief Writes a profiling results header to the profiling results file.
+     * \brief Names the calling thread, so that its results are shown under the name in the trace.
+     * \param name The name of the thread.
      */
-    static void WriteHeader();
+    static void SetThreadName(const std::string& name);
 
     /**
-     * \brief Writes a profiling results footer to the profiling results file.
+     * \brief Gets the ID the calling thread is recorded under.
+     * \return The ID of the thread.
      */
-    static void WriteFooter();
+    [[nodiscard]] static size_t GetThreadId();
 
 private:
     InstrumentationSession* m_current_session;
     std::ofstream m_output_stream;
     int m_profile_count;
 
+    /**
+     * \brief Guards the results file, as results are written from every thread that runs profiled code.
+     */
+    std::mutex m_mutex;
+    std::unordered_map<size_t, std::string> m_thread_names;
+
     Instrumentor();
     ~Instrumentor() = default;
 
+    /**
+     * \brief Writes a profiling results header to the profiling results file.
+     */
+    static void WriteHeader();
+
+    /**
+     * \brief Writes the names of the threads and a profiling results footer to the profiling results file.
+     */
+    static void WriteFooter();
+
     static Instrumentor& Get() { return s_instance; }
     static Instrumentor s_instance;
 };
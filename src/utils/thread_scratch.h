@@ -0,0 +1,104 @@
+/**
+ * \file thread_scratch.h
+ */
+
+#ifndef THREAD_SCRATCH_H
+#define THREAD_SCRATCH_H
+
+#include "utils/assertion.h"
+#include "utils/job_system.h"
+
+#include <iterator>
+#include <vector>
+
+/**
+ * \brief Output buffers with one buffer per thread that runs jobs, so that parallel jobs can emit results
+ * without locking and merge them once every job has finished. Threads that are not workers share a
+ * buffer, so only one of them may write to it at a time, which holds as long as only the thread that
+ * started the jobs helps run them. The job system may be started after the buffers are created, or
+ * restarted with a different number of workers, so they are sized by \code Prepare before each use.
+ * \tparam T The type of the results.
+ */
+template <typename T>
+class ThreadScratch
+{
+public:
+    /**
+     * \brief Sizes the buffers for the job system's current workers. Must be called before starting the
+     * jobs that write to them, as they cannot be resized while jobs are running.
+     */
+    void Prepare()
+    {
+        const size_t count = JobSystem::GetWorkerCount() + 1;
+
+        if (m_buffers.size() != count)
+        {
+            // Results still held by buffers that are about to be dropped are moved to the shared one.
+            std::vector<T> pending;
+            MergeInto(pending);
+
+            m_buffers.resize(count);
+            m_buffers[0].items = std::move(pending);
+        }
+    }
+
+    /**
+     * \brief Gets the buffer of the calling thread.
+     * \return The calling thread's buffer.
+     */
+    std::vector<T>& Local()
+    {
+        const size_t index = static_cast<size_t>(JobSystem::GetWorkerIndex() + 1);
+        DFM_ASSERT(index >= m_buffers.size(), "Thread scratch buffers were not prepared for the job system's workers.");
+
+        return m_buffers[index].items;
+    }
+
+    /**
+     * \brief Appends the results of every thread to a vector and empties the buffers, keeping their
+     * capacity for reuse. Results from one thread stay in the order they were emitted, but the order
+     * between threads depends on which thread ran which job.
+     * \param output The vector receiving the results.
+     */
+    void MergeInto(std::vector<T>& output)
+    {
+        size_t count = output.size();
+        for (const auto& buffer : m_buffers)
+        {
+            count += buffer.items.size();
+        }
+
+        output.reserve(count);
+
+        for (auto& buffer : m_buffers)
+        {
+            output.insert(output.end(), std::make_move_iterator(buffer.items.begin()), std::make_move_iterator(buffer.items.end()));
+            buffer.items.clear();
+        }
+    }
+
+    /**
+     * \brief Empties the buffers of every thread, keeping their capacity for reuse.
+     */
+    void Clear()
+    {
+        for (auto& buffer : m_buffers)
+        {
+            buffer.items.clear();
+        }
+    }
+
+private:
+    /**
+     * \brief A thread's buffer, kept on its own cache line so that threads appending to their buffers do
+     * not contend over the vectors' sizes.
+     */
+    struct alignas(64) Buffer
+    {
+        std::vector<T> items;
+    };
+
+    std::vector<Buffer> m_buffers;
+};
+
+#endif // THREAD_SCRATCH_H
@@ -0,0 +1,270 @@
+/**
+ * \file main.cpp
+ * \brief Compares iterating the scene's hot component sets through views against owning groups, at
+ * several entity counts.
+ */
+
+#include "utils/logging.h"
+
+#include "entt/entity/registry.hpp"
+#include "glm/vec3.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The number of times each pass is timed, of which the fastest is reported.
+ */
+constexpr int REPETITIONS = 15;
+
+/**
+ * \brief The share of entities that are drawn, and the share that are lights.
+ */
+constexpr double RENDERABLE_SHARE = 0.6;
+constexpr double LIGHT_SHARE = 0.05;
+
+// Stand-ins with the same members, sizes and ownership as the scene's components, so the benchmark does
+// not need a GL context or the model importer. Only the types behind the pointers and handles differ.
+
+struct IdComponent
+{
+    uint64_t uuid;
+};
+
+struct TransformComponent
+{
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+};
+
+struct PreviousTransformComponent
+{
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+};
+
+struct MeshComponent
+{
+    std::shared_ptr<const void> model;
+};
+
+/**
+ * \brief Mirrors the members of \code Shader.
+ */
+struct ShaderStandIn
+{
+    int32_t id;
+    bool compiled;
+    uint32_t vertex_shader;
+    uint32_t fragment_shader;
+    uint32_t compute_shader;
+    uint64_t cache_key;
+};
+
+struct ShaderComponent
+{
+    ShaderStandIn shader;
+    std::string name;
+};
+
+struct LightComponent
+{
+    enum class Type
+    {
+        Point,
+        Directional,
+        Spot
+    };
+
+    Type type;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float inner_angle;
+    float outer_angle;
+};
+
+/**
+ * \brief Fills a registry with entities whose components were added in different orders, as they are
+ * in a scene that has been edited for a while, so the components' sparse sets are not aligned.
+ * \param registry The registry.
+ * \param count The number of entities.
+ */
+static void Populate(entt::registry& registry, const size_t count)
+{
+    std::mt19937 engine{ 42 };
+    std::uniform_real_distribution<float> distribution{ 0.0f, 1.0f };
+
+    std::vector<entt::entity> entities(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        entities[i] = registry.create();
+        registry.emplace<IdComponent>(entities[i], static_cast<uint64_t>(i));
+    }
+
+    std::shuffle(entities.begin(), entities.end(), engine);
+    for (const auto entity : entities)
+    {
+        const glm::vec3 position{ distribution(engine) };
+        registry.emplace<TransformComponent>(entity, position, glm::vec3{ 0.0f }, glm::vec3{ 1.0f });
+        registry.emplace<PreviousTransformComponent>(entity, position, glm::vec3{ 0.0f }, glm::vec3{ 1.0f });
+    }
+
+    std::shuffle(entities.begin(), entities.end(), engine);
+    for (const auto entity : entities)
+    {
+        const float roll = distribution(engine);
+
+        if (roll < RENDERABLE_SHARE)
+        {
+            registry.emplace<MeshComponent>(entity, std::make_shared<const int>(0));
+            registry.emplace<ShaderComponent>(entity, ShaderStandIn{ 1, true, 2, 3, 0, 0 }, "model_shader");
+        }
+        else if (roll < RENDERABLE_SHARE + LIGHT_SHARE)
+        {
+            registry.emplace<LightComponent>(entity, LightComponent::Type::Point, 1.0f, 0.09f, 0.032f,
+                glm::vec3{ 0.1f }, glm::vec3{ 1.0f }, glm::vec3{ 1.0f }, 0.0f, 0.0f);
+        }
+    }
+}
+
+/**
+ * \brief Times a pass, keeping the fastest of several runs.
+ * \tparam F The type of the pass.
+ * \param pass The pass, which returns a value that depends on every component it read.
+ * \param sink Accumulates the passes' results, so the compiler cannot skip them.
+ * \return The time of the fastest run in milliseconds.
+ */
+template <typename F>
+static double Time(F&& pass, float& sink)
+{
+    double best = 0.0;
+
+    for (int i = 0; i < REPETITIONS; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        sink += pass();
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        best = i == 0 ? milliseconds : std::min(best, milliseconds);
+    }
+
+    return best;
+}
+
+/**
+ * \brief Compares view and group iteration at one entity count, and logs the results.
+ * \param count The number of entities.
+ * \param sink Accumulates the passes' results, so the compiler cannot skip them.
+ */
+static void Compare(const size_t count, float& sink)
+{
+    // Views iterate the registry the way the systems used to, while the groups match Scene's.
+    entt::registry view_registry;
+    Populate(view_registry, count);
+
+    entt::registry group_registry;
+    group_registry.group<TransformComponent, PreviousTransformComponent, MeshComponent, ShaderComponent>();
+    group_registry.group<LightComponent>(entt::get<TransformComponent, PreviousTransformComponent, IdComponent>);
+    Populate(group_registry, count);
+
+    const double renderable_view = Time([&view_registry]
+    {
+        float sum = 0.0f;
+        for (const auto entity : view_registry.view<MeshComponent, ShaderComponent>())
+        {
+            const auto& transform = view_registry.get<TransformComponent>(entity);
+            const auto& previous = view_registry.get<PreviousTransformComponent>(entity);
+            const auto& mesh = view_registry.get<MeshComponent>(entity);
+            const auto& shader = view_registry.get<ShaderComponent>(entity);
+            sum += (transform.position.x + previous.position.x) * transform.scale.y + static_cast<float>(mesh.model != nullptr) +
+                static_cast<float>(shader.shader.id);
+        }
+        return sum;
+    }, sink);
+
+    const double renderable_group = Time([&group_registry]
+    {
+        float sum = 0.0f;
+        group_registry.group<TransformComponent, PreviousTransformComponent, MeshComponent, ShaderComponent>().each(
+            [&sum](const TransformComponent& transform, const PreviousTransformComponent& previous, const MeshComponent& mesh,
+                   const ShaderComponent& shader)
+            {
+                sum += (transform.position.x + previous.position.x) * transform.scale.y + static_cast<float>(mesh.model != nullptr) +
+                    static_cast<float>(shader.shader.id);
+            });
+        return sum;
+    }, sink);
+
+    const double light_view = Time([&view_registry]
+    {
+        float sum = 0.0f;
+        for (const auto entity : view_registry.view<LightComponent>())
+        {
+            const auto& light = view_registry.get<LightComponent>(entity);
+            const auto& transform = view_registry.get<TransformComponent>(entity);
+            const auto& previous = view_registry.get<PreviousTransformComponent>(entity);
+            const auto& id = view_registry.get<IdComponent>(entity);
+            sum += light.linear * (transform.position.x + previous.position.x) + static_cast<float>(id.uuid & 1);
+        }
+        return sum;
+    }, sink);
+
+    const double light_group = Time([&group_registry]
+    {
+        float sum = 0.0f;
+        group_registry.group<LightComponent>(entt::get<TransformComponent, PreviousTransformComponent, IdComponent>).each(
+            [&sum](const LightComponent& light, const TransformComponent& transform, const PreviousTransformComponent& previous,
+                   const IdComponent& id)
+            {
+                sum += light.linear * (transform.position.x + previous.position.x) + static_cast<float>(id.uuid & 1);
+            });
+        return sum;
+    }, sink);
+
+    DFM_CORE_INFO("{0} entities: renderables {1:.3f} ms as a view, {2:.3f} ms as an owning group ({3:.2f}x); "
+        "lights {4:.3f} ms as a view, {5:.3f} ms as a partial group ({6:.2f}x).", count,
+        renderable_view, renderable_group, renderable_view / renderable_group,
+        light_view, light_group, light_view / light_group);
+}
+
+int main(const int argc, char** argv)
+{
+    Logging::Initialise();
+
+    std::vector<size_t> counts{ 10'000, 100'000, 1'000'000 };
+
+    // Entity counts can be given on the command line in place of the defaults.
+    if (argc > 1)
+    {
+        counts.clear();
+
+        for (int i = 1; i < argc; i++)
+        {
+            counts.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+    }
+
+    float sink = 0.0f;
+
+    for (const size_t count : counts)
+    {
+        Compare(count, sink);
+    }
+
+    // Using the results keeps the passes from being optimised away.
+    DFM_CORE_TRACE("Checksum: {0}.", sink);
+
+    return 0;
+}
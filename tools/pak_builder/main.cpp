@@ -0,0 +1,186 @@
+/**
+ * \file main.cpp
+ * \brief Packs asset directories into a single pak archive, which the virtual file system mounts
+ * in place of the loose files.
+ */
+
+#include "io/pak_archive.h"
+#include "utils/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Describes how the pak builder should pack its inputs.
+ */
+struct BuilderOptions
+{
+    std::string compression = "lz4";
+    std::filesystem::path root = ".";
+};
+
+/**
+ * \brief Prints the command line usage of the pak builder.
+ */
+static void PrintUsage()
+{
+    DFM_CORE_INFO("Usage: pak_builder <output.pak> <input directory>... [options]");
+    DFM_CORE_INFO("  --compression <none|lz4|zstd>  The compression applied to each entry (default: lz4).");
+    DFM_CORE_INFO("  --root <directory>             The directory entry paths are relative to, which should be");
+    DFM_CORE_INFO("                                 the application's working directory (default: .).");
+}
+
+/**
+ * \brief Gets the compression method with the given name.
+ * \param name The name of the compression method.
+ * \param compression The compression method.
+ * \return A boolean value indicating if the name is known and supported by this build.
+ */
+static bool ParseCompression(const std::string& name, PakCompression& compression)
+{
+    if (name == "none")
+    {
+        compression = PakCompression::None;
+    }
+    else if (name == "lz4")
+    {
+        compression = PakCompression::Lz4;
+    }
+    else if (name == "zstd")
+    {
+        compression = PakCompression::Zstd;
+    }
+    else
+    {
+        return false;
+    }
+
+    return PakArchive::IsCompressionSupported(compression);
+}
+
+/**
+ * \brief Reads the entire contents of a file.
+ * \param path The path to the file.
+ * \param contents The buffer to read the contents into.
+ * \return A boolean value indicating if the file was read successfully.
+ */
+static bool ReadFile(const std::filesystem::path& path, std::vector<unsigned char>& contents)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+    return true;
+}
+
+int main(const int argc, char** argv)
+{
+    Logging::Initialise();
+
+    std::vector<std::string> positional;
+    BuilderOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+        {
+            options.compression = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--root") == 0 && i + 1 < argc)
+        {
+            options.root = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            positional.emplace_back(argv[i]);
+        }
+    }
+
+    if (positional.size() < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    PakCompression compression;
+    if (!ParseCompression(options.compression, compression))
+    {
+        DFM_CORE_ERROR("Unknown or unsupported compression '{0}'.", options.compression);
+        return 1;
+    }
+
+    const std::filesystem::path output{ positional[0] };
+    const std::filesystem::path output_path = std::filesystem::absolute(output).lexically_normal();
+    const std::filesystem::path root = std::filesystem::absolute(options.root).lexically_normal();
+
+    std::vector<std::filesystem::path> files;
+    for (size_t i = 1; i < positional.size(); i++)
+    {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator{ positional[i] })
+        {
+            if (!entry.is_regular_file()) continue;
+
+            // Skip the archive itself when it is written into one of the input directories.
+            std::filesystem::path file = std::filesystem::absolute(entry.path()).lexically_normal();
+            if (file != output_path)
+            {
+                files.push_back(std::move(file));
+            }
+        }
+    }
+
+    // Sort so that files from the same directory, which tend to be loaded together, sit next to each other.
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::vector<PakSource> sources;
+    sources.reserve(files.size());
+    size_t total_bytes = 0;
+
+    for (const auto& file : files)
+    {
+        PakSource source;
+        source.path = file.lexically_relative(root).generic_string();
+        source.compression = compression;
+
+        if (source.path.empty() || source.path.rfind("..", 0) == 0)
+        {
+            DFM_CORE_ERROR("'{0}' is outside of the root directory '{1}'.", file.string(), root.string());
+            return 1;
+        }
+
+        if (!ReadFile(file, source.data))
+        {
+            DFM_CORE_ERROR("Failed to read '{0}'.", file.string());
+            return 1;
+        }
+
+        total_bytes += source.data.size();
+        sources.push_back(std::move(source));
+    }
+
+    if (!PakArchive::Write(output.string(), sources))
+    {
+        return 1;
+    }
+
+    DFM_CORE_INFO("Packed {0} files ({1:.1f} KiB) into '{2}' ({3:.1f} KiB).", sources.size(),
+        static_cast<double>(total_bytes) / 1024.0, output.string(),
+        static_cast<double>(std::filesystem::file_size(output)) / 1024.0);
+
+    return 0;
+}
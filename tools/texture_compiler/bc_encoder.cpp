@@ -0,0 +1,593 @@
+/**
+ * \file bc_encoder.cpp
+ */
+
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+constexpr int BLOCK_PIXELS = 16;
+constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/**
+ * \brief Finds the principal axis of a set of points with power iteration on their covariance.
+ * \tparam N The number of components in each point.
+ * \param points The points, \code BLOCK_PIXELS\endcode groups of 4 components.
+ * \param mean The mean of the points.
+ * \param axis The principal axis, normalised, or zero if the points are all equal.
+ */
+template <int N>
+static void FindPrincipalAxis(const float* points, float* mean, float* axis)
+{
+    float covariance[N][N]{};
+
+    for (int c = 0; c < N; c++)
+    {
+        mean[c] = 0.0f;
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            mean[c] += points[i * 4 + c];
+        }
+        mean[c] /= BLOCK_PIXELS;
+    }
+
+    for (int i = 0; i < BLOCK_PIXELS; i++)
+    {
+        for (int a = 0; a < N; a++)
+        {
+            for (int b = 0; b < N; b++)
+            {
+                covariance[a][b] += (points[i * 4 + a] - mean[a]) * (points[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+
+    // Start from the diagonal of the bounding box, which converges quickly for typical blocks.
+    for (int c = 0; c < N; c++)
+    {
+        float minimum = points[c], maximum = points[c];
+        for (int i = 1; i < BLOCK_PIXELS; i++)
+        {
+            minimum = std::min(minimum, points[i * 4 + c]);
+            maximum = std::max(maximum, points[i * 4 + c]);
+        }
+        axis[c] = maximum - minimum;
+    }
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[N]{};
+        float length = 0.0f;
+
+        for (int a = 0; a < N; a++)
+        {
+            for (int b = 0; b < N; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+
+        if (length <= 1e-12f)
+        {
+            break;
+        }
+
+        length = std::sqrt(length);
+        for (int c = 0; c < N; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < N; c++)
+    {
+        length += axis[c] * axis[c];
+    }
+
+    length = std::sqrt(length);
+    for (int c = 0; c < N; c++)
+    {
+        axis[c] = length > 1e-6f ? axis[c] / length : 0.0f;
+    }
+}
+
+/**
+ * \brief Finds the two endpoints of the line through a set of points that bound their projections.
+ * \tparam N The number of components in each point.
+ * \param rgba The RGBA pixels of the block.
+ * \param endpoint0 The endpoint with the largest projection.
+ * \param endpoint1 The endpoint with the smallest projection.
+ */
+template <int N>
+static void FindEndpoints(const unsigned char* rgba, float* endpoint0, float* endpoint1)
+{
+    float points[BLOCK_PIXELS * 4];
+    for (int i = 0; i < BLOCK_PIXELS * 4; i++)
+    {
+        points[i] = rgba[i];
+    }
+
+    float mean[N], axis[N];
+    FindPrincipalAxis<N>(points, mean, axis);
+
+    float minimum = 0.0f, maximum = 0.0f;
+    for (int i = 0; i < BLOCK_PIXELS; i++)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < N; c++)
+        {
+            projection += (points[i * 4 + c] - mean[c]) * axis[c];
+        }
+
+        minimum = std::min(minimum, projection);
+        maximum = std::max(maximum, projection);
+    }
+
+    for (int c = 0; c < N; c++)
+    {
+        endpoint0[c] = std::clamp(mean[c] + axis[c] * maximum, 0.0f, 255.0f);
+        endpoint1[c] = std::clamp(mean[c] + axis[c] * minimum, 0.0f, 255.0f);
+    }
+}
+
+/**
+ * \brief Packs an RGB colour into the 5:6:5 format used by BC1 endpoints.
+ * \param colour The RGB colour.
+ * \return The packed colour.
+ */
+static uint16_t PackRgb565(const float* colour)
+{
+    const auto r = static_cast<uint16_t>(std::lround(colour[0] * 31.0f / 255.0f));
+    const auto g = static_cast<uint16_t>(std::lround(colour[1] * 63.0f / 255.0f));
+    const auto b = static_cast<uint16_t>(std::lround(colour[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+/**
+ * \brief Expands a 5:6:5 packed colour to 8 bits per channel.
+ * \param packed The packed colour.
+ * \param colour The expanded RGB colour.
+ */
+static void UnpackRgb565(const uint16_t packed, int* colour)
+{
+    const int r = packed >> 11 & 0x1F;
+    const int g = packed >> 5 & 0x3F;
+    const int b = packed & 0x1F;
+
+    colour[0] = r << 3 | r >> 2;
+    colour[1] = g << 2 | g >> 4;
+    colour[2] = b << 3 | b >> 2;
+}
+
+/**
+ * \brief Encodes the colour part of a BC1 or BC3 block, always using four-colour mode.
+ * \param rgba The 16 RGBA pixels of the block.
+ * \param output The 8 bytes of the encoded colour block.
+ */
+static void EncodeColourBlock(const unsigned char* rgba, unsigned char* output)
+{
+    float endpoint0[3], endpoint1[3];
+    FindEndpoints<3>(rgba, endpoint0, endpoint1);
+
+    uint16_t colour0 = PackRgb565(endpoint0);
+    uint16_t colour1 = PackRgb565(endpoint1);
+
+    // Four-colour mode requires the first endpoint to be the larger one.
+    if (colour0 < colour1)
+    {
+        std::swap(colour0, colour1);
+    }
+
+    uint32_t indices = 0;
+
+    if (colour0 != colour1)
+    {
+        int palette[4][3];
+        UnpackRgb565(colour0, palette[0]);
+        UnpackRgb565(colour1, palette[1]);
+
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            int best_index = 0, best_error = INT32_MAX;
+
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    const int difference = rgba[i * 4 + c] - palette[p][c];
+                    error += difference * difference;
+                }
+
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+
+            indices |= static_cast<uint32_t>(best_index) << (i * 2);
+        }
+    }
+
+    std::memcpy(output, &colour0, 2);
+    std::memcpy(output + 2, &colour1, 2);
+    std::memcpy(output + 4, &indices, 4);
+}
+
+/**
+ * \brief Encodes a single channel of a 4x4 block as a BC4 block, using eight-value mode.
+ * \param rgba The 16 RGBA pixels of the block.
+ * \param channel The channel to encode.
+ * \param output The 8 bytes of the encoded block.
+ */
+static void EncodeSingleChannelBlock(const unsigned char* rgba, const int channel, unsigned char* output)
+{
+    int maximum = 0, minimum = 255;
+    for (int i = 0; i < BLOCK_PIXELS; i++)
+    {
+        maximum = std::max<int>(maximum, rgba[i * 4 + channel]);
+        minimum = std::min<int>(minimum, rgba[i * 4 + channel]);
+    }
+
+    uint64_t indices = 0;
+
+    if (maximum != minimum)
+    {
+        int palette[8];
+        palette[0] = maximum;
+        palette[1] = minimum;
+        for (int p = 2; p < 8; p++)
+        {
+            palette[p] = ((8 - p) * maximum + (p - 1) * minimum) / 7;
+        }
+
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            int best_index = 0, best_error = INT32_MAX;
+
+            for (int p = 0; p < 8; p++)
+            {
+                const int error = std::abs(rgba[i * 4 + channel] - palette[p]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+
+            indices |= static_cast<uint64_t>(best_index) << (i * 3);
+        }
+    }
+
+    output[0] = static_cast<unsigned char>(maximum);
+    output[1] = static_cast<unsigned char>(minimum);
+    for (int b = 0; b < 6; b++)
+    {
+        output[2 + b] = static_cast<unsigned char>(indices >> (b * 8));
+    }
+}
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC1 block, ignoring alpha.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 8 bytes of the encoded block.
+ */
+void EncodeBc1Block(const unsigned char* rgba, unsigned char* output)
+{
+    EncodeColourBlock(rgba, output);
+}
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC3 block.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc3Block(const unsigned char* rgba, unsigned char* output)
+{
+    EncodeSingleChannelBlock(rgba, 3, output);
+    EncodeColourBlock(rgba, output + 8);
+}
+
+/**
+ * \brief Encodes the red and green channels of a 4x4 block of RGBA pixels as a BC5 block.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc5Block(const unsigned char* rgba, unsigned char* output)
+{
+    EncodeSingleChannelBlock(rgba, 0, output);
+    EncodeSingleChannelBlock(rgba, 1, output + 8);
+}
+
+/**
+ * \brief Writes values into a block, least significant bit first.
+ */
+class BlockBitWriter
+{
+public:
+    explicit BlockBitWriter(unsigned char* output)
+        : m_output{ output }, m_position{ 0 }
+    {
+        std::memset(m_output, 0, 16);
+    }
+
+    /**
+     * \brief Writes the lowest bits of a value.
+     * \param value The value to write.
+     * \param bit_count The number of bits to write.
+     */
+    void Write(const uint32_t value, const int bit_count)
+    {
+        for (int i = 0; i < bit_count; i++, m_position++)
+        {
+            if (value >> i & 1)
+            {
+                m_output[m_position / 8] |= static_cast<unsigned char>(1 << (m_position % 8));
+            }
+        }
+    }
+
+private:
+    unsigned char* m_output;
+    int m_position;
+};
+
+/**
+ * \brief Quantises a BC7 mode 6 endpoint to 7 bits per channel plus a shared p-bit.
+ * \param endpoint The RGBA endpoint.
+ * \param quantised The quantised 7-bit channels.
+ * \return The p-bit that gives the smallest error.
+ */
+static int QuantiseBc7Endpoint(const float* endpoint, int* quantised)
+{
+    int best_p_bit = 0;
+    float best_error = -1.0f;
+
+    for (int p_bit = 0; p_bit < 2; p_bit++)
+    {
+        int candidate[4];
+        float error = 0.0f;
+
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((endpoint[c] - p_bit) / 2.0f)), 0, 127);
+            const float difference = static_cast<float>(candidate[c] << 1 | p_bit) - endpoint[c];
+            error += difference * difference;
+        }
+
+        if (best_error < 0.0f || error < best_error)
+        {
+            best_error = error;
+            best_p_bit = p_bit;
+            std::copy(candidate, candidate + 4, quantised);
+        }
+    }
+
+    return best_p_bit;
+}
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC7 block using mode 6.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc7Block(const unsigned char* rgba, unsigned char* output)
+{
+    // Mode 6 has a single subset with 7.7.7.7 endpoints, per-endpoint p-bits and 4-bit indices.
+    float endpoint0[4], endpoint1[4];
+    FindEndpoints<4>(rgba, endpoint0, endpoint1);
+
+    int quantised0[4], quantised1[4];
+    int p_bit0 = QuantiseBc7Endpoint(endpoint0, quantised0);
+    int p_bit1 = QuantiseBc7Endpoint(endpoint1, quantised1);
+
+    int indices[BLOCK_PIXELS];
+
+    const auto select_indices = [&]
+    {
+        int colour0[4], colour1[4];
+        for (int c = 0; c < 4; c++)
+        {
+            colour0[c] = quantised0[c] << 1 | p_bit0;
+            colour1[c] = quantised1[c] << 1 | p_bit1;
+        }
+
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            int best_index = 0, best_error = INT32_MAX;
+
+            for (int w = 0; w < 16; w++)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    const int value = ((64 - BC7_WEIGHTS[w]) * colour0[c] + BC7_WEIGHTS[w] * colour1[c] + 32) >> 6;
+                    const int difference = rgba[i * 4 + c] - value;
+                    error += difference * difference;
+                }
+
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_index = w;
+                }
+            }
+
+            indices[i] = best_index;
+        }
+    };
+
+    select_indices();
+
+    // The anchor index is stored with an implicit zero high bit, so swap the endpoints if it is set.
+    if (indices[0] & 0x8)
+    {
+        std::swap(quantised0, quantised1);
+        std::swap(p_bit0, p_bit1);
+
+        for (int& index : indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    BlockBitWriter writer{ output };
+    writer.Write(1 << 6, 7);
+
+    for (int c = 0; c < 4; c++)
+    {
+        writer.Write(static_cast<uint32_t>(quantised0[c]), 7);
+        writer.Write(static_cast<uint32_t>(quantised1[c]), 7);
+    }
+
+    writer.Write(static_cast<uint32_t>(p_bit0), 1);
+    writer.Write(static_cast<uint32_t>(p_bit1), 1);
+
+    writer.Write(static_cast<uint32_t>(indices[0]), 3);
+    for (int i = 1; i < BLOCK_PIXELS; i++)
+    {
+        writer.Write(static_cast<uint32_t>(indices[i]), 4);
+    }
+}
+
+/**
+ * \brief Compresses an RGBA image into the given block-compressed format.
+ * \param rgba The RGBA pixels of the image, in row-major order.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param format The block-compressed format to encode to.
+ * \return The encoded blocks.
+ */
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, const int width, const int height, const Ktx2Format format)
+{
+    const int blocks_x = (width + 3) / 4;
+    const int blocks_y = (height + 3) / 4;
+    const unsigned int block_size = GetKtx2BlockSize(format);
+
+    std::vector<unsigned char> output(static_cast<size_t>(blocks_x) * blocks_y * block_size);
+    unsigned char block[BLOCK_PIXELS * 4];
+
+    for (int by = 0; by < blocks_y; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            // Blocks overhanging the edge of the image repeat the last row and column.
+            for (int y = 0; y < 4; y++)
+            {
+                for (int x = 0; x < 4; x++)
+                {
+                    const int source_x = std::min(bx * 4 + x, width - 1);
+                    const int source_y = std::min(by * 4 + y, height - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(source_y) * width + source_x) * 4, 4);
+                }
+            }
+
+            unsigned char* destination = output.data() + (static_cast<size_t>(by) * blocks_x + bx) * block_size;
+
+            switch (format)
+            {
+            case Ktx2Format::Bc1RgbUnorm:
+            case Ktx2Format::Bc1RgbSrgb:
+            case Ktx2Format::Bc1RgbaUnorm:
+            case Ktx2Format::Bc1RgbaSrgb:
+                EncodeBc1Block(block, destination);
+                break;
+            case Ktx2Format::Bc3Unorm:
+            case Ktx2Format::Bc3Srgb:
+                EncodeBc3Block(block, destination);
+                break;
+            case Ktx2Format::Bc5Unorm:
+            case Ktx2Format::Bc5Snorm:
+                EncodeBc5Block(block, destination);
+                break;
+            case Ktx2Format::Bc7Unorm:
+            case Ktx2Format::Bc7Srgb:
+                EncodeBc7Block(block, destination);
+                break;
+            }
+        }
+    }
+
+    return output;
+}
+
+/**
+ * \brief Converts an sRGB encoded channel to linear space.
+ * \param value The sRGB encoded channel.
+ * \return The linear channel, between 0 and 1.
+ */
+static float SrgbToLinear(const unsigned char value)
+{
+    const float channel = value / 255.0f;
+    return channel <= 0.04045f ? channel / 12.92f : std::pow((channel + 0.055f) / 1.055f, 2.4f);
+}
+
+/**
+ * \brief Converts a linear channel to sRGB encoding.
+ * \param value The linear channel, between 0 and 1.
+ * \return The sRGB encoded channel.
+ */
+static unsigned char LinearToSrgb(const float value)
+{
+    const float channel = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<unsigned char>(std::clamp(std::lround(channel * 255.0f), 0l, 255l));
+}
+
+/**
+ * \brief Halves the size of an RGBA image with a box filter.
+ * \param rgba The RGBA pixels of the image, in row-major order.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param srgb Determines if the pixels are sRGB encoded and should be averaged in linear space.
+ * \return The RGBA pixels of the next mip level.
+ */
+std::vector<unsigned char> DownsampleImage(const unsigned char* rgba, const int width, const int height, const bool srgb)
+{
+    const int next_width = std::max(width / 2, 1);
+    const int next_height = std::max(height / 2, 1);
+
+    std::vector<unsigned char> output(static_cast<size_t>(next_width) * next_height * 4);
+
+    for (int y = 0; y < next_height; y++)
+    {
+        for (int x = 0; x < next_width; x++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+
+                for (int sy = 0; sy < 2; sy++)
+                {
+                    for (int sx = 0; sx < 2; sx++)
+                    {
+                        const int source_x = std::min(x * 2 + sx, width - 1);
+                        const int source_y = std::min(y * 2 + sy, height - 1);
+                        const unsigned char value = rgba[(static_cast<size_t>(source_y) * width + source_x) * 4 + c];
+
+                        // Alpha is always linear.
+                        sum += srgb && c < 3 ? SrgbToLinear(value) : value / 255.0f;
+                    }
+                }
+
+                const float average = sum / 4.0f;
+                output[(static_cast<size_t>(y) * next_width + x) * 4 + c] = srgb && c < 3
+                    ? LinearToSrgb(average)
+                    : static_cast<unsigned char>(std::lround(average * 255.0f));
+            }
+        }
+    }
+
+    return output;
+}
@@ -0,0 +1,60 @@
+/**
+ * \file bc_encoder.h
+ */
+
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include "rendering/ktx2.h"
+
+#include <vector>
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC1 block, ignoring alpha.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 8 bytes of the encoded block.
+ */
+void EncodeBc1Block(const unsigned char* rgba, unsigned char* output);
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC3 block.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc3Block(const unsigned char* rgba, unsigned char* output);
+
+/**
+ * \brief Encodes the red and green channels of a 4x4 block of RGBA pixels as a BC5 block.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc5Block(const unsigned char* rgba, unsigned char* output);
+
+/**
+ * \brief Encodes a 4x4 block of RGBA pixels as a BC7 block using mode 6.
+ * \param rgba The 16 RGBA pixels of the block, in row-major order.
+ * \param output The 16 bytes of the encoded block.
+ */
+void EncodeBc7Block(const unsigned char* rgba, unsigned char* output);
+
+/**
+ * \brief Compresses an RGBA image into the given block-compressed format.
+ * \param rgba The RGBA pixels of the image, in row-major order.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param format The block-compressed format to encode to.
+ * \return The encoded blocks.
+ */
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, int width, int height, Ktx2Format format);
+
+/**
+ * \brief Halves the size of an RGBA image with a box filter.
+ * \param rgba The RGBA pixels of the image, in row-major order.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param srgb Determines if the pixels are sRGB encoded and should be averaged in linear space.
+ * \return The RGBA pixels of the next mip level.
+ */
+std::vector<unsigned char> DownsampleImage(const unsigned char* rgba, int width, int height, bool srgb);
+
+#endif // BC_ENCODER_H
@@ -0,0 +1,249 @@
+/**
+ * \file main.cpp
+ * \brief Compresses images into block-compressed KTX2 files with a full mip chain, which the texture
+ * cache loads in place of the source image when they sit next to it.
+ */
+
+#include "bc_encoder.h"
+#include "rendering/image.h"
+#include "rendering/ktx2.h"
+#include "utils/logging.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Describes how the texture compiler should encode its inputs.
+ */
+struct CompilerOptions
+{
+    std::string format = "auto";
+    bool srgb = false;
+    bool flip = false;
+    bool mipmaps = true;
+};
+
+/**
+ * \brief Prints the command line usage of the texture compiler.
+ */
+static void PrintUsage()
+{
+    DFM_CORE_INFO("Usage: texture_compiler <input file|directory> [output.ktx2] [options]");
+    DFM_CORE_INFO("  --format <auto|bc1|bc3|bc5|bc7>  The block-compressed format to encode to (default: auto).");
+    DFM_CORE_INFO("  --srgb                           Store colour data as sRGB.");
+    DFM_CORE_INFO("  --flip                           Flip the image vertically, matching textures loaded with flipping.");
+    DFM_CORE_INFO("  --no-mips                        Only store the base level.");
+}
+
+/**
+ * \brief Determines whether the given path has an image extension that can be compiled.
+ * \param path The path to check.
+ * \return A boolean value indicating if the path refers to a source image.
+ */
+static bool IsSourceImage(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+        extension == ".tga" || extension == ".bmp" || extension == ".psd";
+}
+
+/**
+ * \brief Chooses the block-compressed format for an image.
+ * \param path The path to the source image.
+ * \param image The decoded source image.
+ * \param options The compiler options.
+ * \param format The chosen format.
+ * \return A boolean value indicating if the requested format is known.
+ */
+static bool ChooseFormat(const std::filesystem::path& path, const Image& image, const CompilerOptions& options,
+                         Ktx2Format& format)
+{
+    std::string name = options.format;
+
+    if (name == "auto")
+    {
+        std::string filename = path.filename().string();
+        std::transform(filename.begin(), filename.end(), filename.begin(),
+            [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        // Normal maps only need two channels, and suffer badly from BC1's shared colour line.
+        if (filename.find("normal") != std::string::npos)
+        {
+            name = "bc5";
+        }
+        else
+        {
+            name = image.GetChannels() == 2 || image.GetChannels() == 4 ? "bc3" : "bc1";
+        }
+    }
+
+    if (name == "bc1")
+    {
+        format = options.srgb ? Ktx2Format::Bc1RgbSrgb : Ktx2Format::Bc1RgbUnorm;
+    }
+    else if (name == "bc3")
+    {
+        format = options.srgb ? Ktx2Format::Bc3Srgb : Ktx2Format::Bc3Unorm;
+    }
+    else if (name == "bc5")
+    {
+        format = Ktx2Format::Bc5Unorm;
+    }
+    else if (name == "bc7")
+    {
+        format = options.srgb ? Ktx2Format::Bc7Srgb : Ktx2Format::Bc7Unorm;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Compresses a single image into a KTX2 file.
+ * \param input The path to the source image.
+ * \param output The path of the KTX2 file to write.
+ * \param options The compiler options.
+ * \return A boolean value indicating if the image was compiled successfully.
+ */
+static bool CompileTexture(const std::filesystem::path& input, const std::filesystem::path& output,
+                           const CompilerOptions& options)
+{
+    Image image;
+    if (!image.Load(input.string(), 0, options.flip))
+    {
+        DFM_CORE_ERROR("Failure to load image: '{0}'.", input.string());
+        return false;
+    }
+
+    Ktx2Format format;
+    if (!ChooseFormat(input, image, options, format))
+    {
+        DFM_CORE_ERROR("Unknown texture format '{0}'.", options.format);
+        return false;
+    }
+
+    // Reload as RGBA so the encoders only have to deal with a single pixel layout.
+    Image rgba;
+    rgba.Load(input.string(), 4, options.flip);
+
+    int width = rgba.GetWidth();
+    int height = rgba.GetHeight();
+    std::vector<unsigned char> pixels(rgba.GetData(), rgba.GetData() + static_cast<size_t>(width) * height * 4);
+
+    const bool srgb_filtering = options.srgb && format != Ktx2Format::Bc5Unorm;
+
+    std::vector<std::vector<unsigned char>> levels;
+    while (true)
+    {
+        levels.push_back(CompressImage(pixels.data(), width, height, format));
+
+        if (!options.mipmaps || (width == 1 && height == 1)) break;
+
+        pixels = DownsampleImage(pixels.data(), width, height, srgb_filtering);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    if (!Ktx2Texture::Write(output.string(), format, static_cast<uint32_t>(rgba.GetWidth()),
+                            static_cast<uint32_t>(rgba.GetHeight()), levels, options.flip))
+    {
+        DFM_CORE_ERROR("Failure to write compressed texture: '{0}'.", output.string());
+        return false;
+    }
+
+    size_t compressed_bytes = 0;
+    for (const auto& level : levels)
+    {
+        compressed_bytes += level.size();
+    }
+
+    DFM_CORE_INFO("Compressed '{0}' ({1}x{2}, {3} levels, {4:.1f} KiB).", input.string(), rgba.GetWidth(),
+        rgba.GetHeight(), levels.size(), static_cast<double>(compressed_bytes) / 1024.0);
+
+    return true;
+}
+
+int main(const int argc, char** argv)
+{
+    Logging::Initialise();
+
+    std::vector<std::string> positional;
+    CompilerOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            options.format = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--srgb") == 0)
+        {
+            options.srgb = true;
+        }
+        else if (std::strcmp(argv[i], "--flip") == 0)
+        {
+            options.flip = true;
+        }
+        else if (std::strcmp(argv[i], "--no-mips") == 0)
+        {
+            options.mipmaps = false;
+        }
+        else if (argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            positional.emplace_back(argv[i]);
+        }
+    }
+
+    if (positional.empty() || positional.size() > 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::filesystem::path input{ positional[0] };
+
+    if (!std::filesystem::is_directory(input))
+    {
+        std::filesystem::path output{ input };
+        output.replace_extension(".ktx2");
+
+        if (positional.size() == 2)
+        {
+            output = positional[1];
+        }
+
+        return CompileTexture(input, output, options) ? 0 : 1;
+    }
+
+    // Compile every image in the directory next to its source, as that is where the texture cache looks.
+    int failures = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator{ input })
+    {
+        if (!entry.is_regular_file() || !IsSourceImage(entry.path())) continue;
+
+        std::filesystem::path output{ entry.path() };
+        output.replace_extension(".ktx2");
+
+        if (!CompileTexture(entry.path(), output, options))
+        {
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}